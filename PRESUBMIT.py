@@ -84,6 +84,7 @@ def CheckChange(input, output):
   results += RunAndReportIfLong(CheckBadCppPatterns, input, output)
   results += RunAndReportIfLong(CheckSqlModules, input, output)
   results += RunAndReportIfLong(CheckSqlMetrics, input, output)
+  results += RunAndReportIfLong(CheckTraceStorageTables, input, output)
   results += RunAndReportIfLong(CheckTestData, input, output)
   results += RunAndReportIfLong(CheckAmalgamatedPythonTools, input, output)
   results += RunAndReportIfLong(CheckChromeStdlib, input, output)
@@ -393,6 +394,27 @@ def CheckSqlMetrics(input_api, output_api):
   return []
 
 
+def CheckTraceStorageTables(input_api, output_api):
+  # The script invocation doesn't work on Windows.
+  if input_api.is_windows:
+    return []
+
+  tool = 'tools/check_trace_storage_tables.py'
+
+  def file_filter(x):
+    return input_api.FilterSourceFile(
+        x,
+        files_to_check=[
+            'src/trace_processor/storage/trace_storage[.](h|cc)$', tool
+        ])
+
+  if not input_api.AffectedSourceFiles(file_filter):
+    return []
+  if subprocess.call([tool]):
+    return [output_api.PresubmitError(tool + ' failed')]
+  return []
+
+
 def CheckTestData(input_api, output_api):
   # The script invocation doesn't work on Windows.
   if input_api.is_windows:
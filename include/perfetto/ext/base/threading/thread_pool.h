@@ -57,6 +57,11 @@ class ThreadPool {
   // This task should not block for IO as this can cause starvation.
   void PostTask(std::function<void()>);
 
+  // Returns the number of threads in this thread pool.
+  uint32_t thread_count() const {
+    return static_cast<uint32_t>(threads_.size());
+  }
+
  private:
   void RunThreadLoop();
 
@@ -54,7 +54,16 @@ class IteratorImpl;
 class QueryResultSerializer {
  public:
   static constexpr uint32_t kDefaultBatchSplitThreshold = 128 * 1024;
-  explicit QueryResultSerializer(Iterator);
+
+  // The encoding of the batches (see QueryArgs.ResultFormat).
+  enum class Format {
+    // Row by row, in QueryResult.batch.
+    kCells,
+    // Column by column, in QueryResult.columnar_batch.
+    kColumnar,
+  };
+
+  explicit QueryResultSerializer(Iterator, Format = Format::kCells);
   ~QueryResultSerializer();
 
   // No copy or move.
@@ -78,10 +87,12 @@ class QueryResultSerializer {
  private:
   void SerializeMetadata(protos::pbzero::QueryResult*);
   void SerializeBatch(protos::pbzero::QueryResult*);
+  void SerializeColumnarBatch(protos::pbzero::QueryResult*);
   void MaybeSerializeError(protos::pbzero::QueryResult*);
 
   std::unique_ptr<IteratorImpl> iter_;
   const uint32_t num_cols_;
+  const Format format_;
   bool did_write_metadata_ = false;
   bool eof_reached_ = false;
   uint32_t col_ = UINT32_MAX;
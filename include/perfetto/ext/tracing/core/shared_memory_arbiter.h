@@ -18,6 +18,7 @@
 #define INCLUDE_PERFETTO_EXT_TRACING_CORE_SHARED_MEMORY_ARBITER_H_
 
 #include <stddef.h>
+#include <stdint.h>
 
 #include <functional>
 #include <memory>
@@ -158,6 +159,25 @@ class PERFETTO_EXPORT_COMPONENT SharedMemoryArbiter {
   // and this method should always be called.
   virtual void SetDirectSMBPatchingSupportedByService() = 0;
 
+  // Splits the pages of the shared memory buffer into contiguous partitions,
+  // one for each NUMA node of the host, and makes the trace writers prefer the
+  // chunks of the partition of the CPU they are running on. This way, the page
+  // headers of each partition are mostly written from the CPUs of one node.
+  // Writers still fall back to the other partitions when theirs is full.
+  //
+  // |partition_for_cpu| overrides the NUMA topology: the i-th entry is the
+  // partition of CPU i (e.g. to have one partition per group of CPUs sharing a
+  // cache). The partitioning doesn't change the layout of the pages, so the
+  // service is unaffected.
+  //
+  // Returns false, leaving the buffer unpartitioned, if this isn't supported
+  // on the platform or by the implementation, there are less than 2
+  // partitions, more partitions than pages or if it was already enabled.
+  virtual bool EnableCpuLocalPages(
+      std::vector<uint32_t> /*partition_for_cpu*/ = {}) {
+    return false;
+  }
+
   // Forces an immediate commit of the completed packets, without waiting for
   // the next task or for a batching period to end. Should only be called while
   // bound.
@@ -285,8 +285,20 @@ struct PERFETTO_EXPORT_COMPONENT TracingServiceInitOpts {
   using CompressorFn = void (*)(std::vector<TracePacket>*);
   CompressorFn compressor_fn = nullptr;
 
+  // If > 0 (and |compressor_fn| is set), the chunks of compressed traces
+  // written into files are compressed concurrently by this many worker threads
+  // (plus the service thread), rather than one after the other on the service
+  // thread. |compressor_fn| must be thread-safe in this case.
+  uint32_t compression_thread_count = 0;
+
   // Whether the relay endpoint is enabled on producer transport(s).
   bool enable_relay_endpoint = false;
+
+  // If > 0, the buffers of a tracing session are read concurrently by this
+  // many worker threads (plus the service thread) when the trace is read
+  // back, rather than one after the other on the service thread. This
+  // reduces the latency of reading back traces with many buffers.
+  uint32_t read_buffers_thread_count = 0;
 };
 
 // The API for the Relay port of the Service. Subclassed by the
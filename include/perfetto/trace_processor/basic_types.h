@@ -184,6 +184,57 @@ struct PERFETTO_EXPORT_COMPONENT Config {
   // When set to true, trace processor will perform additional runtime checks
   // to catch additional classes of SQL errors.
   bool enable_extra_checks = false;
+
+  // The number of worker threads trace processor can use to parallelize
+  // CPU-bound stages of trace ingestion (e.g. decompressing the
+  // CompressedPackets of proto traces). Even when this is set, all importer
+  // state is only ever touched on the thread calling Parse() so the resulting
+  // tables are identical to a single-threaded import.
+  //
+  // 0 (the default) disables the worker threads entirely. This option is
+  // ignored in WASM builds.
+  uint32_t ingestion_thread_count = 0;
+
+  // The number of worker threads trace processor can use to parallelize the
+  // execution of a single query. Currently, this splits filters over large
+  // tables (e.g. sched or slice) into chunks which are searched concurrently.
+  //
+  // 0 (the default) disables the worker threads entirely. This option is
+  // ignored in WASM builds.
+  uint32_t query_thread_count = 0;
+
+  // When set to true, the bytes of the packets trace processor buffers while
+  // sorting are copied out of the trace and compressed in memory until they
+  // are parsed. This significantly reduces the peak memory usage for traces
+  // which require a lot of buffering to sort (e.g. ring buffer traces) at the
+  // cost of slower trace loading.
+  //
+  // This option is ignored if trace processor was built without zlib.
+  bool compress_sorter_buffer = false;
+
+  // The maximum number of bytes trace processor can use to cache the results
+  // of read-only queries passed to |TraceProcessor::ExecuteQuery|. Repeated
+  // executions of the same query are then answered from the cache until the
+  // trace or any table, view or function is changed.
+  //
+  // Queries which use non-deterministic functions or read the |stats| or
+  // |sql_stats| tables are never cached. The |cache_hits| and |cache_misses|
+  // columns of the |sql_stats| table can be used to check how effective the
+  // cache is.
+  //
+  // 0 (the default) disables the cache entirely.
+  uint64_t query_cache_size_bytes = 0;
+
+  // When set to true, the tables and views defined by PerfettoSQL modules
+  // (e.g. the standard library) are not computed when the module is included
+  // but only when a query first references them. This makes including large
+  // modules much faster when only a few of their tables are used.
+  //
+  // As a consequence, errors in the definition of a table are only reported
+  // when the table is used, tables which are never used are not listed in
+  // |sqlite_master| and tables are computed on the data parsed so far when
+  // they are first used rather than when they are included.
+  bool lazy_module_tables = false;
 };
 
 // Represents a dynamically typed value returned by SQL.
@@ -283,6 +334,55 @@ struct SqlPackage {
   bool allow_override = false;
 };
 
+// Data used to register an incremental query: an aggregation over a trace
+// table whose result is kept up to date as more of the trace is parsed without
+// re-running the aggregation over the whole table.
+//
+// The result is stored in a table called |name| with the same contents as:
+//   SELECT <group_by>, <function>(<expr>) AS <aggregate name>, ...
+//   FROM <table>
+//   WHERE <filter>
+//   GROUP BY <group_by>
+struct IncrementalQuery {
+  enum class Function {
+    kCount,
+    kSum,
+    kMin,
+    kMax,
+  };
+  struct Aggregate {
+    Function function = Function::kCount;
+
+    // SQL expression, over the columns of |table|, being aggregated. Can be
+    // empty for |kCount| to count all the rows.
+    std::string expr;
+
+    // Name of the column of the result holding this aggregate.
+    std::string name;
+  };
+
+  // Name of the table holding the result. Must not be the name of any other
+  // table or view.
+  std::string name;
+
+  // Name of the table (or view) being aggregated. Rows of this table are only
+  // aggregated once: it must have an |id| column which increases as rows are
+  // appended (as all the trace tables do) and changes to rows which were
+  // already aggregated (e.g. setting the duration of a slice once it ends) are
+  // not reflected in the result.
+  std::string table;
+
+  // Optional SQL expression used to filter the rows of |table| being
+  // aggregated.
+  std::string filter;
+
+  // Names of the columns of |table| to group the rows by. If empty, the result
+  // has a single row aggregating all the rows.
+  std::vector<std::string> group_by;
+
+  std::vector<Aggregate> aggregates;
+};
+
 // Deprecated. Use only with |trace_processor->RegisterSqlModule()|. Alias of
 // |SqlPackage|.
 struct SqlModule {
@@ -81,6 +81,17 @@ class PERFETTO_EXPORT_COMPONENT TraceProcessor : public TraceProcessorStorage {
       size_t size,
       const std::vector<std::string>& skip_prefixes) = 0;
 
+  // Registers an incremental query (see |IncrementalQuery|) and creates the
+  // table holding its result over the loaded portion of the trace.
+  //
+  // Every subsequent call to Flush() (and NotifyEndOfFile()) only aggregates
+  // the rows appended to the table since the previous call and merges them
+  // into the result. This makes polling aggregations cheap while a trace is
+  // being streamed in chunks.
+  //
+  // Incremental queries are removed by RestoreInitialTables().
+  virtual base::Status RegisterIncrementalQuery(IncrementalQuery) = 0;
+
   // Computes the given metrics on the loded portion of the trace. If
   // successful, the output argument |metrics_proto| will be filled with the
   // proto-encoded bytes for the message TraceMetrics in
@@ -119,6 +130,35 @@ class PERFETTO_EXPORT_COMPONENT TraceProcessor : public TraceProcessorStorage {
   virtual std::string GetCurrentTraceName() = 0;
   virtual void SetCurrentTraceName(const std::string&) = 0;
 
+  // Writes a snapshot of the fully ingested trace to the file at |path|.
+  // Loading the snapshot with |LoadSnapshot| is much faster than parsing the
+  // trace again. Can only be called after NotifyEndOfFile().
+  //
+  // Only the data imported from the trace is part of the snapshot: tables,
+  // views and functions created through SQL are not saved. Snapshots are an
+  // implementation detail of trace processor and can only be loaded by the
+  // same version of trace processor which wrote them.
+  virtual base::Status SaveSnapshot(const std::string& path) = 0;
+
+  // Loads a snapshot written by |SaveSnapshot| from the file at |path|. This
+  // replaces the Parse()/NotifyEndOfFile() sequence and so can only be called
+  // on an instance which has not parsed any data.
+  virtual base::Status LoadSnapshot(const std::string& path) = 0;
+
+  // Writes the contents of each of the tables in |table_names| (or of all the
+  // tables in the perfetto_tables table if it is empty) to a file named
+  // "<table name>.pfcol" in the directory |output_dir|, which is created if
+  // needed. The values are read directly from the columns of the tables
+  // (rather than through SQL queries) and written as typed, compressed
+  // columns. Views can't be exported this way.
+  //
+  // Unlike snapshots, the format is stable and documented (see
+  // src/trace_processor/db/table_columnar_export.h) so that the files can be
+  // loaded into other systems.
+  virtual base::Status ExportColumnar(
+      const std::string& output_dir,
+      const std::vector<std::string>& table_names) = 0;
+
   // Enables "meta-tracing" of trace processor.
   // Metatracing involves tracing trace processor itself to root-cause
   // performace issues in trace processor. See |DisableAndReadMetatrace| for
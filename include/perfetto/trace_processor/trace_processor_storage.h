@@ -59,6 +59,17 @@ class PERFETTO_EXPORT_COMPONENT TraceProcessorStorage {
   // Calls Flush and finishes all of the actions required for parsing the trace.
   // Calling this function multiple times is undefined behaviour.
   virtual base::Status NotifyEndOfFile() = 0;
+
+  // Finishes parsing the trace pushed so far (as NotifyEndOfFile() would) and
+  // prepares for a new, unrelated, trace to be pushed with the following
+  // Parse() calls. This allows loading many traces in the same instance, e.g.
+  // to aggregate data across all of them with a single query. The traces
+  // share the tables (and interned strings). The rows of the process, thread,
+  // cpu and track tables have a |trace_id| column pointing to the trace_file
+  // table, set once their trace is finished, to tell the traces apart.
+  // Does nothing if no data was pushed since the start of the current trace.
+  // NotifyEndOfFile() should still be called after the last trace.
+  virtual base::Status StartNewTrace() = 0;
 };
 
 }  // namespace perfetto::trace_processor
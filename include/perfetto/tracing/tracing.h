@@ -113,6 +113,12 @@ struct TracingInitArgs {
   // if the service supports direct patching, otherwise it will be ignored.
   bool shmem_direct_patching_enabled = false;
 
+  // [Optional] Makes trace writers prefer the pages of the shared memory buffer
+  // assigned to the NUMA node of the CPU they run on, reducing the cross-node
+  // cache traffic on multi-socket hosts. Has no effect on hosts with a single
+  // NUMA node. See SharedMemoryArbiter::EnableCpuLocalPages().
+  bool shmem_numa_aware_pages = false;
+
   // [Optional] If set, the policy object is notified when certain SDK events
   // occur and may apply policy decisions, such as denying connections. The
   // embedder is responsible for ensuring the object remains alive for the
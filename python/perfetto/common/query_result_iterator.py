@@ -12,9 +12,79 @@
 # See the License for the specific language governing permissions and
 # limitations under the License.
 
+import dataclasses as dc
+from typing import List
+
 from perfetto.common.exceptions import PerfettoException
 
 
+# Has the same fields as the CellsBatch proto. See
+# cells_batch_from_columnar_batch.
+@dc.dataclass
+class _CellsBatch:
+  cells: List[int]
+  varint_cells: List[int]
+  float64_cells: List[float]
+  blob_cells: List[bytes]
+  string_cells: str
+  is_last_batch: bool
+
+
+# Converts a ColumnarBatch proto (returned when QueryArgs.result_format is
+# RESULT_FORMAT_COLUMNAR) to the row by row layout of the CellsBatch proto so
+# it can be passed to QueryResultIterator.
+def cells_batch_from_columnar_batch(batch):
+  # See the comment about non UTF-8 characters in QueryResultIterator.
+  strings_str = batch.string_dictionary
+  try:
+    strings_str = strings_str.decode('utf-8', 'ignore')
+  except AttributeError:
+    pass
+  strings = strings_str.split('\0')[:-1]
+
+  columns = []
+  for column in batch.columns:
+    if column.cell_types:
+      cell_types = list(column.cell_types)
+    else:
+      cell_types = [column.type] * batch.row_count
+    if len(cell_types) != batch.row_count:
+      raise PerfettoException("Column has " + str(len(cell_types)) +
+                              " cells, expected " + str(batch.row_count))
+    values = {
+        QueryResultIterator.QUERY_CELL_VARINT_FIELD_ID:
+            iter(column.int64_values),
+        QueryResultIterator.QUERY_CELL_FLOAT64_FIELD_ID:
+            iter(column.float64_values),
+        QueryResultIterator.QUERY_CELL_STRING_FIELD_ID:
+            (strings[i] for i in column.string_ids),
+        QueryResultIterator.QUERY_CELL_BLOB_FIELD_ID:
+            iter(column.blob_values),
+    }
+    columns.append((cell_types, values))
+
+  res = _CellsBatch([], [], [], [], '', batch.is_last_batch)
+  cells_by_type = {
+      QueryResultIterator.QUERY_CELL_VARINT_FIELD_ID: res.varint_cells,
+      QueryResultIterator.QUERY_CELL_FLOAT64_FIELD_ID: res.float64_cells,
+      QueryResultIterator.QUERY_CELL_BLOB_FIELD_ID: res.blob_cells,
+  }
+  row_strings = []
+  try:
+    for row in range(batch.row_count):
+      for cell_types, values in columns:
+        cell_type = cell_types[row]
+        res.cells.append(cell_type)
+        if cell_type == QueryResultIterator.QUERY_CELL_STRING_FIELD_ID:
+          row_strings.append(next(values[cell_type]))
+        elif cell_type in cells_by_type:
+          cells_by_type[cell_type].append(next(values[cell_type]))
+  except (StopIteration, IndexError):
+    raise PerfettoException("Column has fewer values than cells")
+  res.string_cells = ''.join(s + '\0' for s in row_strings)
+  return res
+
+
 # Provides a Python interface to operate on the contents of QueryResult protos
 class QueryResultIterator:
   # Values of these constants correspond to the QueryResponse message at
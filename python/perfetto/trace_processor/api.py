@@ -18,6 +18,8 @@ from typing import List, Optional
 
 from perfetto.common.exceptions import PerfettoException
 from perfetto.common.query_result_iterator import QueryResultIterator
+from perfetto.common.query_result_iterator import (
+    cells_batch_from_columnar_batch)
 from perfetto.trace_processor.http import TraceProcessorHttp
 from perfetto.trace_processor.platform import PlatformDelegate
 from perfetto.trace_processor.protos import ProtoFactory
@@ -48,6 +50,7 @@ class TraceProcessorConfig:
   resolver_registry: Optional[ResolverRegistry]
   load_timeout: int
   extra_flags: Optional[List[str]]
+  columnar_query_results: bool
 
   def __init__(self,
                bin_path: Optional[str] = None,
@@ -57,7 +60,8 @@ class TraceProcessorConfig:
                enable_dev_features=False,
                resolver_registry: Optional[ResolverRegistry] = None,
                load_timeout: int = 2,
-               extra_flags: Optional[List[str]] = None):
+               extra_flags: Optional[List[str]] = None,
+               columnar_query_results: bool = False):
     self.bin_path = bin_path
     self.unique_port = unique_port
     self.verbose = verbose
@@ -66,6 +70,7 @@ class TraceProcessorConfig:
     self.resolver_registry = resolver_registry
     self.load_timeout = load_timeout
     self.extra_flags = extra_flags
+    self.columnar_query_results = columnar_query_results
 
 
 class TraceProcessor:
@@ -140,12 +145,18 @@ class TraceProcessor:
       can also be converted to a pandas dataframe by calling the
       as_pandas_dataframe() function after calling query.
     """
-    response = self.http.execute_query(sql)
+    response = self.http.execute_query(
+        sql, columnar=self.config.columnar_query_results)
     if response.error:
       raise TraceProcessorException(response.error)
 
-    return TraceProcessor.QueryResultIterator(response.column_names,
-                                              response.batch)
+    if response.columnar_batch:
+      batches = [
+          cells_batch_from_columnar_batch(b) for b in response.columnar_batch
+      ]
+    else:
+      batches = response.batch
+    return TraceProcessor.QueryResultIterator(response.column_names, batches)
 
   def metric(self, metrics: List[str]):
     """Returns the metrics data corresponding to the passed in trace metric.
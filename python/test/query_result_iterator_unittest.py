@@ -16,6 +16,8 @@ import unittest
 
 from perfetto.common.exceptions import PerfettoException
 from perfetto.common.query_result_iterator import QueryResultIterator
+from perfetto.common.query_result_iterator import (
+    cells_batch_from_columnar_batch)
 from perfetto.trace_processor.api import PLATFORM_DELEGATE
 from perfetto.trace_processor.protos import ProtoFactory
 
@@ -26,6 +28,7 @@ class TestQueryResultIterator(unittest.TestCase):
   # defined under trace_processor.proto
   CELL_VARINT = PROTO_FACTORY.CellsBatch().CELL_VARINT
   CELL_STRING = PROTO_FACTORY.CellsBatch().CELL_STRING
+  CELL_FLOAT64 = PROTO_FACTORY.CellsBatch().CELL_FLOAT64
   CELL_INVALID = PROTO_FACTORY.CellsBatch().CELL_INVALID
   CELL_NULL = PROTO_FACTORY.CellsBatch().CELL_NULL
 
@@ -342,3 +345,78 @@ class TestQueryResultIterator(unittest.TestCase):
     # so we should raise a PerfettoException.
     with self.assertRaises(PerfettoException):
       _ = qr_iterator.as_pandas_dataframe()
+
+  def test_columnar_batch(self):
+    batch = PROTO_FACTORY.ColumnarBatch()
+    batch.row_count = 3
+    batch.is_last_batch = True
+
+    ids = batch.columns.add()
+    ids.type = TestQueryResultIterator.CELL_VARINT
+    ids.int64_values.extend([1, 2, 3])
+
+    names = batch.columns.add()
+    names.cell_types.extend([
+        TestQueryResultIterator.CELL_STRING,
+        TestQueryResultIterator.CELL_NULL,
+        TestQueryResultIterator.CELL_STRING,
+    ])
+    names.string_ids.extend([1, 1])
+
+    values = batch.columns.add()
+    values.cell_types.extend([
+        TestQueryResultIterator.CELL_FLOAT64,
+        TestQueryResultIterator.CELL_STRING,
+        TestQueryResultIterator.CELL_VARINT,
+    ])
+    values.float64_values.extend([0.5])
+    values.string_ids.extend([0])
+    values.int64_values.extend([7])
+
+    batch.string_dictionary = "foo\0bar\0"
+
+    qr_iterator = QueryResultIterator(
+        ['id', 'name', 'value'], [cells_batch_from_columnar_batch(batch)])
+    rows = [(row.id, row.name, row.value) for row in qr_iterator]
+    self.assertEqual(rows, [(1, 'bar', 0.5), (2, None, 'foo'), (3, 'bar', 7)])
+
+  def test_columnar_batches_as_pandas(self):
+    batches = []
+    for values, is_last_batch in [([100, 200], False), ([300], True)]:
+      batch = PROTO_FACTORY.ColumnarBatch()
+      batch.row_count = len(values)
+      batch.is_last_batch = is_last_batch
+      column = batch.columns.add()
+      column.type = TestQueryResultIterator.CELL_VARINT
+      column.int64_values.extend(values)
+      column = batch.columns.add()
+      column.type = TestQueryResultIterator.CELL_STRING
+      column.string_ids.extend([0] * len(values))
+      batch.string_dictionary = "foo\0"
+      batches.append(cells_batch_from_columnar_batch(batch))
+
+    qr_df = QueryResultIterator(['num', 'name'], batches).as_pandas_dataframe()
+    self.assertEqual(list(qr_df['num']), [100, 200, 300])
+    self.assertEqual(list(qr_df['name']), ['foo', 'foo', 'foo'])
+
+  def test_empty_columnar_batch(self):
+    batch = PROTO_FACTORY.ColumnarBatch()
+    batch.columns.add()
+    batch.is_last_batch = True
+
+    qr_iterator = QueryResultIterator(['foo'],
+                                      [cells_batch_from_columnar_batch(batch)])
+    self.assertEqual(len(list(qr_iterator)), 0)
+
+  def test_incorrect_columnar_batch(self):
+    batch = PROTO_FACTORY.ColumnarBatch()
+    batch.row_count = 2
+    batch.is_last_batch = True
+    column = batch.columns.add()
+    column.type = TestQueryResultIterator.CELL_VARINT
+    column.int64_values.extend([1])
+
+    # The column claims two integer cells but only has one value so we
+    # should raise a PerfettoException.
+    with self.assertRaises(PerfettoException):
+      _ = cells_batch_from_columnar_batch(batch)
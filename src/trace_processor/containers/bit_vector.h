@@ -83,6 +83,44 @@ class BitVector {
       global_bit_offset_ += BitWord::kBits;
     }
 
+    // Appends the bits of |bv| between the current end of the builder and
+    // |end|, i.e. the bit at index i of the built BitVector will be the same
+    // as the bit at index i of |bv|. This allows for efficiently concatenating
+    // BitVectors which each cover a disjoint part of the index space.
+    void AppendBitsFrom(const BitVector& bv, uint32_t end) {
+      PERFETTO_DCHECK(end <= bv.size());
+      PERFETTO_DCHECK(end <= size_);
+      while (global_bit_offset_ < end &&
+             global_bit_offset_ % BitWord::kBits != 0) {
+        Append(bv.IsSet(global_bit_offset_));
+      }
+      uint32_t word_end = WordFloor(end) * BitWord::kBits;
+      while (global_bit_offset_ < word_end) {
+        AppendWord(bv.words_[WordFloor(global_bit_offset_)]);
+      }
+      while (global_bit_offset_ < end) {
+        Append(bv.IsSet(global_bit_offset_));
+      }
+    }
+
+    // Appends |count| bits, all set to |value|.
+    void AppendRepeated(bool value, uint32_t count) {
+      PERFETTO_DCHECK(count <= BitsUntilFull());
+      uint32_t end = global_bit_offset_ + count;
+      while (global_bit_offset_ < end &&
+             global_bit_offset_ % BitWord::kBits != 0) {
+        Append(value);
+      }
+      uint32_t word_end = WordFloor(end) * BitWord::kBits;
+      uint64_t word = value ? ~uint64_t{0} : 0;
+      while (global_bit_offset_ < word_end) {
+        AppendWord(word);
+      }
+      while (global_bit_offset_ < end) {
+        Append(value);
+      }
+    }
+
     // Creates a BitVector from this Builder.
     BitVector Build() && {
       if (size_ == 0)
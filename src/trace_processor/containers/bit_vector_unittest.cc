@@ -569,6 +569,46 @@ TEST(BitVectorUnittest, Builder) {
   ASSERT_FALSE(bv.IsSet(2));
 }
 
+TEST(BitVectorUnittest, BuilderAppendBitsFrom) {
+  BitVector first(1000);
+  BitVector second(1000);
+  for (uint32_t i = 0; i < 1000; i += 3) {
+    first.Set(i);
+    second.Set(i + 1);
+  }
+
+  // Start and end away from word boundaries to exercise all the paths.
+  BitVector::Builder builder(1000, 7);
+  builder.AppendBitsFrom(first, 500);
+  builder.AppendBitsFrom(second, 990);
+  builder.AppendRepeated(true, 5);
+  builder.AppendRepeated(false, 5);
+  BitVector bv = std::move(builder).Build();
+
+  ASSERT_EQ(bv.size(), 1000u);
+  for (uint32_t i = 0; i < 1000; ++i) {
+    bool expected = i < 7      ? false
+                    : i < 500  ? first.IsSet(i)
+                    : i < 990  ? second.IsSet(i)
+                    : i < 995;
+    ASSERT_EQ(bv.IsSet(i), expected) << i;
+  }
+  ASSERT_EQ(bv.CountSetBits(), bv.GetSetBitIndices().size());
+}
+
+TEST(BitVectorUnittest, BuilderAppendRepeatedWords) {
+  BitVector::Builder builder(300, 3);
+  builder.AppendRepeated(true, 200);
+  builder.AppendRepeated(false, 97);
+  BitVector bv = std::move(builder).Build();
+
+  ASSERT_EQ(bv.CountSetBits(), 200u);
+  ASSERT_FALSE(bv.IsSet(2));
+  ASSERT_TRUE(bv.IsSet(3));
+  ASSERT_TRUE(bv.IsSet(202));
+  ASSERT_FALSE(bv.IsSet(203));
+}
+
 TEST(BitVectorUnittest, BuilderCountSetBits) {
   // 16 words and 1 bit
   BitVector::Builder builder(1025);
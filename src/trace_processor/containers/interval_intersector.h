@@ -79,14 +79,14 @@ class IntervalIntersector {
       return;
     }
 
-    // Find the first interval that ends after |s|.
-    auto overlap =
-        std::lower_bound(intervals_.begin(), intervals_.end(), s,
-                         [](const Interval& interval, uint64_t start) {
-                           return interval.end <= start;
-                         });
-
     if (mode_ == kBinarySearch) {
+      // Find the first interval that ends after |s|. As the intervals are non
+      // overlapping, their ends are sorted too.
+      auto overlap =
+          std::lower_bound(intervals_.begin(), intervals_.end(), s,
+                           [](const Interval& interval, uint64_t start) {
+                             return interval.end <= start;
+                           });
       for (; overlap != intervals_.end() && overlap->start < e; ++overlap) {
         UpdateResultVector(s, e, *overlap, res);
       }
@@ -95,6 +95,9 @@ class IntervalIntersector {
 
     PERFETTO_CHECK(mode_ == kLinearScan);
 
+    // The ends of overlapping intervals are not sorted (an interval can end
+    // after the ones starting after it) so they can't be binary searched.
+    auto overlap = intervals_.begin();
     for (; overlap != intervals_.end() && overlap->start < e; ++overlap) {
       if (overlap->end <= s) {
         continue;
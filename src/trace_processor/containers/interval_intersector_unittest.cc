@@ -150,6 +150,16 @@ TEST(IntervalIntersector, LinearScan_MultipleOverlaps) {
   EXPECT_THAT(overlaps, UnorderedElementsAre(0, 1, 2));
 }
 
+TEST(IntervalIntersector, LinearScan_LongIntervalBeforeShortOnes) {
+  // The first interval ends after all the others so the intervals are not
+  // sorted by their end.
+  auto intervals = CreateIntervals({{0, 100}, {1, 2}, {3, 4}, {60, 70}});
+  IntervalIntersector intersector(intervals, IntervalIntersector::kLinearScan);
+  std::vector<Id> overlaps;
+  intersector.FindOverlaps(50, 65, overlaps);
+  EXPECT_THAT(overlaps, UnorderedElementsAre(0, 3));
+}
+
 TEST(IntervalIntersector, LinearScan_NoOverlap) {
   auto intervals = CreateIntervals({{0, 5}, {10, 15}});
   IntervalIntersector intersector(intervals, IntervalIntersector::kLinearScan);
@@ -59,7 +59,8 @@ class IntervalTree {
   // interval (s, e). Has a complexity of O(log(size of tree) + (number of
   // overlaps)).
   void FindOverlaps(uint64_t s, uint64_t e, std::vector<Id>& res) const {
-    std::vector<const Node*> stack{nodes_.data() + root_};
+    base::SmallVector<const Node*, kInlineStackSize> stack;
+    stack.emplace_back(nodes_.data() + root_);
     while (!stack.empty()) {
       const Node* n = stack.back();
       stack.pop_back();
@@ -79,11 +80,11 @@ class IntervalTree {
 
       if (e > n->center_ &&
           n->right_node_ != std::numeric_limits<size_t>::max()) {
-        stack.push_back(&nodes_[n->right_node_]);
+        stack.emplace_back(&nodes_[n->right_node_]);
       }
       if (s < n->center_ &&
           n->left_node_ != std::numeric_limits<size_t>::max()) {
-        stack.push_back(&nodes_[n->left_node_]);
+        stack.emplace_back(&nodes_[n->left_node_]);
       }
     }
   }
@@ -91,7 +92,8 @@ class IntervalTree {
   // Modifies |res| to contain all overlaps (as Intervals) that overlap interval
   // (s, e). Has a complexity of O(log(size of tree) + (number of overlaps)).
   void FindOverlaps(Ts s, Ts e, std::vector<Interval>& res) const {
-    std::vector<const Node*> stack{nodes_.data() + root_};
+    base::SmallVector<const Node*, kInlineStackSize> stack;
+    stack.emplace_back(nodes_.data() + root_);
     while (!stack.empty()) {
       const Node* n = stack.back();
       stack.pop_back();
@@ -115,16 +117,20 @@ class IntervalTree {
 
       if (e > n->center_ &&
           n->right_node_ != std::numeric_limits<size_t>::max()) {
-        stack.push_back(&nodes_[n->right_node_]);
+        stack.emplace_back(&nodes_[n->right_node_]);
       }
       if (s < n->center_ &&
           n->left_node_ != std::numeric_limits<size_t>::max()) {
-        stack.push_back(&nodes_[n->left_node_]);
+        stack.emplace_back(&nodes_[n->left_node_]);
       }
     }
   }
 
  private:
+  // The stack of nodes to visit is only as deep as the path being explored
+  // so, for most trees, it fits inline and queries don't allocate.
+  static constexpr size_t kInlineStackSize = 64;
+
   struct Node {
     base::SmallVector<Interval, 2> intervals_;
     uint64_t center_ = 0;
@@ -16,8 +16,10 @@
 
 #include "src/trace_processor/containers/string_pool.h"
 
+#include <cstring>
 #include <limits>
-#include <tuple>
+#include <mutex>
+#include <utility>
 
 #include "perfetto/base/logging.h"
 #include "perfetto/ext/base/utils.h"
@@ -25,85 +27,159 @@
 namespace perfetto {
 namespace trace_processor {
 
-StringPool::StringPool() {
+StringPool::StringPool()
+    : blocks_(new Block[kMaxBlocks]),
+      index_shards_(new IndexShard[kNumIndexShards]) {
   static_assert(
       StringPool::kMinLargeStringSizeBytes <= StringPool::kBlockSizeBytes + 1,
       "minimum size of large strings must be small enough to support any "
       "string that doesn't fit in a Block.");
 
-  blocks_.emplace_back(kBlockSizeBytes);
+  blocks_[0] = Block(kBlockSizeBytes);
+  block_count_.store(1, std::memory_order_release);
 
   // Reserve a slot for the null string.
-  PERFETTO_CHECK(blocks_.back().TryInsert(NullTermStringView()).first);
+  PERFETTO_CHECK(blocks_[0].TryInsert(NullTermStringView(), false).first);
 }
 
 StringPool::~StringPool() = default;
 
-StringPool::StringPool(StringPool&&) noexcept = default;
-StringPool& StringPool::operator=(StringPool&&) noexcept = default;
+StringPool::StringPool(StringPool&& other) noexcept {
+  *this = std::move(other);
+}
+
+StringPool& StringPool::operator=(StringPool&& other) noexcept {
+  blocks_ = std::move(other.blocks_);
+  block_count_.store(other.block_count_.load(std::memory_order_relaxed),
+                     std::memory_order_relaxed);
+  other.block_count_.store(0, std::memory_order_relaxed);
+  large_strings_ = std::move(other.large_strings_);
+  index_shards_ = std::move(other.index_shards_);
+  concurrent_ = other.concurrent_;
+  return *this;
+}
+
+size_t StringPool::size() const {
+  size_t size = 0;
+  for (size_t i = 0; i < kNumIndexShards; ++i) {
+    size += index_shards_[i].index.size();
+  }
+  return size;
+}
+
+void StringPool::set_concurrent(bool concurrent) {
+  if (concurrent && !concurrent_) {
+    // Blocks added from now on are committed when added. The current one
+    // has to be committed here.
+    blocks_[block_count_.load(std::memory_order_relaxed) - 1].CommitAll();
+  }
+  concurrent_ = concurrent;
+}
 
 StringPool::Id StringPool::InsertString(base::StringView str, uint64_t hash) {
-  // Try and find enough space in the current block for the string and the
-  // metadata (varint-encoded size + the string data + the null terminator).
-  bool success;
-  uint32_t offset;
-  std::tie(success, offset) = blocks_.back().TryInsert(str);
-  if (PERFETTO_UNLIKELY(!success)) {
+  for (;;) {
+    // Try and find enough space in the current block for the string and the
+    // metadata (varint-encoded size + the string data + the null terminator).
+    uint32_t block_index = block_count_.load(std::memory_order_acquire) - 1;
+    auto [success, offset] = blocks_[block_index].TryInsert(str, concurrent_);
+    if (PERFETTO_LIKELY(success)) {
+      // Compute the id from the block index and offset.
+      Id string_id = Id::BlockString(block_index, offset);
+
+      // Deliberately not adding |string_id| to the index. The caller
+      // (InternString()) must take care of this.
+      PERFETTO_DCHECK(ShardForHash(hash).index.Find(hash));
+      return string_id;
+    }
+
     // The block did not have enough space for the string. If the string is
     // large, add it into the |large_strings_| vector, to avoid discarding a
     // large portion of the current block's memory. This also enables us to
     // support strings that wouldn't fit into a single block. Otherwise, add a
-    // new block to store the string.
+    // new block to store the string and try again.
     if (str.size() + kMaxMetadataSize >= kMinLargeStringSizeBytes) {
       return InsertLargeString(str, hash);
     }
-    blocks_.emplace_back(kBlockSizeBytes);
-
-    // Try and reserve space again - this time we should definitely succeed.
-    std::tie(success, offset) = blocks_.back().TryInsert(str);
-    PERFETTO_CHECK(success);
+    AddBlock(block_index);
   }
+}
 
-  // Compute the id from the block index and offset and add a mapping from the
-  // hash to the id.
-  Id string_id = Id::BlockString(blocks_.size() - 1, offset);
-
-  // Deliberately not adding |string_id| to |string_index_|. The caller
-  // (InternString()) must take care of this.
-  PERFETTO_DCHECK(string_index_.Find(hash));
-
-  return string_id;
+void StringPool::AddBlock(uint32_t full_block_index) {
+  std::unique_lock<std::mutex> lock = MaybeLock(mutex_);
+  uint32_t block_count = block_count_.load(std::memory_order_relaxed);
+  if (block_count != full_block_index + 1) {
+    // Another thread already added a block while we were waiting for the
+    // lock.
+    return;
+  }
+  PERFETTO_CHECK(block_count < kMaxBlocks);
+  blocks_[block_count] = Block(kBlockSizeBytes);
+  if (concurrent_)
+    blocks_[block_count].CommitAll();
+  block_count_.store(block_count + 1, std::memory_order_release);
 }
 
 StringPool::Id StringPool::InsertLargeString(base::StringView str,
                                              uint64_t hash) {
+  std::unique_lock<std::mutex> lock = MaybeLock(mutex_);
   large_strings_.emplace_back(new std::string(str.begin(), str.size()));
   // Compute id from the index and add a mapping from the hash to the id.
   Id string_id = Id::LargeString(large_strings_.size() - 1);
 
-  // Deliberately not adding |string_id| to |string_index_|. The caller
+  // Deliberately not adding |string_id| to the index. The caller
   // (InternString()) must take care of this.
-  PERFETTO_DCHECK(string_index_.Find(hash));
+  PERFETTO_DCHECK(ShardForHash(hash).index.Find(hash));
 
   return string_id;
 }
 
-std::pair<bool /*success*/, uint32_t /*offset*/> StringPool::Block::TryInsert(
-    base::StringView str) {
-  auto str_size = str.size();
-  size_t max_pos = static_cast<size_t>(pos_) + str_size + kMaxMetadataSize;
-  if (max_pos > size_)
-    return std::make_pair(false, 0u);
+StringPool::Block::Block(Block&& other) noexcept {
+  *this = std::move(other);
+}
 
-  // Ensure that we commit up until the end of the string to memory.
-  mem_.EnsureCommitted(max_pos);
+StringPool::Block& StringPool::Block::operator=(Block&& other) noexcept {
+  mem_ = std::move(other.mem_);
+  pos_.store(other.pos_.load(std::memory_order_relaxed),
+             std::memory_order_relaxed);
+  size_ = other.size_;
+  other.pos_.store(0, std::memory_order_relaxed);
+  other.size_ = 0;
+  return *this;
+}
 
-  // Get where we should start writing this string.
-  uint32_t offset = pos_;
-  uint8_t* begin = Get(offset);
+std::pair<bool /*success*/, uint32_t /*offset*/> StringPool::Block::TryInsert(
+    base::StringView str,
+    bool concurrent) {
+  // The string is stored as its varint-encoded size, the string itself and a
+  // null terminator.
+  auto str_size = str.size();
+  size_t varint_size = 1;
+  for (size_t v = str_size; v >= 0x80; v >>= 7)
+    varint_size++;
+  size_t needed = varint_size + str_size + 1;
+
+  // Reserve the space. In concurrent mode, many threads may be doing this at
+  // the same time: each one gets a disjoint range of the block.
+  uint32_t offset = pos_.load(std::memory_order_relaxed);
+  size_t end_pos;
+  for (;;) {
+    end_pos = static_cast<size_t>(offset) + needed;
+    if (end_pos > size_)
+      return std::make_pair(false, 0u);
+    if (!concurrent) {
+      // Ensure that we commit up until the end of the string to memory.
+      mem_.EnsureCommitted(end_pos);
+      pos_.store(static_cast<uint32_t>(end_pos), std::memory_order_relaxed);
+      break;
+    }
+    if (pos_.compare_exchange_weak(offset, static_cast<uint32_t>(end_pos),
+                                   std::memory_order_relaxed)) {
+      break;
+    }
+  }
 
   // First write the size of the string using varint encoding.
-  uint8_t* end = protozero::proto_utils::WriteVarInt(str_size, begin);
+  uint8_t* end = protozero::proto_utils::WriteVarInt(str_size, Get(offset));
 
   // Next the string itself.
   if (PERFETTO_LIKELY(str_size > 0)) {
@@ -113,9 +189,7 @@ std::pair<bool /*success*/, uint32_t /*offset*/> StringPool::Block::TryInsert(
 
   // Finally add a null terminator.
   *(end++) = '\0';
-
-  // Update the end of the block and return the pointer to the string.
-  pos_ = OffsetOf(end);
+  PERFETTO_DCHECK(end == Get(static_cast<uint32_t>(end_pos)));
 
   return std::make_pair(true, offset);
 }
@@ -123,7 +197,7 @@ std::pair<bool /*success*/, uint32_t /*offset*/> StringPool::Block::TryInsert(
 StringPool::Iterator::Iterator(const StringPool* pool) : pool_(pool) {}
 
 StringPool::Iterator& StringPool::Iterator::operator++() {
-  if (block_index_ < pool_->blocks_.size()) {
+  if (block_index_ < pool_->block_count_.load(std::memory_order_acquire)) {
     // Try and go to the next string in the current block.
     const auto& block = pool_->blocks_[block_index_];
 
@@ -151,7 +225,7 @@ StringPool::Iterator& StringPool::Iterator::operator++() {
 }
 
 StringPool::Iterator::operator bool() const {
-  return block_index_ < pool_->blocks_.size() ||
+  return block_index_ < pool_->block_count_.load(std::memory_order_acquire) ||
          large_strings_index_ < pool_->large_strings_.size();
 }
 
@@ -160,7 +234,7 @@ NullTermStringView StringPool::Iterator::StringView() {
 }
 
 StringPool::Id StringPool::Iterator::StringId() {
-  if (block_index_ < pool_->blocks_.size()) {
+  if (block_index_ < pool_->block_count_.load(std::memory_order_acquire)) {
     PERFETTO_DCHECK(block_offset_ < pool_->blocks_[block_index_].pos());
 
     // If we're at (0, 0), we have the null string which has id 0.
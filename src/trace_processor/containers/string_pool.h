@@ -17,11 +17,13 @@
 #ifndef SRC_TRACE_PROCESSOR_CONTAINERS_STRING_POOL_H_
 #define SRC_TRACE_PROCESSOR_CONTAINERS_STRING_POOL_H_
 
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
 #include <functional>
 #include <limits>
 #include <memory>
+#include <mutex>
 #include <optional>
 #include <string>
 #include <utility>
@@ -39,6 +41,13 @@ namespace perfetto::trace_processor {
 
 // Interns strings in a string pool and hands out compact StringIds which can
 // be used to retrieve the string in O(1).
+//
+// By default the pool must only be used from a single thread. After calling
+// set_concurrent(true), InternString(), GetId() and Get() can be called from
+// many threads at the same time (e.g. by parsers running on a thread pool):
+// the hash index is split in shards, each guarded by its own lock, and the
+// space for the strings is reserved in the current block with an atomic bump
+// pointer, so threads interning different strings rarely contend.
 class StringPool {
  public:
   struct Id {
@@ -127,10 +136,12 @@ class StringPool {
       return Id::Null();
 
     auto hash = str.Hash();
+    IndexShard& shard = ShardForHash(hash);
+    std::unique_lock<std::mutex> lock = MaybeLock(shard.mutex);
 
     // Perform a hashtable insertion with a null ID just to check if the string
     // is already inserted. If it's not, overwrite 0 with the actual Id.
-    auto it_and_inserted = string_index_.Insert(hash, Id());
+    auto it_and_inserted = shard.index.Insert(hash, Id());
     Id* id = it_and_inserted.first;
     if (!it_and_inserted.second) {
       PERFETTO_DCHECK(Get(*id) == str);
@@ -145,7 +156,9 @@ class StringPool {
       return Id::Null();
 
     auto hash = str.Hash();
-    Id* id = string_index_.Find(hash);
+    IndexShard& shard = ShardForHash(hash);
+    std::unique_lock<std::mutex> lock = MaybeLock(shard.mutex);
+    Id* id = shard.index.Find(hash);
     if (id) {
       PERFETTO_DCHECK(Get(*id) == str);
       return *id;
@@ -161,22 +174,32 @@ class StringPool {
     return GetFromBlockPtr(IdToPtr(id));
   }
 
+  // Must not be called while strings are being interned concurrently.
   Iterator CreateIterator() const { return Iterator(this); }
 
-  size_t size() const { return string_index_.size(); }
+  // Must not be called while strings are being interned concurrently.
+  size_t size() const;
 
   // Maximum Id of a small (not large) string in the string pool.
   StringPool::Id MaxSmallStringId() const {
-    return Id::BlockString(blocks_.size() - 1, blocks_.back().pos());
+    uint32_t block_count = block_count_.load(std::memory_order_acquire);
+    return Id::BlockString(block_count - 1, blocks_[block_count - 1].pos());
   }
 
   // Returns whether there is at least one large string in a string pool
   bool HasLargeString() const { return !large_strings_.empty(); }
 
+  // Enables or disables interning strings from multiple threads at the same
+  // time. Must be called while the pool is used by a single thread.
+  // Concurrent mode commits the whole memory of each block upfront.
+  void set_concurrent(bool concurrent);
+  bool concurrent() const { return concurrent_; }
+
  private:
   using StringHash = uint64_t;
 
   struct Block {
+    Block() = default;
     explicit Block(size_t size)
         : mem_(base::PagedMemory::Allocate(size,
                                            base::PagedMemory::kDontCommit)),
@@ -184,8 +207,8 @@ class StringPool {
     ~Block() = default;
 
     // Allow std::move().
-    Block(Block&&) noexcept = default;
-    Block& operator=(Block&&) = default;
+    Block(Block&&) noexcept;
+    Block& operator=(Block&&) noexcept;
 
     // Disable implicit copy.
     Block(const Block&) = delete;
@@ -195,23 +218,45 @@ class StringPool {
       return static_cast<uint8_t*>(mem_.Get()) + offset;
     }
 
+    // Reserves space for |str| and writes it. If |concurrent| is true, the
+    // space is reserved atomically so that many threads can insert in the
+    // same block at the same time; the block must be fully committed.
     std::pair<bool /*success*/, uint32_t /*offset*/> TryInsert(
-        base::StringView str);
+        base::StringView str,
+        bool concurrent);
 
     uint32_t OffsetOf(const uint8_t* ptr) const {
       PERFETTO_DCHECK(Get(0) < ptr &&
-                      ptr <= Get(static_cast<uint32_t>(size_ - 1)));
+                      ptr <= Get(static_cast<uint32_t>(size_)));
       return static_cast<uint32_t>(ptr - Get(0));
     }
 
-    uint32_t pos() const { return pos_; }
+    // Commits the whole block, so that TryInsert(concurrent=true) does not
+    // have to.
+    void CommitAll() { mem_.EnsureCommitted(size_); }
+
+    uint32_t pos() const { return pos_.load(std::memory_order_relaxed); }
 
    private:
     base::PagedMemory mem_;
-    uint32_t pos_ = 0;
+    std::atomic<uint32_t> pos_{0};
     size_t size_ = 0;
   };
 
+  // A shard of the index from the hashes of the strings to their Id. The
+  // shard is picked by the top bits of the hash while the hashmap uses the
+  // bottom ones, so the strings spread evenly across and within shards.
+  struct alignas(64) IndexShard {
+    // Only locked in concurrent mode.
+    std::mutex mutex;
+    base::FlatHashMap<StringHash,
+                      Id,
+                      base::AlreadyHashed<StringHash>,
+                      base::LinearProbe,
+                      /*AppendOnly=*/true>
+        index{/*initial_capacity=*/kInitialShardCapacity};
+  };
+
   friend class Iterator;
   friend class StringPoolTest;
 
@@ -227,6 +272,7 @@ class StringPool {
   //  +------------------- 1: large string, 0: string in a Block.
   static constexpr size_t kNumBlockIndexBits = 6;
   static constexpr size_t kNumBlockOffsetBits = 25;
+  static constexpr size_t kMaxBlocks = 1u << kNumBlockIndexBits;
 
   static constexpr size_t kLargeStringFlagBitMask = 1u << 31;
   static constexpr size_t kBlockOffsetBitMask = (1u << kNumBlockOffsetBits) - 1;
@@ -246,9 +292,29 @@ class StringPool {
   // plus 1 byte for null terminator. The actual size may be lower.
   static constexpr uint8_t kMaxMetadataSize = 6;
 
+  // The index is split in 2^kNumIndexShardBits shards.
+  static constexpr size_t kNumIndexShardBits = 6;
+  static constexpr size_t kNumIndexShards = 1u << kNumIndexShardBits;
+  static constexpr size_t kInitialShardCapacity = 4096u / kNumIndexShards;
+
+  IndexShard& ShardForHash(StringHash hash) const {
+    return index_shards_[hash >> (64 - kNumIndexShardBits)];
+  }
+
+  // Returns a lock holding |mutex| in concurrent mode and an empty lock
+  // otherwise.
+  std::unique_lock<std::mutex> MaybeLock(std::mutex& mutex) const {
+    return concurrent_ ? std::unique_lock<std::mutex>(mutex)
+                       : std::unique_lock<std::mutex>();
+  }
+
   // Inserts the string with the given hash into the pool and return its Id.
   Id InsertString(base::StringView, uint64_t hash);
 
+  // Starts a new block after the block |full_block_index|, unless another
+  // thread already did.
+  void AddBlock(uint32_t full_block_index);
+
   // Insert a large string into the pool and return its Id.
   Id InsertLargeString(base::StringView, uint64_t hash);
 
@@ -262,7 +328,8 @@ class StringPool {
     size_t block_index = id.block_index();
     uint32_t block_offset = id.block_offset();
 
-    PERFETTO_DCHECK(block_index < blocks_.size());
+    PERFETTO_DCHECK(block_index <
+                    block_count_.load(std::memory_order_relaxed));
     PERFETTO_DCHECK(block_offset < blocks_[block_index].pos());
 
     return blocks_[block_index].Get(block_offset);
@@ -293,14 +360,18 @@ class StringPool {
   // set.
   NullTermStringView GetLargeString(Id id) const {
     PERFETTO_DCHECK(id.is_large_string());
+    std::unique_lock<std::mutex> lock = MaybeLock(mutex_);
     size_t index = id.large_string_index();
     PERFETTO_DCHECK(index < large_strings_.size());
     const std::string* str = large_strings_[index].get();
     return {str->c_str(), str->size()};
   }
 
-  // The actual memory storing the strings.
-  std::vector<Block> blocks_;
+  // The actual memory storing the strings. Only the first |block_count_|
+  // blocks are allocated: new strings go in the last one. The array is never
+  // reallocated, so blocks can be read while another thread adds a block.
+  std::unique_ptr<Block[]> blocks_;
+  std::atomic<uint32_t> block_count_{0};
 
   // Any string that is too large to fit into a Block is stored separately
   // (inside a unique_ptr to ensure any references to it remain valid even if
@@ -308,12 +379,12 @@ class StringPool {
   std::vector<std::unique_ptr<std::string>> large_strings_;
 
   // Maps hashes of strings to the Id in the string pool.
-  base::FlatHashMap<StringHash,
-                    Id,
-                    base::AlreadyHashed<StringHash>,
-                    base::LinearProbe,
-                    /*AppendOnly=*/true>
-      string_index_{/*initial_capacity=*/4096u};
+  std::unique_ptr<IndexShard[]> index_shards_;
+
+  // In concurrent mode, guards adding blocks and |large_strings_|.
+  mutable std::mutex mutex_;
+
+  bool concurrent_ = false;
 };
 
 }  // namespace perfetto::trace_processor
@@ -0,0 +1,151 @@
+// Copyright (C) 2024 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "perfetto/ext/base/string_view.h"
+#include "src/trace_processor/containers/string_pool.h"
+
+using perfetto::base::StringView;
+using perfetto::trace_processor::StringPool;
+
+namespace {
+
+// Number of distinct slice names.
+static constexpr uint32_t kDistinctNames = 50000;
+
+// Number of strings interned by each thread in each iteration.
+static constexpr uint32_t kStringsPerThread = 200000;
+
+static constexpr uint32_t kMaxThreads = 32;
+
+bool IsBenchmarkFunctionalOnly() {
+  return getenv("BENCHMARK_FUNCTIONAL_TEST_ONLY") != nullptr;
+}
+
+void ThreadArgs(benchmark::internal::Benchmark* b) {
+  if (IsBenchmarkFunctionalOnly()) {
+    b->Arg(2);
+  } else {
+    b->RangeMultiplier(2)->Range(1, kMaxThreads);
+  }
+}
+
+// Slice names look like the ones found in real traces: a small set of very
+// common names (e.g. "DrawFrame") and a long tail of names with ids in them
+// (e.g. "binder transaction 1234").
+std::vector<std::string> CreateNames() {
+  static const char* const kPrefixes[] = {
+      "Choreographer#doFrame ",
+      "binder transaction ",
+      "RenderThread::DrawFrame ",
+      "animation ",
+      "inflate ",
+      "Lock contention on a monitor lock (owner tid: ",
+      "ThreadController::RunTask ",
+      "android.os.Handler: ",
+      "measure ",
+      "traversal ",
+  };
+  constexpr uint32_t kNumPrefixes = sizeof(kPrefixes) / sizeof(kPrefixes[0]);
+  std::vector<std::string> names;
+  names.reserve(kDistinctNames);
+  for (uint32_t i = 0; i < kDistinctNames; ++i) {
+    names.push_back(kPrefixes[i % kNumPrefixes] + std::to_string(i));
+  }
+  return names;
+}
+
+// Returns, for each thread, the sequence of indexes in the names to intern.
+// The frequency of the names follows a Zipf distribution (the n-th most
+// common name appears ~1/n as often as the most common one).
+std::vector<std::vector<uint32_t>> CreateSequences() {
+  std::vector<double> cdf(kDistinctNames);
+  double sum = 0;
+  for (uint32_t i = 0; i < kDistinctNames; ++i) {
+    sum += 1.0 / std::pow(i + 1, 1.1);
+    cdf[i] = sum;
+  }
+  std::vector<std::vector<uint32_t>> sequences(kMaxThreads);
+  for (uint32_t t = 0; t < kMaxThreads; ++t) {
+    std::minstd_rand0 rnd_engine(t);
+    std::uniform_real_distribution<double> dist(0, sum);
+    sequences[t].reserve(kStringsPerThread);
+    for (uint32_t i = 0; i < kStringsPerThread; ++i) {
+      auto it = std::lower_bound(cdf.begin(), cdf.end(), dist(rnd_engine));
+      sequences[t].push_back(static_cast<uint32_t>(it - cdf.begin()));
+    }
+  }
+  return sequences;
+}
+
+void InternSequence(StringPool* pool,
+                    const std::vector<std::string>& names,
+                    const std::vector<uint32_t>& sequence) {
+  for (uint32_t idx : sequence) {
+    benchmark::DoNotOptimize(pool->InternString(StringView(names[idx])));
+  }
+}
+
+// Interns the strings from a single thread, without concurrent mode: this
+// is the baseline for the benchmark below.
+static void BM_StringPoolIntern(benchmark::State& state) {
+  static const auto* names = new std::vector<std::string>(CreateNames());
+  static const auto* sequences =
+      new std::vector<std::vector<uint32_t>>(CreateSequences());
+
+  for (auto _ : state) {
+    StringPool pool;
+    InternSequence(&pool, *names, (*sequences)[0]);
+  }
+  state.SetItemsProcessed(state.iterations() * kStringsPerThread);
+}
+BENCHMARK(BM_StringPoolIntern)->UseRealTime();
+
+// Interns the strings from state.range(0) threads at the same time, each
+// interning the same number of strings: with perfect scaling, the time per
+// iteration doesn't change with the number of threads.
+static void BM_StringPoolInternConcurrent(benchmark::State& state) {
+  static const auto* names = new std::vector<std::string>(CreateNames());
+  static const auto* sequences =
+      new std::vector<std::vector<uint32_t>>(CreateSequences());
+
+  auto thread_count = static_cast<uint32_t>(state.range(0));
+  for (auto _ : state) {
+    StringPool pool;
+    pool.set_concurrent(true);
+    std::vector<std::thread> threads;
+    for (uint32_t t = 0; t < thread_count; ++t) {
+      threads.emplace_back(
+          [&pool, t] { InternSequence(&pool, *names, (*sequences)[t]); });
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * thread_count *
+                          kStringsPerThread);
+}
+BENCHMARK(BM_StringPoolInternConcurrent)->Apply(ThreadArgs)->UseRealTime();
+
+}  // namespace
@@ -18,6 +18,9 @@
 
 #include <array>
 #include <random>
+#include <string>
+#include <thread>
+#include <vector>
 
 #include "test/gtest_and_gmock.h"
 
@@ -197,6 +200,64 @@ TEST_F(StringPoolTest, BigString) {
   }
 }
 
+TEST_F(StringPoolTest, ConcurrentIntern) {
+  pool_.set_concurrent(true);
+
+  // Every thread interns the same strings (in a different order) plus some of
+  // its own. The strings are large enough to need more than one block.
+  constexpr uint32_t kThreads = 8;
+  constexpr uint32_t kSharedStrings = 20000;
+  constexpr uint32_t kOwnStrings = 2000;
+  auto shared_str = [](uint32_t i) {
+    return "shared_" + std::to_string(i) + std::string(i % 4000, 'x');
+  };
+  auto own_str = [](uint32_t t, uint32_t i) {
+    return "own_" + std::to_string(t) + "_" + std::to_string(i);
+  };
+
+  std::vector<std::vector<StringPool::Id>> shared_ids(kThreads);
+  std::vector<std::vector<StringPool::Id>> own_ids(kThreads);
+  std::vector<std::thread> threads;
+  for (uint32_t t = 0; t < kThreads; ++t) {
+    threads.emplace_back([&, t] {
+      shared_ids[t].resize(kSharedStrings);
+      for (uint32_t j = 0; j < kSharedStrings; ++j) {
+        uint32_t i = (j + t * 997) % kSharedStrings;
+        std::string str = shared_str(i);
+        shared_ids[t][i] = pool_.InternString(base::StringView(str));
+        ASSERT_EQ(pool_.Get(shared_ids[t][i]), base::StringView(str));
+        if (j < kOwnStrings) {
+          std::string own = own_str(t, j);
+          own_ids[t].push_back(pool_.InternString(base::StringView(own)));
+        }
+      }
+    });
+  }
+  for (auto& thread : threads)
+    thread.join();
+  pool_.set_concurrent(false);
+
+  ASSERT_GT(pool_.MaxSmallStringId().block_index(), 0u);
+  ASSERT_EQ(pool_.size(), kSharedStrings + kThreads * kOwnStrings);
+  for (uint32_t i = 0; i < kSharedStrings; ++i) {
+    for (uint32_t t = 1; t < kThreads; ++t)
+      ASSERT_EQ(shared_ids[t][i], shared_ids[0][i]);
+    ASSERT_EQ(pool_.Get(shared_ids[0][i]), base::StringView(shared_str(i)));
+  }
+  for (uint32_t t = 0; t < kThreads; ++t) {
+    for (uint32_t i = 0; i < kOwnStrings; ++i)
+      ASSERT_EQ(pool_.Get(own_ids[t][i]), base::StringView(own_str(t, i)));
+  }
+
+  // Every string is visited exactly once by the iterator.
+  size_t count = 0;
+  for (auto it = pool_.CreateIterator(); it; ++it) {
+    ASSERT_EQ(it.StringView(), pool_.Get(it.StringId()));
+    ++count;
+  }
+  ASSERT_EQ(count, pool_.size() + 1 /* null string */);
+}
+
 }  // namespace
 }  // namespace trace_processor
 }  // namespace perfetto
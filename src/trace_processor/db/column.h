@@ -369,6 +369,7 @@ class ColumnLegacy {
 
  private:
   friend class Table;
+  friend class TableSnapshot;
   friend class View;
 
   // Base constructor for this class which all other constructors call into.
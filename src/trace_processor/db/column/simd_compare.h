@@ -0,0 +1,192 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_TRACE_PROCESSOR_DB_COLUMN_SIMD_COMPARE_H_
+#define SRC_TRACE_PROCESSOR_DB_COLUMN_SIMD_COMPARE_H_
+
+#include <cstdint>
+#include <functional>
+#include <type_traits>
+
+#include "perfetto/base/build_config.h"
+#include "perfetto/public/compiler.h"
+
+#if PERFETTO_BUILDFLAG(PERFETTO_X64_CPU_OPT)
+#include <immintrin.h>
+#endif
+
+namespace perfetto::trace_processor::column::utils {
+namespace internal {
+
+// Number of values compared by |CompareWord|: one for each bit in a
+// BitVector word.
+inline constexpr uint32_t kValuesPerWord = 64;
+
+enum class SimdOp { kNone, kEq, kNe, kLt, kLe, kGt, kGe };
+
+// Maps the std comparator functors to the operation they perform. Any other
+// comparator (e.g. the ones used for strings) maps to kNone.
+template <typename Comparator>
+inline constexpr SimdOp kSimdOpFor = SimdOp::kNone;
+template <typename T>
+inline constexpr SimdOp kSimdOpFor<std::equal_to<T>> = SimdOp::kEq;
+template <typename T>
+inline constexpr SimdOp kSimdOpFor<std::not_equal_to<T>> = SimdOp::kNe;
+template <typename T>
+inline constexpr SimdOp kSimdOpFor<std::less<T>> = SimdOp::kLt;
+template <typename T>
+inline constexpr SimdOp kSimdOpFor<std::less_equal<T>> = SimdOp::kLe;
+template <typename T>
+inline constexpr SimdOp kSimdOpFor<std::greater<T>> = SimdOp::kGt;
+template <typename T>
+inline constexpr SimdOp kSimdOpFor<std::greater_equal<T>> = SimdOp::kGe;
+
+#if PERFETTO_BUILDFLAG(PERFETTO_X64_CPU_OPT)
+
+// AVX2 only has "equal" and "signed greater than" integer comparisons: all the
+// other operations are derived from those by swapping the operands and/or
+// inverting the resulting mask. |lane_mask| has one bit set for each lane.
+template <SimdOp op>
+PERFETTO_ALWAYS_INLINE uint32_t IntegerCompareMask(__m256i data,
+                                                   __m256i val,
+                                                   uint32_t lane_mask,
+                                                   bool is_64_bit) {
+  __m256i res;
+  bool invert;
+  if constexpr (op == SimdOp::kEq || op == SimdOp::kNe) {
+    res = is_64_bit ? _mm256_cmpeq_epi64(data, val)
+                    : _mm256_cmpeq_epi32(data, val);
+    invert = op == SimdOp::kNe;
+  } else if constexpr (op == SimdOp::kGt || op == SimdOp::kLe) {
+    res = is_64_bit ? _mm256_cmpgt_epi64(data, val)
+                    : _mm256_cmpgt_epi32(data, val);
+    invert = op == SimdOp::kLe;
+  } else {
+    static_assert(op == SimdOp::kLt || op == SimdOp::kGe);
+    res = is_64_bit ? _mm256_cmpgt_epi64(val, data)
+                    : _mm256_cmpgt_epi32(val, data);
+    invert = op == SimdOp::kGe;
+  }
+  auto mask = static_cast<uint32_t>(
+      is_64_bit ? _mm256_movemask_pd(_mm256_castsi256_pd(res))
+                : _mm256_movemask_ps(_mm256_castsi256_ps(res)));
+  return invert ? mask ^ lane_mask : mask;
+}
+
+template <SimdOp op>
+PERFETTO_ALWAYS_INLINE uint64_t CompareWordAvx2(const int64_t* data,
+                                                int64_t val) {
+  const __m256i val_vec = _mm256_set1_epi64x(val);
+  uint64_t word = 0;
+  for (uint32_t i = 0; i < kValuesPerWord; i += 4) {
+    __m256i data_vec =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+    uint64_t mask = IntegerCompareMask<op>(data_vec, val_vec, 0xF, true);
+    word |= mask << i;
+  }
+  return word;
+}
+
+template <SimdOp op>
+PERFETTO_ALWAYS_INLINE uint64_t CompareWordAvx2(const int32_t* data,
+                                                int32_t val) {
+  const __m256i val_vec = _mm256_set1_epi32(val);
+  uint64_t word = 0;
+  for (uint32_t i = 0; i < kValuesPerWord; i += 8) {
+    __m256i data_vec =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+    uint64_t mask = IntegerCompareMask<op>(data_vec, val_vec, 0xFF, false);
+    word |= mask << i;
+  }
+  return word;
+}
+
+template <SimdOp op>
+PERFETTO_ALWAYS_INLINE uint64_t CompareWordAvx2(const uint32_t* data,
+                                                uint32_t val) {
+  // Flipping the sign bit maps unsigned ordering onto signed ordering so the
+  // signed comparison instructions can be used.
+  const __m256i sign = _mm256_set1_epi32(static_cast<int32_t>(0x80000000u));
+  const __m256i val_vec =
+      _mm256_xor_si256(_mm256_set1_epi32(static_cast<int32_t>(val)), sign);
+  uint64_t word = 0;
+  for (uint32_t i = 0; i < kValuesPerWord; i += 8) {
+    __m256i data_vec = _mm256_xor_si256(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i)), sign);
+    uint64_t mask = IntegerCompareMask<op>(data_vec, val_vec, 0xFF, false);
+    word |= mask << i;
+  }
+  return word;
+}
+
+template <SimdOp op>
+PERFETTO_ALWAYS_INLINE uint64_t CompareWordAvx2(const double* data,
+                                                double val) {
+  // The ordered predicates are false if either operand is NaN, matching the
+  // C++ operators. The only exception is != which is true for NaN.
+  constexpr int kPredicate = op == SimdOp::kEq   ? _CMP_EQ_OQ
+                             : op == SimdOp::kNe ? _CMP_NEQ_UQ
+                             : op == SimdOp::kLt ? _CMP_LT_OQ
+                             : op == SimdOp::kLe ? _CMP_LE_OQ
+                             : op == SimdOp::kGt ? _CMP_GT_OQ
+                                                 : _CMP_GE_OQ;
+  const __m256d val_vec = _mm256_set1_pd(val);
+  uint64_t word = 0;
+  for (uint32_t i = 0; i < kValuesPerWord; i += 4) {
+    __m256d res = _mm256_cmp_pd(_mm256_loadu_pd(data + i), val_vec, kPredicate);
+    word |= static_cast<uint64_t>(_mm256_movemask_pd(res)) << i;
+  }
+  return word;
+}
+
+template <typename T>
+inline constexpr bool kHasAvx2Kernel =
+    std::is_same_v<T, int64_t> || std::is_same_v<T, int32_t> ||
+    std::is_same_v<T, uint32_t> || std::is_same_v<T, double>;
+
+#endif  // PERFETTO_BUILDFLAG(PERFETTO_X64_CPU_OPT)
+
+}  // namespace internal
+
+// Compares the 64 values starting at |data| with |val| using |comparator| and
+// returns the results packed in a BitVector word (i.e. the result for data[i]
+// is stored in bit i).
+//
+// When building with x64 CPU optimizations, comparisons of numeric values
+// with std comparators use explicit AVX2 kernels. Otherwise, this falls back to
+// a scalar loop (which the compiler may still be able to auto-vectorize).
+template <typename Comparator, typename ValType, typename DataType>
+PERFETTO_ALWAYS_INLINE uint64_t CompareWord(const DataType* data,
+                                            const ValType& val,
+                                            const Comparator& comparator) {
+#if PERFETTO_BUILDFLAG(PERFETTO_X64_CPU_OPT)
+  constexpr internal::SimdOp kOp = internal::kSimdOpFor<Comparator>;
+  if constexpr (kOp != internal::SimdOp::kNone &&
+                std::is_same_v<ValType, DataType> &&
+                internal::kHasAvx2Kernel<DataType>) {
+    return internal::CompareWordAvx2<kOp>(data, val);
+  }
+#endif
+  uint64_t word = 0;
+  for (uint32_t k = 0; k < internal::kValuesPerWord; ++k) {
+    word |= static_cast<uint64_t>(comparator(data[k], val)) << k;
+  }
+  return word;
+}
+
+}  // namespace perfetto::trace_processor::column::utils
+
+#endif  // SRC_TRACE_PROCESSOR_DB_COLUMN_SIMD_COMPARE_H_
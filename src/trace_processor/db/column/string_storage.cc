@@ -27,7 +27,9 @@
 #include <utility>
 #include <vector>
 
+#include "perfetto/base/compiler.h"
 #include "perfetto/base/logging.h"
+#include "perfetto/ext/base/flat_hash_map.h"
 #include "perfetto/ext/base/status_or.h"
 #include "perfetto/ext/base/string_view.h"
 #include "perfetto/trace_processor/basic_types.h"
@@ -88,22 +90,6 @@ struct Glob {
   const StringPool* pool_;
 };
 
-struct GlobFullStringPool {
-  GlobFullStringPool(StringPool* pool, const util::GlobMatcher& matcher)
-      : pool_(pool), matches_(pool->MaxSmallStringId().raw_id()) {
-    PERFETTO_DCHECK(!pool->HasLargeString());
-    for (auto it = pool->CreateIterator(); it; ++it) {
-      auto id = it.StringId();
-      matches_[id.raw_id()] = matcher.Matches(pool->Get(id));
-    }
-  }
-  bool operator()(StringPool::Id lhs, StringPool::Id) const {
-    return lhs != StringPool::Id::Null() && matches_[lhs.raw_id()];
-  }
-  StringPool* pool_;
-  std::vector<uint8_t> matches_;
-};
-
 struct Regex {
   bool operator()(StringPool::Id lhs, const regex::Regex& pattern) const {
     return lhs != StringPool::Id::Null() &&
@@ -112,23 +98,50 @@ struct Regex {
   const StringPool* pool_;
 };
 
-struct RegexFullStringPool {
-  RegexFullStringPool(StringPool* pool, const regex::Regex& regex)
-      : pool_(pool), matches_(pool->MaxSmallStringId().raw_id()) {
-    PERFETTO_DCHECK(!pool->HasLargeString());
-    for (auto it = pool->CreateIterator(); it; ++it) {
-      auto id = it.StringId();
-      matches_[id.raw_id()] =
-          id != StringPool::Id::Null() && regex.Search(pool_->Get(id).c_str());
-    }
-  }
+// Wraps one of the comparators above so that it is evaluated at most once for
+// each distinct string in the column instead of once per row: string columns
+// usually have orders of magnitude more rows than distinct strings (e.g. slice
+// names) and dereferencing the string and evaluating a glob or a regex is far
+// more expensive than looking up the cached result by id.
+//
+// The results are cached in a hash map so the memory used is proportional to
+// the number of distinct strings searched rather than to the size of the
+// string pool. The result for the previous row is also remembered, which
+// avoids the hash lookup for runs of rows with the same string.
+template <typename Comparator, typename Val>
+class CachedPerDistinctId {
+ public:
+  CachedPerDistinctId(Comparator comparator, const Val& val)
+      : comparator_(std::move(comparator)), val_(&val) {}
+
   bool operator()(StringPool::Id lhs, StringPool::Id) const {
-    return matches_[lhs.raw_id()];
+    if (lhs == last_id_) {
+      return last_res_;
+    }
+    bool* cached = results_.Find(lhs.raw_id());
+    bool res = cached ? *cached : comparator_(lhs, *val_);
+    if (!cached) {
+      results_.Insert(lhs.raw_id(), res);
+    }
+    last_id_ = lhs;
+    last_res_ = res;
+    return res;
   }
-  StringPool* pool_;
-  std::vector<uint8_t> matches_;
+
+ private:
+  Comparator comparator_;
+  const Val* val_;
+  mutable base::FlatHashMap<uint32_t, bool> results_;
+  mutable std::optional<StringPool::Id> last_id_;
+  mutable bool last_res_ = false;
 };
 
+template <typename Comparator, typename Val>
+CachedPerDistinctId<Comparator, Val> CachePerDistinctId(Comparator comparator,
+                                                        const Val& val) {
+  return CachedPerDistinctId<Comparator, Val>(std::move(comparator), val);
+}
+
 struct IsNull {
   bool operator()(StringPool::Id lhs, StringPool::Id) const {
     return lhs == StringPool::Id::Null();
@@ -363,22 +376,32 @@ void StringStorage::ChainImpl::IndexSearchValidated(FilterOp op,
     case FilterOp::kNe:
       utils::IndexSearchWithComparator(val, start, indices, NotEqual());
       break;
-    case FilterOp::kLe:
-      utils::IndexSearchWithComparator(string_pool_->Get(val), start, indices,
-                                       LessEqual{string_pool_});
+    case FilterOp::kLe: {
+      NullTermStringView str = string_pool_->Get(val);
+      utils::IndexSearchWithComparator(
+          val, start, indices,
+          CachePerDistinctId(LessEqual{string_pool_}, str));
       break;
-    case FilterOp::kLt:
-      utils::IndexSearchWithComparator(string_pool_->Get(val), start, indices,
-                                       Less{string_pool_});
+    }
+    case FilterOp::kLt: {
+      NullTermStringView str = string_pool_->Get(val);
+      utils::IndexSearchWithComparator(
+          val, start, indices, CachePerDistinctId(Less{string_pool_}, str));
       break;
-    case FilterOp::kGt:
-      utils::IndexSearchWithComparator(string_pool_->Get(val), start, indices,
-                                       Greater{string_pool_});
+    }
+    case FilterOp::kGt: {
+      NullTermStringView str = string_pool_->Get(val);
+      utils::IndexSearchWithComparator(
+          val, start, indices, CachePerDistinctId(Greater{string_pool_}, str));
       break;
-    case FilterOp::kGe:
-      utils::IndexSearchWithComparator(string_pool_->Get(val), start, indices,
-                                       GreaterEqual{string_pool_});
+    }
+    case FilterOp::kGe: {
+      NullTermStringView str = string_pool_->Get(val);
+      utils::IndexSearchWithComparator(
+          val, start, indices,
+          CachePerDistinctId(GreaterEqual{string_pool_}, str));
       break;
+    }
     case FilterOp::kGlob: {
       util::GlobMatcher matcher =
           util::GlobMatcher::FromPattern(sql_val.AsString());
@@ -387,15 +410,16 @@ void StringStorage::ChainImpl::IndexSearchValidated(FilterOp op,
                                          std::equal_to<>());
         break;
       }
-      utils::IndexSearchWithComparator(std::move(matcher), start, indices,
-                                       Glob{string_pool_});
+      utils::IndexSearchWithComparator(
+          val, start, indices, CachePerDistinctId(Glob{string_pool_}, matcher));
       break;
     }
     case FilterOp::kRegex: {
       base::StatusOr<regex::Regex> regex =
           regex::Regex::Create(sql_val.AsString());
-      utils::IndexSearchWithComparator(std::move(regex.value()), start, indices,
-                                       Regex{string_pool_});
+      utils::IndexSearchWithComparator(
+          val, start, indices,
+          CachePerDistinctId(Regex{string_pool_}, regex.value()));
       break;
     }
     case FilterOp::kIsNull:
@@ -425,22 +449,32 @@ BitVector StringStorage::ChainImpl::LinearSearch(FilterOp op,
     case FilterOp::kNe:
       utils::LinearSearchWithComparator(val, start, NotEqual(), builder);
       break;
-    case FilterOp::kLe:
-      utils::LinearSearchWithComparator(string_pool_->Get(val), start,
-                                        LessEqual{string_pool_}, builder);
+    case FilterOp::kLe: {
+      NullTermStringView str = string_pool_->Get(val);
+      utils::LinearSearchWithComparator(
+          val, start, CachePerDistinctId(LessEqual{string_pool_}, str),
+          builder);
       break;
-    case FilterOp::kLt:
-      utils::LinearSearchWithComparator(string_pool_->Get(val), start,
-                                        Less{string_pool_}, builder);
+    }
+    case FilterOp::kLt: {
+      NullTermStringView str = string_pool_->Get(val);
+      utils::LinearSearchWithComparator(
+          val, start, CachePerDistinctId(Less{string_pool_}, str), builder);
       break;
-    case FilterOp::kGt:
-      utils::LinearSearchWithComparator(string_pool_->Get(val), start,
-                                        Greater{string_pool_}, builder);
+    }
+    case FilterOp::kGt: {
+      NullTermStringView str = string_pool_->Get(val);
+      utils::LinearSearchWithComparator(
+          val, start, CachePerDistinctId(Greater{string_pool_}, str), builder);
       break;
-    case FilterOp::kGe:
-      utils::LinearSearchWithComparator(string_pool_->Get(val), start,
-                                        GreaterEqual{string_pool_}, builder);
+    }
+    case FilterOp::kGe: {
+      NullTermStringView str = string_pool_->Get(val);
+      utils::LinearSearchWithComparator(
+          val, start, CachePerDistinctId(GreaterEqual{string_pool_}, str),
+          builder);
       break;
+    }
     case FilterOp::kGlob: {
       util::GlobMatcher matcher =
           util::GlobMatcher::FromPattern(sql_val.AsString());
@@ -452,19 +486,8 @@ BitVector StringStorage::ChainImpl::LinearSearch(FilterOp op,
                                           builder);
         break;
       }
-
-      // For very big string pools (or small ranges) or pools with large strings
-      // run a standard glob function.
-      if (range.size() < string_pool_->size() ||
-          string_pool_->HasLargeString()) {
-        utils::LinearSearchWithComparator(std::move(matcher), start,
-                                          Glob{string_pool_}, builder);
-        break;
-      }
-
       utils::LinearSearchWithComparator(
-          StringPool::Id::Null(), start,
-          GlobFullStringPool{string_pool_, matcher}, builder);
+          val, start, CachePerDistinctId(Glob{string_pool_}, matcher), builder);
       break;
     }
     case FilterOp::kRegex: {
@@ -472,18 +495,9 @@ BitVector StringStorage::ChainImpl::LinearSearch(FilterOp op,
       base::StatusOr<regex::Regex> regex =
           regex::Regex::Create(sql_val.AsString());
       PERFETTO_CHECK(regex.status().ok());
-
-      // For very big string pools (or small ranges) or pools with large
-      // strings run a standard regex function.
-      if (range.size() < string_pool_->size() ||
-          string_pool_->HasLargeString()) {
-        utils::LinearSearchWithComparator(std::move(regex.value()), start,
-                                          Regex{string_pool_}, builder);
-        break;
-      }
       utils::LinearSearchWithComparator(
-          StringPool::Id::Null(), start,
-          RegexFullStringPool{string_pool_, regex.value()}, builder);
+          val, start, CachePerDistinctId(Regex{string_pool_}, regex.value()),
+          builder);
       break;
     }
     case FilterOp::kIsNull:
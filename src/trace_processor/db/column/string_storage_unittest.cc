@@ -208,6 +208,86 @@ TEST(StringStorage, IndexSearch) {
   ASSERT_THAT(utils::ExtractPayloadForTesting(indices), ElementsAre(2, 4, 5));
 }
 
+TEST(StringStorage, SearchManyRowsFewDistinctStrings) {
+  // Many more rows than distinct strings: the predicate is only evaluated
+  // once per string and then looked up by id.
+  StringPool pool;
+  std::vector<StringPool::Id> distinct{
+      pool.InternString("pasta"), pool.InternString("pizza"),
+      StringPool::Id::Null(), pool.InternString("fries")};
+  std::vector<StringPool::Id> ids;
+  for (uint32_t i = 0; i < 1000; ++i) {
+    ids.push_back(distinct[i % distinct.size()]);
+  }
+  StringStorage storage(&pool, &ids);
+  auto chain = storage.MakeChain();
+
+  auto res = chain->Search(FilterOp::kGlob, SqlValue::String("p*"),
+                           Range(10, 1000));
+  std::vector<uint32_t> expected;
+  for (uint32_t i = 10; i < 1000; ++i) {
+    if (i % 4 == 0 || i % 4 == 1) {
+      expected.push_back(i);
+    }
+  }
+  ASSERT_EQ(utils::ToIndexVectorForTests(res), expected);
+
+  res = chain->Search(FilterOp::kLt, SqlValue::String("pizza"),
+                      Range(10, 1000));
+  expected.clear();
+  for (uint32_t i = 10; i < 1000; ++i) {
+    if (i % 4 == 0 || i % 4 == 3) {
+      expected.push_back(i);
+    }
+  }
+  ASSERT_EQ(utils::ToIndexVectorForTests(res), expected);
+}
+
+TEST(StringStorage, SearchFewRowsManyDistinctStrings) {
+  // Many more strings in the pool than rows: only the strings of the searched
+  // rows are evaluated, the size of the pool does not matter.
+  StringPool pool;
+  for (uint32_t i = 0; i < 10000; ++i) {
+    pool.InternString(base::StringView(std::to_string(i)));
+  }
+  std::vector<StringPool::Id> ids{
+      pool.InternString("pasta"), pool.InternString("pizza"),
+      StringPool::Id::Null(), pool.InternString("fries"),
+      pool.InternString("pasta")};
+  StringStorage storage(&pool, &ids);
+  auto chain = storage.MakeChain();
+
+  auto res =
+      chain->Search(FilterOp::kGlob, SqlValue::String("p*"), Range(0, 5));
+  ASSERT_THAT(utils::ToIndexVectorForTests(res), ElementsAre(0, 1, 4));
+
+  Indices indices = Indices::CreateWithIndexPayloadForTesting(
+      {4, 3, 2, 1, 0}, Indices::State::kNonmonotonic);
+  chain->IndexSearch(FilterOp::kGt, SqlValue::String("fries"), indices);
+  ASSERT_THAT(utils::ExtractPayloadForTesting(indices), ElementsAre(0, 3, 4));
+}
+
+TEST(StringStorage, SearchRunsOfSameString) {
+  // Consecutive rows with the same string reuse the result of the previous
+  // row.
+  StringPool pool;
+  StringPool::Id pasta = pool.InternString("pasta");
+  StringPool::Id fries = pool.InternString("fries");
+  std::vector<StringPool::Id> ids{pasta, pasta, fries, fries,
+                                  StringPool::Id::Null(), pasta, fries};
+  StringStorage storage(&pool, &ids);
+  auto chain = storage.MakeChain();
+
+  auto res =
+      chain->Search(FilterOp::kGlob, SqlValue::String("p*"), Range(0, 7));
+  ASSERT_THAT(utils::ToIndexVectorForTests(res), ElementsAre(0, 1, 5));
+
+  Indices indices = Indices::CreateWithIndexPayloadForTesting(
+      {0, 1, 4, 4, 2, 3, 6}, Indices::State::kNonmonotonic);
+  chain->IndexSearch(FilterOp::kLt, SqlValue::String("pasta"), indices);
+  ASSERT_THAT(utils::ExtractPayloadForTesting(indices), ElementsAre(4, 5, 6));
+}
+
 #if !PERFETTO_BUILDFLAG(PERFETTO_OS_WIN)
 TEST(StringStorage, LinearSearchRegex) {
   std::vector<std::string> strings{"cheese",  "pasta", "pizza",
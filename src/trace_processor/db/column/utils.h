@@ -28,6 +28,7 @@
 #include "perfetto/trace_processor/basic_types.h"
 #include "src/trace_processor/containers/bit_vector.h"
 #include "src/trace_processor/db/column/data_layer.h"
+#include "src/trace_processor/db/column/simd_compare.h"
 #include "src/trace_processor/db/column/types.h"
 
 namespace perfetto::trace_processor::column::utils {
@@ -76,16 +77,12 @@ void LinearSearchWithComparator(ValType val,
   }
 
   // Fast path: we compare as many groups of 64 elements as we can.
-  // This should be very easy for the compiler to auto-vectorize.
+  // See |CompareWord| for how each group is vectorized.
+  static_assert(internal::kValuesPerWord == BitVector::kBitsInWord);
   uint32_t fast_path_elements = builder.BitsInCompleteWordsUntilFull();
   for (uint32_t i = 0; i < fast_path_elements; i += BitVector::kBitsInWord) {
-    uint64_t word = 0;
-    // This part should be optimised by SIMD and is expected to be fast.
-    for (uint32_t k = 0; k < BitVector::kBitsInWord; ++k, ++cur_val) {
-      bool comp_result = comparator(*cur_val, val);
-      word |= static_cast<uint64_t>(comp_result) << k;
-    }
-    builder.AppendWord(word);
+    builder.AppendWord(CompareWord(cur_val, val, comparator));
+    cur_val += BitVector::kBitsInWord;
   }
 
   // Slow path: we compare <64 elements and append to fill the Builder.
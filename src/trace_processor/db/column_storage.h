@@ -20,6 +20,7 @@
 #include <cstddef>
 #include <cstdint>
 #include <optional>
+#include <utility>
 #include <vector>
 
 #include "perfetto/base/compiler.h"
@@ -46,6 +47,14 @@ class ColumnStorageBase {
   virtual const BitVector* bv() const = 0;
   virtual uint32_t size() const = 0;
   virtual uint32_t non_null_size() const = 0;
+
+  // Returns the number of times a value of this storage was changed in place.
+  // Used to detect indexes made stale by those changes: unlike appends, they
+  // do not change the number of rows.
+  uint64_t mutation_count() const { return mutation_count_; }
+
+ protected:
+  uint64_t mutation_count_ = 0;
 };
 
 // Class used for implementing storage for non-null columns.
@@ -68,7 +77,16 @@ class ColumnStorage final : public ColumnStorageBase {
   void AppendMultiple(T val, uint32_t count) {
     vector_.insert(vector_.end(), count, val);
   }
-  void Set(uint32_t idx, T val) { vector_[idx] = val; }
+  void Set(uint32_t idx, T val) {
+    vector_[idx] = val;
+    ++mutation_count_;
+  }
+  // Fills an empty storage with the |count| values at |data|. Used when
+  // restoring a table from a snapshot.
+  void RestoreFromSnapshot(const T* data, uint32_t count) {
+    PERFETTO_CHECK(vector_.empty());
+    vector_.assign(data, data + count);
+  }
   PERFETTO_NO_INLINE void ShrinkToFit() { vector_.shrink_to_fit(); }
   const std::vector<T>& vector() const { return vector_; }
 
@@ -142,6 +160,7 @@ class ColumnStorage<std::optional<T>> final : public ColumnStorageBase {
     valid_.Resize(valid_.size() + static_cast<uint32_t>(vals.size()), true);
   }
   void Set(uint32_t idx, T val) {
+    ++mutation_count_;
     if (mode_ == Mode::kDense) {
       valid_.Set(idx);
       data_[idx] = val;
@@ -157,6 +176,16 @@ class ColumnStorage<std::optional<T>> final : public ColumnStorageBase {
       }
     }
   }
+  // Fills an empty storage from a snapshot: |data| and |valid| must have the
+  // same layout as |non_null_vector()| and |non_null_bit_vector()| for the
+  // mode of this storage.
+  void RestoreFromSnapshot(const T* data, uint32_t count, BitVector valid) {
+    PERFETTO_CHECK(data_.empty() && valid_.size() == 0);
+    PERFETTO_CHECK(count == (mode_ == Mode::kDense ? valid.size()
+                                                   : valid.CountSetBits()));
+    data_.assign(data, data + count);
+    valid_ = std::move(valid);
+  }
   bool IsDense() const { return mode_ == Mode::kDense; }
   PERFETTO_NO_INLINE void ShrinkToFit() {
     data_.shrink_to_fit();
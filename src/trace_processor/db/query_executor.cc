@@ -23,6 +23,7 @@
 
 #include <sys/types.h>
 #include "perfetto/base/logging.h"
+#include "perfetto/ext/base/threading/thread_pool.h"
 #include "perfetto/trace_processor/basic_types.h"
 #include "src/trace_processor/containers/bit_vector.h"
 #include "src/trace_processor/containers/row_map.h"
@@ -30,6 +31,8 @@
 #include "src/trace_processor/db/column/types.h"
 #include "src/trace_processor/db/query_executor.h"
 #include "src/trace_processor/db/table.h"
+#include "src/trace_processor/tp_metatrace.h"
+#include "src/trace_processor/util/parallel_for.h"
 
 namespace perfetto::trace_processor {
 
@@ -39,11 +42,17 @@ using Range = RowMap::Range;
 using Indices = column::DataLayerChain::Indices;
 using OrderedIndices = column::DataLayerChain::OrderedIndices;
 
+// Searches over fewer rows than this are not worth parallelizing: the cost of
+// waking up the workers and concatenating the results would dominate.
+constexpr uint32_t kMinRowsForParallelSearch =
+    4 * QueryExecutor::kParallelSearchChunkSize;
+
 }  // namespace
 
 void QueryExecutor::ApplyConstraint(const Constraint& c,
                                     const column::DataLayerChain& chain,
-                                    RowMap* rm) {
+                                    RowMap* rm,
+                                    base::ThreadPool* pool) {
   // Shortcut of empty row map.
   uint32_t rm_size = rm->size();
   if (rm_size == 0)
@@ -86,17 +95,23 @@ void QueryExecutor::ApplyConstraint(const Constraint& c,
     IndexSearch(c, chain, rm);
     return;
   }
-  LinearSearch(c, chain, rm);
+  LinearSearch(c, chain, rm, pool);
 }
 
 void QueryExecutor::LinearSearch(const Constraint& c,
                                  const column::DataLayerChain& chain,
-                                 RowMap* rm) {
+                                 RowMap* rm,
+                                 base::ThreadPool* pool) {
   // TODO(b/283763282): Align these to word boundaries.
   Range bounds(rm->Get(0), rm->Get(rm->size() - 1) + 1);
 
-  // Search the storage.
-  RangeOrBitVector res = chain.Search(c.op, c.value, bounds);
+  // Search the storage. The metatrace ring buffer is not thread-safe so don't
+  // search in parallel while DB operations are being traced.
+  bool parallel = pool && bounds.size() >= kMinRowsForParallelSearch &&
+                  (metatrace::g_enabled_categories & metatrace::Category::DB) ==
+                      0;
+  RangeOrBitVector res = parallel ? ParallelSearch(c, chain, bounds, pool)
+                                  : chain.Search(c.op, c.value, bounds);
   if (rm->IsRange()) {
     if (res.IsRange()) {
       Range range = std::move(res).TakeIfRange();
@@ -117,6 +132,90 @@ void QueryExecutor::LinearSearch(const Constraint& c,
   rm->Intersect(RowMap(std::move(res).TakeIfBitVector()));
 }
 
+RangeOrBitVector QueryExecutor::ParallelSearch(
+    const Constraint& c,
+    const column::DataLayerChain& chain,
+    Range bounds,
+    base::ThreadPool* pool) {
+  // Chunks are aligned to multiples of |kParallelSearchChunkSize| so that all
+  // the chunk boundaries (except the start of the first chunk) are on word
+  // boundaries.
+  uint32_t first_chunk = bounds.start / kParallelSearchChunkSize;
+  uint32_t last_chunk = (bounds.end - 1) / kParallelSearchChunkSize;
+  uint32_t chunk_count = last_chunk - first_chunk + 1;
+  auto chunk_range = [&](uint32_t i) {
+    uint32_t chunk = first_chunk + i;
+    return Range(std::max(bounds.start, chunk * kParallelSearchChunkSize),
+                 std::min(bounds.end, (chunk + 1) * kParallelSearchChunkSize));
+  };
+
+  std::vector<std::optional<RangeOrBitVector>> results(chunk_count);
+
+  // Searching can lazily mutate state shared between searches (e.g. interning
+  // the string being searched for): do the first chunk on this thread first
+  // so that all the other chunks only ever read that state.
+  results[0] = chain.Search(c.op, c.value, chunk_range(0));
+  util::ParallelFor(pool, pool->thread_count(), chunk_count - 1,
+                    [&](size_t i) {
+                      auto idx = static_cast<uint32_t>(i + 1);
+                      results[idx] =
+                          chain.Search(c.op, c.value, chunk_range(idx));
+                    });
+
+  // Split the results between chunks which returned ranges and chunks which
+  // returned BitVectors.
+  std::vector<std::optional<Range>> ranges(chunk_count);
+  std::vector<BitVector> bvs(chunk_count);
+  for (uint32_t i = 0; i < chunk_count; ++i) {
+    if (results[i]->IsRange()) {
+      ranges[i] = std::move(*results[i]).TakeIfRange();
+    } else {
+      bvs[i] = std::move(*results[i]).TakeIfBitVector();
+    }
+  }
+
+  // If all the chunks returned ranges which are contiguous, keep the result
+  // a range so as to not lose the benefits of |Range| for the caller.
+  std::optional<Range> merged = Range();
+  for (const auto& range : ranges) {
+    if (!range) {
+      merged = std::nullopt;
+      break;
+    }
+    if (range->empty()) {
+      continue;
+    }
+    if (merged->empty()) {
+      merged = range;
+    } else if (merged->end == range->start) {
+      merged->end = range->end;
+    } else {
+      merged = std::nullopt;
+      break;
+    }
+  }
+  if (merged) {
+    return RangeOrBitVector(*merged);
+  }
+
+  BitVector::Builder builder(bounds.end, bounds.start);
+  for (uint32_t i = 0; i < chunk_count; ++i) {
+    Range chunk = chunk_range(i);
+    if (!ranges[i]) {
+      builder.AppendBitsFrom(bvs[i], chunk.end);
+      continue;
+    }
+    if (ranges[i]->empty()) {
+      builder.AppendRepeated(false, chunk.size());
+      continue;
+    }
+    builder.AppendRepeated(false, ranges[i]->start - chunk.start);
+    builder.AppendRepeated(true, ranges[i]->size());
+    builder.AppendRepeated(false, chunk.end - ranges[i]->end);
+  }
+  return RangeOrBitVector(std::move(builder).Build());
+}
+
 void QueryExecutor::IndexSearch(const Constraint& c,
                                 const column::DataLayerChain& chain,
                                 RowMap* rm) {
@@ -198,7 +297,7 @@ void QueryExecutor::BoundedColumnFilterForTesting(
     const Constraint& c,
     const column::DataLayerChain& col,
     RowMap* rm) {
-  LinearSearch(c, col, rm);
+  LinearSearch(c, col, rm, nullptr);
 }
 
 void QueryExecutor::IndexedColumnFilterForTesting(
@@ -25,6 +25,10 @@
 #include "src/trace_processor/db/column/data_layer.h"
 #include "src/trace_processor/db/column/types.h"
 
+namespace perfetto::base {
+class ThreadPool;
+}  // namespace perfetto::base
+
 namespace perfetto::trace_processor {
 
 // Responsible for executing filtering/sorting operations on a single Table.
@@ -63,16 +67,43 @@ class QueryExecutor {
                                             RowMap*);
 
   // Updates RowMap with result of filtering single column using the Constraint.
+  //
+  // If |pool| is not null, searches over large ranges of rows are split into
+  // chunks which are searched concurrently on |pool|.
   static void ApplyConstraint(const Constraint&,
                               const column::DataLayerChain&,
-                              RowMap*);
+                              RowMap*,
+                              base::ThreadPool* pool = nullptr);
+
+  // Used only in unittests. Exposes private function.
+  static RangeOrBitVector ParallelSearchForTesting(
+      const Constraint& c,
+      const column::DataLayerChain& chain,
+      Range bounds,
+      base::ThreadPool* pool) {
+    return ParallelSearch(c, chain, bounds, pool);
+  }
+
+  // Number of rows searched by each task of a parallel search. This is a
+  // multiple of the BitVector word size so that the results of each chunk can
+  // be concatenated word by word and is small enough that the data of a
+  // (numeric) column chunk stays in L2 cache.
+  static constexpr uint32_t kParallelSearchChunkSize = 32 * 1024;
 
  private:
   // Filters the column using Range algorithm - tries to find the smallest Range
   // to filter the storage with.
   static void LinearSearch(const Constraint&,
                            const column::DataLayerChain&,
-                           RowMap*);
+                           RowMap*,
+                           base::ThreadPool*);
+
+  // Searches |bounds| in chunks of |kParallelSearchChunkSize| rows
+  // concurrently on |pool| and concatenates the results.
+  static RangeOrBitVector ParallelSearch(const Constraint&,
+                                         const column::DataLayerChain&,
+                                         Range,
+                                         base::ThreadPool* pool);
 
   // Filters the column using Index algorithm - finds the indices to filter the
   // storage with.
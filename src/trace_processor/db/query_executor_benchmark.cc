@@ -19,22 +19,31 @@
 #include <cstddef>
 #include <cstdint>
 #include <initializer_list>
+#include <memory>
 #include <optional>
+#include <random>
 #include <string>
 #include <string_view>
 #include <vector>
 
 #include "perfetto/base/logging.h"
 #include "perfetto/ext/base/file_utils.h"
+#include "perfetto/ext/base/flat_hash_map.h"
 #include "perfetto/ext/base/string_utils.h"
 #include "perfetto/ext/base/string_view.h"
+#include "perfetto/ext/base/threading/thread_pool.h"
 #include "perfetto/trace_processor/basic_types.h"
 #include "src/base/test/utils.h"
 #include "src/trace_processor/containers/string_pool.h"
+#include "src/trace_processor/db/column/numeric_storage.h"
+#include "src/trace_processor/db/column/string_storage.h"
 #include "src/trace_processor/db/column/types.h"
+#include "src/trace_processor/db/query_executor.h"
 #include "src/trace_processor/db/table.h"
+#include "src/trace_processor/db/table_aggregator.h"
 #include "src/trace_processor/tables/metadata_tables_py.h"
 #include "src/trace_processor/tables/profiler_tables_py.h"
+#include "src/trace_processor/tables/sched_tables_py.h"
 #include "src/trace_processor/tables/slice_tables_py.h"
 #include "src/trace_processor/tables/track_tables_py.h"
 
@@ -363,6 +372,20 @@ void BM_QESliceTableNameRegex(benchmark::State& state) {
 }
 BENCHMARK(BM_QESliceTableNameRegex);
 
+void BM_QESliceTableNameGt(benchmark::State& state) {
+  SliceTableForBenchmark table(state);
+  BenchmarkSliceTableFilter(state, table, {table.table_.name().gt("M")});
+}
+BENCHMARK(BM_QESliceTableNameGt);
+
+void BM_QESliceTableTrackIdAndNameGlob(benchmark::State& state) {
+  SliceTableForBenchmark table(state);
+  BenchmarkSliceTableFilter(state, table,
+                            {table.table_.track_id().eq(1422),
+                             table.table_.name().glob("*Binder*")});
+}
+BENCHMARK(BM_QESliceTableTrackIdAndNameGlob);
+
 void BM_QESliceTableSorted(benchmark::State& state) {
   SliceTableForBenchmark table(state);
   BenchmarkSliceTableFilter(state, table,
@@ -371,6 +394,26 @@ void BM_QESliceTableSorted(benchmark::State& state) {
 }
 BENCHMARK(BM_QESliceTableSorted);
 
+void BM_QESliceTableDurGt(benchmark::State& state) {
+  SliceTableForBenchmark table(state);
+  BenchmarkSliceTableFilter(state, table, {table.table_.dur().gt(1000000)});
+}
+BENCHMARK(BM_QESliceTableDurGt);
+
+void BM_QESliceTableDurBetween(benchmark::State& state) {
+  SliceTableForBenchmark table(state);
+  BenchmarkSliceTableFilter(
+      state, table,
+      {table.table_.dur().ge(10000), table.table_.dur().le(1000000)});
+}
+BENCHMARK(BM_QESliceTableDurBetween);
+
+void BM_QESliceTableDepthLe(benchmark::State& state) {
+  SliceTableForBenchmark table(state);
+  BenchmarkSliceTableFilter(state, table, {table.table_.depth().le(2)});
+}
+BENCHMARK(BM_QESliceTableDepthLe);
+
 void BM_QEFilterWithSparseSelector(benchmark::State& state) {
   ExpectedFrameTimelineTableForBenchmark table(state);
   Query q;
@@ -686,5 +729,179 @@ void BM_QEMax(benchmark::State& state) {
 }
 BENCHMARK(BM_QEMax);
 
+// Number of rows of the synthetic columns used to benchmark parallel filtering:
+// this is in the order of magnitude of the sched/slice tables of large traces.
+constexpr uint32_t kParallelFilterRows = 16 * 1024 * 1024;
+
+void ParallelFilterThreadArgs(benchmark::internal::Benchmark* b) {
+  for (int threads : {0, 1, 2, 4, 8}) {
+    b->Arg(threads);
+  }
+  b->UseRealTime();
+}
+
+void BenchmarkParallelFilter(benchmark::State& state,
+                             const column::DataLayerChain& chain,
+                             const Constraint& c) {
+  auto threads = static_cast<uint32_t>(state.range(0));
+  std::unique_ptr<base::ThreadPool> pool;
+  if (threads > 0) {
+    pool = std::make_unique<base::ThreadPool>(threads);
+  }
+  for (auto _ : state) {
+    RowMap rm(0, kParallelFilterRows);
+    QueryExecutor::ApplyConstraint(c, chain, &rm, pool.get());
+    benchmark::DoNotOptimize(rm);
+  }
+  state.counters["s/row"] =
+      benchmark::Counter(static_cast<double>(kParallelFilterRows),
+                         benchmark::Counter::kIsIterationInvariantRate |
+                             benchmark::Counter::kInvert);
+}
+
+void BM_QEParallelFilterNumeric(benchmark::State& state) {
+  std::minstd_rand0 rnd(0);
+  std::vector<int64_t> data(kParallelFilterRows);
+  for (auto& d : data) {
+    d = static_cast<int64_t>(rnd() % 1000000);
+  }
+  column::NumericStorage<int64_t> storage(&data, ColumnType::kInt64, false);
+  auto chain = storage.MakeChain();
+  BenchmarkParallelFilter(state, *chain,
+                          Constraint{0, FilterOp::kGt, SqlValue::Long(500000)});
+}
+BENCHMARK(BM_QEParallelFilterNumeric)->Apply(ParallelFilterThreadArgs);
+
+void BM_QEParallelFilterStringGlob(benchmark::State& state) {
+  StringPool pool;
+  std::vector<StringPool::Id> names;
+  for (uint32_t i = 0; i < 10000; ++i) {
+    names.push_back(pool.InternString(
+        base::StringView("slice_name_" + std::to_string(i))));
+  }
+  std::minstd_rand0 rnd(0);
+  std::vector<StringPool::Id> data(kParallelFilterRows);
+  for (auto& d : data) {
+    d = names[rnd() % names.size()];
+  }
+  column::StringStorage storage(&pool, &data);
+  auto chain = storage.MakeChain();
+  BenchmarkParallelFilter(
+      state, *chain,
+      Constraint{0, FilterOp::kGlob, SqlValue::String("*_12*")});
+}
+BENCHMARK(BM_QEParallelFilterStringGlob)->Apply(ParallelFilterThreadArgs);
+
+// Number of rows of the synthetic sched/slice-shaped tables used to benchmark
+// aggregations.
+constexpr uint32_t kAggregateRows = 4 * 1024 * 1024;
+
+// Arguments of the aggregation benchmarks: 0 aggregates by iterating the
+// table and converting every cell to a SqlValue (which is roughly what
+// happens when SQLite aggregates over the table), 1 uses TableAggregator.
+void AggregateArgs(benchmark::internal::Benchmark* b) {
+  b->Arg(0);
+  b->Arg(1);
+}
+
+// Computes COUNT(*) and SUM of |aggregates| for each value of |group_by|
+// through the table iterator.
+size_t IteratorAggregate(const Table& table,
+                         const Query& q,
+                         uint32_t group_by,
+                         const std::vector<uint32_t>& aggregates) {
+  base::FlatHashMap<std::string, std::vector<int64_t>> groups;
+  for (auto it = table.QueryToIterator(q); it; ++it) {
+    SqlValue key = it.Get(group_by);
+    std::string str = key.type == SqlValue::kString
+                          ? key.string_value
+                          : std::to_string(key.AsLong());
+    auto* acc = groups.Insert(str, std::vector<int64_t>(aggregates.size() + 1))
+                    .first;
+    (*acc)[0]++;
+    for (uint32_t i = 0; i < aggregates.size(); ++i) {
+      SqlValue value = it.Get(aggregates[i]);
+      (*acc)[i + 1] += value.is_null() ? 0 : value.AsLong();
+    }
+  }
+  return groups.size();
+}
+
+void BenchmarkAggregate(benchmark::State& state,
+                        const Table& table,
+                        const Query& q,
+                        uint32_t group_by,
+                        const std::vector<uint32_t>& aggregates) {
+  std::vector<TableAggregator::Aggregate> aggs = {
+      {TableAggregator::Op::kCount, std::nullopt}};
+  for (uint32_t col : aggregates) {
+    aggs.push_back({TableAggregator::Op::kSum, col});
+  }
+  for (auto _ : state) {
+    if (state.range(0)) {
+      benchmark::DoNotOptimize(
+          TableAggregator::Compute(table, q, group_by, aggs, 1024 * 1024));
+    } else {
+      benchmark::DoNotOptimize(
+          IteratorAggregate(table, q, group_by, aggregates));
+    }
+  }
+  state.counters["s/row"] =
+      benchmark::Counter(static_cast<double>(table.row_count()),
+                         benchmark::Counter::kIsIterationInvariantRate |
+                             benchmark::Counter::kInvert);
+}
+
+void BM_QEAggregateSchedDurByCpu(benchmark::State& state) {
+  // SELECT ucpu, COUNT(*), SUM(dur) FROM sched GROUP BY ucpu
+  StringPool pool;
+  tables::SchedSliceTable sched(&pool);
+  std::minstd_rand0 rnd(0);
+  StringPool::Id end_states[] = {pool.InternString("R"),
+                                 pool.InternString("S"),
+                                 pool.InternString("D")};
+  for (uint32_t i = 0; i < kAggregateRows; ++i) {
+    tables::SchedSliceTable::Row row;
+    row.ts = i * 1000;
+    row.dur = rnd() % 1000;
+    row.utid = rnd() % 2000;
+    row.end_state = end_states[rnd() % 3];
+    row.priority = 120;
+    row.ucpu = tables::CpuTable::Id(rnd() % 8);
+    sched.Insert(row);
+  }
+  BenchmarkAggregate(state, sched, Query(), sched.ucpu().index_in_table(),
+                     {sched.dur().index_in_table()});
+}
+BENCHMARK(BM_QEAggregateSchedDurByCpu)->Apply(AggregateArgs);
+
+void BM_QEAggregateSliceDurByName(benchmark::State& state) {
+  // SELECT name, COUNT(*), SUM(dur), SUM(depth) FROM slice WHERE dur > 0
+  // GROUP BY name
+  StringPool pool;
+  tables::SliceTable slices(&pool);
+  std::vector<StringPool::Id> names;
+  for (uint32_t i = 0; i < 1000; ++i) {
+    names.push_back(pool.InternString(
+        base::StringView("slice_name_" + std::to_string(i))));
+  }
+  std::minstd_rand0 rnd(0);
+  for (uint32_t i = 0; i < kAggregateRows; ++i) {
+    tables::SliceTable::Row row;
+    row.ts = i * 1000;
+    row.dur = static_cast<int64_t>(rnd() % 1000) - 10;
+    row.track_id = tables::TrackTable::Id(rnd() % 500);
+    row.name = names[rnd() % names.size()];
+    row.depth = rnd() % 16;
+    slices.Insert(row);
+  }
+  Query q;
+  q.constraints = {slices.dur().gt(0)};
+  BenchmarkAggregate(
+      state, slices, q, slices.name().index_in_table(),
+      {slices.dur().index_in_table(), slices.depth().index_in_table()});
+}
+BENCHMARK(BM_QEAggregateSliceDurByName)->Apply(AggregateArgs);
+
 }  // namespace
 }  // namespace perfetto::trace_processor
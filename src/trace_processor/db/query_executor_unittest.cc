@@ -24,6 +24,7 @@
 #include <vector>
 
 #include "perfetto/ext/base/string_view.h"
+#include "perfetto/ext/base/threading/thread_pool.h"
 #include "perfetto/trace_processor/basic_types.h"
 #include "src/trace_processor/containers/bit_vector.h"
 #include "src/trace_processor/containers/row_map.h"
@@ -628,6 +629,78 @@ TEST(QueryExecutor, MismatchedTypeSetIdWithDouble) {
   ASSERT_EQ(res.size(), 9u);
 }
 
+TEST(QueryExecutor, ParallelSearchMatchesSerialSearch) {
+  // Not a multiple of the chunk size so that the last chunk is partial.
+  constexpr uint32_t kSize = 5 * QueryExecutor::kParallelSearchChunkSize + 77;
+  std::vector<int64_t> storage_data(kSize);
+  for (uint32_t i = 0; i < kSize; ++i) {
+    storage_data[i] = (i * 7919) % 1000;
+  }
+  column::NumericStorage<int64_t> storage(&storage_data, ColumnType::kInt64,
+                                          false);
+  auto chain = storage.MakeChain();
+  base::ThreadPool pool(4);
+
+  Constraint c{0, FilterOp::kLt, SqlValue::Long(300)};
+  // Start and end away from the chunk and word boundaries.
+  Range bounds(1234, kSize - 5);
+  BitVector parallel =
+      QueryExecutor::ParallelSearchForTesting(c, *chain, bounds, &pool)
+          .TakeIfBitVector();
+  BitVector serial =
+      chain->Search(c.op, c.value, bounds).TakeIfBitVector();
+
+  ASSERT_EQ(parallel.size(), serial.size());
+  ASSERT_EQ(parallel.GetSetBitIndices(), serial.GetSetBitIndices());
+  ASSERT_EQ(parallel.CountSetBits(), serial.CountSetBits());
+}
+
+TEST(QueryExecutor, ParallelSearchSortedReturnsRange) {
+  constexpr uint32_t kSize = 6 * QueryExecutor::kParallelSearchChunkSize;
+  std::vector<int64_t> storage_data(kSize);
+  std::iota(storage_data.begin(), storage_data.end(), 0);
+  column::NumericStorage<int64_t> storage(&storage_data, ColumnType::kInt64,
+                                          true);
+  auto chain = storage.MakeChain();
+  base::ThreadPool pool(4);
+
+  Constraint c{0, FilterOp::kGe, SqlValue::Long(100000)};
+  RangeOrBitVector res = QueryExecutor::ParallelSearchForTesting(
+      c, *chain, Range(10, kSize), &pool);
+  ASSERT_TRUE(res.IsRange());
+  Range range = std::move(res).TakeIfRange();
+  ASSERT_EQ(range.start, 100000u);
+  ASSERT_EQ(range.end, kSize);
+}
+
+TEST(QueryExecutor, ParallelFilterString) {
+  constexpr uint32_t kSize = 5 * QueryExecutor::kParallelSearchChunkSize;
+  StringPool pool;
+  std::vector<StringPool::Id> ids(kSize);
+  for (uint32_t i = 0; i < kSize; ++i) {
+    ids[i] = i % 3 == 0 ? StringPool::Id::Null()
+                        : pool.InternString(base::StringView(
+                              "str" + std::to_string(i % 10)));
+  }
+  StringStorage storage(&pool, &ids);
+  auto chain = storage.MakeChain();
+  base::ThreadPool thread_pool(4);
+
+  // The searched string is not in the pool yet: it is interned by the first
+  // chunk before the other ones are searched.
+  for (const char* val : {"str1", "not_in_pool"}) {
+    Constraint c{0, FilterOp::kGe, SqlValue::String(val)};
+    RowMap parallel(0, kSize);
+    QueryExecutor::ApplyConstraint(c, *chain, &parallel, &thread_pool);
+    RowMap serial(0, kSize);
+    QueryExecutor::ApplyConstraint(c, *chain, &serial);
+    ASSERT_EQ(parallel.size(), serial.size());
+    for (uint32_t i = 0; i < serial.size(); ++i) {
+      ASSERT_EQ(parallel.Get(i), serial.Get(i));
+    }
+  }
+}
+
 #if !PERFETTO_BUILDFLAG(PERFETTO_OS_WIN)
 TEST(QueryExecutor, StringBinarySearchRegex) {
   StringPool pool;
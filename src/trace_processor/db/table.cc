@@ -142,7 +142,7 @@ Table Table::CopyExceptOverlays() const {
   return {string_pool_, row_count_, std::move(cols), {}};
 }
 
-RowMap Table::QueryToRowMap(const Query& q) const {
+RowMap Table::QueryToRowMap(const Query& q, base::ThreadPool* pool) const {
   // We need to delay creation of the chains to this point because of Chrome
   // does not want the binary size overhead of including the chain
   // implementations. As they also don't query tables (instead just iterating)
@@ -171,7 +171,7 @@ RowMap Table::QueryToRowMap(const Query& q) const {
   // Filter on constraints that are not using index.
   for (; cs_offset < cs.size(); cs_offset++) {
     const Constraint& c = cs[cs_offset];
-    QueryExecutor::ApplyConstraint(c, ChainForColumn(c.col_idx), &rm);
+    QueryExecutor::ApplyConstraint(c, ChainForColumn(c.col_idx), &rm, pool);
   }
 
   if (q.order_type != Query::OrderType::kSort) {
@@ -285,25 +285,49 @@ void Table::CreateChains() const {
   }
 }
 
-base::Status Table::CreateIndex(const std::string& name,
-                                std::vector<uint32_t> col_idxs,
-                                bool replace) {
+std::vector<uint32_t> Table::ComputeIndex(
+    const std::vector<uint32_t>& cols) const {
   Query q;
-  for (const auto& c : col_idxs) {
+  for (const auto& c : cols) {
     q.orders.push_back({c});
   }
-  std::vector<uint32_t> index = QueryToRowMap(q).TakeAsIndexVector();
+  return QueryToRowMap(q).TakeAsIndexVector();
+}
+
+uint64_t Table::MutationCount(const std::vector<uint32_t>& cols) const {
+  uint64_t count = 0;
+  for (uint32_t col : cols) {
+    const ColumnLegacy& c = columns_[col];
+    if (!c.IsId() && !c.IsDummy()) {
+      count += c.storage_base().mutation_count();
+    }
+  }
+  return count;
+}
+
+bool Table::IsIndexFresh(const ColumnIndex& idx) const {
+  return idx.index.size() == row_count_ &&
+         idx.mutation_count == MutationCount(idx.columns);
+}
+
+base::Status Table::CreateIndex(const std::string& name,
+                                std::vector<uint32_t> col_idxs,
+                                bool replace) {
+  std::vector<uint32_t> index = ComputeIndex(col_idxs);
+  uint64_t mutation_count = MutationCount(col_idxs);
 
   auto it = std::find_if(
       indexes_.begin(), indexes_.end(),
       [&name](const ColumnIndex& idx) { return idx.name == name; });
   if (it == indexes_.end()) {
-    indexes_.push_back({name, std::move(col_idxs), std::move(index)});
+    indexes_.push_back(
+        {name, std::move(col_idxs), std::move(index), mutation_count});
     return base::OkStatus();
   }
   if (replace) {
     it->columns = std::move(col_idxs);
     it->index = std::move(index);
+    it->mutation_count = mutation_count;
     return base::OkStatus();
   }
   return base::ErrStatus("Index of this name already exists on this table.");
@@ -374,10 +398,10 @@ void Table::ApplySort(const Query& q, RowMap* rm) const {
   *rm = RowMap(std::move(idx));
 }
 
-RowMap Table::TryApplyIndex(const std::vector<Constraint>& c_vec,
-                            uint32_t& cs_offset) const {
-  RowMap rm(0, row_count());
-
+std::optional<OrderedIndices> Table::FindIndexForConstraints(
+    const std::vector<Constraint>& c_vec,
+    bool rebuild_stale,
+    uint32_t& cs_count) const {
   // Prework - use indexes if possible and decide which one.
   std::vector<uint32_t> maybe_idx_cols;
   for (const auto& c : c_vec) {
@@ -398,28 +422,51 @@ RowMap Table::TryApplyIndex(const std::vector<Constraint>& c_vec,
     }
   }
 
-  OrderedIndices o_idxs;
   while (!maybe_idx_cols.empty()) {
-    if (auto maybe_idx = GetIndex(maybe_idx_cols)) {
-      o_idxs = *maybe_idx;
-      break;
+    for (auto& idx : indexes_) {
+      if (maybe_idx_cols.size() > idx.columns.size() ||
+          !std::equal(maybe_idx_cols.begin(), maybe_idx_cols.end(),
+                      idx.columns.begin())) {
+        continue;
+      }
+      if (PERFETTO_UNLIKELY(!IsIndexFresh(idx))) {
+        if (!rebuild_stale) {
+          continue;
+        }
+        idx.index = ComputeIndex(idx.columns);
+        idx.mutation_count = MutationCount(idx.columns);
+      }
+      cs_count = static_cast<uint32_t>(maybe_idx_cols.size());
+      return OrderedIndicesFromIndex(idx.index);
     }
     maybe_idx_cols.pop_back();
   }
+  cs_count = 0;
+  return std::nullopt;
+}
+
+RowMap Table::TryApplyIndex(const std::vector<Constraint>& c_vec,
+                            uint32_t& cs_offset) const {
+  RowMap rm(0, row_count());
+
+  uint32_t idx_cs_count = 0;
+  std::optional<OrderedIndices> maybe_o_idxs =
+      FindIndexForConstraints(c_vec, /*rebuild_stale=*/true, idx_cs_count);
 
   // If we can't use the index just apply constraints in a standard way.
-  if (maybe_idx_cols.empty()) {
+  if (!maybe_o_idxs) {
     return rm;
   }
 
-  for (uint32_t i = 0; i < maybe_idx_cols.size(); i++) {
+  OrderedIndices o_idxs = *maybe_o_idxs;
+  for (uint32_t i = 0; i < idx_cs_count; i++) {
     const Constraint& c = c_vec[i];
     Range r =
         ChainForColumn(c.col_idx).OrderedIndexSearch(c.op, c.value, o_idxs);
     o_idxs.data += r.start;
     o_idxs.size = r.size();
   }
-  cs_offset = static_cast<uint32_t>(maybe_idx_cols.size());
+  cs_offset = idx_cs_count;
 
   std::vector<uint32_t> res_vec(o_idxs.data, o_idxs.data + o_idxs.size);
   if (res_vec.size() < kIndexVectorThreshold) {
@@ -38,6 +38,10 @@
 #include "src/trace_processor/db/column/types.h"
 #include "src/trace_processor/db/column_storage_overlay.h"
 
+namespace perfetto::base {
+class ThreadPool;
+}  // namespace perfetto::base
+
 namespace perfetto::trace_processor {
 
 namespace {
@@ -143,7 +147,10 @@ class Table {
 
   // Filters and sorts the tables with the arguments specified, returning the
   // result as a RowMap.
-  RowMap QueryToRowMap(const Query&) const;
+  //
+  // If |pool| is not null, filtering large tables is parallelized on |pool|.
+  // See QueryExecutor::ApplyConstraint.
+  RowMap QueryToRowMap(const Query&, base::ThreadPool* pool = nullptr) const;
 
   // Applies the RowMap |rm| onto this table and returns an iterator over the
   // resulting rows.
@@ -157,19 +164,34 @@ class Table {
     return Iterator(this, std::move(rm));
   }
 
+  // Returns an index whose leading columns are |cols|, if any. Indexes which
+  // are stale because rows were inserted or changed after they were built are
+  // not returned: they are only rebuilt when a query is run (see
+  // |TryApplyIndex|).
   std::optional<OrderedIndices> GetIndex(
       const std::vector<uint32_t>& cols) const {
     for (const auto& idx : indexes_) {
       if (cols.size() > idx.columns.size()) {
         continue;
       }
-      if (std::equal(cols.begin(), cols.end(), idx.columns.begin())) {
+      if (std::equal(cols.begin(), cols.end(), idx.columns.begin()) &&
+          IsIndexFresh(idx)) {
         return OrderedIndicesFromIndex(idx.index);
       }
     }
     return std::nullopt;
   }
 
+  // Returns the number of leading constraints in |cs| which can be resolved by
+  // binary searching an index created with |CreateIndex|. Only the columns and
+  // operators of the constraints are taken into account. Stale indexes are not
+  // counted and, as this is used for query planning, never rebuilt.
+  uint32_t IndexedConstraintCount(const std::vector<Constraint>& cs) const {
+    uint32_t count = 0;
+    FindIndexForConstraints(cs, /*rebuild_stale=*/false, count);
+    return count;
+  }
+
   // Adds an index onto column.
   // Returns an error if index already exists and `!replace`.
   base::Status CreateIndex(const std::string& name,
@@ -248,11 +270,16 @@ class Table {
  private:
   friend class ColumnLegacy;
   friend class QueryExecutor;
+  friend class TableAggregator;
+  friend class TableColumnarExport;
+  friend class TableSnapshot;
 
   struct ColumnIndex {
     std::string name;
     std::vector<uint32_t> columns;
     std::vector<uint32_t> index;
+    // The value of |MutationCount(columns)| when |index| was computed.
+    uint64_t mutation_count = 0;
   };
 
   bool HasNullOrOverlayLayer(uint32_t col_idx) const;
@@ -264,6 +291,20 @@ class Table {
   void ApplyDistinct(const Query&, RowMap*) const;
   void ApplySort(const Query&, RowMap*) const;
 
+  std::vector<uint32_t> ComputeIndex(const std::vector<uint32_t>& cols) const;
+  // Returns the sum of the mutation counts of the storages of |cols|. Child
+  // tables share the storage of the columns of their parent so this also
+  // accounts for values changed through a child table.
+  uint64_t MutationCount(const std::vector<uint32_t>& cols) const;
+  // Returns whether |idx| reflects the current rows and values of the table.
+  bool IsIndexFresh(const ColumnIndex& idx) const;
+  // Returns the index used to resolve the leading |cs_count| constraints of
+  // the given constraints. If |rebuild_stale| is true, an index which went
+  // stale is rebuilt and used; otherwise it is skipped.
+  std::optional<OrderedIndices> FindIndexForConstraints(
+      const std::vector<Constraint>&,
+      bool rebuild_stale,
+      uint32_t& cs_count) const;
   RowMap TryApplyIndex(const std::vector<Constraint>&,
                        uint32_t& cs_offset) const;
   RowMap ApplyIdJoinConstraints(const std::vector<Constraint>&,
@@ -283,7 +324,9 @@ class Table {
   std::vector<RefPtr<column::OverlayLayer>> overlay_layers_;
   mutable std::vector<std::unique_ptr<column::DataLayerChain>> chains_;
 
-  std::vector<ColumnIndex> indexes_;
+  // Mutable as indexes are lazily rebuilt in |TryApplyIndex| if the table grew
+  // or the indexed columns changed.
+  mutable std::vector<ColumnIndex> indexes_;
 };
 
 }  // namespace perfetto::trace_processor
@@ -0,0 +1,477 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "src/trace_processor/db/table_aggregator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+#include "perfetto/base/compiler.h"
+#include "perfetto/base/logging.h"
+#include "perfetto/ext/base/flat_hash_map.h"
+#include "perfetto/trace_processor/basic_types.h"
+#include "src/trace_processor/containers/bit_vector.h"
+#include "src/trace_processor/containers/row_map.h"
+#include "src/trace_processor/containers/string_pool.h"
+#include "src/trace_processor/db/column.h"
+#include "src/trace_processor/db/column/types.h"
+#include "src/trace_processor/db/column_storage_overlay.h"
+#include "src/trace_processor/db/table.h"
+#include "src/trace_processor/tp_metatrace.h"
+
+namespace perfetto::trace_processor {
+namespace {
+
+using Op = TableAggregator::Op;
+
+// Number of rows for which storage indices are materialized at a time.
+constexpr uint32_t kChunkSize = 4096;
+
+// Group keys below this value are looked up in a vector rather than hashed.
+constexpr int64_t kMaxDirectKey = 64 * 1024;
+
+// Type erased view of the storage of a column.
+struct ColumnData {
+  ColumnType type = ColumnType::kDummy;
+  const void* data = nullptr;
+  // Set only for nullable columns.
+  const BitVector* valid = nullptr;
+  bool dense = false;
+  uint32_t overlay = 0;
+};
+
+std::optional<ColumnData> GetColumnData(const ColumnLegacy& col) {
+  ColumnData data;
+  data.type = col.col_type();
+  data.overlay = col.overlay_index();
+  switch (data.type) {
+    case ColumnType::kDummy:
+      return std::nullopt;
+    case ColumnType::kId:
+      return data;
+    case ColumnType::kInt32:
+    case ColumnType::kUint32:
+    case ColumnType::kInt64:
+    case ColumnType::kDouble:
+    case ColumnType::kString:
+      data.data = col.storage_base().data();
+      data.valid = col.storage_base().bv();
+      data.dense = col.IsDense();
+      return data;
+  }
+  PERFETTO_FATAL("For GCC");
+}
+
+bool IsNumeric(ColumnType type) {
+  return type != ColumnType::kString && type != ColumnType::kDummy;
+}
+
+// Calls |fn(i, value)| for each row |i| in |idx| with a non-null value.
+// Doubles which are NaN are treated as NULL as SQLite does.
+template <typename T, typename Fn>
+PERFETTO_ALWAYS_INLINE void ForEachValue(const ColumnData& col,
+                                         const uint32_t* idx,
+                                         uint32_t size,
+                                         Fn fn) {
+  const T* data = static_cast<const T*>(col.data);
+  auto call = [&fn](uint32_t i, T value) {
+    if constexpr (std::is_same_v<T, double>) {
+      if (std::isnan(value)) {
+        return;
+      }
+    }
+    if constexpr (std::is_same_v<T, StringPool::Id>) {
+      if (value.is_null()) {
+        return;
+      }
+    }
+    fn(i, value);
+  };
+  if (!col.valid) {
+    for (uint32_t i = 0; i < size; ++i) {
+      call(i, data[idx[i]]);
+    }
+  } else if (col.dense) {
+    for (uint32_t i = 0; i < size; ++i) {
+      if (col.valid->IsSet(idx[i])) {
+        call(i, data[idx[i]]);
+      }
+    }
+  } else {
+    for (uint32_t i = 0; i < size; ++i) {
+      if (col.valid->IsSet(idx[i])) {
+        call(i, data[col.valid->CountSetBits(idx[i])]);
+      }
+    }
+  }
+}
+
+// Dispatches to ForEachValue based on the type of |col|.
+template <typename Fn>
+PERFETTO_ALWAYS_INLINE void ForEachValue(const ColumnData& col,
+                                         const uint32_t* idx,
+                                         uint32_t size,
+                                         Fn fn) {
+  switch (col.type) {
+    case ColumnType::kId:
+      for (uint32_t i = 0; i < size; ++i) {
+        fn(i, static_cast<int64_t>(idx[i]));
+      }
+      return;
+    case ColumnType::kInt32:
+      ForEachValue<int32_t>(col, idx, size, fn);
+      return;
+    case ColumnType::kUint32:
+      ForEachValue<uint32_t>(col, idx, size, fn);
+      return;
+    case ColumnType::kInt64:
+      ForEachValue<int64_t>(col, idx, size, fn);
+      return;
+    case ColumnType::kDouble:
+      ForEachValue<double>(col, idx, size, fn);
+      return;
+    case ColumnType::kString:
+      ForEachValue<StringPool::Id>(col, idx, size, fn);
+      return;
+    case ColumnType::kDummy:
+      PERFETTO_FATAL("Dummy columns cannot be aggregated");
+  }
+}
+
+// The state of one aggregate for one group.
+struct Accumulator {
+  // Number of non-null values seen.
+  int64_t count = 0;
+  // Used for SUM/MIN/MAX of integer columns.
+  int64_t i = 0;
+  // Used for SUM/MIN/MAX of double columns. For SUM, |err| is the
+  // compensation term of the Kahan-Babuska-Neumaier summation which SQLite
+  // also uses.
+  double r = 0;
+  double err = 0;
+};
+
+void AddDouble(Accumulator& acc, double v) {
+  double t = acc.r + v;
+  if (std::fabs(acc.r) > std::fabs(v)) {
+    acc.err += (acc.r - t) + v;
+  } else {
+    acc.err += (v - t) + acc.r;
+  }
+  acc.r = t;
+}
+
+// Updates the accumulators at |accs[group[i] * stride]| (or just |accs[0]| if
+// not |kGrouped|) with the value of each row |i| in the chunk. The switch on
+// |op| is done outside the loop so that each combination of aggregate and
+// column type gets its own loop.
+// Returns false if the result cannot be represented (i.e. integer overflow).
+template <bool kGrouped>
+bool Accumulate(Op op,
+                const ColumnData& col,
+                const uint32_t* idx,
+                const uint32_t* group,
+                uint32_t size,
+                Accumulator* accs,
+                size_t stride) {
+  // Without groups, accumulate into a local which can be kept in registers.
+  Accumulator local = accs[0];
+  auto acc_for = [&](uint32_t i) -> Accumulator& {
+    if constexpr (kGrouped) {
+      return accs[group[i] * stride];
+    } else {
+      base::ignore_result(i);
+      return local;
+    }
+  };
+  bool overflow = false;
+  switch (op) {
+    case Op::kCount:
+      ForEachValue(col, idx, size,
+                   [&](uint32_t i, auto) { acc_for(i).count++; });
+      break;
+    case Op::kSum:
+      ForEachValue(col, idx, size, [&](uint32_t i, auto value) {
+        Accumulator& acc = acc_for(i);
+        if constexpr (std::is_same_v<decltype(value), double>) {
+          AddDouble(acc, value);
+        } else if constexpr (std::is_integral_v<decltype(value)>) {
+          overflow |= __builtin_add_overflow(
+              acc.i, static_cast<int64_t>(value), &acc.i);
+        }
+        acc.count++;
+      });
+      break;
+    case Op::kMin:
+    case Op::kMax: {
+      bool is_min = op == Op::kMin;
+      ForEachValue(col, idx, size, [&](uint32_t i, auto value) {
+        Accumulator& acc = acc_for(i);
+        if constexpr (std::is_same_v<decltype(value), double>) {
+          if (acc.count == 0 || (is_min ? value < acc.r : value > acc.r)) {
+            acc.r = value;
+          }
+        } else if constexpr (std::is_integral_v<decltype(value)>) {
+          auto v = static_cast<int64_t>(value);
+          if (acc.count == 0 || (is_min ? v < acc.i : v > acc.i)) {
+            acc.i = v;
+          }
+        }
+        acc.count++;
+      });
+      break;
+    }
+  }
+  if constexpr (!kGrouped) {
+    accs[0] = local;
+  }
+  return !overflow;
+}
+
+SqlValue ToSqlValue(Op op, ColumnType type, const Accumulator& acc) {
+  if (op == Op::kCount) {
+    return SqlValue::Long(acc.count);
+  }
+  if (acc.count == 0) {
+    return SqlValue();
+  }
+  if (type != ColumnType::kDouble) {
+    return SqlValue::Long(acc.i);
+  }
+  if (op == Op::kSum && std::isfinite(acc.err)) {
+    return SqlValue::Double(acc.r + acc.err);
+  }
+  return SqlValue::Double(acc.r);
+}
+
+}  // namespace
+
+std::optional<TableAggregator::Result> TableAggregator::Compute(
+    const Table& table,
+    const Query& query,
+    std::optional<uint32_t> group_by,
+    const std::vector<Aggregate>& aggregates,
+    uint32_t max_groups,
+    base::ThreadPool* pool) {
+  PERFETTO_DCHECK(query.orders.empty());
+  PERFETTO_DCHECK(!query.limit && !query.offset);
+  PERFETTO_TP_TRACE(metatrace::Category::QUERY_DETAILED,
+                    "TABLE_AGGREGATOR_COMPUTE");
+
+  // Check upfront that all the columns can be handled.
+  std::optional<ColumnData> group_col;
+  if (group_by) {
+    group_col = GetColumnData(table.columns()[*group_by]);
+    if (!group_col || group_col->type == ColumnType::kDouble) {
+      return std::nullopt;
+    }
+  }
+  std::vector<std::optional<ColumnData>> agg_cols;
+  for (const Aggregate& agg : aggregates) {
+    if (!agg.col) {
+      if (agg.op != Op::kCount) {
+        return std::nullopt;
+      }
+      agg_cols.emplace_back();
+      continue;
+    }
+    std::optional<ColumnData> col = GetColumnData(table.columns()[*agg.col]);
+    if (!col || (agg.op != Op::kCount && !IsNumeric(col->type))) {
+      return std::nullopt;
+    }
+    agg_cols.emplace_back(col);
+  }
+
+  RowMap rm = table.QueryToRowMap(query, pool);
+  uint32_t row_count = rm.size();
+
+  // Overlays needed for computing the aggregates.
+  std::vector<uint32_t> overlays;
+  auto add_overlay = [&overlays](uint32_t overlay) {
+    if (std::find(overlays.begin(), overlays.end(), overlay) ==
+        overlays.end()) {
+      overlays.push_back(overlay);
+    }
+  };
+  if (group_col) {
+    add_overlay(group_col->overlay);
+  }
+  for (const auto& col : agg_cols) {
+    if (col) {
+      add_overlay(col->overlay);
+    }
+  }
+
+  // For each needed overlay, the rows matching the query expressed in terms of
+  // storage indices.
+  std::vector<ColumnStorageOverlay> selected(table.overlays().size());
+  std::vector<std::optional<ColumnStorageOverlay::Iterator>> its(
+      table.overlays().size());
+  std::vector<std::vector<uint32_t>> idx(table.overlays().size());
+  for (uint32_t overlay : overlays) {
+    selected[overlay] = table.overlays()[overlay].SelectRows(rm);
+    if (!selected[overlay].row_map().IsRange()) {
+      its[overlay] = selected[overlay].IterateRows();
+    }
+    idx[overlay].resize(kChunkSize);
+  }
+
+  // Maps the value of the group column to the index of the group. For string
+  // columns, the key is the raw StringPool::Id. Small non-negative keys (e.g.
+  // cpus, depths or utids) are looked up in |direct_ids| to avoid hashing.
+  constexpr uint32_t kUnassigned = std::numeric_limits<uint32_t>::max();
+  std::vector<uint32_t> direct_ids;
+  base::FlatHashMap<int64_t, uint32_t> group_ids;
+  std::optional<uint32_t> null_group;
+  std::vector<SqlValue> group_keys;
+  std::vector<uint32_t> group(kChunkSize);
+  auto add_group = [&](auto value) {
+    if constexpr (std::is_same_v<decltype(value), StringPool::Id>) {
+      group_keys.push_back(
+          SqlValue::String(table.string_pool()->Get(value).c_str()));
+    } else {
+      group_keys.push_back(SqlValue::Long(static_cast<int64_t>(value)));
+    }
+    return static_cast<uint32_t>(group_keys.size() - 1);
+  };
+  auto find_group = [&](auto value) {
+    int64_t key;
+    if constexpr (std::is_same_v<decltype(value), StringPool::Id>) {
+      key = value.raw_id();
+    } else {
+      key = static_cast<int64_t>(value);
+    }
+    if (key >= 0 && key < kMaxDirectKey) {
+      if (PERFETTO_UNLIKELY(static_cast<size_t>(key) >= direct_ids.size())) {
+        direct_ids.resize(static_cast<size_t>(key) + 1, kUnassigned);
+      }
+      uint32_t& id = direct_ids[static_cast<size_t>(key)];
+      if (PERFETTO_UNLIKELY(id == kUnassigned)) {
+        id = add_group(value);
+      }
+      return id;
+    }
+    uint32_t* id = group_ids.Find(key);
+    return id ? *id : *group_ids.Insert(key, add_group(value)).first;
+  };
+
+  size_t stride = aggregates.size();
+  std::vector<Accumulator> accs;
+  if (!group_col) {
+    accs.resize(stride);
+  }
+
+  for (uint32_t start = 0; start < row_count; start += kChunkSize) {
+    uint32_t size = std::min(kChunkSize, row_count - start);
+    for (uint32_t overlay : overlays) {
+      uint32_t* out = idx[overlay].data();
+      if (its[overlay]) {
+        auto& it = *its[overlay];
+        for (uint32_t i = 0; i < size; ++i, it.Next()) {
+          out[i] = it.index();
+        }
+      } else {
+        std::iota(out, out + size, selected[overlay].Get(start));
+      }
+    }
+
+    if (group_col) {
+      // Rows with a NULL value are not visited by ForEachValue so start by
+      // assigning all rows to the NULL group: if there are any, the group
+      // will be created below.
+      std::fill(group.begin(), group.begin() + size, kUnassigned);
+      ForEachValue(*group_col, idx[group_col->overlay].data(), size,
+                   [&](uint32_t i, auto v) { group[i] = find_group(v); });
+      for (uint32_t i = 0; i < size; ++i) {
+        if (PERFETTO_UNLIKELY(group[i] == kUnassigned)) {
+          if (!null_group) {
+            null_group = static_cast<uint32_t>(group_keys.size());
+            group_keys.emplace_back();
+          }
+          group[i] = *null_group;
+        }
+      }
+      if (group_keys.size() > max_groups) {
+        return std::nullopt;
+      }
+      accs.resize(group_keys.size() * stride);
+    }
+
+    for (uint32_t a = 0; a < aggregates.size(); ++a) {
+      const auto& col = agg_cols[a];
+      if (!col) {
+        // COUNT(*).
+        if (!group_col) {
+          accs[a].count += size;
+          continue;
+        }
+        for (uint32_t i = 0; i < size; ++i) {
+          accs[group[i] * stride + a].count++;
+        }
+        continue;
+      }
+      auto* accumulate = group_col ? &Accumulate<true> : &Accumulate<false>;
+      if (!accumulate(aggregates[a].op, *col, idx[col->overlay].data(),
+                      group.data(), size, accs.data() + a, stride)) {
+        return std::nullopt;
+      }
+    }
+  }
+
+  std::vector<uint32_t> order(group_col ? group_keys.size() : 1);
+  std::iota(order.begin(), order.end(), 0u);
+  if (group_col) {
+    // Match the order SQLite returns groups in: NULL first, then ascending
+    // (by value for integers and byte-wise for strings).
+    std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+      const SqlValue& l = group_keys[a];
+      const SqlValue& r = group_keys[b];
+      if (l.is_null() || r.is_null()) {
+        return l.is_null() && !r.is_null();
+      }
+      if (l.type == SqlValue::kString) {
+        return std::string_view(l.string_value) <
+               std::string_view(r.string_value);
+      }
+      return l.long_value < r.long_value;
+    });
+  }
+
+  Result result;
+  result.reserve(order.size());
+  for (uint32_t g : order) {
+    std::vector<SqlValue> row;
+    if (group_col) {
+      row.push_back(group_keys[g]);
+    }
+    for (uint32_t a = 0; a < aggregates.size(); ++a) {
+      ColumnType type =
+          agg_cols[a] ? agg_cols[a]->type : ColumnType::kInt64;
+      row.push_back(
+          ToSqlValue(aggregates[a].op, type, accs[g * stride + a]));
+    }
+    result.emplace_back(std::move(row));
+  }
+  return result;
+}
+
+}  // namespace perfetto::trace_processor
@@ -0,0 +1,90 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_TRACE_PROCESSOR_DB_TABLE_AGGREGATOR_H_
+#define SRC_TRACE_PROCESSOR_DB_TABLE_AGGREGATOR_H_
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include "perfetto/trace_processor/basic_types.h"
+#include "src/trace_processor/db/column/types.h"
+
+namespace perfetto {
+namespace base {
+class ThreadPool;
+}  // namespace base
+
+namespace trace_processor {
+
+class Table;
+
+// Computes COUNT/SUM/MIN/MAX aggregations, optionally grouped by a single
+// column, directly over the storage of a Table.
+//
+// Instead of producing a SqlValue for every row and cell (as happens when
+// SQLite aggregates over a virtual table), the rows matching the query are
+// processed in chunks of storage indices and each aggregate is computed with
+// a tight loop over the typed storage vector. Grouping is done with a hash map
+// keyed on the integer value (or StringPool::Id) of the group column.
+//
+// The results match what SQLite would return for the equivalent query, e.g.
+//   SELECT depth, COUNT(*), SUM(dur), MAX(ts) FROM slice WHERE dur > 0
+//   GROUP BY depth
+// including the handling of NULLs and empty inputs. Combinations for which
+// this cannot be guaranteed (e.g. SUM over strings, grouping by a double
+// column or integer overflow in SUM) are rejected and the caller is expected
+// to fall back to SQLite.
+class TableAggregator {
+ public:
+  enum class Op {
+    kCount,
+    kSum,
+    kMin,
+    kMax,
+  };
+  struct Aggregate {
+    Op op = Op::kCount;
+    // The column to aggregate or std::nullopt for COUNT(*).
+    std::optional<uint32_t> col;
+  };
+
+  // One row for each group, containing the value of the group column (if
+  // any) followed by the value of each aggregate.
+  using Result = std::vector<std::vector<SqlValue>>;
+
+  // Aggregates the rows of |table| matching the constraints of |query| (which
+  // must not have any orders or a limit).
+  //
+  // If |group_by| is set, one row is returned for each distinct value of the
+  // column, ordered by the value of the column with NULL first. Otherwise a
+  // single row is returned, even if no rows match.
+  //
+  // Returns std::nullopt if the aggregation cannot be computed by this class
+  // or if there are more than |max_groups| groups.
+  static std::optional<Result> Compute(const Table& table,
+                                       const Query& query,
+                                       std::optional<uint32_t> group_by,
+                                       const std::vector<Aggregate>& aggregates,
+                                       uint32_t max_groups,
+                                       base::ThreadPool* pool = nullptr);
+};
+
+}  // namespace trace_processor
+}  // namespace perfetto
+
+#endif  // SRC_TRACE_PROCESSOR_DB_TABLE_AGGREGATOR_H_
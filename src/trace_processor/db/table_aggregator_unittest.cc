@@ -0,0 +1,225 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "src/trace_processor/db/table_aggregator.h"
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "perfetto/trace_processor/basic_types.h"
+#include "src/trace_processor/containers/string_pool.h"
+#include "src/trace_processor/db/column/types.h"
+#include "src/trace_processor/db/table.h"
+#include "src/trace_processor/tables/counter_tables_py.h"
+#include "src/trace_processor/tables/slice_tables_py.h"
+#include "test/gtest_and_gmock.h"
+
+namespace perfetto::trace_processor {
+namespace {
+
+using Aggregate = TableAggregator::Aggregate;
+using Op = TableAggregator::Op;
+using testing::ElementsAre;
+
+// Formats the result of an aggregation as one string per row.
+std::vector<std::string> ToStrings(
+    const std::optional<TableAggregator::Result>& result) {
+  std::vector<std::string> rows;
+  for (const auto& row : *result) {
+    std::string str;
+    for (const SqlValue& value : row) {
+      str += str.empty() ? "" : ",";
+      switch (value.type) {
+        case SqlValue::kNull:
+          str += "NULL";
+          break;
+        case SqlValue::kLong:
+          str += std::to_string(value.long_value);
+          break;
+        case SqlValue::kDouble:
+          str += std::to_string(value.double_value);
+          break;
+        case SqlValue::kString:
+          str += value.string_value;
+          break;
+        case SqlValue::kBytes:
+          str += "<bytes>";
+          break;
+      }
+    }
+    rows.push_back(str);
+  }
+  return rows;
+}
+
+class TableAggregatorTest : public ::testing::Test {
+ protected:
+  TableAggregatorTest() {
+    struct {
+      int64_t ts;
+      int64_t dur;
+      const char* name;
+      uint32_t depth;
+      std::optional<int64_t> thread_dur;
+    } rows[] = {
+        {0, 10, "foo", 0, 5},      {1, 20, "bar", 1, std::nullopt},
+        {2, 30, "foo", 2, 7},      {3, 40, nullptr, 0, std::nullopt},
+        {4, 50, "bar", 1, 9},      {5, 60, "foo", 0, std::nullopt},
+        {6, 70, nullptr, 1, 11},   {7, 80, "baz", 2, std::nullopt},
+    };
+    for (const auto& r : rows) {
+      tables::SliceTable::Row row;
+      row.ts = r.ts;
+      row.dur = r.dur;
+      row.name = r.name ? pool_.InternString(r.name) : StringPool::Id::Null();
+      row.depth = r.depth;
+      row.thread_dur = r.thread_dur;
+      slices_.Insert(row);
+    }
+  }
+
+  uint32_t Col(const Table& table, const char* name) {
+    return *table.ColumnIdxFromName(name);
+  }
+
+  StringPool pool_;
+  tables::SliceTable slices_{&pool_};
+};
+
+TEST_F(TableAggregatorTest, GroupByString) {
+  std::vector<Aggregate> aggs = {
+      {Op::kCount, std::nullopt},
+      {Op::kCount, Col(slices_, "thread_dur")},
+      {Op::kSum, Col(slices_, "dur")},
+      {Op::kMin, Col(slices_, "ts")},
+      {Op::kMax, Col(slices_, "thread_dur")},
+  };
+  auto res = TableAggregator::Compute(slices_, Query(), Col(slices_, "name"),
+                                      aggs, 100);
+  ASSERT_TRUE(res);
+  ASSERT_THAT(ToStrings(res), ElementsAre("NULL,2,1,110,3,11", "bar,2,1,70,1,9",
+                                          "baz,1,0,80,7,NULL",
+                                          "foo,3,2,100,0,7"));
+}
+
+TEST_F(TableAggregatorTest, GroupByIntegerWithConstraints) {
+  Query q;
+  q.constraints = {{Col(slices_, "dur"), FilterOp::kGt, SqlValue::Long(10)},
+                   {Col(slices_, "name"), FilterOp::kIsNotNull, SqlValue()}};
+  std::vector<Aggregate> aggs = {
+      {Op::kCount, std::nullopt},
+      {Op::kSum, Col(slices_, "thread_dur")},
+      {Op::kMax, Col(slices_, "id")},
+  };
+  auto res =
+      TableAggregator::Compute(slices_, q, Col(slices_, "depth"), aggs, 100);
+  ASSERT_TRUE(res);
+  ASSERT_THAT(ToStrings(res),
+              ElementsAre("0,1,NULL,5", "1,2,9,4", "2,2,7,7"));
+}
+
+TEST_F(TableAggregatorTest, NoGroupBy) {
+  std::vector<Aggregate> aggs = {
+      {Op::kCount, std::nullopt},
+      {Op::kSum, Col(slices_, "dur")},
+      {Op::kMin, Col(slices_, "thread_dur")},
+  };
+  auto res =
+      TableAggregator::Compute(slices_, Query(), std::nullopt, aggs, 100);
+  ASSERT_TRUE(res);
+  ASSERT_THAT(ToStrings(res), ElementsAre("8,360,5"));
+
+  // Even if no row matches, a row is returned.
+  Query q;
+  q.constraints = {{Col(slices_, "dur"), FilterOp::kGt, SqlValue::Long(1000)}};
+  res = TableAggregator::Compute(slices_, q, std::nullopt, aggs, 100);
+  ASSERT_TRUE(res);
+  ASSERT_THAT(ToStrings(res), ElementsAre("0,NULL,NULL"));
+
+  // But no groups are returned.
+  res = TableAggregator::Compute(slices_, q, Col(slices_, "depth"), aggs, 100);
+  ASSERT_TRUE(res);
+  ASSERT_TRUE(res->empty());
+}
+
+TEST_F(TableAggregatorTest, SortedTable) {
+  // The rows of a sorted table are not a contiguous range of storage indices.
+  Table sorted = slices_.Sort({{Col(slices_, "dur"), true}});
+  std::vector<Aggregate> aggs = {
+      {Op::kCount, std::nullopt},
+      {Op::kSum, Col(sorted, "dur")},
+      {Op::kMax, Col(sorted, "thread_dur")},
+  };
+  auto res =
+      TableAggregator::Compute(sorted, Query(), Col(sorted, "depth"), aggs, 3);
+  ASSERT_TRUE(res);
+  ASSERT_THAT(ToStrings(res),
+              ElementsAre("0,3,110,5", "1,3,140,11", "2,2,110,7"));
+}
+
+TEST_F(TableAggregatorTest, Doubles) {
+  tables::CounterTable counters(&pool_);
+  double values[] = {1.5, -2.25, std::nan(""), 4.0, 0.5};
+  for (uint32_t i = 0; i < 5; ++i) {
+    tables::CounterTable::Row row;
+    row.ts = i;
+    row.track_id = tables::CounterTrackTable::Id(i % 2);
+    row.value = values[i];
+    counters.Insert(row);
+  }
+  std::vector<Aggregate> aggs = {
+      {Op::kCount, Col(counters, "value")},
+      {Op::kSum, Col(counters, "value")},
+      {Op::kMin, Col(counters, "value")},
+      {Op::kMax, Col(counters, "value")},
+  };
+  auto res = TableAggregator::Compute(counters, Query(),
+                                      Col(counters, "track_id"), aggs, 100);
+  ASSERT_TRUE(res);
+  ASSERT_THAT(ToStrings(res),
+              ElementsAre("0,2,2.000000,0.500000,1.500000",
+                          "1,2,1.750000,-2.250000,4.000000"));
+
+  // Grouping by a double column is not supported.
+  ASSERT_FALSE(TableAggregator::Compute(counters, Query(),
+                                        Col(counters, "value"), aggs, 100));
+}
+
+TEST_F(TableAggregatorTest, Unsupported) {
+  // SUM/MIN/MAX of strings.
+  ASSERT_FALSE(TableAggregator::Compute(
+      slices_, Query(), std::nullopt, {{Op::kMin, Col(slices_, "name")}}, 100));
+
+  // Too many groups.
+  ASSERT_FALSE(TableAggregator::Compute(slices_, Query(), Col(slices_, "ts"),
+                                        {{Op::kCount, std::nullopt}}, 4));
+
+  // Integer overflow.
+  tables::SliceTable::Row row;
+  row.dur = std::numeric_limits<int64_t>::max();
+  slices_.Insert(row);
+  ASSERT_FALSE(TableAggregator::Compute(
+      slices_, Query(), std::nullopt, {{Op::kSum, Col(slices_, "dur")}}, 100));
+  ASSERT_TRUE(TableAggregator::Compute(
+      slices_, Query(), std::nullopt, {{Op::kMax, Col(slices_, "dur")}}, 100));
+}
+
+}  // namespace
+}  // namespace perfetto::trace_processor
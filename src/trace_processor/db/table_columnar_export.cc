@@ -0,0 +1,321 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "src/trace_processor/db/table_columnar_export.h"
+
+#include <fcntl.h>
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "perfetto/base/logging.h"
+#include "perfetto/base/status.h"
+#include "perfetto/ext/base/file_utils.h"
+#include "perfetto/ext/base/flat_hash_map.h"
+#include "perfetto/ext/base/scoped_file.h"
+#include "src/trace_processor/containers/string_pool.h"
+#include "src/trace_processor/db/column.h"
+#include "src/trace_processor/db/column/types.h"
+#include "src/trace_processor/db/column_storage.h"
+#include "src/trace_processor/db/table.h"
+#include "src/trace_processor/util/gzip_utils.h"
+
+namespace perfetto::trace_processor {
+namespace {
+
+using Type = TableColumnarExport::Type;
+using Encoding = TableColumnarExport::Encoding;
+using Compression = TableColumnarExport::Compression;
+
+// Size in bytes of a run of the kDeltaRunLength encoding.
+constexpr size_t kRunSize = sizeof(int64_t) + sizeof(uint32_t);
+
+template <typename T>
+void Append(std::vector<uint8_t>* out, T value) {
+  size_t offset = out->size();
+  out->resize(offset + sizeof(T));
+  memcpy(out->data() + offset, &value, sizeof(T));
+}
+
+void AppendString(std::vector<uint8_t>* out, const char* data, size_t size) {
+  Append(out, static_cast<uint32_t>(size));
+  out->insert(out->end(), data, data + size);
+}
+
+// The values of a column, in row order, gathered from its storage.
+struct ColumnValues {
+  Type type = Type::kInt64;
+  std::vector<uint8_t> validity;
+  bool has_nulls = false;
+
+  // Only the vector matching |type| is populated, with the non-null values.
+  std::vector<int64_t> ints;
+  std::vector<double> doubles;
+  std::vector<StringPool::Id> strings;
+};
+
+void SetValid(ColumnValues* values, uint32_t row) {
+  values->validity[row / 8] |= static_cast<uint8_t>(1u << (row % 8));
+}
+
+template <typename T, typename Out>
+void GatherNumeric(const ColumnLegacy& col,
+                   const std::vector<uint32_t>& indices,
+                   ColumnValues* values,
+                   std::vector<Out>* out) {
+  out->reserve(indices.size());
+  if (!col.IsNullable()) {
+    const auto& storage = col.storage<T>();
+    for (uint32_t i = 0; i < indices.size(); ++i) {
+      out->push_back(static_cast<Out>(storage.Get(indices[i])));
+      SetValid(values, i);
+    }
+    return;
+  }
+  const auto& storage = col.storage<std::optional<T>>();
+  for (uint32_t i = 0; i < indices.size(); ++i) {
+    std::optional<T> value = storage.Get(indices[i]);
+    if (value) {
+      out->push_back(static_cast<Out>(*value));
+      SetValid(values, i);
+    } else {
+      values->has_nulls = true;
+    }
+  }
+}
+
+ColumnValues Gather(const ColumnLegacy& col,
+                    const std::vector<uint32_t>& indices) {
+  ColumnValues values;
+  values.validity.resize((indices.size() + 7) / 8);
+  switch (col.col_type()) {
+    case ColumnType::kId:
+      values.ints.assign(indices.begin(), indices.end());
+      for (uint32_t i = 0; i < indices.size(); ++i) {
+        SetValid(&values, i);
+      }
+      break;
+    case ColumnType::kInt32:
+      GatherNumeric<int32_t>(col, indices, &values, &values.ints);
+      break;
+    case ColumnType::kUint32:
+      GatherNumeric<uint32_t>(col, indices, &values, &values.ints);
+      break;
+    case ColumnType::kInt64:
+      GatherNumeric<int64_t>(col, indices, &values, &values.ints);
+      break;
+    case ColumnType::kDouble:
+      values.type = Type::kDouble;
+      GatherNumeric<double>(col, indices, &values, &values.doubles);
+      break;
+    case ColumnType::kString: {
+      values.type = Type::kString;
+      // Nullable and non-null string columns are both backed by StringPool::Id
+      // storage, with nulls stored as StringPool::Id::Null().
+      const auto& storage =
+          static_cast<const ColumnStorage<StringPool::Id>&>(col.storage_base());
+      values.strings.reserve(indices.size());
+      for (uint32_t i = 0; i < indices.size(); ++i) {
+        StringPool::Id id = storage.Get(indices[i]);
+        if (id.is_null()) {
+          values.has_nulls = true;
+        } else {
+          values.strings.push_back(id);
+          SetValid(&values, i);
+        }
+      }
+      break;
+    }
+    case ColumnType::kDummy:
+      PERFETTO_FATAL("Dummy columns cannot be exported");
+  }
+  return values;
+}
+
+// Appends |ints| with the kDeltaRunLength encoding if it is smaller than the
+// kPlain encoding and returns the encoding used.
+Encoding EncodeInts(const std::vector<int64_t>& ints,
+                    std::vector<uint8_t>* out) {
+  struct Run {
+    int64_t delta;
+    uint32_t length;
+  };
+  std::vector<Run> runs;
+  size_t max_runs = ints.size() * sizeof(int64_t) / kRunSize;
+  for (size_t i = 1; i < ints.size() && runs.size() <= max_runs; ++i) {
+    int64_t delta = static_cast<int64_t>(static_cast<uint64_t>(ints[i]) -
+                                         static_cast<uint64_t>(ints[i - 1]));
+    if (!runs.empty() && runs.back().delta == delta) {
+      runs.back().length++;
+    } else {
+      runs.push_back(Run{delta, 1});
+    }
+  }
+  if (ints.empty() || runs.size() >= max_runs) {
+    for (int64_t value : ints) {
+      Append(out, value);
+    }
+    return Encoding::kPlain;
+  }
+  Append(out, ints[0]);
+  Append(out, static_cast<uint32_t>(runs.size()));
+  for (const Run& run : runs) {
+    Append(out, run.delta);
+    Append(out, run.length);
+  }
+  return Encoding::kDeltaRunLength;
+}
+
+void EncodeStrings(const std::vector<StringPool::Id>& strings,
+                   const StringPool& pool,
+                   std::vector<uint8_t>* out) {
+  base::FlatHashMap<StringPool::Id, uint32_t> entry_for_id;
+  std::vector<StringPool::Id> entries;
+  std::vector<uint32_t> entry_indices;
+  entry_indices.reserve(strings.size());
+  for (StringPool::Id id : strings) {
+    auto [it, inserted] =
+        entry_for_id.Insert(id, static_cast<uint32_t>(entries.size()));
+    if (inserted) {
+      entries.push_back(id);
+    }
+    entry_indices.push_back(*it);
+  }
+  Append(out, static_cast<uint32_t>(entries.size()));
+  for (StringPool::Id id : entries) {
+    NullTermStringView str = pool.Get(id);
+    AppendString(out, str.data(), str.size());
+  }
+  for (uint32_t idx : entry_indices) {
+    Append(out, idx);
+  }
+}
+
+void EncodeColumn(const ColumnLegacy& col,
+                  const std::vector<uint32_t>& indices,
+                  const StringPool& pool,
+                  std::vector<uint8_t>* out) {
+  ColumnValues values = Gather(col, indices);
+
+  std::vector<uint8_t> payload;
+  if (values.has_nulls) {
+    payload = values.validity;
+  }
+  Encoding encoding = Encoding::kPlain;
+  switch (values.type) {
+    case Type::kInt64:
+      encoding = EncodeInts(values.ints, &payload);
+      break;
+    case Type::kDouble:
+      for (double value : values.doubles) {
+        Append(&payload, value);
+      }
+      break;
+    case Type::kString:
+      encoding = Encoding::kDictionary;
+      EncodeStrings(values.strings, pool, &payload);
+      break;
+  }
+
+  // Only keep the compressed payload if it is actually smaller: this is not
+  // the case for tiny columns or when zlib is not available.
+  std::vector<uint8_t> compressed =
+      util::RawDeflateFast(payload.data(), payload.size());
+  bool use_compressed =
+      !compressed.empty() && compressed.size() < payload.size();
+
+  uint8_t flags = 0;
+  if (values.has_nulls) {
+    flags |= TableColumnarExport::kHasNulls;
+  }
+  if (col.IsSorted()) {
+    flags |= TableColumnarExport::kSorted;
+  }
+  if (col.IsId()) {
+    flags |= TableColumnarExport::kId;
+  }
+
+  AppendString(out, col.name(), strlen(col.name()));
+  Append(out, static_cast<uint8_t>(values.type));
+  Append(out, static_cast<uint8_t>(encoding));
+  Append(out, static_cast<uint8_t>(use_compressed ? Compression::kDeflate
+                                                  : Compression::kNone));
+  Append(out, flags);
+  Append(out, static_cast<uint64_t>(payload.size()));
+  const std::vector<uint8_t>& stored = use_compressed ? compressed : payload;
+  Append(out, static_cast<uint64_t>(stored.size()));
+  out->insert(out->end(), stored.begin(), stored.end());
+}
+
+bool IsExported(const ColumnLegacy& col) {
+  return !col.IsHidden() && !col.IsDummy();
+}
+
+}  // namespace
+
+// static
+std::vector<uint8_t> TableColumnarExport::Encode(const Table& table,
+                                                 const StringPool& pool) {
+  std::vector<uint8_t> out(kMagic, kMagic + sizeof(kMagic) - 1);
+  Append(&out, table.row_count());
+  uint32_t column_count = 0;
+  for (const ColumnLegacy& col : table.columns()) {
+    column_count += IsExported(col);
+  }
+  Append(&out, column_count);
+
+  // The storage indices of the rows are shared by all the columns using the
+  // same overlay so they are only computed once per overlay.
+  std::vector<std::optional<std::vector<uint32_t>>> indices_for_overlay(
+      table.overlays().size());
+  for (const ColumnLegacy& col : table.columns()) {
+    if (!IsExported(col)) {
+      continue;
+    }
+    auto& indices = indices_for_overlay[col.overlay_index()];
+    if (!indices) {
+      indices = table.overlays()[col.overlay_index()].row_map().GetAllIndices();
+    }
+    EncodeColumn(col, *indices, pool, &out);
+  }
+  return out;
+}
+
+// static
+base::Status TableColumnarExport::WriteToFile(const Table& table,
+                                              const StringPool& pool,
+                                              const std::string& path) {
+  std::vector<uint8_t> data = Encode(table, pool);
+  base::ScopedFile fd =
+      base::OpenFile(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (!fd) {
+    return base::ErrStatus("Unable to open %s for writing: %s", path.c_str(),
+                           strerror(errno));
+  }
+  ssize_t res = base::WriteAll(*fd, data.data(), data.size());
+  if (res < 0 || static_cast<size_t>(res) != data.size()) {
+    return base::ErrStatus("Failed writing %s: %s", path.c_str(),
+                           strerror(errno));
+  }
+  return base::OkStatus();
+}
+
+}  // namespace perfetto::trace_processor
@@ -0,0 +1,108 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_TRACE_PROCESSOR_DB_TABLE_COLUMNAR_EXPORT_H_
+#define SRC_TRACE_PROCESSOR_DB_TABLE_COLUMNAR_EXPORT_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "perfetto/base/status.h"
+#include "src/trace_processor/containers/string_pool.h"
+#include "src/trace_processor/db/table.h"
+
+namespace perfetto::trace_processor {
+
+// Exports the contents of a Table as a compressed, columnar file intended to
+// be loaded into data warehouses. Unlike TableSnapshot, the format is stable
+// and self-describing: it can be read without any knowledge of trace
+// processor. The values are read directly from the storage of the columns.
+//
+// Layout of the file (all integers are little-endian):
+//
+//   magic         8 bytes: "PFCOLv1\n"
+//   row_count     u32
+//   column_count  u32
+//   column_count times:
+//     name        u32 size followed by the UTF-8 bytes
+//     type        u8: Type
+//     encoding    u8: Encoding
+//     compression u8: Compression
+//     flags       u8: bitwise or of Flag
+//     raw_size    u64: size of the payload once decompressed
+//     stored_size u64: size of the payload in the file
+//     payload     stored_size bytes
+//
+// Once decompressed, the payload of a column is:
+//   - if the column has the kHasNulls flag: a validity bitmap of
+//     ceil(row_count / 8) bytes where bit i (LSB first) is set iff the value
+//     of row i is not null.
+//   - the non-null values, in row order, encoded as specified by the encoding
+//     of the column.
+class TableColumnarExport {
+ public:
+  static constexpr char kMagic[] = "PFCOLv1\n";
+
+  enum class Type : uint8_t {
+    kInt64 = 0,
+    kDouble = 1,
+    kString = 2,
+  };
+
+  enum class Encoding : uint8_t {
+    // One i64 or f64 per value.
+    kPlain = 0,
+
+    // Integers only. The first value as i64 (0 if there are no values), a u32
+    // run count and then the runs as (i64 delta, u32 length) pairs: each run
+    // adds |delta| to the previous value |length| times. Sorted ids (and
+    // other columns with constant steps) compress to a single run.
+    kDeltaRunLength = 1,
+
+    // Strings only. A u32 entry count, the entries as u32 size followed by
+    // the UTF-8 bytes and then, for each value, the u32 index of its entry.
+    kDictionary = 2,
+  };
+
+  enum class Compression : uint8_t {
+    kNone = 0,
+
+    // Raw deflate stream (i.e. zlib without header, window bits = -15).
+    kDeflate = 1,
+  };
+
+  enum Flag : uint8_t {
+    kHasNulls = 1 << 0,
+    kSorted = 1 << 1,
+    kId = 1 << 2,
+  };
+
+  // Returns the contents of |table| encoded in the format described above.
+  // Hidden and dummy columns are not exported.
+  static std::vector<uint8_t> Encode(const Table& table,
+                                     const StringPool& pool);
+
+  // Writes the contents of |table| to the file at |path|, replacing it if it
+  // exists.
+  static base::Status WriteToFile(const Table& table,
+                                  const StringPool& pool,
+                                  const std::string& path);
+};
+
+}  // namespace perfetto::trace_processor
+
+#endif  // SRC_TRACE_PROCESSOR_DB_TABLE_COLUMNAR_EXPORT_H_
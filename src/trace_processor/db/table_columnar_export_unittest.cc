@@ -0,0 +1,257 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "src/trace_processor/db/table_columnar_export.h"
+
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "src/trace_processor/containers/string_pool.h"
+#include "src/trace_processor/tables/counter_tables_py.h"
+#include "src/trace_processor/tables/slice_tables_py.h"
+#include "src/trace_processor/util/gzip_utils.h"
+#include "test/gtest_and_gmock.h"
+
+namespace perfetto::trace_processor {
+namespace {
+
+using Compression = TableColumnarExport::Compression;
+using Encoding = TableColumnarExport::Encoding;
+using Type = TableColumnarExport::Type;
+using testing::ElementsAre;
+
+struct DecodedColumn {
+  Type type;
+  Encoding encoding;
+  uint8_t flags;
+  // The values of the column formatted as strings, "NULL" for nulls.
+  std::vector<std::string> values;
+};
+
+struct DecodedTable {
+  uint32_t row_count = 0;
+  std::vector<std::string> column_names;
+  std::map<std::string, DecodedColumn> columns;
+};
+
+// Minimal reader of the export format, written from the documentation of
+// TableColumnarExport rather than from its implementation.
+class Reader {
+ public:
+  Reader(const uint8_t* data, size_t size) : ptr_(data), end_(data + size) {}
+
+  template <typename T>
+  T Read() {
+    T value;
+    EXPECT_LE(ptr_ + sizeof(T), end_);
+    memcpy(&value, ptr_, sizeof(T));
+    ptr_ += sizeof(T);
+    return value;
+  }
+
+  std::string ReadString() {
+    auto size = Read<uint32_t>();
+    std::string str(reinterpret_cast<const char*>(ptr_), size);
+    ptr_ += size;
+    return str;
+  }
+
+  std::vector<uint8_t> ReadBytes(size_t size) {
+    EXPECT_LE(ptr_ + size, end_);
+    std::vector<uint8_t> bytes(ptr_, ptr_ + size);
+    ptr_ += size;
+    return bytes;
+  }
+
+  bool AtEnd() const { return ptr_ == end_; }
+
+ private:
+  const uint8_t* ptr_;
+  const uint8_t* end_;
+};
+
+std::vector<std::string> DecodeValues(Reader* reader,
+                                      Type type,
+                                      Encoding encoding,
+                                      uint32_t count) {
+  std::vector<std::string> values;
+  if (encoding == Encoding::kDeltaRunLength) {
+    auto value = reader->Read<int64_t>();
+    auto run_count = reader->Read<uint32_t>();
+    values.push_back(std::to_string(value));
+    for (uint32_t i = 0; i < run_count; ++i) {
+      auto delta = reader->Read<int64_t>();
+      auto length = reader->Read<uint32_t>();
+      for (uint32_t j = 0; j < length; ++j) {
+        value += delta;
+        values.push_back(std::to_string(value));
+      }
+    }
+    return values;
+  }
+  if (encoding == Encoding::kDictionary) {
+    std::vector<std::string> entries(reader->Read<uint32_t>());
+    for (auto& entry : entries) {
+      entry = reader->ReadString();
+    }
+    for (uint32_t i = 0; i < count; ++i) {
+      values.push_back(entries[reader->Read<uint32_t>()]);
+    }
+    return values;
+  }
+  for (uint32_t i = 0; i < count; ++i) {
+    values.push_back(type == Type::kDouble
+                         ? std::to_string(reader->Read<double>())
+                         : std::to_string(reader->Read<int64_t>()));
+  }
+  return values;
+}
+
+DecodedTable Decode(const std::vector<uint8_t>& data) {
+  DecodedTable table;
+  Reader reader(data.data(), data.size());
+  std::vector<uint8_t> magic = reader.ReadBytes(8);
+  EXPECT_EQ(std::string(magic.begin(), magic.end()), "PFCOLv1\n");
+  table.row_count = reader.Read<uint32_t>();
+  auto column_count = reader.Read<uint32_t>();
+  for (uint32_t i = 0; i < column_count; ++i) {
+    std::string name = reader.ReadString();
+    DecodedColumn col;
+    col.type = static_cast<Type>(reader.Read<uint8_t>());
+    col.encoding = static_cast<Encoding>(reader.Read<uint8_t>());
+    auto compression = static_cast<Compression>(reader.Read<uint8_t>());
+    col.flags = reader.Read<uint8_t>();
+    auto raw_size = reader.Read<uint64_t>();
+    auto stored_size = reader.Read<uint64_t>();
+    std::vector<uint8_t> payload = reader.ReadBytes(stored_size);
+    if (compression == Compression::kDeflate) {
+      util::GzipDecompressor decompressor(
+          util::GzipDecompressor::InputMode::kRawDeflate);
+      std::vector<uint8_t> raw;
+      decompressor.FeedAndExtract(
+          payload.data(), payload.size(),
+          [&raw](const uint8_t* ptr, size_t size) {
+            raw.insert(raw.end(), ptr, ptr + size);
+          });
+      payload = std::move(raw);
+    }
+    EXPECT_EQ(payload.size(), raw_size);
+
+    Reader payload_reader(payload.data(), payload.size());
+    std::vector<bool> valid(table.row_count, true);
+    uint32_t valid_count = table.row_count;
+    if (col.flags & TableColumnarExport::kHasNulls) {
+      std::vector<uint8_t> bitmap =
+          payload_reader.ReadBytes((table.row_count + 7) / 8);
+      for (uint32_t row = 0; row < table.row_count; ++row) {
+        valid[row] = (bitmap[row / 8] >> (row % 8)) & 1;
+        valid_count -= !valid[row];
+      }
+    }
+    std::vector<std::string> values =
+        DecodeValues(&payload_reader, col.type, col.encoding, valid_count);
+    EXPECT_TRUE(payload_reader.AtEnd());
+    EXPECT_EQ(values.size(), valid_count);
+    auto it = values.begin();
+    for (uint32_t row = 0; row < table.row_count; ++row) {
+      col.values.push_back(valid[row] ? *it++ : "NULL");
+    }
+    table.column_names.push_back(name);
+    table.columns[name] = std::move(col);
+  }
+  EXPECT_TRUE(reader.AtEnd());
+  return table;
+}
+
+TEST(TableColumnarExportTest, NumericColumns) {
+  StringPool pool;
+  tables::CounterTable counters(&pool);
+  for (uint32_t i = 0; i < 100; ++i) {
+    tables::CounterTable::Row row;
+    row.ts = 1000 + i * 10;
+    row.track_id = tables::CounterTrackTable::Id(i * i % 5);
+    row.value = i * 0.5;
+    row.arg_set_id = i % 2 ? std::make_optional(i) : std::nullopt;
+    counters.Insert(row);
+  }
+
+  DecodedTable table = Decode(TableColumnarExport::Encode(counters, pool));
+  ASSERT_EQ(table.row_count, 100u);
+
+  const DecodedColumn& id = table.columns["id"];
+  ASSERT_EQ(id.type, Type::kInt64);
+  ASSERT_EQ(id.encoding, Encoding::kDeltaRunLength);
+  ASSERT_EQ(id.flags, TableColumnarExport::kId | TableColumnarExport::kSorted);
+  ASSERT_EQ(id.values[0], "0");
+  ASSERT_EQ(id.values[99], "99");
+
+  const DecodedColumn& ts = table.columns["ts"];
+  ASSERT_EQ(ts.encoding, Encoding::kDeltaRunLength);
+  ASSERT_EQ(ts.flags, TableColumnarExport::kSorted);
+  ASSERT_EQ(ts.values[0], "1000");
+  ASSERT_EQ(ts.values[99], "1990");
+
+  const DecodedColumn& track_id = table.columns["track_id"];
+  ASSERT_EQ(track_id.encoding, Encoding::kPlain);
+  ASSERT_THAT(std::vector<std::string>(track_id.values.begin(),
+                                       track_id.values.begin() + 4),
+              ElementsAre("0", "1", "4", "4"));
+
+  const DecodedColumn& value = table.columns["value"];
+  ASSERT_EQ(value.type, Type::kDouble);
+  ASSERT_EQ(value.values[3], std::to_string(1.5));
+
+  const DecodedColumn& arg_set_id = table.columns["arg_set_id"];
+  ASSERT_EQ(arg_set_id.flags, TableColumnarExport::kHasNulls);
+  ASSERT_THAT(std::vector<std::string>(arg_set_id.values.begin(),
+                                       arg_set_id.values.begin() + 4),
+              ElementsAre("NULL", "1", "NULL", "3"));
+}
+
+TEST(TableColumnarExportTest, StringColumns) {
+  StringPool pool;
+  tables::SliceTable slices(&pool);
+  const char* names[] = {"foo", nullptr, "bar", "foo", "foo", nullptr};
+  for (uint32_t i = 0; i < 6; ++i) {
+    tables::SliceTable::Row row;
+    row.ts = i;
+    row.name = names[i] ? pool.InternString(names[i]) : StringPool::Id::Null();
+    slices.Insert(row);
+  }
+
+  DecodedTable table = Decode(TableColumnarExport::Encode(slices, pool));
+  const DecodedColumn& name = table.columns["name"];
+  ASSERT_EQ(name.type, Type::kString);
+  ASSERT_EQ(name.encoding, Encoding::kDictionary);
+  ASSERT_EQ(name.flags, TableColumnarExport::kHasNulls);
+  ASSERT_THAT(name.values,
+              ElementsAre("foo", "NULL", "bar", "foo", "foo", "NULL"));
+}
+
+TEST(TableColumnarExportTest, EmptyTable) {
+  StringPool pool;
+  tables::SliceTable slices(&pool);
+  DecodedTable table = Decode(TableColumnarExport::Encode(slices, pool));
+  ASSERT_EQ(table.row_count, 0u);
+  ASSERT_EQ(table.columns["ts"].values.size(), 0u);
+}
+
+}  // namespace
+}  // namespace perfetto::trace_processor
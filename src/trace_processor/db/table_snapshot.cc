@@ -0,0 +1,283 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "src/trace_processor/db/table_snapshot.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "perfetto/base/logging.h"
+#include "perfetto/base/status.h"
+#include "perfetto/ext/base/string_view.h"
+#include "src/trace_processor/containers/bit_vector.h"
+#include "src/trace_processor/containers/string_pool.h"
+#include "src/trace_processor/db/column.h"
+#include "src/trace_processor/db/column/types.h"
+#include "src/trace_processor/db/column_storage.h"
+#include "src/trace_processor/db/table.h"
+#include "src/trace_processor/util/snapshot_file.h"
+#include "src/trace_processor/util/status_macros.h"
+
+namespace perfetto::trace_processor {
+namespace {
+
+constexpr uint32_t kBitsInWord = BitVector::kBitsInWord;
+
+// Returns true if |col| is backed by storage owned by its table (as opposed to
+// storage owned by one of the ancestors of the table). The storage of a table
+// is always indexed by its last overlay.
+bool IsOwnedColumn(const ColumnLegacy& col, size_t overlay_count) {
+  if (col.IsId() || col.IsDummy()) {
+    return false;
+  }
+  return col.overlay_index() + 1 == overlay_count;
+}
+
+size_t ElementSize(ColumnType type) {
+  switch (type) {
+    case ColumnType::kInt32:
+      return sizeof(int32_t);
+    case ColumnType::kUint32:
+      return sizeof(uint32_t);
+    case ColumnType::kInt64:
+      return sizeof(int64_t);
+    case ColumnType::kDouble:
+      return sizeof(double);
+    case ColumnType::kString:
+      return sizeof(StringPool::Id);
+    case ColumnType::kId:
+    case ColumnType::kDummy:
+      break;
+  }
+  PERFETTO_FATAL("Column type has no storage");
+}
+
+void WriteBitVector(const BitVector& bv, util::SnapshotWriter* writer) {
+  std::vector<uint64_t> words((bv.size() + kBitsInWord - 1) / kBitsInWord);
+  for (uint32_t idx : bv.GetSetBitIndices()) {
+    words[idx / kBitsInWord] |= 1ull << (idx % kBitsInWord);
+  }
+  writer->WriteU32(bv.size());
+  writer->WriteBlock(words.data(), words.size() * sizeof(uint64_t));
+}
+
+base::StatusOr<BitVector> ReadBitVector(util::SnapshotReader* reader) {
+  uint32_t size = reader->ReadU32();
+  size_t words_size = 0;
+  const auto* words =
+      reinterpret_cast<const uint64_t*>(reader->ReadBlock(&words_size));
+  RETURN_IF_ERROR(reader->status());
+  if (words_size !=
+      (size + kBitsInWord - 1) / kBitsInWord * sizeof(uint64_t)) {
+    return base::ErrStatus("Snapshot bit vector has an invalid size");
+  }
+  BitVector::Builder builder(size);
+  uint32_t complete_words = size / kBitsInWord;
+  for (uint32_t i = 0; i < complete_words; ++i) {
+    builder.AppendWord(words[i]);
+  }
+  for (uint32_t i = complete_words * kBitsInWord; i < size; ++i) {
+    builder.Append((words[i / kBitsInWord] >> (i % kBitsInWord)) & 1);
+  }
+  return std::move(builder).Build();
+}
+
+template <typename T>
+base::Status ReadNonNullStorage(util::SnapshotReader* reader,
+                                ColumnStorage<T>* storage,
+                                uint32_t row_count) {
+  size_t size = 0;
+  const uint8_t* data = reader->ReadBlock(&size);
+  RETURN_IF_ERROR(reader->status());
+  if (size != static_cast<uint64_t>(row_count) * sizeof(T)) {
+    return base::ErrStatus("Snapshot column has an invalid size");
+  }
+  storage->RestoreFromSnapshot(reinterpret_cast<const T*>(data), row_count);
+  return base::OkStatus();
+}
+
+template <typename T>
+base::Status ReadNullableStorage(util::SnapshotReader* reader,
+                                 ColumnStorage<std::optional<T>>* storage,
+                                 uint32_t row_count) {
+  ASSIGN_OR_RETURN(BitVector valid, ReadBitVector(reader));
+  size_t size = 0;
+  const uint8_t* data = reader->ReadBlock(&size);
+  RETURN_IF_ERROR(reader->status());
+  uint32_t count = storage->IsDense() ? valid.size() : valid.CountSetBits();
+  if (valid.size() != row_count ||
+      size != static_cast<uint64_t>(count) * sizeof(T)) {
+    return base::ErrStatus("Snapshot column has an invalid size");
+  }
+  storage->RestoreFromSnapshot(reinterpret_cast<const T*>(data), count,
+                               std::move(valid));
+  return base::OkStatus();
+}
+
+}  // namespace
+
+void TableSnapshot::Write(const Table& table, util::SnapshotWriter* writer) {
+  writer->WriteU32(table.row_count_);
+
+  // The last overlay always selects all the rows of |table| itself so only
+  // the overlays over the parent tables need to be stored.
+  const auto& overlays = table.overlays_;
+  PERFETTO_DCHECK(overlays.back().size() == table.row_count_);
+  writer->WriteU32(static_cast<uint32_t>(overlays.size()));
+  for (uint32_t i = 0; i + 1 < overlays.size(); ++i) {
+    std::vector<uint32_t> indices = overlays[i].row_map().GetAllIndices();
+    writer->WriteBlock(indices.data(), indices.size() * sizeof(uint32_t));
+  }
+
+  uint32_t owned_count = 0;
+  for (const ColumnLegacy& col : table.columns_) {
+    owned_count += IsOwnedColumn(col, overlays.size());
+  }
+  writer->WriteU32(owned_count);
+  for (const ColumnLegacy& col : table.columns_) {
+    if (!IsOwnedColumn(col, overlays.size())) {
+      continue;
+    }
+    writer->WriteString(col.name());
+    writer->WriteU32(static_cast<uint32_t>(col.col_type()));
+    writer->WriteU32(col.flags_);
+
+    const ColumnStorageBase& storage = col.storage_base();
+    if (const BitVector* bv = storage.bv(); bv) {
+      WriteBitVector(*bv, writer);
+    }
+    writer->WriteBlock(storage.data(),
+                       storage.non_null_size() * ElementSize(col.col_type()));
+  }
+}
+
+base::Status TableSnapshot::Read(util::SnapshotReader* reader, Table* table) {
+  if (table->row_count_ != 0) {
+    return base::ErrStatus("Snapshots can only be restored into empty tables");
+  }
+
+  uint32_t row_count = reader->ReadU32();
+  uint32_t overlay_count = reader->ReadU32();
+  RETURN_IF_ERROR(reader->status());
+  if (overlay_count != table->overlays_.size()) {
+    return base::ErrStatus("Snapshot table has %u overlays, expected %zu",
+                           overlay_count, table->overlays_.size());
+  }
+  for (uint32_t i = 0; i + 1 < overlay_count; ++i) {
+    size_t size = 0;
+    const auto* indices =
+        reinterpret_cast<const uint32_t*>(reader->ReadBlock(&size));
+    RETURN_IF_ERROR(reader->status());
+    if (size != static_cast<uint64_t>(row_count) * sizeof(uint32_t)) {
+      return base::ErrStatus("Snapshot overlay has an invalid size");
+    }
+    // Replaying the inserts (which must be in increasing order) reproduces the
+    // BitVector backing the overlay exactly. The BitVector is updated in place
+    // as it's referenced by the SelectorOverlay layers of the table.
+    ColumnStorageOverlay& overlay = table->overlays_[i];
+    for (uint32_t j = 0; j < row_count; ++j) {
+      if (j > 0 && indices[j] <= indices[j - 1]) {
+        return base::ErrStatus("Snapshot overlay is not sorted");
+      }
+      overlay.Insert(indices[j]);
+    }
+  }
+
+  uint32_t owned_count = reader->ReadU32();
+  RETURN_IF_ERROR(reader->status());
+  uint32_t expected_owned_count = 0;
+  for (const ColumnLegacy& col : table->columns_) {
+    expected_owned_count += IsOwnedColumn(col, overlay_count);
+  }
+  if (owned_count != expected_owned_count) {
+    return base::ErrStatus("Snapshot table has %u columns, expected %u",
+                           owned_count, expected_owned_count);
+  }
+  for (ColumnLegacy& col : table->columns_) {
+    if (!IsOwnedColumn(col, overlay_count)) {
+      continue;
+    }
+
+    base::StringView name = reader->ReadString();
+    auto type = static_cast<ColumnType>(reader->ReadU32());
+    uint32_t flags = reader->ReadU32();
+    RETURN_IF_ERROR(reader->status());
+    if (name != base::StringView(col.name()) || type != col.col_type() ||
+        flags != col.flags_) {
+      return base::ErrStatus(
+          "Snapshot column %s does not match the schema of the table",
+          name.ToStdString().c_str());
+    }
+
+    switch (col.col_type()) {
+      case ColumnType::kInt32:
+        RETURN_IF_ERROR(
+            col.IsNullable()
+                ? ReadNullableStorage(
+                      reader, col.mutable_storage<std::optional<int32_t>>(),
+                      row_count)
+                : ReadNonNullStorage(reader, col.mutable_storage<int32_t>(),
+                                     row_count));
+        break;
+      case ColumnType::kUint32:
+        RETURN_IF_ERROR(
+            col.IsNullable()
+                ? ReadNullableStorage(
+                      reader, col.mutable_storage<std::optional<uint32_t>>(),
+                      row_count)
+                : ReadNonNullStorage(reader, col.mutable_storage<uint32_t>(),
+                                     row_count));
+        break;
+      case ColumnType::kInt64:
+        RETURN_IF_ERROR(
+            col.IsNullable()
+                ? ReadNullableStorage(
+                      reader, col.mutable_storage<std::optional<int64_t>>(),
+                      row_count)
+                : ReadNonNullStorage(reader, col.mutable_storage<int64_t>(),
+                                     row_count));
+        break;
+      case ColumnType::kDouble:
+        RETURN_IF_ERROR(
+            col.IsNullable()
+                ? ReadNullableStorage(
+                      reader, col.mutable_storage<std::optional<double>>(),
+                      row_count)
+                : ReadNonNullStorage(reader, col.mutable_storage<double>(),
+                                     row_count));
+        break;
+      case ColumnType::kString:
+        // String columns are never nullable: null strings are stored as
+        // StringPool::Id::Null().
+        RETURN_IF_ERROR(ReadNonNullStorage(
+            reader, col.mutable_storage<StringPool::Id>(), row_count));
+        break;
+      case ColumnType::kId:
+      case ColumnType::kDummy:
+        PERFETTO_FATAL("Column type has no storage");
+    }
+  }
+
+  for (uint32_t i = 0; i < row_count; ++i) {
+    table->IncrementRowCountAndAddToLastOverlay();
+  }
+  return base::OkStatus();
+}
+
+}  // namespace perfetto::trace_processor
@@ -0,0 +1,48 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_TRACE_PROCESSOR_DB_TABLE_SNAPSHOT_H_
+#define SRC_TRACE_PROCESSOR_DB_TABLE_SNAPSHOT_H_
+
+#include "perfetto/base/status.h"
+#include "src/trace_processor/db/table.h"
+#include "src/trace_processor/util/snapshot_file.h"
+
+namespace perfetto::trace_processor {
+
+// Writes the contents of a Table into a snapshot file and restores them.
+//
+// Only the data owned by the table is written: i.e. the storage of the columns
+// which were added by the table itself (not inherited from a parent) and the
+// overlays mapping the rows of the table to the rows of its parents. A child
+// table therefore needs to be restored together with all its ancestors (in any
+// order) for its contents to be complete.
+//
+// Strings are stored as StringPool::Ids: the string pool needs to be restored
+// separately and must assign the same ids as when the snapshot was written.
+class TableSnapshot {
+ public:
+  // Writes the contents of |table| to |writer|.
+  static void Write(const Table& table, util::SnapshotWriter* writer);
+
+  // Restores the contents of |table| from |reader|. |table| must be empty and
+  // have the same schema as the table which was written.
+  static base::Status Read(util::SnapshotReader* reader, Table* table);
+};
+
+}  // namespace perfetto::trace_processor
+
+#endif  // SRC_TRACE_PROCESSOR_DB_TABLE_SNAPSHOT_H_
@@ -25,10 +25,11 @@ namespace perfetto::trace_processor {
 
 CpuTracker::CpuTracker(TraceProcessorContext* context) : context_(context) {
   // Preallocate ucpu of this machine for maintaining the relative order between
-  // ucpu and cpu.
+  // ucpu and cpu. The CPUs of this machine come after the ones of all the
+  // machines (and traces, see TraceProcessorStorage::StartNewTrace) seen so
+  // far.
   auto machine_id = context_->machine_tracker->machine_id();
-  if (machine_id.has_value())
-    ucpu_offset_ = machine_id->value * kMaxCpusPerMachine;
+  ucpu_offset_ = context_->storage->cpu_table().row_count();
 
   for (auto id = 0u; id < kMaxCpusPerMachine; id++) {
     // Only populate the |machine_id| column. The |cpu| column is update only
@@ -50,6 +50,8 @@ class ScopedActiveTraceFile {
     return *this;
   }
 
+  tables::TraceFileTable::Id id() const { return row_.id(); }
+
   void SetTraceType(TraceType type);
 
   // For streamed files this method can be called for each chunk to update the
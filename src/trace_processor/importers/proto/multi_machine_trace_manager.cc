@@ -77,6 +77,7 @@ ProtoTraceReader* MultiMachineTraceManager::GetOrCreateReader(
   auto context = CreateContext(raw_machine_id);
   // Share the sorter, but enable for the parser.
   context->sorter = default_context_->sorter;
+  context->thread_pool = default_context_->thread_pool;
   context->sorter->AddMachineContext(context.get());
   context->process_tracker->SetPidZeroIsUpidZeroIdleProcess();
   context->proto_trace_parser.reset(new ProtoTraceParserImpl(context.get()));
@@ -17,24 +17,54 @@
 #include "src/trace_processor/importers/proto/proto_trace_tokenizer.h"
 #include "perfetto/trace_processor/trace_blob.h"
 
+#include "perfetto/ext/base/threading/thread_pool.h"
 #include "perfetto/ext/base/utils.h"
+#include "src/trace_processor/util/parallel_for.h"
 
 namespace perfetto {
 namespace trace_processor {
 
 ProtoTraceTokenizer::ProtoTraceTokenizer() = default;
 
-util::Status ProtoTraceTokenizer::Decompress(TraceBlobView input,
-                                             TraceBlobView* output) {
+ProtoTraceTokenizer::ProtoTraceTokenizer(base::ThreadPool* thread_pool,
+                                         uint32_t thread_count)
+    : thread_pool_(thread_count > 0 ? thread_pool : nullptr),
+      thread_count_(thread_count) {}
+
+ProtoTraceTokenizer::~ProtoTraceTokenizer() = default;
+
+void ProtoTraceTokenizer::DecompressPendingPackets() {
+  std::vector<PendingPacket*> compressed;
+  compressed.reserve(pending_compressed_count_);
+  for (PendingPacket& p : pending_packets_) {
+    if (p.compressed) {
+      compressed.push_back(&p);
+    }
+  }
+  util::ParallelFor(thread_pool_, thread_count_, compressed.size(),
+                    [&compressed](size_t i) {
+                      // zlib streams cannot be shared between threads so use
+                      // a decompressor per packet.
+                      util::GzipDecompressor decompressor;
+                      PendingPacket* p = compressed[i];
+                      p->status = Decompress(decompressor, std::move(p->data),
+                                             &p->decompressed);
+                    });
+}
+
+util::Status ProtoTraceTokenizer::Decompress(
+    util::GzipDecompressor& decompressor,
+    TraceBlobView input,
+    TraceBlobView* output) {
   PERFETTO_DCHECK(util::IsGzipSupported());
 
   std::vector<uint8_t> data;
   data.reserve(input.length());
 
   // Ensure that the decompressor is able to cope with a new stream of data.
-  decompressor_.Reset();
+  decompressor.Reset();
   using ResultCode = util::GzipDecompressor::ResultCode;
-  ResultCode ret = decompressor_.FeedAndExtract(
+  ResultCode ret = decompressor.FeedAndExtract(
       input.data(), input.length(),
       [&data](const uint8_t* buffer, size_t buffer_len) {
         data.insert(data.end(), buffer, buffer + buffer_len);
@@ -22,6 +22,7 @@
 #include <cstdint>
 #include <optional>
 #include <utility>
+#include <vector>
 
 #include "perfetto/base/logging.h"
 #include "perfetto/base/status.h"
@@ -36,6 +37,12 @@
 #include "src/trace_processor/util/status_macros.h"
 #include "src/trace_processor/util/trace_blob_view_reader.h"
 
+namespace perfetto {
+namespace base {
+class ThreadPool;
+}  // namespace base
+}  // namespace perfetto
+
 namespace perfetto::trace_processor {
 
 // Reads a protobuf trace in chunks and extracts boundaries of trace packets
@@ -44,10 +51,51 @@ class ProtoTraceTokenizer {
  public:
   ProtoTraceTokenizer();
 
+  // Creates a tokenizer which decompresses CompressedPackets using up to
+  // |thread_count| tasks on |thread_pool|. Packets are still passed to the
+  // callback of Tokenize() in trace order and on the calling thread.
+  ProtoTraceTokenizer(base::ThreadPool* thread_pool, uint32_t thread_count);
+
+  ~ProtoTraceTokenizer();
+
   template <typename Callback = base::Status(TraceBlobView)>
   base::Status Tokenize(TraceBlobView tbv, Callback callback) {
     reader_.PushBack(std::move(tbv));
+    base::Status status = TokenizeInternal(callback);
+
+    // Packets queued for decompression precede any point where tokenization
+    // stopped so they need to be forwarded even if |status| is an error.
+    base::Status flush_status = FlushPendingPackets(callback);
+    return flush_status.ok() ? status : flush_status;
+  }
+
+ private:
+  static constexpr uint8_t kTracePacketTag =
+      protozero::proto_utils::MakeTagLengthDelimited(
+          protos::pbzero::Trace::kPacketFieldNumber);
 
+  // Maximum number of CompressedPackets which are buffered before being
+  // decompressed in parallel. Bounds the amount of decompressed data which
+  // is in memory at any one time.
+  static constexpr size_t kMaxPendingCompressedPackets = 128;
+
+  // A packet which was split from the input but has not yet been forwarded
+  // to the callback because it follows a CompressedPackets packet which is
+  // still waiting to be decompressed.
+  struct PendingPacket {
+    // Either the full TracePacket or, if |compressed| is true, the contents
+    // of its |compressed_packets| field.
+    TraceBlobView data;
+    bool compressed = false;
+
+    // Only valid if |compressed| is true and after the batch has been
+    // decompressed.
+    TraceBlobView decompressed;
+    base::Status status;
+  };
+
+  template <typename Callback>
+  base::Status TokenizeInternal(Callback& callback) {
     for (;;) {
       size_t start_offset = reader_.start_offset();
       size_t avail = reader_.avail();
@@ -175,7 +223,12 @@ class ProtoTraceTokenizer {
       protos::pbzero::TracePacket::Decoder decoder(packet->data(),
                                                    packet->length());
       if (!decoder.has_compressed_packets()) {
-        RETURN_IF_ERROR(callback(std::move(*packet)));
+        if (pending_packets_.empty()) {
+          RETURN_IF_ERROR(callback(std::move(*packet)));
+        } else {
+          pending_packets_.emplace_back();
+          pending_packets_.back().data = std::move(*packet);
+        }
         continue;
       }
 
@@ -186,37 +239,80 @@ class ProtoTraceTokenizer {
 
       protozero::ConstBytes field = decoder.compressed_packets();
       TraceBlobView compressed_packets = packet->slice(field.data, field.size);
-      TraceBlobView packets;
-      RETURN_IF_ERROR(Decompress(std::move(compressed_packets), &packets));
-
-      const uint8_t* start = packets.data();
-      const uint8_t* end = packets.data() + packets.length();
-      const uint8_t* ptr = start;
-      while ((end - ptr) > 2) {
-        const uint8_t* packet_outer = ptr;
-        if (PERFETTO_UNLIKELY(*ptr != kTracePacketTag)) {
-          return base::ErrStatus("Expected TracePacket tag");
+      if (thread_pool_) {
+        pending_packets_.emplace_back();
+        pending_packets_.back().data = std::move(compressed_packets);
+        pending_packets_.back().compressed = true;
+        if (++pending_compressed_count_ >= kMaxPendingCompressedPackets) {
+          RETURN_IF_ERROR(FlushPendingPackets(callback));
         }
-        uint64_t packet_size = 0;
-        ptr = protozero::proto_utils::ParseVarInt(++ptr, end, &packet_size);
-        const uint8_t* packet_start = ptr;
-        ptr += packet_size;
-        if (PERFETTO_UNLIKELY((ptr - packet_outer) < 2 || ptr > end)) {
-          return base::ErrStatus("Invalid packet size");
-        }
-        TraceBlobView sliced =
-            packets.slice(packet_start, static_cast<size_t>(packet_size));
-        RETURN_IF_ERROR(callback(std::move(sliced)));
+        continue;
       }
+
+      TraceBlobView packets;
+      RETURN_IF_ERROR(
+          Decompress(decompressor_, std::move(compressed_packets), &packets));
+      RETURN_IF_ERROR(SplitDecompressedPackets(packets, callback));
     }
   }
 
- private:
-  static constexpr uint8_t kTracePacketTag =
-      protozero::proto_utils::MakeTagLengthDelimited(
-          protos::pbzero::Trace::kPacketFieldNumber);
+  // Splits the decompressed contents of a CompressedPackets field into the
+  // individual packets and passes them to |callback|.
+  template <typename Callback>
+  static base::Status SplitDecompressedPackets(const TraceBlobView& packets,
+                                               Callback& callback) {
+    const uint8_t* start = packets.data();
+    const uint8_t* end = packets.data() + packets.length();
+    const uint8_t* ptr = start;
+    while ((end - ptr) > 2) {
+      const uint8_t* packet_outer = ptr;
+      if (PERFETTO_UNLIKELY(*ptr != kTracePacketTag)) {
+        return base::ErrStatus("Expected TracePacket tag");
+      }
+      uint64_t packet_size = 0;
+      ptr = protozero::proto_utils::ParseVarInt(++ptr, end, &packet_size);
+      const uint8_t* packet_start = ptr;
+      ptr += packet_size;
+      if (PERFETTO_UNLIKELY((ptr - packet_outer) < 2 || ptr > end)) {
+        return base::ErrStatus("Invalid packet size");
+      }
+      TraceBlobView sliced =
+          packets.slice(packet_start, static_cast<size_t>(packet_size));
+      RETURN_IF_ERROR(callback(std::move(sliced)));
+    }
+    return base::OkStatus();
+  }
+
+  // Decompresses all the pending CompressedPackets in parallel and then
+  // forwards all pending packets to |callback| in trace order.
+  template <typename Callback>
+  base::Status FlushPendingPackets(Callback& callback) {
+    if (pending_packets_.empty()) {
+      return base::OkStatus();
+    }
+    DecompressPendingPackets();
 
-  base::Status Decompress(TraceBlobView input, TraceBlobView* output);
+    std::vector<PendingPacket> pending = std::move(pending_packets_);
+    pending_packets_.clear();
+    pending_compressed_count_ = 0;
+    for (PendingPacket& p : pending) {
+      if (!p.compressed) {
+        RETURN_IF_ERROR(callback(std::move(p.data)));
+        continue;
+      }
+      RETURN_IF_ERROR(p.status);
+      RETURN_IF_ERROR(SplitDecompressedPackets(p.decompressed, callback));
+    }
+    return base::OkStatus();
+  }
+
+  // Fills |decompressed| and |status| of all compressed entries in
+  // |pending_packets_|, fanning out the work on |thread_pool_|.
+  void DecompressPendingPackets();
+
+  static base::Status Decompress(util::GzipDecompressor& decompressor,
+                                 TraceBlobView input,
+                                 TraceBlobView* output);
 
   // Used to glue together trace packets that span across two (or more)
   // Parse() boundaries.
@@ -224,6 +320,14 @@ class ProtoTraceTokenizer {
 
   // Allows support for compressed trace packets.
   util::GzipDecompressor decompressor_;
+
+  // If set, CompressedPackets are queued in |pending_packets_| and
+  // decompressed in parallel on this pool. Not owned.
+  base::ThreadPool* thread_pool_ = nullptr;
+  uint32_t thread_count_ = 0;
+
+  std::vector<PendingPacket> pending_packets_;
+  size_t pending_compressed_count_ = 0;
 };
 
 }  // namespace perfetto::trace_processor
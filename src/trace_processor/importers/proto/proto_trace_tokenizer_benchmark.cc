@@ -0,0 +1,135 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include <zlib.h>
+
+#include "perfetto/base/logging.h"
+#include "perfetto/base/status.h"
+#include "perfetto/ext/base/threading/thread_pool.h"
+#include "perfetto/protozero/scattered_heap_buffer.h"
+#include "perfetto/trace_processor/trace_blob.h"
+#include "perfetto/trace_processor/trace_blob_view.h"
+#include "src/trace_processor/importers/proto/proto_trace_tokenizer.h"
+
+#include "protos/perfetto/trace/trace_packet.pbzero.h"
+
+namespace perfetto::trace_processor {
+namespace {
+
+// Size of the input passed to each Tokenize() call. Matches the chunk size
+// used by ReadTrace().
+constexpr size_t kChunkSize = 128 * 1024 * 1024;
+
+bool IsBenchmarkFunctionalOnly() {
+  return getenv("BENCHMARK_FUNCTIONAL_TEST_ONLY") != nullptr;
+}
+
+std::vector<uint8_t> ZlibCompress(const std::vector<uint8_t>& input) {
+  uLongf size = compressBound(static_cast<uLong>(input.size()));
+  std::vector<uint8_t> output(size);
+  PERFETTO_CHECK(compress(output.data(), &size, input.data(),
+                          static_cast<uLong>(input.size())) == Z_OK);
+  output.resize(size);
+  return output;
+}
+
+// Creates a trace which looks like a compressed write_into_file trace: every
+// top-level packet is a CompressedPackets wrapping ~512KB of small packets.
+std::vector<uint8_t> CreateCompressedTrace(uint32_t compressed_packets) {
+  static constexpr uint32_t kRandomSeed = 42;
+  std::minstd_rand0 rnd_engine(kRandomSeed);
+
+  protozero::HeapBuffered<protozero::Message> trace;
+  for (uint32_t i = 0; i < compressed_packets; ++i) {
+    protozero::HeapBuffered<protozero::Message> inner;
+    for (uint32_t j = 0; j < 8192; ++j) {
+      protozero::HeapBuffered<protozero::Message> packet;
+      packet->AppendVarInt(/*timestamp*/ 8, rnd_engine());
+      packet->AppendString(/*dummy payload*/ 1000,
+                           "slice_" + std::to_string(rnd_engine() % 1024));
+      std::vector<uint8_t> packet_data = packet.SerializeAsArray();
+      inner->AppendBytes(/*packet*/ 1, packet_data.data(), packet_data.size());
+    }
+    std::vector<uint8_t> compressed = ZlibCompress(inner.SerializeAsArray());
+
+    protozero::HeapBuffered<protozero::Message> packet;
+    packet->AppendBytes(
+        protos::pbzero::TracePacket::kCompressedPacketsFieldNumber,
+        compressed.data(), compressed.size());
+    std::vector<uint8_t> packet_data = packet.SerializeAsArray();
+    trace->AppendBytes(/*packet*/ 1, packet_data.data(), packet_data.size());
+  }
+  return trace.SerializeAsArray();
+}
+
+void TokenizerArgs(benchmark::internal::Benchmark* b) {
+  if (IsBenchmarkFunctionalOnly()) {
+    b->Args({0});
+    b->Args({2});
+    return;
+  }
+  for (int threads : {0, 1, 2, 4, 8, 16, 32}) {
+    b->Args({threads});
+  }
+}
+
+}  // namespace
+
+static void BM_ProtoTraceTokenizerCompressedPackets(benchmark::State& state) {
+  auto thread_count = static_cast<uint32_t>(state.range(0));
+  std::vector<uint8_t> data =
+      CreateCompressedTrace(IsBenchmarkFunctionalOnly() ? 4 : 256);
+
+  std::unique_ptr<base::ThreadPool> pool;
+  if (thread_count > 0) {
+    pool = std::make_unique<base::ThreadPool>(thread_count);
+  }
+
+  uint64_t packets = 0;
+  for (auto _ : state) {
+    ProtoTraceTokenizer tokenizer(pool.get(), thread_count);
+    for (size_t off = 0; off < data.size(); off += kChunkSize) {
+      size_t size = std::min(kChunkSize, data.size() - off);
+      base::Status status = tokenizer.Tokenize(
+          TraceBlobView(TraceBlob::CopyFrom(data.data() + off, size)),
+          [&packets](TraceBlobView packet) {
+            benchmark::DoNotOptimize(packet.data());
+            packets++;
+            return base::OkStatus();
+          });
+      PERFETTO_CHECK(status.ok());
+    }
+  }
+  state.counters["packets/s"] =
+      benchmark::Counter(static_cast<double>(packets),
+                         benchmark::Counter::kIsRate);
+  state.SetBytesProcessed(static_cast<int64_t>(data.size()) *
+                          static_cast<int64_t>(state.iterations()));
+}
+BENCHMARK(BM_ProtoTraceTokenizerCompressedPackets)
+    ->Apply(TokenizerArgs)
+    ->UseRealTime();
+
+}  // namespace perfetto::trace_processor
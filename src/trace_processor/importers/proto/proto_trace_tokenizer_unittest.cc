@@ -16,9 +16,18 @@
 
 #include "src/trace_processor/importers/proto/proto_trace_tokenizer.h"
 
+#include <string>
+#include <vector>
+
+#include "perfetto/base/build_config.h"
+#include "perfetto/ext/base/threading/thread_pool.h"
 #include "perfetto/protozero/scattered_heap_buffer.h"
 #include "test/gtest_and_gmock.h"
 
+#if PERFETTO_BUILDFLAG(PERFETTO_ZLIB)
+#include <zlib.h>
+#endif
+
 namespace perfetto::trace_processor {
 namespace {
 
@@ -145,5 +154,88 @@ TEST(ProtoTraceTokenizerTest, SkipFieldsSingleByteByByte) {
   }
 }
 
+#if PERFETTO_BUILDFLAG(PERFETTO_ZLIB)
+
+std::vector<uint8_t> ZlibCompress(const std::vector<uint8_t>& input) {
+  uLongf size = compressBound(static_cast<uLong>(input.size()));
+  std::vector<uint8_t> output(size);
+  PERFETTO_CHECK(compress(output.data(), &size, input.data(),
+                          static_cast<uLong>(input.size())) == Z_OK);
+  output.resize(size);
+  return output;
+}
+
+// Creates a trace where every other packet is a CompressedPackets packet
+// wrapping two inner packets.
+std::vector<uint8_t> CreateTraceWithCompressedPackets(
+    uint32_t count,
+    std::vector<std::string>* expected) {
+  protozero::HeapBuffered<protozero::Message> trace;
+  for (uint32_t i = 0; i < count; ++i) {
+    std::string plain = "plain" + std::to_string(i);
+    trace->AppendString(/*field_id=*/1, plain);
+    expected->push_back(plain);
+
+    protozero::HeapBuffered<protozero::Message> inner;
+    for (uint32_t j = 0; j < 2; ++j) {
+      std::string name = "inner" + std::to_string(i) + "_" + std::to_string(j);
+      inner->AppendString(/*field_id=*/1, name);
+      expected->push_back(name);
+    }
+    std::vector<uint8_t> compressed = ZlibCompress(inner.SerializeAsArray());
+    protozero::HeapBuffered<protozero::Message> packet;
+    packet->AppendBytes(
+        protos::pbzero::TracePacket::kCompressedPacketsFieldNumber,
+        compressed.data(), compressed.size());
+    std::vector<uint8_t> packet_data = packet.SerializeAsArray();
+    trace->AppendBytes(/*field_id=*/1, packet_data.data(), packet_data.size());
+  }
+  return trace.SerializeAsArray();
+}
+
+TEST(ProtoTraceTokenizerTest, CompressedPacketsInOrder) {
+  std::vector<std::string> expected;
+  std::vector<uint8_t> data = CreateTraceWithCompressedPackets(300, &expected);
+
+  ProtoTraceTokenizer tokenizer;
+  std::vector<std::string> actual;
+  auto bv = TraceBlobView(TraceBlob::CopyFrom(data.data(), data.size()));
+  ASSERT_TRUE(tokenizer
+                  .Tokenize(std::move(bv),
+                            [&actual](TraceBlobView out) {
+                              actual.emplace_back(ToStringView(out));
+                              return base::OkStatus();
+                            })
+                  .ok());
+  ASSERT_EQ(actual, expected);
+}
+
+TEST(ProtoTraceTokenizerTest, CompressedPacketsInOrderWithThreadPool) {
+  std::vector<std::string> expected;
+  std::vector<uint8_t> data = CreateTraceWithCompressedPackets(300, &expected);
+
+  base::ThreadPool pool(4);
+  ProtoTraceTokenizer tokenizer(&pool, 4);
+  std::vector<std::string> actual;
+
+  // Feed the trace in small chunks to also exercise packets which straddle
+  // Tokenize() calls while others are pending decompression.
+  constexpr size_t kChunkSize = 37;
+  for (size_t i = 0; i < data.size(); i += kChunkSize) {
+    size_t size = std::min(kChunkSize, data.size() - i);
+    auto bv = TraceBlobView(TraceBlob::CopyFrom(data.data() + i, size));
+    ASSERT_TRUE(tokenizer
+                    .Tokenize(std::move(bv),
+                              [&actual](TraceBlobView out) {
+                                actual.emplace_back(ToStringView(out));
+                                return base::OkStatus();
+                              })
+                    .ok());
+  }
+  ASSERT_EQ(actual, expected);
+}
+
+#endif  // PERFETTO_BUILDFLAG(PERFETTO_ZLIB)
+
 }  // namespace
 }  // namespace perfetto::trace_processor
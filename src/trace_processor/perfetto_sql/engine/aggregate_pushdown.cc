@@ -0,0 +1,483 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "src/trace_processor/perfetto_sql/engine/aggregate_pushdown.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <limits>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "perfetto/base/logging.h"
+#include "perfetto/ext/base/string_utils.h"
+#include "perfetto/ext/base/string_view.h"
+#include "perfetto/trace_processor/basic_types.h"
+#include "src/trace_processor/db/column.h"
+#include "src/trace_processor/db/column/types.h"
+#include "src/trace_processor/db/table.h"
+#include "src/trace_processor/db/table_aggregator.h"
+#include "src/trace_processor/perfetto_sql/grammar/perfettosql_grammar.h"
+#include "src/trace_processor/perfetto_sql/tokenizer/sqlite_tokenizer.h"
+#include "src/trace_processor/sqlite/sql_source.h"
+#include "src/trace_processor/util/sql_argument.h"
+
+namespace perfetto::trace_processor {
+namespace {
+
+using Op = TableAggregator::Op;
+using Token = SqliteTokenizer::Token;
+
+// Aggregations with more groups than this are left to SQLite: the result
+// is returned as a literal statement which should stay small.
+constexpr uint32_t kMaxGroups = 1024;
+
+// The parsed form of a statement which might be pushed down.
+struct Aggregation {
+  struct Item {
+    // The name of the result column.
+    std::string name;
+    // Index into |aggregates| or std::nullopt for the group column.
+    std::optional<uint32_t> aggregate;
+  };
+  struct Function {
+    Op op;
+    // std::nullopt for COUNT(*).
+    std::optional<std::string> column;
+  };
+  struct Condition {
+    std::string column;
+    FilterOp op;
+    // The right-hand side of comparisons: at most one of these is set.
+    std::optional<SqlValue> number;
+    std::optional<std::string> string;
+  };
+
+  std::vector<Item> items;
+  std::vector<Function> aggregates;
+  // The columns which appear in the SELECT list outside of an aggregate.
+  std::vector<std::string> columns;
+  std::string table;
+  std::vector<Condition> conditions;
+  std::optional<std::string> group_by;
+};
+
+bool IsIdentifier(const Token& token) {
+  return token.token_type == TK_ID &&
+         sql_argument::IsValidName(
+             base::StringView(token.str.data(), token.str.size()));
+}
+
+std::optional<Op> ParseFunction(std::string_view name) {
+  base::StringView str(name.data(), name.size());
+  if (str.CaseInsensitiveEq("count")) {
+    return Op::kCount;
+  }
+  if (str.CaseInsensitiveEq("sum")) {
+    return Op::kSum;
+  }
+  if (str.CaseInsensitiveEq("min")) {
+    return Op::kMin;
+  }
+  if (str.CaseInsensitiveEq("max")) {
+    return Op::kMax;
+  }
+  return std::nullopt;
+}
+
+// Parses the (optionally negated) literal on the right-hand side of a
+// comparison.
+bool ParseLiteral(SqliteTokenizer& tokenizer, Aggregation::Condition& cond) {
+  Token token = tokenizer.NextNonWhitespace();
+  bool negate = token.token_type == TK_MINUS;
+  if (negate) {
+    token = tokenizer.NextNonWhitespace();
+  }
+  switch (token.token_type) {
+    case TK_INTEGER: {
+      // Only decimal literals which are guaranteed to fit in an int64: SQLite
+      // parses larger ones as doubles.
+      if (token.str.size() > 18 ||
+          token.str.find_first_not_of("0123456789") != std::string_view::npos) {
+        return false;
+      }
+      std::optional<int64_t> value =
+          base::StringToInt64(std::string(token.str));
+      if (!value) {
+        return false;
+      }
+      cond.number = SqlValue::Long(negate ? -*value : *value);
+      return true;
+    }
+    case TK_FLOAT: {
+      std::optional<double> value =
+          base::StringToDouble(std::string(token.str));
+      if (!value || !std::isfinite(*value)) {
+        return false;
+      }
+      cond.number = SqlValue::Double(negate ? -*value : *value);
+      return true;
+    }
+    case TK_STRING: {
+      if (negate || token.str.size() < 2 || token.str.front() != '\'') {
+        return false;
+      }
+      std::string_view contents = token.str.substr(1, token.str.size() - 2);
+      cond.string.emplace();
+      for (size_t i = 0; i < contents.size(); ++i) {
+        cond.string->push_back(contents[i]);
+        // Quotes inside the string are escaped by doubling them.
+        if (contents[i] == '\'') {
+          ++i;
+        }
+      }
+      return true;
+    }
+    default:
+      return false;
+  }
+}
+
+// Parses a single condition of the WHERE clause, leaving the token following
+// it in |next|.
+std::optional<Aggregation::Condition> ParseCondition(SqliteTokenizer& tokenizer,
+                                                     Token& next) {
+  Aggregation::Condition cond;
+  Token column = tokenizer.NextNonWhitespace();
+  if (!IsIdentifier(column)) {
+    return std::nullopt;
+  }
+  cond.column = column.str;
+
+  Token op = tokenizer.NextNonWhitespace();
+  bool has_value = true;
+  switch (op.token_type) {
+    case TK_EQ:
+      cond.op = FilterOp::kEq;
+      break;
+    case TK_NE:
+      cond.op = FilterOp::kNe;
+      break;
+    case TK_LT:
+      cond.op = FilterOp::kLt;
+      break;
+    case TK_LE:
+      cond.op = FilterOp::kLe;
+      break;
+    case TK_GT:
+      cond.op = FilterOp::kGt;
+      break;
+    case TK_GE:
+      cond.op = FilterOp::kGe;
+      break;
+    case TK_LIKE_KW:
+      // LIKE is evaluated by SQLite rather than by the table.
+      if (!base::StringView(op.str.data(), op.str.size())
+               .CaseInsensitiveEq("glob")) {
+        return std::nullopt;
+      }
+      cond.op = FilterOp::kGlob;
+      break;
+    case TK_ISNULL:
+      cond.op = FilterOp::kIsNull;
+      has_value = false;
+      break;
+    case TK_NOTNULL:
+      cond.op = FilterOp::kIsNotNull;
+      has_value = false;
+      break;
+    case TK_IS:
+    case TK_NOT: {
+      // IS NULL, IS NOT NULL and NOT NULL.
+      Token token = tokenizer.NextNonWhitespace();
+      cond.op =
+          op.token_type == TK_IS ? FilterOp::kIsNull : FilterOp::kIsNotNull;
+      if (op.token_type == TK_IS && token.token_type == TK_NOT) {
+        cond.op = FilterOp::kIsNotNull;
+        token = tokenizer.NextNonWhitespace();
+      }
+      if (token.token_type != TK_NULL) {
+        return std::nullopt;
+      }
+      has_value = false;
+      break;
+    }
+    default:
+      return std::nullopt;
+  }
+  if (has_value && !ParseLiteral(tokenizer, cond)) {
+    return std::nullopt;
+  }
+  next = tokenizer.NextNonWhitespace();
+  return std::move(cond);
+}
+
+std::optional<Aggregation> Parse(SqliteTokenizer& tokenizer) {
+  Aggregation agg;
+  if (tokenizer.NextNonWhitespace().token_type != TK_SELECT) {
+    return std::nullopt;
+  }
+
+  // The SELECT list.
+  Token next;
+  do {
+    Token first = tokenizer.NextNonWhitespace();
+    if (!IsIdentifier(first)) {
+      return std::nullopt;
+    }
+    Token last = first;
+    Aggregation::Item item;
+    next = tokenizer.NextNonWhitespace();
+    if (next.token_type == TK_LP) {
+      std::optional<Op> op = ParseFunction(first.str);
+      if (!op) {
+        return std::nullopt;
+      }
+      Token arg = tokenizer.NextNonWhitespace();
+      Aggregation::Function function{*op, std::nullopt};
+      if (IsIdentifier(arg)) {
+        function.column = arg.str;
+      } else if (arg.token_type != TK_STAR || *op != Op::kCount) {
+        return std::nullopt;
+      }
+      last = tokenizer.NextNonWhitespace();
+      if (last.token_type != TK_RP) {
+        return std::nullopt;
+      }
+      item.aggregate = static_cast<uint32_t>(agg.aggregates.size());
+      agg.aggregates.push_back(std::move(function));
+      next = tokenizer.NextNonWhitespace();
+    } else {
+      agg.columns.emplace_back(first.str);
+    }
+    if (next.token_type == TK_AS) {
+      Token alias = tokenizer.NextNonWhitespace();
+      if (!IsIdentifier(alias)) {
+        return std::nullopt;
+      }
+      item.name = alias.str;
+      next = tokenizer.NextNonWhitespace();
+    } else {
+      // Without an alias, SQLite names the column after the text of the
+      // expression.
+      const char* end = last.str.data() + last.str.size();
+      item.name = std::string(first.str.data(), end);
+    }
+    agg.items.push_back(std::move(item));
+  } while (next.token_type == TK_COMMA);
+
+  if (next.token_type != TK_FROM) {
+    return std::nullopt;
+  }
+  Token table = tokenizer.NextNonWhitespace();
+  if (!IsIdentifier(table)) {
+    return std::nullopt;
+  }
+  agg.table = table.str;
+
+  next = tokenizer.NextNonWhitespace();
+  if (next.token_type == TK_WHERE) {
+    do {
+      std::optional<Aggregation::Condition> cond =
+          ParseCondition(tokenizer, next);
+      if (!cond) {
+        return std::nullopt;
+      }
+      agg.conditions.push_back(std::move(*cond));
+    } while (next.token_type == TK_AND);
+  }
+  if (next.token_type == TK_GROUP) {
+    if (tokenizer.NextNonWhitespace().token_type != TK_BY) {
+      return std::nullopt;
+    }
+    Token column = tokenizer.NextNonWhitespace();
+    if (!IsIdentifier(column)) {
+      return std::nullopt;
+    }
+    agg.group_by = column.str;
+    next = tokenizer.NextNonWhitespace();
+  }
+  if (!next.IsTerminal()) {
+    return std::nullopt;
+  }
+  return std::move(agg);
+}
+
+bool IsNumeric(ColumnType type) {
+  return type != ColumnType::kString && type != ColumnType::kDummy;
+}
+
+// Returns |value| as a SQL literal which SQLite parses back to exactly the
+// same value.
+std::optional<std::string> ToLiteral(const SqlValue& value) {
+  switch (value.type) {
+    case SqlValue::kNull:
+      return "NULL";
+    case SqlValue::kLong:
+      // The minimum int64 value can only be written as an expression.
+      if (value.long_value == std::numeric_limits<int64_t>::min()) {
+        return std::nullopt;
+      }
+      return std::to_string(value.long_value);
+    case SqlValue::kDouble: {
+      if (!std::isfinite(value.double_value)) {
+        return std::nullopt;
+      }
+      char buf[32];
+      snprintf(buf, sizeof(buf), "%.17g", value.double_value);
+      std::string str = buf;
+      if (str.find_first_of(".e") == std::string::npos) {
+        str += ".0";
+      }
+      return str;
+    }
+    case SqlValue::kString: {
+      std::string str = "'";
+      for (const char* c = value.string_value; *c; ++c) {
+        str += *c == '\'' ? "''" : std::string(1, *c);
+      }
+      return str + "'";
+    }
+    case SqlValue::kBytes:
+      return std::nullopt;
+  }
+  PERFETTO_FATAL("For GCC");
+}
+
+std::string QuoteIdentifier(const std::string& name) {
+  std::string str = "\"";
+  for (char c : name) {
+    str += c == '"' ? "\"\"" : std::string(1, c);
+  }
+  return str + "\"";
+}
+
+}  // namespace
+
+std::optional<std::string> PushDownAggregation(
+    const SqlSource& sql,
+    const std::function<const Table*(std::string_view)>& get_table,
+    base::ThreadPool* pool) {
+  SqliteTokenizer tokenizer(sql);
+  std::optional<Aggregation> agg = Parse(tokenizer);
+  if (!agg) {
+    return std::nullopt;
+  }
+  const Table* table = get_table(agg->table);
+  if (!table) {
+    return std::nullopt;
+  }
+
+  std::optional<uint32_t> group_by;
+  if (agg->group_by) {
+    group_by = table->ColumnIdxFromName(*agg->group_by);
+    if (!group_by) {
+      return std::nullopt;
+    }
+  }
+  // Columns outside of aggregates are only well defined if they are the
+  // group column.
+  for (const std::string& column : agg->columns) {
+    if (!agg->group_by || column != *agg->group_by) {
+      return std::nullopt;
+    }
+  }
+
+  std::vector<TableAggregator::Aggregate> aggregates;
+  for (const Aggregation::Function& function : agg->aggregates) {
+    TableAggregator::Aggregate aggregate{function.op, std::nullopt};
+    if (function.column) {
+      aggregate.col = table->ColumnIdxFromName(*function.column);
+      if (!aggregate.col) {
+        return std::nullopt;
+      }
+    }
+    aggregates.push_back(aggregate);
+  }
+
+  Query query;
+  for (const Aggregation::Condition& cond : agg->conditions) {
+    std::optional<uint32_t> col = table->ColumnIdxFromName(cond.column);
+    if (!col) {
+      return std::nullopt;
+    }
+    // Only allow comparisons between values of the same kind to avoid
+    // depending on how SQLite applies type affinities.
+    ColumnType type = table->columns()[*col].col_type();
+    SqlValue value;
+    if (cond.string) {
+      if (type != ColumnType::kString) {
+        return std::nullopt;
+      }
+      value = SqlValue::String(cond.string->c_str());
+    } else if (cond.number) {
+      if (!IsNumeric(type) || cond.op == FilterOp::kGlob) {
+        return std::nullopt;
+      }
+      value = *cond.number;
+    }
+    query.constraints.push_back(Constraint{*col, cond.op, value});
+  }
+
+  std::optional<TableAggregator::Result> result = TableAggregator::Compute(
+      *table, query, group_by, aggregates, kMaxGroups, pool);
+  if (!result) {
+    return std::nullopt;
+  }
+
+  // Convert the result into a statement with the same columns.
+  uint32_t offset = group_by ? 1 : 0;
+  std::vector<std::string> rows;
+  for (const std::vector<SqlValue>& values : *result) {
+    std::vector<std::string> literals;
+    for (const Aggregation::Item& item : agg->items) {
+      std::optional<std::string> literal = ToLiteral(
+          item.aggregate ? values[offset + *item.aggregate] : values[0]);
+      if (!literal) {
+        return std::nullopt;
+      }
+      if (!group_by) {
+        *literal += " AS " + QuoteIdentifier(item.name);
+      }
+      literals.push_back(std::move(*literal));
+    }
+    rows.push_back(base::Join(literals, ", "));
+  }
+  if (!group_by) {
+    PERFETTO_DCHECK(rows.size() == 1);
+    return "SELECT " + rows[0];
+  }
+
+  std::vector<std::string> columns;
+  for (uint32_t i = 0; i < agg->items.size(); ++i) {
+    columns.push_back("column" + std::to_string(i + 1) + " AS " +
+                      QuoteIdentifier(agg->items[i].name));
+  }
+  std::string res = "SELECT " + base::Join(columns, ", ");
+  if (rows.empty()) {
+    // VALUES cannot be empty so use a row of NULLs which is filtered out.
+    std::vector<std::string> nulls(agg->items.size(), "NULL");
+    return res + " FROM (VALUES (" + base::Join(nulls, ", ") + ")) WHERE 0";
+  }
+  return res + " FROM (VALUES (" + base::Join(rows, "), (") + "))";
+}
+
+}  // namespace perfetto::trace_processor
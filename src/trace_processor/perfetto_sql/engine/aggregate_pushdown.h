@@ -0,0 +1,62 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_TRACE_PROCESSOR_PERFETTO_SQL_ENGINE_AGGREGATE_PUSHDOWN_H_
+#define SRC_TRACE_PROCESSOR_PERFETTO_SQL_ENGINE_AGGREGATE_PUSHDOWN_H_
+
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "src/trace_processor/sqlite/sql_source.h"
+
+namespace perfetto {
+namespace base {
+class ThreadPool;
+}  // namespace base
+
+namespace trace_processor {
+
+class Table;
+
+// Computes simple aggregations over a single table without going through
+// SQLite's VM.
+//
+// SQLite has no way to push aggregations down into virtual tables so, for
+// a statement like
+//   SELECT depth, COUNT(*), SUM(dur) FROM __intrinsic_slice
+//   WHERE dur > 0 GROUP BY depth
+// every matching row and cell would be converted to a SQLite value before
+// being aggregated. Instead, if |sql| is a statement of the form
+//   SELECT <item>, ... FROM <table>
+//   [WHERE <column> <op> <literal> [AND ...]] [GROUP BY <column>]
+// where each item is either the group column or COUNT, SUM, MIN or MAX of
+// a column (or COUNT(*)) with an optional alias, and |get_table| returns the
+// table backing <table>, the aggregation is computed with |TableAggregator|.
+//
+// Returns the SQL of a statement returning the result (with the same column
+// names as |sql|) or std::nullopt if |sql| cannot be handled this way, in
+// which case it should be executed by SQLite as usual.
+std::optional<std::string> PushDownAggregation(
+    const SqlSource& sql,
+    const std::function<const Table*(std::string_view)>& get_table,
+    base::ThreadPool* pool);
+
+}  // namespace trace_processor
+}  // namespace perfetto
+
+#endif  // SRC_TRACE_PROCESSOR_PERFETTO_SQL_ENGINE_AGGREGATE_PUSHDOWN_H_
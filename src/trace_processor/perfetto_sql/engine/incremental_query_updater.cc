@@ -0,0 +1,171 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "src/trace_processor/perfetto_sql/engine/incremental_query_updater.h"
+
+#include <sqlite3.h>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <utility>
+
+#include "perfetto/base/status.h"
+#include "perfetto/ext/base/status_or.h"
+#include "perfetto/ext/base/string_utils.h"
+#include "perfetto/trace_processor/basic_types.h"
+#include "src/trace_processor/perfetto_sql/engine/perfetto_sql_engine.h"
+#include "src/trace_processor/sqlite/sql_source.h"
+#include "src/trace_processor/util/sql_argument.h"
+#include "src/trace_processor/util/status_macros.h"
+
+namespace perfetto::trace_processor {
+namespace {
+
+using Function = IncrementalQuery::Function;
+
+const char* FunctionName(Function function) {
+  switch (function) {
+    case Function::kCount:
+      return "COUNT";
+    case Function::kSum:
+      return "SUM";
+    case Function::kMin:
+      return "MIN";
+    case Function::kMax:
+      return "MAX";
+  }
+  PERFETTO_FATAL("For GCC");
+}
+
+// Returns the function used to merge two partial results of |function|.
+const char* MergeFunctionName(Function function) {
+  return function == Function::kCount ? "SUM" : FunctionName(function);
+}
+
+}  // namespace
+
+IncrementalQueryUpdater::IncrementalQueryUpdater(IncrementalQuery query)
+    : query_(std::move(query)),
+      group_by_list_(base::Join(query_.group_by, ", ")) {}
+
+base::StatusOr<IncrementalQueryUpdater> IncrementalQueryUpdater::Create(
+    IncrementalQuery query) {
+  if (!sql_argument::IsValidName(base::StringView(query.name))) {
+    return base::ErrStatus("Incremental query: invalid name '%s'",
+                           query.name.c_str());
+  }
+  if (!sql_argument::IsValidName(base::StringView(query.table))) {
+    return base::ErrStatus("Incremental query %s: invalid table name '%s'",
+                           query.name.c_str(), query.table.c_str());
+  }
+  for (const std::string& column : query.group_by) {
+    if (!sql_argument::IsValidName(base::StringView(column))) {
+      return base::ErrStatus("Incremental query %s: invalid column name '%s'",
+                             query.name.c_str(), column.c_str());
+    }
+  }
+  if (query.aggregates.empty()) {
+    return base::ErrStatus("Incremental query %s: no aggregates specified",
+                           query.name.c_str());
+  }
+  for (const IncrementalQuery::Aggregate& aggregate : query.aggregates) {
+    if (!sql_argument::IsValidName(base::StringView(aggregate.name))) {
+      return base::ErrStatus(
+          "Incremental query %s: invalid aggregate name '%s'",
+          query.name.c_str(), aggregate.name.c_str());
+    }
+    if (aggregate.expr.empty() && aggregate.function != Function::kCount) {
+      return base::ErrStatus(
+          "Incremental query %s: aggregate '%s' has no expression",
+          query.name.c_str(), aggregate.name.c_str());
+    }
+  }
+  return IncrementalQueryUpdater(std::move(query));
+}
+
+base::Status IncrementalQueryUpdater::Update(PerfettoSqlEngine* engine) {
+  // Find out the id of the last row which will be aggregated: this is cheap
+  // as the constraint on id only selects the new rows.
+  std::optional<int64_t> last_id;
+  {
+    std::string sql = "SELECT MAX(id) FROM " + query_.table +
+                      " WHERE id >= " + std::to_string(watermark_);
+    ASSIGN_OR_RETURN(auto res,
+                     engine->ExecuteUntilLastStatement(
+                         SqlSource::FromTraceProcessorImplementation(sql)));
+    sqlite3_stmt* stmt = res.stmt.sqlite_stmt();
+    if (!res.stmt.IsDone() && sqlite3_column_type(stmt, 0) != SQLITE_NULL) {
+      last_id = sqlite3_column_int64(stmt, 0);
+    }
+  }
+  if (!last_id && created_) {
+    return base::OkStatus();
+  }
+
+  std::string sql;
+  if (!created_) {
+    sql = "CREATE PERFETTO TABLE " + query_.name + " AS " + PartialResultSql();
+  } else {
+    sql = "CREATE OR REPLACE PERFETTO TABLE " + query_.name + " AS SELECT ";
+    if (!query_.group_by.empty()) {
+      sql += group_by_list_ + ", ";
+    }
+    for (uint32_t i = 0; i < query_.aggregates.size(); ++i) {
+      const IncrementalQuery::Aggregate& aggregate = query_.aggregates[i];
+      sql += (i == 0 ? "" : ", ") +
+             std::string(MergeFunctionName(aggregate.function)) + "(" +
+             aggregate.name + ") AS " + aggregate.name;
+    }
+    sql += " FROM (SELECT * FROM " + query_.name + " UNION ALL " +
+           PartialResultSql() + ")";
+    if (!query_.group_by.empty()) {
+      sql += " GROUP BY " + group_by_list_;
+    }
+  }
+  RETURN_IF_ERROR(
+      engine->Execute(SqlSource::FromTraceProcessorImplementation(sql))
+          .status());
+
+  created_ = true;
+  if (last_id) {
+    watermark_ = *last_id + 1;
+  }
+  return base::OkStatus();
+}
+
+std::string IncrementalQueryUpdater::PartialResultSql() const {
+  std::string sql = "SELECT ";
+  if (!query_.group_by.empty()) {
+    sql += group_by_list_ + ", ";
+  }
+  for (uint32_t i = 0; i < query_.aggregates.size(); ++i) {
+    const IncrementalQuery::Aggregate& aggregate = query_.aggregates[i];
+    const std::string& expr = aggregate.expr.empty() ? "*" : aggregate.expr;
+    sql += (i == 0 ? "" : ", ") +
+           std::string(FunctionName(aggregate.function)) + "(" + expr +
+           ") AS " + aggregate.name;
+  }
+  sql += " FROM " + query_.table + " WHERE id >= " + std::to_string(watermark_);
+  if (!query_.filter.empty()) {
+    sql += " AND (" + query_.filter + ")";
+  }
+  if (!query_.group_by.empty()) {
+    sql += " GROUP BY " + group_by_list_;
+  }
+  return sql;
+}
+
+}  // namespace perfetto::trace_processor
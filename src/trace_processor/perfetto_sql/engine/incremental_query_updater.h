@@ -0,0 +1,72 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_TRACE_PROCESSOR_PERFETTO_SQL_ENGINE_INCREMENTAL_QUERY_UPDATER_H_
+#define SRC_TRACE_PROCESSOR_PERFETTO_SQL_ENGINE_INCREMENTAL_QUERY_UPDATER_H_
+
+#include <cstdint>
+#include <string>
+
+#include "perfetto/base/status.h"
+#include "perfetto/ext/base/status_or.h"
+#include "perfetto/trace_processor/basic_types.h"
+
+namespace perfetto::trace_processor {
+
+class PerfettoSqlEngine;
+
+// Maintains the result table of an |IncrementalQuery|.
+//
+// The updater remembers the id of the first row of the source table which has
+// not been aggregated yet (the "watermark"). On each update, only the rows
+// at or after the watermark are aggregated and the partial result is merged
+// with the previous one: counts and sums are summed, minimums and maximums are
+// combined with MIN and MAX. This is all done in SQL, by replacing the result
+// table with a PERFETTO TABLE built from the union of the previous result and
+// the partial one, so the cost of an update is proportional to the number of
+// new rows and groups rather than to the size of the source table.
+class IncrementalQueryUpdater {
+ public:
+  // Validates |query| and returns an updater for it. The result table is only
+  // created by the first call to |Update|.
+  static base::StatusOr<IncrementalQueryUpdater> Create(IncrementalQuery query);
+
+  // Aggregates the rows appended to the source table since the last
+  // successful call and merges them into the result table. If an error is
+  // returned, the result table and the watermark are left unchanged.
+  base::Status Update(PerfettoSqlEngine*);
+
+  const std::string& name() const { return query_.name; }
+
+ private:
+  explicit IncrementalQueryUpdater(IncrementalQuery);
+
+  // Returns the SQL aggregating the rows of the source table at or after
+  // |watermark_|.
+  std::string PartialResultSql() const;
+
+  IncrementalQuery query_;
+
+  // Comma separated list of the columns of |query_.group_by|.
+  std::string group_by_list_;
+
+  int64_t watermark_ = 0;
+  bool created_ = false;
+};
+
+}  // namespace perfetto::trace_processor
+
+#endif  // SRC_TRACE_PROCESSOR_PERFETTO_SQL_ENGINE_INCREMENTAL_QUERY_UPDATER_H_
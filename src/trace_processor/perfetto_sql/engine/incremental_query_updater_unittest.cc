@@ -0,0 +1,160 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "src/trace_processor/perfetto_sql/engine/incremental_query_updater.h"
+
+#include <sqlite3.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "perfetto/trace_processor/basic_types.h"
+#include "src/trace_processor/perfetto_sql/engine/perfetto_sql_engine.h"
+#include "src/trace_processor/sqlite/sql_source.h"
+#include "src/trace_processor/tables/slice_tables_py.h"
+#include "test/gtest_and_gmock.h"
+
+namespace perfetto::trace_processor {
+namespace {
+
+using Function = IncrementalQuery::Function;
+
+class IncrementalQueryUpdaterTest : public ::testing::Test {
+ protected:
+  IncrementalQueryUpdaterTest() {
+    engine_.RegisterStaticTable(&slices_, "slice",
+                                tables::SliceTable::ComputeStaticSchema());
+  }
+
+  void InsertSlices(uint32_t count) {
+    for (uint32_t i = 0; i < count; ++i) {
+      auto n = static_cast<int64_t>(inserted_++);
+      tables::SliceTable::Row row;
+      row.ts = n;
+      row.dur = n % 7;
+      row.depth = static_cast<uint32_t>(n % 3);
+      slices_.Insert(row);
+    }
+  }
+
+  // Returns all the rows returned by |sql| with the columns joined by ','.
+  std::vector<std::string> Rows(const std::string& sql) {
+    auto res = engine_.ExecuteUntilLastStatement(
+        SqlSource::FromExecuteQuery(sql));
+    EXPECT_TRUE(res.ok()) << res.status().c_message();
+    std::vector<std::string> rows;
+    if (!res.ok()) {
+      return rows;
+    }
+    for (; !res->stmt.IsDone(); res->stmt.Step()) {
+      std::string row;
+      sqlite3_stmt* stmt = res->stmt.sqlite_stmt();
+      for (int i = 0; i < sqlite3_column_count(stmt); ++i) {
+        const auto* text = sqlite3_column_text(stmt, i);
+        row += (i == 0 ? "" : ",") +
+               std::string(text ? reinterpret_cast<const char*>(text) : "NULL");
+      }
+      rows.push_back(std::move(row));
+    }
+    EXPECT_TRUE(res->stmt.status().ok());
+    return rows;
+  }
+
+  StringPool pool_;
+  PerfettoSqlEngine engine_{&pool_, true};
+  tables::SliceTable slices_{&pool_};
+  uint32_t inserted_ = 0;
+};
+
+IncrementalQuery DepthQuery() {
+  IncrementalQuery query;
+  query.name = "depth_stats";
+  query.table = "slice";
+  query.filter = "dur > 0";
+  query.group_by = {"depth"};
+  query.aggregates = {
+      {Function::kCount, "", "cnt"},
+      {Function::kSum, "dur", "total_dur"},
+      {Function::kMin, "ts", "min_ts"},
+      {Function::kMax, "ts", "max_ts"},
+  };
+  return query;
+}
+
+TEST_F(IncrementalQueryUpdaterTest, MatchesFullQueryAfterEachUpdate) {
+  auto updater = IncrementalQueryUpdater::Create(DepthQuery());
+  ASSERT_TRUE(updater.ok()) << updater.status().c_message();
+
+  for (uint32_t batch : {0u, 10u, 1u, 0u, 100u, 57u}) {
+    InsertSlices(batch);
+    auto status = updater->Update(&engine_);
+    ASSERT_TRUE(status.ok()) << status.c_message();
+    ASSERT_EQ(Rows("SELECT * FROM depth_stats ORDER BY depth"),
+              Rows("SELECT depth, COUNT(*), SUM(dur), MIN(ts), MAX(ts) "
+                   "FROM slice WHERE dur > 0 GROUP BY depth ORDER BY depth"));
+  }
+  ASSERT_FALSE(Rows("SELECT * FROM depth_stats").empty());
+}
+
+TEST_F(IncrementalQueryUpdaterTest, RowsAreOnlyAggregatedOnce) {
+  IncrementalQuery query;
+  query.name = "total";
+  query.table = "slice";
+  query.aggregates = {{Function::kSum, "dur", "dur"}};
+  auto updater = IncrementalQueryUpdater::Create(std::move(query));
+  ASSERT_TRUE(updater.ok());
+
+  ASSERT_TRUE(updater->Update(&engine_).ok());
+  ASSERT_THAT(Rows("SELECT * FROM total"), testing::ElementsAre("NULL"));
+
+  InsertSlices(8);
+  ASSERT_TRUE(updater->Update(&engine_).ok());
+  ASSERT_THAT(Rows("SELECT * FROM total"), testing::ElementsAre("21"));
+
+  // Changes to rows which were already aggregated are not picked up.
+  slices_.mutable_dur()->Set(0, 1000);
+  ASSERT_TRUE(updater->Update(&engine_).ok());
+  ASSERT_THAT(Rows("SELECT * FROM total"), testing::ElementsAre("21"));
+
+  InsertSlices(1);
+  ASSERT_TRUE(updater->Update(&engine_).ok());
+  ASSERT_THAT(Rows("SELECT * FROM total"), testing::ElementsAre("22"));
+}
+
+TEST_F(IncrementalQueryUpdaterTest, InvalidQuery) {
+  IncrementalQuery query = DepthQuery();
+  query.name = "depth stats";
+  ASSERT_FALSE(IncrementalQueryUpdater::Create(query).ok());
+
+  query = DepthQuery();
+  query.aggregates.clear();
+  ASSERT_FALSE(IncrementalQueryUpdater::Create(query).ok());
+
+  query = DepthQuery();
+  query.aggregates[1].expr.clear();
+  ASSERT_FALSE(IncrementalQueryUpdater::Create(query).ok());
+
+  // Names clashing with existing tables are only detected when the result is
+  // created.
+  query = DepthQuery();
+  query.name = "slice";
+  auto updater = IncrementalQueryUpdater::Create(query);
+  ASSERT_TRUE(updater.ok());
+  ASSERT_FALSE(updater->Update(&engine_).ok());
+}
+
+}  // namespace
+}  // namespace perfetto::trace_processor
@@ -43,12 +43,15 @@
 #include "src/trace_processor/db/column/types.h"
 #include "src/trace_processor/db/runtime_table.h"
 #include "src/trace_processor/db/table.h"
+#include "src/trace_processor/perfetto_sql/engine/aggregate_pushdown.h"
 #include "src/trace_processor/perfetto_sql/engine/created_function.h"
+#include "src/trace_processor/perfetto_sql/engine/query_cache_module.h"
 #include "src/trace_processor/perfetto_sql/engine/runtime_table_function.h"
 #include "src/trace_processor/perfetto_sql/intrinsics/table_functions/static_table_function.h"
 #include "src/trace_processor/perfetto_sql/parser/function_util.h"
 #include "src/trace_processor/perfetto_sql/parser/perfetto_sql_parser.h"
 #include "src/trace_processor/perfetto_sql/preprocessor/perfetto_sql_preprocessor.h"
+#include "src/trace_processor/perfetto_sql/tokenizer/sqlite_tokenizer.h"
 #include "src/trace_processor/sqlite/db_sqlite_table.h"
 #include "src/trace_processor/sqlite/scoped_db.h"
 #include "src/trace_processor/sqlite/sql_source.h"
@@ -175,11 +178,75 @@ std::string GetTokenNamesAllowedInMacro() {
   return base::Join(result, ", ");
 }
 
+// Tables whose contents change without any statement being executed and
+// functions which are not deterministic: statements using any of these are
+// never cached.
+constexpr std::array<const char*, 6> kTablesNotCacheable({
+    "sql_stats",
+    "sqlite_master",
+    "sqlite_schema",
+    "sqlite_temp_master",
+    "sqlite_temp_schema",
+    "stats",
+});
+constexpr std::array<const char*, 5> kFunctionsNotCacheable({
+    "changes",
+    "last_insert_rowid",
+    "random",
+    "randomblob",
+    "total_changes",
+});
+
+bool IsNameInList(const char* name,
+                  const char* const* begin,
+                  const char* const* end) {
+  std::string lower = base::ToLower(name);
+  return std::any_of(begin, end, [&lower](const char* not_cacheable) {
+    return lower == not_cacheable;
+  });
+}
+
+// Returns the tokens of |source| separated by a single space: this makes
+// statements which only differ in whitespace or comments share a single query
+// cache entry.
+std::string NormalizeSqlForQueryCache(const SqlSource& source) {
+  SqliteTokenizer tokenizer(source);
+  std::string normalized;
+  for (auto t = tokenizer.NextNonWhitespace(); !t.IsTerminal();
+       t = tokenizer.NextNonWhitespace()) {
+    normalized.append(t.str);
+    normalized.push_back(' ');
+  }
+  return normalized;
+}
+
+// Returns the SQL reading the result with id |result_id| from the query cache.
+// The module reading the result has generic column names as the names of the
+// columns of |stmt| can be arbitrary expressions: the original names are
+// restored by aliasing the columns.
+std::string QueryCacheSelectSql(sqlite3_stmt* stmt, uint32_t result_id) {
+  std::vector<std::string> select_columns;
+  for (int i = 0; i < sqlite3_column_count(stmt); ++i) {
+    std::string name = sqlite3_column_name(stmt, i);
+    select_columns.push_back("c" + std::to_string(i) + " AS \"" +
+                             base::ReplaceAll(name, "\"", "\"\"") + "\"");
+  }
+  return "SELECT " + base::Join(select_columns, ", ") +
+         " FROM __intrinsic_query_cache(" + std::to_string(result_id) + ")";
+}
+
 }  // namespace
 
-PerfettoSqlEngine::PerfettoSqlEngine(StringPool* pool, bool enable_extra_checks)
+PerfettoSqlEngine::PerfettoSqlEngine(StringPool* pool,
+                                     bool enable_extra_checks,
+                                     base::ThreadPool* query_thread_pool,
+                                     uint64_t query_cache_size_bytes,
+                                     bool lazy_module_tables)
     : pool_(pool),
       enable_extra_checks_(enable_extra_checks),
+      query_thread_pool_(query_thread_pool),
+      lazy_module_tables_(lazy_module_tables),
+      query_cache_size_bytes_(query_cache_size_bytes),
       engine_(new SqliteEngine()) {
   // Initialize `perfetto_tables` table, which will contain the names of all of
   // the registered tables.
@@ -200,22 +267,39 @@ PerfettoSqlEngine::PerfettoSqlEngine(StringPool* pool, bool enable_extra_checks)
   }
   {
     auto ctx = std::make_unique<DbSqliteModule::Context>();
+    ctx->query_thread_pool = query_thread_pool;
     runtime_table_context_ = ctx.get();
     engine_->RegisterVirtualTableModule<DbSqliteModule>("runtime_table",
                                                         std::move(ctx));
   }
   {
     auto ctx = std::make_unique<DbSqliteModule::Context>();
+    ctx->query_thread_pool = query_thread_pool;
     static_table_context_ = ctx.get();
     engine_->RegisterVirtualTableModule<DbSqliteModule>("static_table",
                                                         std::move(ctx));
   }
   {
     auto ctx = std::make_unique<DbSqliteModule::Context>();
+    ctx->query_thread_pool = query_thread_pool;
     static_table_fn_context_ = ctx.get();
     engine_->RegisterVirtualTableModule<DbSqliteModule>("static_table_function",
                                                         std::move(ctx));
   }
+  if (query_cache_size_bytes_ > 0) {
+    auto ctx = std::make_unique<QueryCacheModule::Context>();
+    query_cache_context_ = ctx.get();
+    engine_->RegisterVirtualTableModule<QueryCacheModule>(
+        "__intrinsic_query_cache", std::move(ctx));
+
+    // Note: the authorizer is only invoked while statements are being
+    // prepared so this has no cost when executing statements.
+    sqlite3_set_authorizer(engine_->db(), &QueryCacheAuthorizer, this);
+  }
+  if (lazy_module_tables_) {
+    engine_->SetMissingTableFn(
+        [this](const std::string& name) { return CreateLazyTable(name); });
+  }
 }
 
 base::StatusOr<SqliteEngine::PreparedStatement>
@@ -295,7 +379,8 @@ base::StatusOr<PerfettoSqlEngine::ExecutionStats> PerfettoSqlEngine::Execute(
 }
 
 base::StatusOr<PerfettoSqlEngine::ExecutionResult>
-PerfettoSqlEngine::ExecuteUntilLastStatement(SqlSource sql_source) {
+PerfettoSqlEngine::ExecuteUntilLastStatement(SqlSource sql_source,
+                                             bool use_query_cache) {
   // A SQL string can contain several statements. Some of them might be comment
   // only, e.g. "SELECT 1; /* comment */; SELECT 2;". Some statements can also
   // be PerfettoSQL statements which we need to transpile before execution or
@@ -314,11 +399,19 @@ PerfettoSqlEngine::ExecuteUntilLastStatement(SqlSource sql_source) {
   //    take hold *before* we step into the next statement.
   //  - Once no further statements are encountered, we return the prepared
   //    statement for the last valid statement.
+  //
+  // If the query cache is used, read-only statements are additionally
+  // replaced by a statement reading their cached result (see
+  // |ApplyQueryCache|) and every other statement invalidates the cache.
+  use_query_cache = use_query_cache && query_cache_size_bytes_ > 0;
+
   std::optional<SqliteEngine::PreparedStatement> res;
   ExecutionStats stats;
   PerfettoSqlParser parser(std::move(sql_source), macros_);
   while (parser.Next()) {
     std::optional<SqlSource> source;
+    bool is_sqlite_sql = false;
+    bool is_pushed_down_aggregation = false;
     if (auto* cf = std::get_if<PerfettoSqlParser::CreateFunction>(
             &parser.statement())) {
       RETURN_IF_ERROR(AddTracebackIfNeeded(ExecuteCreateFunction(*cf),
@@ -326,13 +419,18 @@ PerfettoSqlEngine::ExecuteUntilLastStatement(SqlSource sql_source) {
       source = RewriteToDummySql(parser.statement_sql());
     } else if (auto* cst = std::get_if<PerfettoSqlParser::CreateTable>(
                    &parser.statement())) {
-      RETURN_IF_ERROR(AddTracebackIfNeeded(ExecuteCreateTable(*cst),
-                                           parser.statement_sql()));
+      RETURN_IF_ERROR(AddTracebackIfNeeded(
+          lazy_module_tables_ && include_depth_ > 0 ? AddLazyTable(*cst)
+                                                    : ExecuteCreateTable(*cst),
+          parser.statement_sql()));
       source = RewriteToDummySql(parser.statement_sql());
     } else if (auto* create_view = std::get_if<PerfettoSqlParser::CreateView>(
                    &parser.statement())) {
-      RETURN_IF_ERROR(AddTracebackIfNeeded(ExecuteCreateView(*create_view),
-                                           parser.statement_sql()));
+      RETURN_IF_ERROR(AddTracebackIfNeeded(
+          lazy_module_tables_ && include_depth_ > 0
+              ? AddLazyTable(*create_view)
+              : ExecuteCreateView(*create_view),
+          parser.statement_sql()));
       source = RewriteToDummySql(parser.statement_sql());
     } else if (auto* include = std::get_if<PerfettoSqlParser::Include>(
                    &parser.statement())) {
@@ -358,13 +456,41 @@ PerfettoSqlEngine::ExecuteUntilLastStatement(SqlSource sql_source) {
           std::get_if<PerfettoSqlParser::SqliteSql>(&parser.statement());
       PERFETTO_CHECK(sql);
       source = parser.statement_sql();
+      is_sqlite_sql = true;
+
+      // Simple aggregations over a single table are computed directly on the
+      // table and replaced by a statement returning the result.
+      PERFETTO_TP_TRACE(metatrace::Category::QUERY_TIMELINE,
+                        "AGGREGATE_PUSHDOWN");
+      std::optional<std::string> pushed_down = PushDownAggregation(
+          *source,
+          [this](std::string_view name) { return GetTableOrNull(name); },
+          query_thread_pool_);
+      if (pushed_down) {
+        source = source->RewriteAllIgnoreExisting(
+            SqlSource::FromTraceProcessorImplementation(
+                std::move(*pushed_down)));
+        is_pushed_down_aggregation = true;
+      }
+    }
+
+    // Any PerfettoSQL statement can change the result of other statements
+    // (includes only do so through the statements of the included modules).
+    if (!is_sqlite_sql &&
+        !std::holds_alternative<PerfettoSqlParser::Include>(
+            parser.statement())) {
+      InvalidateQueryCache();
     }
 
     // Try to get SQLite to prepare the statement.
     std::optional<SqliteEngine::PreparedStatement> cur_stmt;
+    bool cacheable =
+        use_query_cache && is_sqlite_sql && !is_pushed_down_aggregation;
     {
       PERFETTO_TP_TRACE(metatrace::Category::QUERY_TIMELINE, "QUERY_PREPARE");
-      auto stmt = engine_->PrepareStatement(std::move(*source));
+      query_cache_stmt_cacheable_ = cacheable ? &cacheable : nullptr;
+      auto stmt = engine_->PrepareStatement(*source);
+      query_cache_stmt_cacheable_ = nullptr;
       RETURN_IF_ERROR(stmt.status());
       cur_stmt = std::move(stmt);
     }
@@ -389,6 +515,12 @@ PerfettoSqlEngine::ExecuteUntilLastStatement(SqlSource sql_source) {
       RETURN_IF_ERROR(res->status());
     }
 
+    if (is_sqlite_sql && !sqlite3_stmt_readonly(cur_stmt->sqlite_stmt())) {
+      InvalidateQueryCache();
+    } else if (cacheable && sqlite3_column_count(cur_stmt->sqlite_stmt()) > 0) {
+      RETURN_IF_ERROR(ApplyQueryCache(*source, *cur_stmt, &stats));
+    }
+
     // Propogate the current statement to the next iteration.
     res = std::move(cur_stmt);
 
@@ -420,6 +552,204 @@ PerfettoSqlEngine::ExecuteUntilLastStatement(SqlSource sql_source) {
   return ExecutionResult{std::move(*res), stats};
 }
 
+void PerfettoSqlEngine::InvalidateQueryCache() {
+  if (!query_cache_context_) {
+    return;
+  }
+  // Statements still reading a result keep it alive until they are done.
+  query_cache_context_->results.Clear();
+  query_cache_.Clear();
+  query_cache_lru_.clear();
+  query_cache_used_bytes_ = 0;
+}
+
+int PerfettoSqlEngine::QueryCacheAuthorizer(void* ctx,
+                                            int action,
+                                            const char* arg1,
+                                            const char* arg2,
+                                            const char*,
+                                            const char*) {
+  auto* engine = static_cast<PerfettoSqlEngine*>(ctx);
+  if (!engine->query_cache_stmt_cacheable_) {
+    return SQLITE_OK;
+  }
+  bool not_cacheable = false;
+  if (action == SQLITE_READ && arg1) {
+    not_cacheable = IsNameInList(arg1, kTablesNotCacheable.begin(),
+                                 kTablesNotCacheable.end());
+  } else if (action == SQLITE_FUNCTION && arg2) {
+    not_cacheable = IsNameInList(arg2, kFunctionsNotCacheable.begin(),
+                                 kFunctionsNotCacheable.end()) ||
+                    engine->engine_->IsNonDeterministicFunction(arg2);
+  }
+  if (not_cacheable) {
+    *engine->query_cache_stmt_cacheable_ = false;
+  }
+  return SQLITE_OK;
+}
+
+base::Status PerfettoSqlEngine::ApplyQueryCache(
+    const SqlSource& source,
+    SqliteEngine::PreparedStatement& stmt,
+    ExecutionStats* stats) {
+  PERFETTO_TP_TRACE(metatrace::Category::QUERY_TIMELINE, "QUERY_CACHE");
+
+  std::string key = NormalizeSqlForQueryCache(source);
+  if (QueryCacheEntry* entry = query_cache_.Find(key)) {
+    query_cache_lru_.splice(query_cache_lru_.begin(), query_cache_lru_,
+                            entry->lru_it);
+    if (!entry->result_id) {
+      // We already know that the result of this statement cannot be cached:
+      // just execute it normally.
+      stats->query_cache_misses++;
+      return base::OkStatus();
+    }
+    stats->query_cache_hits++;
+    stmt = engine_->PrepareStatement(source.RewriteAllIgnoreExisting(
+        SqlSource::FromTraceProcessorImplementation(entry->select_sql)));
+    return stmt.status();
+  }
+
+  stats->query_cache_misses++;
+  uint32_t result_id = query_cache_next_result_id_++;
+  std::string select_sql = QueryCacheSelectSql(stmt.sqlite_stmt(), result_id);
+  base::StatusOr<std::shared_ptr<QueryCacheModule::Result>> materialized =
+      MaterializeQueryCacheResult(stmt);
+  if (!materialized.ok()) {
+    // Prepare the statement again so it is executed normally: this makes the
+    // error be reported exactly as without the cache.
+    InsertQueryCacheEntry(std::move(key), QueryCacheEntry{});
+    stmt = engine_->PrepareStatement(source);
+    return stmt.status();
+  }
+  std::shared_ptr<QueryCacheModule::Result> result = std::move(*materialized);
+  if (!result) {
+    InsertQueryCacheEntry(std::move(key), QueryCacheEntry{});
+    return base::OkStatus();
+  }
+
+  QueryCacheEntry new_entry;
+  bool cacheable = !result->remaining;
+  if (cacheable) {
+    new_entry.result_id = result_id;
+    new_entry.select_sql = select_sql;
+    new_entry.size_bytes = result->size_bytes;
+  }
+  bool inserted = InsertQueryCacheEntry(std::move(key), std::move(new_entry));
+
+  // Even if the result is not cached, the rows were already (at least
+  // partially) stepped: read them once rather than executing the statement
+  // again.
+  result->read_once = !cacheable || !inserted;
+  bool read_once = result->read_once;
+  query_cache_context_->results.Insert(result_id, std::move(result));
+  stmt = engine_->PrepareStatement(source.RewriteAllIgnoreExisting(
+      SqlSource::FromTraceProcessorImplementation(std::move(select_sql))));
+  if (!stmt.status().ok() && read_once) {
+    query_cache_context_->results.Erase(result_id);
+  }
+  return stmt.status();
+}
+
+base::StatusOr<std::shared_ptr<QueryCacheModule::Result>>
+PerfettoSqlEngine::MaterializeQueryCacheResult(
+    SqliteEngine::PreparedStatement& stmt) {
+  sqlite3_stmt* sqlite_stmt = stmt.sqlite_stmt();
+  auto column_count = static_cast<uint32_t>(sqlite3_column_count(sqlite_stmt));
+  if (column_count > QueryCacheModule::kMaxColumnCount) {
+    return std::shared_ptr<QueryCacheModule::Result>();
+  }
+
+  auto result = std::make_shared<QueryCacheModule::Result>();
+  result->column_count = column_count;
+  // Copies |size| bytes of |data| into a buffer owned by |result|.
+  auto copy = [&result](const void* data, size_t size) {
+    result->size_bytes += size;
+    result->buffers.emplace_back(new char[size]);
+    memcpy(result->buffers.back().get(), data, size);
+    return result->buffers.back().get();
+  };
+  int res;
+  for (res = sqlite3_step(sqlite_stmt); res == SQLITE_ROW;
+       res = sqlite3_step(sqlite_stmt)) {
+    result->size_bytes += column_count * sizeof(SqlValue);
+    for (uint32_t i = 0; i < column_count; ++i) {
+      int int_i = static_cast<int>(i);
+      switch (sqlite3_column_type(sqlite_stmt, int_i)) {
+        case SQLITE_NULL:
+          result->values.push_back(SqlValue());
+          break;
+        case SQLITE_INTEGER:
+          result->values.push_back(
+              SqlValue::Long(sqlite3_column_int64(sqlite_stmt, int_i)));
+          break;
+        case SQLITE_FLOAT:
+          result->values.push_back(
+              SqlValue::Double(sqlite3_column_double(sqlite_stmt, int_i)));
+          break;
+        case SQLITE_TEXT: {
+          const auto* text = sqlite3_column_text(sqlite_stmt, int_i);
+          auto size =
+              static_cast<size_t>(sqlite3_column_bytes(sqlite_stmt, int_i));
+          result->values.push_back(SqlValue::String(copy(text, size + 1)));
+          break;
+        }
+        case SQLITE_BLOB: {
+          const void* blob = sqlite3_column_blob(sqlite_stmt, int_i);
+          auto size =
+              static_cast<size_t>(sqlite3_column_bytes(sqlite_stmt, int_i));
+          result->values.push_back(
+              SqlValue::Bytes(size ? copy(blob, size) : nullptr, size));
+          break;
+        }
+      }
+    }
+    result->row_count++;
+    if (result->size_bytes > query_cache_size_bytes_) {
+      // The result cannot be cached: rather than copying the rest of the
+      // rows, keep the statement so they can be stepped while being read.
+      result->remaining = std::make_unique<SqliteEngine::PreparedStatement>(
+          std::move(stmt));
+      return std::move(result);
+    }
+  }
+  if (res != SQLITE_DONE) {
+    return base::ErrStatus("%s", sqlite3_errmsg(engine_->db()));
+  }
+  return std::move(result);
+}
+
+bool PerfettoSqlEngine::InsertQueryCacheEntry(std::string key,
+                                              QueryCacheEntry entry) {
+  // The key is stored both in |query_cache_| and in |query_cache_lru_|.
+  // Accounting for it means entries of statements which cannot be cached are
+  // also bounded by the budget.
+  entry.size_bytes += 2 * key.size() + sizeof(QueryCacheEntry);
+  if (entry.size_bytes > query_cache_size_bytes_) {
+    return false;
+  }
+  EvictQueryCacheEntries(entry.size_bytes);
+  query_cache_used_bytes_ += entry.size_bytes;
+  query_cache_lru_.push_front(key);
+  entry.lru_it = query_cache_lru_.begin();
+  query_cache_.Insert(std::move(key), std::move(entry));
+  return true;
+}
+
+void PerfettoSqlEngine::EvictQueryCacheEntries(uint64_t bytes) {
+  while (query_cache_used_bytes_ + bytes > query_cache_size_bytes_) {
+    PERFETTO_DCHECK(!query_cache_lru_.empty());
+    const std::string& key = query_cache_lru_.back();
+    const QueryCacheEntry* entry = query_cache_.Find(key);
+    query_cache_used_bytes_ -= entry->size_bytes;
+    if (entry->result_id) {
+      query_cache_context_->results.Erase(*entry->result_id);
+    }
+    query_cache_.Erase(key);
+    query_cache_lru_.pop_back();
+  }
+}
+
 base::Status PerfettoSqlEngine::RegisterRuntimeFunction(
     bool replace,
     const FunctionPrototype& prototype,
@@ -568,6 +898,14 @@ base::Status PerfettoSqlEngine::ExecuteCreateTable(
                       record->AddArg("table_name", create_table.name);
                     });
 
+  // A table with the same name created lazily by a module has to exist for
+  // the statement to behave the same as without lazy tables.
+  if (create_table.replace) {
+    lazy_tables_.Erase(base::ToLower(create_table.name));
+  } else {
+    RETURN_IF_ERROR(CreateLazyTable(create_table.name).status());
+  }
+
   auto stmt_or = engine_->PrepareStatement(create_table.sql);
   RETURN_IF_ERROR(stmt_or.status());
   SqliteEngine::PreparedStatement stmt = std::move(stmt_or);
@@ -636,6 +974,12 @@ base::Status PerfettoSqlEngine::ExecuteCreateView(
                       record->AddArg("view_name", create_view.name);
                     });
 
+  if (create_view.replace) {
+    lazy_tables_.Erase(base::ToLower(create_view.name));
+  } else {
+    RETURN_IF_ERROR(CreateLazyTable(create_view.name).status());
+  }
+
   // Verify that the underlying SQL statement is valid.
   auto stmt = sqlite_engine()->PrepareStatement(create_view.select_sql);
   RETURN_IF_ERROR(stmt.status());
@@ -721,6 +1065,7 @@ base::Status PerfettoSqlEngine::ExecuteCreateIndex(
                       record->AddArg("cols", base::Join(index.col_names, ", "));
                     });
 
+  RETURN_IF_ERROR(CreateLazyTable(index.table_name).status());
   Table* t = GetMutableTableOrNull(index.table_name);
   if (!t) {
     return base::ErrStatus("CREATE PERFETTO INDEX: Table '%s' not found",
@@ -732,7 +1077,7 @@ base::Status PerfettoSqlEngine::ExecuteCreateIndex(
     if (!opt_col) {
       return base::ErrStatus(
           "CREATE PERFETTO INDEX: Column '%s' not found in table '%s'",
-          index.col_names.front().c_str(), index.table_name.c_str());
+          col_name.c_str(), index.table_name.c_str());
     }
     col_idxs.push_back(*opt_col);
   }
@@ -749,6 +1094,7 @@ base::Status PerfettoSqlEngine::ExecuteDropIndex(
                       record->AddArg("table_name", index.table_name);
                     });
 
+  RETURN_IF_ERROR(CreateLazyTable(index.table_name).status());
   Table* t = GetMutableTableOrNull(index.table_name);
   if (!t) {
     return base::ErrStatus("DROP PERFETTO INDEX: Table '%s' not found",
@@ -793,7 +1139,9 @@ base::Status PerfettoSqlEngine::IncludeModuleImpl(
     return base::OkStatus();
   }
 
+  include_depth_++;
   auto it = Execute(SqlSource::FromModuleInclude(file.sql, key));
+  include_depth_--;
   if (!it.status().ok()) {
     return base::ErrStatus("%s%s",
                            parser.statement_sql().AsTraceback(0).c_str(),
@@ -805,6 +1153,50 @@ base::Status PerfettoSqlEngine::IncludeModuleImpl(
   return base::OkStatus();
 }
 
+base::Status PerfettoSqlEngine::AddLazyTable(const LazyTable& lazy_table) {
+  const auto* table = std::get_if<PerfettoSqlParser::CreateTable>(&lazy_table);
+  const auto* view = std::get_if<PerfettoSqlParser::CreateView>(&lazy_table);
+  const std::string& name = table ? table->name : view->name;
+  bool replace = table ? table->replace : view->replace;
+  auto [it, inserted] = lazy_tables_.Insert(base::ToLower(name), lazy_table);
+  if (!inserted) {
+    if (!replace) {
+      return base::ErrStatus("Table '%s' already exists", name.c_str());
+    }
+    *it = lazy_table;
+  }
+  return base::OkStatus();
+}
+
+base::StatusOr<bool> PerfettoSqlEngine::CreateLazyTable(
+    const std::string& name) {
+  std::string key = base::ToLower(name);
+  LazyTable* lazy_table = lazy_tables_.Find(key);
+  if (!lazy_table) {
+    return false;
+  }
+  LazyTable create = std::move(*lazy_table);
+  lazy_tables_.Erase(key);
+
+  // The statement being prepared when the table is created changes the
+  // tables so its result cannot be cached. The statements creating the table
+  // should not be checked for caching either.
+  bool* cacheable = query_cache_stmt_cacheable_;
+  if (cacheable) {
+    *cacheable = false;
+  }
+  query_cache_stmt_cacheable_ = nullptr;
+  base::Status status;
+  if (auto* table = std::get_if<PerfettoSqlParser::CreateTable>(&create)) {
+    status = ExecuteCreateTable(*table);
+  } else {
+    status = ExecuteCreateView(std::get<PerfettoSqlParser::CreateView>(create));
+  }
+  query_cache_stmt_cacheable_ = cacheable;
+  RETURN_IF_ERROR(status);
+  return true;
+}
+
 base::Status PerfettoSqlEngine::ExecuteCreateFunction(
     const PerfettoSqlParser::CreateFunction& cf) {
   PERFETTO_TP_TRACE(metatrace::Category::QUERY_TIMELINE,
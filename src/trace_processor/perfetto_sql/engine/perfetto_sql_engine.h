@@ -19,10 +19,13 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <list>
 #include <memory>
+#include <optional>
 #include <string>
 #include <string_view>
 #include <utility>
+#include <variant>
 #include <vector>
 
 #include "perfetto/base/logging.h"
@@ -33,6 +36,7 @@
 #include "src/trace_processor/containers/string_pool.h"
 #include "src/trace_processor/db/runtime_table.h"
 #include "src/trace_processor/db/table.h"
+#include "src/trace_processor/perfetto_sql/engine/query_cache_module.h"
 #include "src/trace_processor/perfetto_sql/engine/runtime_table_function.h"
 #include "src/trace_processor/perfetto_sql/intrinsics/functions/sql_function.h"
 #include "src/trace_processor/perfetto_sql/intrinsics/table_functions/static_table_function.h"
@@ -59,13 +63,36 @@ class PerfettoSqlEngine {
     uint32_t column_count = 0;
     uint32_t statement_count = 0;
     uint32_t statement_count_with_output = 0;
+
+    // The number of read-only statements which were served from (hits) or
+    // added to (misses) the query cache. Always zero if the query cache is not
+    // used.
+    uint32_t query_cache_hits = 0;
+    uint32_t query_cache_misses = 0;
   };
   struct ExecutionResult {
     SqliteEngine::PreparedStatement stmt;
     ExecutionStats stats;
   };
 
-  PerfettoSqlEngine(StringPool* pool, bool enable_extra_checks);
+  // If |query_thread_pool| is not null, it is used to parallelize filtering
+  // of tables with many rows.
+  //
+  // If |query_cache_size_bytes| is not zero, the results of read-only
+  // statements executed with |use_query_cache| set (see
+  // |ExecuteUntilLastStatement|) are materialized and reused by later
+  // executions of the same statement until anything which could change their
+  // result happens. The cache evicts the least recently used results to keep
+  // the estimated size of all results below |query_cache_size_bytes|.
+  //
+  // If |lazy_module_tables| is true, the tables and views created by included
+  // modules are only created when a statement first references them (see
+  // |lazy_tables_|).
+  PerfettoSqlEngine(StringPool* pool,
+                    bool enable_extra_checks,
+                    base::ThreadPool* query_thread_pool = nullptr,
+                    uint64_t query_cache_size_bytes = 0,
+                    bool lazy_module_tables = false);
 
   // Executes all the statements in |sql| and returns a |ExecutionResult|
   // object. The metadata will reference all the statements executed and the
@@ -80,9 +107,19 @@ class PerfettoSqlEngine {
   // statement (which has been stepped once) and metadata about all statements
   // executed.
   //
+  // If |use_query_cache| is true and the query cache is enabled, read-only
+  // statements are answered from the query cache if possible.
+  //
   // Returns an error if the execution of any statement failed or if there was
   // no valid SQL to run.
-  base::StatusOr<ExecutionResult> ExecuteUntilLastStatement(SqlSource sql);
+  base::StatusOr<ExecutionResult> ExecuteUntilLastStatement(
+      SqlSource sql,
+      bool use_query_cache = false);
+
+  // Drops all the results in the query cache. Must be called whenever the
+  // contents of any table changes without going through this class (e.g. when
+  // the trace is parsed).
+  void InvalidateQueryCache();
 
   // Prepares a single SQLite statement in |sql| and returns a
   // |PreparedStatement| object.
@@ -229,6 +266,12 @@ class PerfettoSqlEngine {
            runtime_function_count_ + macros_.size();
   }
 
+  // Creates the table or view |name| if it was defined by an included module
+  // but not created yet (see |lazy_module_tables|). Returns whether the table
+  // was created. Statements do this automatically: this only needs to be
+  // called before accessing a table in other ways (e.g. GetTableOrNull).
+  base::StatusOr<bool> CreateLazyTable(const std::string& name);
+
   // Find table (Static or Runtime) registered with engine with provided name.
   const Table* GetTableOrNull(std::string_view name) const {
     if (auto maybe_runtime = GetRuntimeTableOrNull(name); maybe_runtime) {
@@ -259,6 +302,60 @@ class PerfettoSqlEngine {
   Table* GetMutableStaticTableOrNull(std::string_view);
 
  private:
+  // A single result in the query cache. See |ExecuteUntilLastStatement|.
+  struct QueryCacheEntry {
+    // The id of the result in |query_cache_context_|. Unset if the statement
+    // could not be cached (e.g. because its result is too large): the entry
+    // then avoids trying to cache the statement again.
+    std::optional<uint32_t> result_id;
+
+    // The SQL which reads the result from |query_cache_context_| with the
+    // column names of the original statement.
+    std::string select_sql;
+
+    // Estimate of the memory used by the entry, including its key.
+    uint64_t size_bytes = 0;
+
+    // Position of the entry in |query_cache_lru_|.
+    std::list<std::string>::iterator lru_it;
+  };
+
+  // A CREATE PERFETTO TABLE/VIEW statement whose execution was deferred.
+  using LazyTable = std::variant<PerfettoSqlParser::CreateTable,
+                                 PerfettoSqlParser::CreateView>;
+
+  // SQLite authorizer callback used to find out whether the statement being
+  // prepared reads a table or calls a function which makes it unsuitable for
+  // caching. See |query_cache_stmt_cacheable_|.
+  static int QueryCacheAuthorizer(void*,
+                                  int,
+                                  const char*,
+                                  const char*,
+                                  const char*,
+                                  const char*);
+
+  // Replaces |stmt| with a statement reading the cached result of |source| if
+  // there is one. Otherwise, executes |stmt|, stores its result in the cache
+  // and does the same.
+  base::Status ApplyQueryCache(const SqlSource& source,
+                               SqliteEngine::PreparedStatement& stmt,
+                               ExecutionStats* stats);
+
+  // Executes |stmt| and copies the rows it returns. Stops once the rows take
+  // more memory than the budget of the cache: |stmt| is then moved into the
+  // result so its remaining rows can be read from it. Returns nullptr if the
+  // result cannot be copied at all, in which case |stmt| is not stepped.
+  base::StatusOr<std::shared_ptr<QueryCacheModule::Result>>
+  MaterializeQueryCacheResult(SqliteEngine::PreparedStatement& stmt);
+
+  // Adds |entry| to the cache, evicting the least recently used entries if
+  // needed. Returns false if the entry is larger than the whole cache.
+  bool InsertQueryCacheEntry(std::string key, QueryCacheEntry entry);
+
+  // Evicts the least recently used entries until |bytes| can be added to
+  // the cache without going over budget.
+  void EvictQueryCacheEntries(uint64_t bytes);
+
   base::Status ExecuteCreateFunction(const PerfettoSqlParser::CreateFunction&);
 
   base::Status ExecuteInclude(const PerfettoSqlParser::Include&,
@@ -274,6 +371,10 @@ class PerfettoSqlEngine {
 
   base::Status ExecuteCreateIndex(const PerfettoSqlParser::CreateIndex&);
 
+  // Records a CREATE PERFETTO TABLE/VIEW statement of an included module in
+  // |lazy_tables_| instead of executing it.
+  base::Status AddLazyTable(const LazyTable&);
+
   base::Status ExecuteDropIndex(const PerfettoSqlParser::DropIndex&);
 
   enum class CreateTableType {
@@ -343,8 +444,35 @@ class PerfettoSqlEngine {
   DbSqliteModule::Context* runtime_table_context_ = nullptr;
   DbSqliteModule::Context* static_table_context_ = nullptr;
   DbSqliteModule::Context* static_table_fn_context_ = nullptr;
+  QueryCacheModule::Context* query_cache_context_ = nullptr;
   base::FlatHashMap<std::string, sql_modules::RegisteredPackage> packages_;
   base::FlatHashMap<std::string, PerfettoSqlPreprocessor::Macro> macros_;
+
+  base::ThreadPool* const query_thread_pool_;
+
+  // With |lazy_module_tables_|, the CREATE PERFETTO TABLE/VIEW statements of
+  // included modules are not executed but stored here, keyed by the lowercase
+  // name of the table. The statement creating a table is executed when a
+  // statement being prepared fails because the table is missing: tables which
+  // are never used are never computed. Note that tables referenced by views
+  // and functions are created at the same time as them.
+  const bool lazy_module_tables_;
+  base::FlatHashMap<std::string, LazyTable> lazy_tables_;
+  // Number of modules currently being included.
+  uint32_t include_depth_ = 0;
+
+  // State of the query cache: keyed by the normalized SQL of the statement.
+  const uint64_t query_cache_size_bytes_;
+  base::FlatHashMap<std::string, QueryCacheEntry> query_cache_;
+  // Keys of |query_cache_|, most recently used first.
+  std::list<std::string> query_cache_lru_;
+  uint64_t query_cache_used_bytes_ = 0;
+  uint32_t query_cache_next_result_id_ = 0;
+
+  // Set while preparing a statement which might be cached: cleared by
+  // |QueryCacheAuthorizer| if the statement should not be cached.
+  bool* query_cache_stmt_cacheable_ = nullptr;
+
   std::unique_ptr<SqliteEngine> engine_;
 };
 
@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Measures the time from the creation of a trace processor instance to the
+// result of the first query, after including many standard library modules,
+// with and without Config::lazy_module_tables.
+
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <string>
+
+#include <benchmark/benchmark.h>
+
+#include "perfetto/base/logging.h"
+#include "perfetto/trace_processor/basic_types.h"
+#include "perfetto/trace_processor/trace_processor.h"
+
+namespace perfetto::trace_processor {
+namespace {
+
+bool IsBenchmarkFunctionalOnly() {
+  return getenv("BENCHMARK_FUNCTIONAL_TEST_ONLY") != nullptr;
+}
+
+void RunQueryChecked(TraceProcessor* tp, const std::string& query) {
+  auto it = tp->ExecuteQuery(query);
+  while (it.Next()) {
+  }
+  PERFETTO_CHECK(it.Status().ok());
+}
+
+void BM_IncludeAndFirstQuery(benchmark::State& state) {
+  // Including all the modules takes a long time: only include a package when
+  // running as a functional test.
+  std::string include = IsBenchmarkFunctionalOnly()
+                            ? "INCLUDE PERFETTO MODULE sched.*;"
+                            : "INCLUDE PERFETTO MODULE *;";
+  Config config;
+  config.lazy_module_tables = state.range(0) != 0;
+  for (auto _ : state) {
+    auto tp = TraceProcessor::CreateInstance(config);
+    PERFETTO_CHECK(tp->NotifyEndOfFile().ok());
+    RunQueryChecked(tp.get(), include);
+    RunQueryChecked(tp.get(),
+                    "SELECT COUNT(*) FROM sched_time_in_state_for_thread");
+  }
+}
+BENCHMARK(BM_IncludeAndFirstQuery)
+    ->ArgName("lazy")
+    ->Arg(0)
+    ->Arg(1)
+    ->Unit(benchmark::kMillisecond);
+
+}  // namespace
+}  // namespace perfetto::trace_processor
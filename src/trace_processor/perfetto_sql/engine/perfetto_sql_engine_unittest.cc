@@ -16,7 +16,15 @@
 
 #include "src/trace_processor/perfetto_sql/engine/perfetto_sql_engine.h"
 
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "perfetto/base/logging.h"
+#include "src/trace_processor/sqlite/bindings/sqlite_function.h"
+#include "src/trace_processor/sqlite/bindings/sqlite_result.h"
 #include "src/trace_processor/sqlite/sql_source.h"
+#include "src/trace_processor/tables/counter_tables_py.h"
 #include "src/trace_processor/tables/slice_tables_py.h"
 #include "test/gtest_and_gmock.h"
 
@@ -317,6 +325,83 @@ TEST_F(PerfettoSqlEngineTest, Include_Module) {
   ASSERT_FALSE(engine_.FindPackage("bar")->modules["bar.bar"].included);
 }
 
+class PerfettoSqlEngineLazyTablesTest : public ::testing::Test {
+ protected:
+  PerfettoSqlEngineLazyTablesTest() {
+    engine_.RegisterPackage(
+        "foo",
+        CreateTestPackage({
+            {"foo.base", "CREATE PERFETTO TABLE foo_base AS SELECT 42 AS x"},
+            {"foo.derived",
+             "INCLUDE PERFETTO MODULE foo.base; "
+             "CREATE PERFETTO TABLE foo_derived AS SELECT x + 1 AS x "
+             "FROM foo_base; "
+             "CREATE PERFETTO VIEW foo_view AS SELECT x FROM foo_derived"},
+            {"foo.broken",
+             "CREATE PERFETTO TABLE foo_broken AS SELECT * FROM missing"},
+        }));
+  }
+
+  // Returns the value of the single row and column returned by |sql|.
+  int64_t QueryValue(const std::string& sql) {
+    auto res =
+        engine_.ExecuteUntilLastStatement(SqlSource::FromExecuteQuery(sql));
+    EXPECT_TRUE(res.ok()) << res.status().c_message();
+    if (!res.ok() || res->stmt.IsDone()) {
+      return -1;
+    }
+    return sqlite3_column_int64(res->stmt.sqlite_stmt(), 0);
+  }
+
+  StringPool pool_;
+  PerfettoSqlEngine engine_{&pool_, true, nullptr, 0,
+                            /*lazy_module_tables=*/true};
+};
+
+TEST_F(PerfettoSqlEngineLazyTablesTest, CreatedOnFirstUse) {
+  auto res = engine_.Execute(
+      SqlSource::FromExecuteQuery("INCLUDE PERFETTO MODULE foo.*"));
+  ASSERT_TRUE(res.ok()) << res.status().c_message();
+  ASSERT_EQ(engine_.GetRuntimeTableOrNull("foo_base"), nullptr);
+  ASSERT_EQ(engine_.GetRuntimeTableOrNull("foo_derived"), nullptr);
+
+  // Querying the view creates it and the tables it depends on.
+  ASSERT_EQ(QueryValue("SELECT x FROM foo_view"), 43);
+  ASSERT_NE(engine_.GetRuntimeTableOrNull("foo_base"), nullptr);
+  ASSERT_NE(engine_.GetRuntimeTableOrNull("foo_derived"), nullptr);
+  ASSERT_EQ(QueryValue("SELECT x FROM FOO_BASE"), 42);
+}
+
+TEST_F(PerfettoSqlEngineLazyTablesTest, ErrorsOnFirstUse) {
+  auto res = engine_.Execute(
+      SqlSource::FromExecuteQuery("INCLUDE PERFETTO MODULE foo.broken"));
+  ASSERT_TRUE(res.ok()) << res.status().c_message();
+
+  res =
+      engine_.Execute(SqlSource::FromExecuteQuery("SELECT * FROM foo_broken"));
+  ASSERT_FALSE(res.ok());
+  ASSERT_THAT(res.status().message(), testing::HasSubstr("missing"));
+}
+
+TEST_F(PerfettoSqlEngineLazyTablesTest, IndexAndReplace) {
+  auto res = engine_.Execute(SqlSource::FromExecuteQuery(
+      "INCLUDE PERFETTO MODULE foo.base; "
+      "CREATE PERFETTO INDEX foo_idx ON foo_base(x)"));
+  ASSERT_TRUE(res.ok()) << res.status().c_message();
+  ASSERT_NE(engine_.GetRuntimeTableOrNull("foo_base"), nullptr);
+
+  // Creating a table with the name of a lazy table behaves as if the lazy
+  // table had been created.
+  res = engine_.Execute(SqlSource::FromExecuteQuery(
+      "INCLUDE PERFETTO MODULE foo.derived; "
+      "CREATE PERFETTO TABLE foo_derived AS SELECT 1 AS x"));
+  ASSERT_FALSE(res.ok());
+  res = engine_.Execute(SqlSource::FromExecuteQuery(
+      "CREATE OR REPLACE PERFETTO TABLE foo_derived AS SELECT 1 AS x"));
+  ASSERT_TRUE(res.ok()) << res.status().c_message();
+  ASSERT_EQ(QueryValue("SELECT x FROM foo_derived"), 1);
+}
+
 TEST_F(PerfettoSqlEngineTest, MismatchedRange) {
   tables::SliceTable parent(&pool_);
   tables::ExpectedFrameTimelineSliceTable child(&pool_, &parent);
@@ -340,6 +425,414 @@ TEST_F(PerfettoSqlEngineTest, MismatchedRange) {
   ASSERT_TRUE(res.ok()) << res.status().c_message();
 }
 
+class PerfettoSqlEngineQueryCacheTest : public ::testing::Test {
+ protected:
+  // Executes |sql| using the query cache and returns the values of the first
+  // column.
+  std::vector<int64_t> Query(const std::string& sql,
+                             PerfettoSqlEngine::ExecutionStats* stats) {
+    auto res = engine_.ExecuteUntilLastStatement(
+        SqlSource::FromExecuteQuery(sql), /*use_query_cache=*/true);
+    EXPECT_TRUE(res.ok()) << res.status().c_message();
+    std::vector<int64_t> values;
+    if (!res.ok()) {
+      return values;
+    }
+    *stats = res->stats;
+    for (bool row = !res->stmt.IsDone(); row; row = res->stmt.Step()) {
+      values.push_back(sqlite3_column_int64(res->stmt.sqlite_stmt(), 0));
+    }
+    EXPECT_TRUE(res->stmt.status().ok());
+    return values;
+  }
+
+  StringPool pool_;
+  PerfettoSqlEngine engine_{&pool_, true, nullptr, 1024 * 1024};
+};
+
+TEST_F(PerfettoSqlEngineQueryCacheTest, HitForSameQuery) {
+  ASSERT_TRUE(engine_
+                  .Execute(SqlSource::FromExecuteQuery(
+                      "CREATE TABLE t(x INT); INSERT INTO t VALUES (2), (1)"))
+                  .ok());
+  uint64_t object_count = engine_.SqliteRegisteredObjectCount();
+
+  PerfettoSqlEngine::ExecutionStats stats;
+  ASSERT_THAT(Query("SELECT x FROM t ORDER BY x", &stats),
+              testing::ElementsAre(1, 2));
+  ASSERT_EQ(stats.query_cache_hits, 0u);
+  ASSERT_EQ(stats.query_cache_misses, 1u);
+
+  // Formatting and comments should not matter.
+  auto res = engine_.ExecuteUntilLastStatement(
+      SqlSource::FromExecuteQuery("SELECT x\n  FROM t -- foo\n ORDER BY x"),
+      /*use_query_cache=*/true);
+  ASSERT_TRUE(res.ok()) << res.status().c_message();
+  ASSERT_EQ(res->stats.query_cache_hits, 1u);
+  ASSERT_EQ(res->stats.query_cache_misses, 0u);
+  ASSERT_STREQ(sqlite3_column_name(res->stmt.sqlite_stmt(), 0), "x");
+  ASSERT_EQ(sqlite3_column_int64(res->stmt.sqlite_stmt(), 0), 1);
+  ASSERT_TRUE(res->stmt.Step());
+  ASSERT_EQ(sqlite3_column_int64(res->stmt.sqlite_stmt(), 0), 2);
+  ASSERT_FALSE(res->stmt.Step());
+
+  // The tables backing the cache should not be visible.
+  ASSERT_EQ(engine_.SqliteRegisteredObjectCount(), object_count);
+}
+
+TEST_F(PerfettoSqlEngineQueryCacheTest, InvalidatedByWrites) {
+  ASSERT_TRUE(engine_
+                  .Execute(SqlSource::FromExecuteQuery(
+                      "CREATE TABLE t(x INT); INSERT INTO t VALUES (1)"))
+                  .ok());
+  PerfettoSqlEngine::ExecutionStats stats;
+  ASSERT_THAT(Query("SELECT x FROM t", &stats), testing::ElementsAre(1));
+
+  ASSERT_TRUE(
+      engine_.Execute(SqlSource::FromExecuteQuery("INSERT INTO t VALUES (2)"))
+          .ok());
+  ASSERT_THAT(Query("SELECT x FROM t", &stats), testing::ElementsAre(1, 2));
+  ASSERT_EQ(stats.query_cache_misses, 1u);
+
+  ASSERT_TRUE(engine_
+                  .Execute(SqlSource::FromExecuteQuery(
+                      "CREATE PERFETTO TABLE foo AS SELECT 1 AS x"))
+                  .ok());
+  ASSERT_THAT(Query("SELECT x FROM foo", &stats), testing::ElementsAre(1));
+  ASSERT_THAT(Query("CREATE OR REPLACE PERFETTO TABLE foo AS SELECT 2 AS x;"
+                    "SELECT x FROM foo",
+                    &stats),
+              testing::ElementsAre(2));
+  ASSERT_EQ(stats.query_cache_misses, 1u);
+}
+
+TEST_F(PerfettoSqlEngineQueryCacheTest, NotCached) {
+  PerfettoSqlEngine::ExecutionStats stats;
+  for (uint32_t i = 0; i < 2; ++i) {
+    Query("SELECT random()", &stats);
+    ASSERT_EQ(stats.query_cache_hits, 0u);
+    ASSERT_EQ(stats.query_cache_misses, 0u);
+  }
+}
+
+TEST_F(PerfettoSqlEngineQueryCacheTest, KeepsValueTypes) {
+  for (uint32_t i = 0; i < 2; ++i) {
+    auto res = engine_.ExecuteUntilLastStatement(
+        SqlSource::FromExecuteQuery(
+            "SELECT 1 AS x UNION ALL SELECT 1.5 UNION ALL SELECT "
+            "'cached_string' UNION ALL SELECT x'00ff' UNION ALL SELECT NULL"),
+        /*use_query_cache=*/true);
+    ASSERT_TRUE(res.ok()) << res.status().c_message();
+    ASSERT_EQ(res->stats.query_cache_hits, i);
+    sqlite3_stmt* stmt = res->stmt.sqlite_stmt();
+    ASSERT_EQ(sqlite3_column_type(stmt, 0), SQLITE_INTEGER);
+    ASSERT_TRUE(res->stmt.Step());
+    ASSERT_EQ(sqlite3_column_double(stmt, 0), 1.5);
+    ASSERT_TRUE(res->stmt.Step());
+    ASSERT_STREQ(reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0)),
+                 "cached_string");
+    ASSERT_TRUE(res->stmt.Step());
+    ASSERT_EQ(sqlite3_column_type(stmt, 0), SQLITE_BLOB);
+    ASSERT_EQ(sqlite3_column_bytes(stmt, 0), 2);
+    ASSERT_TRUE(res->stmt.Step());
+    ASSERT_EQ(sqlite3_column_type(stmt, 0), SQLITE_NULL);
+    ASSERT_FALSE(res->stmt.Step());
+  }
+
+  // Cached strings are not interned so they are freed on eviction.
+  ASSERT_FALSE(pool_.GetId("cached_string"));
+}
+
+TEST_F(PerfettoSqlEngineQueryCacheTest, EvictsLeastRecentlyUsed) {
+  PerfettoSqlEngine engine(&pool_, true, nullptr, 128 * sizeof(SqlValue));
+  // Returns the number of cache hits when executing a query returning |rows|
+  // integers: each of these takes sizeof(SqlValue) bytes in the cache (on top
+  // of a small fixed cost per entry).
+  auto query = [&engine](uint32_t rows) {
+    std::string sql =
+        "WITH RECURSIVE c(x) AS (SELECT 1 UNION ALL SELECT x + 1 FROM c "
+        "WHERE x < " +
+        std::to_string(rows) + ") SELECT x FROM c";
+    auto res = engine.ExecuteUntilLastStatement(
+        SqlSource::FromExecuteQuery(sql), /*use_query_cache=*/true);
+    PERFETTO_CHECK(res.ok());
+    return res->stats.query_cache_hits;
+  };
+  uint64_t object_count = engine.SqliteRegisteredObjectCount();
+
+  ASSERT_EQ(query(50), 0u);
+  ASSERT_EQ(query(40), 0u);
+  ASSERT_EQ(query(50), 1u);
+
+  // Does not fit with the other two: evicts the least recently used result.
+  ASSERT_EQ(query(51), 0u);
+  ASSERT_EQ(query(50), 1u);
+  ASSERT_EQ(query(40), 0u);
+
+  // Never fits in the cache.
+  ASSERT_EQ(query(200), 0u);
+  ASSERT_EQ(query(200), 0u);
+  ASSERT_EQ(engine.SqliteRegisteredObjectCount(), object_count);
+}
+
+// Returns its argument and counts how many times it is called.
+struct CountCalls : public SqliteFunction<CountCalls> {
+  static constexpr char kName[] = "count_calls";
+  static constexpr int kArgCount = 1;
+  using UserDataContext = uint32_t;
+
+  static void Step(sqlite3_context* ctx, int, sqlite3_value** argv) {
+    ++*GetUserData(ctx);
+    sqlite::result::Value(ctx, argv[0]);
+  }
+};
+
+TEST_F(PerfettoSqlEngineQueryCacheTest, TooLargeResultExecutedOnce) {
+  PerfettoSqlEngine engine(&pool_, true, nullptr, 1024);
+  uint32_t calls = 0;
+  ASSERT_TRUE(engine.RegisterSqliteFunction<CountCalls>(&calls).ok());
+  uint64_t object_count = engine.SqliteRegisteredObjectCount();
+
+  std::vector<int64_t> expected;
+  for (int64_t i = 1; i <= 1000; ++i) {
+    expected.push_back(i);
+  }
+  const char kSql[] =
+      "WITH RECURSIVE c(x) AS (SELECT 1 UNION ALL SELECT x + 1 FROM c "
+      "WHERE x < 1000) SELECT count_calls(x) FROM c";
+  for (uint32_t i = 1; i <= 2; ++i) {
+    auto res = engine.ExecuteUntilLastStatement(
+        SqlSource::FromExecuteQuery(kSql), /*use_query_cache=*/true);
+    ASSERT_TRUE(res.ok()) << res.status().c_message();
+    ASSERT_EQ(res->stats.query_cache_misses, 1u);
+    std::vector<int64_t> values;
+    for (bool row = !res->stmt.IsDone(); row; row = res->stmt.Step()) {
+      values.push_back(sqlite3_column_int64(res->stmt.sqlite_stmt(), 0));
+    }
+    ASSERT_TRUE(res->stmt.status().ok());
+    ASSERT_EQ(values, expected);
+    ASSERT_EQ(calls, 1000 * i);
+  }
+  ASSERT_EQ(engine.SqliteRegisteredObjectCount(), object_count);
+}
+
+TEST_F(PerfettoSqlEngineQueryCacheTest, NotCacheableEntriesEvicted) {
+  PerfettoSqlEngine engine(&pool_, true, nullptr, 4096);
+  auto query = [&engine](const std::string& sql) {
+    auto res = engine.ExecuteUntilLastStatement(
+        SqlSource::FromExecuteQuery(sql), /*use_query_cache=*/true);
+    PERFETTO_CHECK(res.ok());
+    return res->stats.query_cache_hits;
+  };
+  ASSERT_EQ(query("SELECT 1"), 0u);
+  ASSERT_EQ(query("SELECT 1"), 1u);
+
+  // Statements whose result is too large also take space in the cache so
+  // they end up evicting the other entries.
+  for (uint32_t i = 0; i < 100; ++i) {
+    ASSERT_EQ(query("WITH RECURSIVE c(x) AS (SELECT 1 UNION ALL SELECT x + 1 "
+                    "FROM c WHERE x < 1000) SELECT x + " +
+                    std::to_string(i) + " FROM c"),
+              0u);
+  }
+  ASSERT_EQ(query("SELECT 1"), 0u);
+}
+
+class PerfettoSqlEngineAggregatePushdownTest : public ::testing::Test {
+ protected:
+  PerfettoSqlEngineAggregatePushdownTest() {
+    engine_.RegisterStaticTable(&slices_, "slice",
+                                tables::SliceTable::ComputeStaticSchema());
+    engine_.RegisterStaticTable(&counters_, "counter",
+                                tables::CounterTable::ComputeStaticSchema());
+    const char* names[] = {"foo", "bar", nullptr, "it's"};
+    for (uint32_t i = 0; i < 20; ++i) {
+      tables::SliceTable::Row row;
+      row.ts = i;
+      row.dur = (i * 7) % 50;
+      row.depth = i % 3;
+      row.name = names[i % 4] ? pool_.InternString(names[i % 4])
+                              : StringPool::Id::Null();
+      if (i % 5) {
+        row.thread_dur = i;
+      }
+      slices_.Insert(row);
+
+      tables::CounterTable::Row counter;
+      counter.ts = i;
+      counter.track_id = tables::CounterTrackTable::Id(i % 2);
+      counter.value = i % 3 == 0 ? -0.75 : static_cast<double>(i) / 4;
+      counters_.Insert(counter);
+    }
+  }
+
+  // Returns the column names followed by the rows returned by |sql|. Sets
+  // |pushed_down| to whether the statement was computed by the tables.
+  std::vector<std::string> Rows(const std::string& sql, bool* pushed_down) {
+    auto res =
+        engine_.ExecuteUntilLastStatement(SqlSource::FromExecuteQuery(sql));
+    EXPECT_TRUE(res.ok()) << res.status().c_message();
+    std::vector<std::string> rows;
+    if (!res.ok()) {
+      return rows;
+    }
+    *pushed_down = std::string(res->stmt.sql()) != res->stmt.original_sql();
+    sqlite3_stmt* stmt = res->stmt.sqlite_stmt();
+    std::string header;
+    for (int i = 0; i < sqlite3_column_count(stmt); ++i) {
+      header += std::string(i == 0 ? "" : "|") + sqlite3_column_name(stmt, i);
+    }
+    rows.push_back(header);
+    for (; !res->stmt.IsDone(); res->stmt.Step()) {
+      std::string row;
+      for (int i = 0; i < sqlite3_column_count(stmt); ++i) {
+        const auto* text = sqlite3_column_text(stmt, i);
+        row += (i == 0 ? "" : "|") +
+               std::string(text ? reinterpret_cast<const char*>(text) : "NULL");
+      }
+      rows.push_back(row);
+    }
+    EXPECT_TRUE(res->stmt.status().ok());
+    return rows;
+  }
+
+  // Checks that |sql| returns the same result as when it is executed by
+  // SQLite (which is forced by wrapping it in a subquery) and returns whether
+  // it was pushed down.
+  bool MatchesSqlite(const std::string& sql) {
+    bool pushed_down = false;
+    bool wrapped_pushed_down = false;
+    std::vector<std::string> rows = Rows(sql, &pushed_down);
+    EXPECT_EQ(rows, Rows("SELECT * FROM (" + sql + ")", &wrapped_pushed_down))
+        << sql;
+    EXPECT_FALSE(wrapped_pushed_down);
+    return pushed_down;
+  }
+
+  StringPool pool_;
+  PerfettoSqlEngine engine_{&pool_, true};
+  tables::SliceTable slices_{&pool_};
+  tables::CounterTable counters_{&pool_};
+};
+
+TEST_F(PerfettoSqlEngineAggregatePushdownTest, PushedDown) {
+  ASSERT_TRUE(MatchesSqlite("SELECT COUNT(*) FROM slice"));
+  ASSERT_TRUE(MatchesSqlite(
+      "SELECT depth, COUNT(*), SUM(dur) AS total, MIN(ts), MAX(thread_dur) "
+      "FROM slice GROUP BY depth"));
+  ASSERT_TRUE(MatchesSqlite(
+      "select count(thread_dur), name from slice "
+      "where dur >= 20 and name is not null group by name"));
+  ASSERT_TRUE(MatchesSqlite(
+      "SELECT sum(dur), max( id ) FROM slice WHERE name GLOB 'f*' AND depth "
+      "!= 1 AND thread_dur NOTNULL"));
+  ASSERT_TRUE(MatchesSqlite(
+      "SELECT depth, COUNT(*) FROM slice WHERE dur > -5 AND dur < 45.5 "
+      "AND name = 'it''s' GROUP BY depth"));
+  ASSERT_TRUE(MatchesSqlite(
+      "SELECT track_id, COUNT(value), SUM(value), MIN(value), MAX(value) "
+      "FROM counter WHERE value != 1.0 GROUP BY track_id"));
+
+  // Empty results.
+  ASSERT_TRUE(MatchesSqlite(
+      "SELECT COUNT(*) AS c, depth FROM slice WHERE dur > 1000 GROUP BY "
+      "depth"));
+  ASSERT_TRUE(MatchesSqlite(
+      "SELECT COUNT(*), SUM(ts), MIN(value) FROM counter WHERE ts > 1000"));
+}
+
+TEST_F(PerfettoSqlEngineAggregatePushdownTest, NotPushedDown) {
+  ASSERT_FALSE(
+      MatchesSqlite("SELECT COUNT(*) FROM slice WHERE name LIKE 'f%'"));
+  ASSERT_FALSE(MatchesSqlite(
+      "SELECT depth, COUNT(*) FROM slice GROUP BY depth ORDER BY depth DESC"));
+  ASSERT_FALSE(MatchesSqlite("SELECT MIN(name) FROM slice"));
+  ASSERT_FALSE(MatchesSqlite("SELECT COUNT(DISTINCT depth) FROM slice"));
+  ASSERT_FALSE(MatchesSqlite("SELECT SUM(dur + 1) FROM slice"));
+  ASSERT_FALSE(MatchesSqlite("SELECT COUNT(*) FROM slice WHERE dur = '10'"));
+  ASSERT_FALSE(
+      MatchesSqlite("SELECT value, COUNT(*) FROM counter GROUP BY value"));
+  ASSERT_FALSE(MatchesSqlite("SELECT ts, COUNT(*) FROM slice"));
+
+  // The group column has to be a column of the table.
+  auto res = engine_.Execute(
+      SqlSource::FromExecuteQuery("SELECT COUNT(*) FROM slice GROUP BY foo"));
+  ASSERT_FALSE(res.ok());
+}
+
+class PerfettoSqlEngineJoinTest : public ::testing::Test {
+ protected:
+  PerfettoSqlEngineJoinTest() {
+    // |probe| has no declared column type so its values keep their type:
+    // this checks that non-integer values are looked up correctly.
+    auto res = engine_.Execute(SqlSource::FromExecuteQuery(
+        "CREATE TABLE probe(k);"
+        "INSERT INTO probe VALUES (1), (NULL), (2), (7), (2), (3), (2.0), "
+        "(2.5), (NULL), (4), (1), (100), (3), (-1), (1.5), (5);"
+        "CREATE TABLE build_src(id INT, k, v INT);"
+        "INSERT INTO build_src VALUES (0, 3, 10), (1, NULL, 11), (2, 1, 12), "
+        "(3, 3, 13), (4, 5, 14), (5, NULL, 15), (6, 1, 16), (7, 2, 17), "
+        "(8, 3, 18), (9, -1, 19), (10, 42, 20);"
+        "CREATE TABLE build_double_src(id INT, k DOUBLE);"
+        "INSERT INTO build_double_src VALUES (0, 1.5), (1, 3), (2, NULL), "
+        "(3, 2.5), (4, 1);"
+        "CREATE PERFETTO TABLE build AS SELECT * FROM build_src;"
+        "CREATE PERFETTO TABLE build_double AS "
+        "SELECT * FROM build_double_src"));
+    PERFETTO_CHECK(res.ok());
+  }
+
+  // Returns the rows returned by |sql|.
+  std::vector<std::string> Rows(const std::string& sql) {
+    auto res =
+        engine_.ExecuteUntilLastStatement(SqlSource::FromExecuteQuery(sql));
+    EXPECT_TRUE(res.ok()) << res.status().c_message();
+    std::vector<std::string> rows;
+    if (!res.ok()) {
+      return rows;
+    }
+    sqlite3_stmt* stmt = res->stmt.sqlite_stmt();
+    for (; !res->stmt.IsDone(); res->stmt.Step()) {
+      std::string row;
+      for (int i = 0; i < sqlite3_column_count(stmt); ++i) {
+        const auto* text = sqlite3_column_text(stmt, i);
+        row += (i == 0 ? "" : "|") +
+               std::string(text ? reinterpret_cast<const char*>(text) : "NULL");
+      }
+      rows.push_back(row);
+    }
+    EXPECT_TRUE(res->stmt.status().ok());
+    return rows;
+  }
+
+  // Checks that joining |probe| with the table |build| returns the same rows
+  // as joining it with the SQLite table |build_src|. CROSS JOIN forces
+  // |build| to be the inner side of the join: it is then queried once per
+  // row of |probe|, which is what makes DbSqliteModule cache its sorted
+  // version and answer further queries with hash lookups.
+  void ExpectSameJoin(const std::string& build,
+                      const std::string& build_src) {
+    auto join = [](const std::string& table) {
+      return "SELECT p.k, b.* FROM probe p CROSS JOIN " + table +
+             " b ON b.k = p.k ORDER BY p.rowid, b.id";
+    };
+    std::vector<std::string> expected = Rows(join(build_src));
+    ASSERT_FALSE(expected.empty());
+    ASSERT_EQ(Rows(join(build)), expected);
+  }
+
+  StringPool pool_;
+  PerfettoSqlEngine engine_{&pool_, true};
+};
+
+TEST_F(PerfettoSqlEngineJoinTest, IntegerKeys) {
+  ExpectSameJoin("build", "build_src");
+}
+
+TEST_F(PerfettoSqlEngineJoinTest, NonIntegerKeys) {
+  ExpectSameJoin("build_double", "build_double_src");
+}
+
 }  // namespace
 }  // namespace trace_processor
 }  // namespace perfetto
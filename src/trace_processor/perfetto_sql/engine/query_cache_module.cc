@@ -0,0 +1,152 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "src/trace_processor/perfetto_sql/engine/query_cache_module.h"
+
+#include <sqlite3.h>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "perfetto/public/compiler.h"
+#include "src/trace_processor/sqlite/bindings/sqlite_result.h"
+#include "src/trace_processor/sqlite/sqlite_utils.h"
+
+namespace perfetto::trace_processor {
+
+int QueryCacheModule::Connect(sqlite3* db,
+                              void* ctx,
+                              int,
+                              const char* const*,
+                              sqlite3_vtab** vtab,
+                              char**) {
+  std::string schema = "CREATE TABLE x(";
+  for (uint32_t i = 0; i < kMaxColumnCount; ++i) {
+    schema += "c" + std::to_string(i) + " ANY, ";
+  }
+  schema += "result_id INTEGER HIDDEN)";
+  if (int ret = sqlite3_declare_vtab(db, schema.c_str()); ret != SQLITE_OK) {
+    return ret;
+  }
+  std::unique_ptr<Vtab> res = std::make_unique<Vtab>();
+  res->context = GetContext(ctx);
+  *vtab = res.release();
+  return SQLITE_OK;
+}
+
+int QueryCacheModule::Disconnect(sqlite3_vtab* vtab) {
+  delete GetVtab(vtab);
+  return SQLITE_OK;
+}
+
+int QueryCacheModule::BestIndex(sqlite3_vtab* tab, sqlite3_index_info* info) {
+  bool seen_result_id_eq = false;
+  for (int i = 0; i < info->nConstraint; ++i) {
+    const auto& in = info->aConstraint[i];
+    if (!in.usable || in.iColumn != kResultIdColumnIndex ||
+        in.op != SQLITE_INDEX_CONSTRAINT_EQ) {
+      continue;
+    }
+    info->aConstraintUsage[i].argvIndex = 1;
+    info->aConstraintUsage[i].omit = true;
+    seen_result_id_eq = true;
+    break;
+  }
+  if (!seen_result_id_eq) {
+    return sqlite::utils::SetError(tab, "result_id must be bound");
+  }
+  return SQLITE_OK;
+}
+
+int QueryCacheModule::Open(sqlite3_vtab* vtab, sqlite3_vtab_cursor** cursor) {
+  std::unique_ptr<Cursor> c = std::make_unique<Cursor>();
+  c->context = GetVtab(vtab)->context;
+  *cursor = c.release();
+  return SQLITE_OK;
+}
+
+int QueryCacheModule::Close(sqlite3_vtab_cursor* cursor) {
+  delete GetCursor(cursor);
+  return SQLITE_OK;
+}
+
+int QueryCacheModule::Filter(sqlite3_vtab_cursor* cursor,
+                             int,
+                             const char*,
+                             int argc,
+                             sqlite3_value** argv) {
+  auto* c = GetCursor(cursor);
+  if (argc != 1 || sqlite3_value_type(argv[0]) != SQLITE_INTEGER) {
+    return sqlite::utils::SetError(c->pVtab, "result_id is not an integer");
+  }
+  auto id = static_cast<uint32_t>(sqlite3_value_int64(argv[0]));
+  std::shared_ptr<Result>* result = c->context->results.Find(id);
+  if (!result) {
+    return sqlite::utils::SetError(c->pVtab, "Query cache result not found");
+  }
+  c->result = *result;
+  if (c->result->read_once) {
+    c->context->results.Erase(id);
+  }
+  c->row = 0;
+  c->eof = c->result->row_count == 0;
+  return SQLITE_OK;
+}
+
+int QueryCacheModule::Next(sqlite3_vtab_cursor* cursor) {
+  auto* c = GetCursor(cursor);
+  if (++c->row < c->result->row_count) {
+    return SQLITE_OK;
+  }
+  SqliteEngine::PreparedStatement* remaining = c->result->remaining.get();
+  if (!remaining || !remaining->Step()) {
+    c->eof = true;
+    if (remaining && !remaining->status().ok()) {
+      return sqlite::utils::SetError(c->pVtab, remaining->status());
+    }
+  }
+  return SQLITE_OK;
+}
+
+int QueryCacheModule::Eof(sqlite3_vtab_cursor* cursor) {
+  return GetCursor(cursor)->eof;
+}
+
+int QueryCacheModule::Column(sqlite3_vtab_cursor* cursor,
+                             sqlite3_context* ctx,
+                             int raw_n) {
+  auto* c = GetCursor(cursor);
+  auto n = static_cast<uint32_t>(raw_n);
+  if (PERFETTO_UNLIKELY(n >= c->result->column_count)) {
+    sqlite::result::Null(ctx);
+    return SQLITE_OK;
+  }
+  if (c->row >= c->result->row_count) {
+    sqlite::result::Value(ctx, sqlite3_column_value(
+                                   c->result->remaining->sqlite_stmt(), raw_n));
+    return SQLITE_OK;
+  }
+  sqlite::utils::ReportSqlValue(
+      ctx, c->result->values[c->row * c->result->column_count + n]);
+  return SQLITE_OK;
+}
+
+int QueryCacheModule::Rowid(sqlite3_vtab_cursor* cursor, sqlite_int64* rowid) {
+  *rowid = GetCursor(cursor)->row;
+  return SQLITE_OK;
+}
+
+}  // namespace perfetto::trace_processor
@@ -0,0 +1,118 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_TRACE_PROCESSOR_PERFETTO_SQL_ENGINE_QUERY_CACHE_MODULE_H_
+#define SRC_TRACE_PROCESSOR_PERFETTO_SQL_ENGINE_QUERY_CACHE_MODULE_H_
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "perfetto/ext/base/flat_hash_map.h"
+#include "perfetto/trace_processor/basic_types.h"
+#include "src/trace_processor/sqlite/bindings/sqlite_module.h"
+#include "src/trace_processor/sqlite/sqlite_engine.h"
+
+namespace perfetto::trace_processor {
+
+// SQLite module which reads the results stored by the query cache of
+// PerfettoSqlEngine. The result to read is passed as an argument, which means
+// that no table needs to be created (and be visible to users) for each result.
+// As with TablePointerModule, the schema is a fixed list of columns which are
+// renamed by the query:
+// ```
+//  SELECT c0 AS ts, c1 AS name FROM __intrinsic_query_cache(3)
+// ```
+//
+// Note: this class is *not* intended to be used directly by end users.
+struct QueryCacheModule : sqlite::Module<QueryCacheModule> {
+  static constexpr uint32_t kMaxColumnCount = 64;
+  static constexpr int kResultIdColumnIndex = kMaxColumnCount;
+
+  // The rows returned by a statement. Strings and bytes are copied into
+  // |buffers| rather than being interned in the StringPool so all the memory
+  // of a result is freed once it is evicted from the cache and no statement
+  // reads it anymore.
+  struct Result {
+    uint32_t column_count = 0;
+    uint32_t row_count = 0;
+
+    // The values of all the rows, one row after the other.
+    std::vector<SqlValue> values;
+    std::vector<std::unique_ptr<char[]>> buffers;
+
+    // Estimate of the memory used by |values| and |buffers|.
+    uint64_t size_bytes = 0;
+
+    // Set if the statement returned more rows than could be stored: the rows
+    // above are followed by the rows returned by stepping this statement.
+    // This avoids executing the statement a second time.
+    std::unique_ptr<SqliteEngine::PreparedStatement> remaining;
+
+    // Whether the result is removed from |Context::results| when it is read.
+    // Always true if |remaining| is set as it can only be stepped once.
+    bool read_once = false;
+  };
+
+  struct Context {
+    base::FlatHashMap<uint32_t, std::shared_ptr<Result>> results;
+  };
+  struct Vtab : sqlite::Module<QueryCacheModule>::Vtab {
+    Context* context = nullptr;
+  };
+  struct Cursor : sqlite::Module<QueryCacheModule>::Cursor {
+    Context* context = nullptr;
+    // Keeps the result alive if it is evicted while being read.
+    std::shared_ptr<Result> result;
+    uint32_t row = 0;
+    bool eof = false;
+  };
+
+  static constexpr auto kType = kEponymousOnly;
+  static constexpr bool kSupportsWrites = false;
+  static constexpr bool kDoesOverloadFunctions = false;
+
+  static int Connect(sqlite3*,
+                     void*,
+                     int,
+                     const char* const*,
+                     sqlite3_vtab**,
+                     char**);
+  static int Disconnect(sqlite3_vtab*);
+
+  static int BestIndex(sqlite3_vtab*, sqlite3_index_info*);
+
+  static int Open(sqlite3_vtab*, sqlite3_vtab_cursor**);
+  static int Close(sqlite3_vtab_cursor*);
+
+  static int Filter(sqlite3_vtab_cursor*,
+                    int,
+                    const char*,
+                    int,
+                    sqlite3_value**);
+  static int Next(sqlite3_vtab_cursor*);
+  static int Eof(sqlite3_vtab_cursor*);
+  static int Column(sqlite3_vtab_cursor*, sqlite3_context*, int);
+  static int Rowid(sqlite3_vtab_cursor*, sqlite_int64*);
+
+  // This needs to happen at the end as it depends on the functions
+  // defined above.
+  static constexpr sqlite3_module kModule = CreateModule();
+};
+
+}  // namespace perfetto::trace_processor
+
+#endif  // SRC_TRACE_PROCESSOR_PERFETTO_SQL_ENGINE_QUERY_CACHE_MODULE_H_
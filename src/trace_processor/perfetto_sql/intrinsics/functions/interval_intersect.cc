@@ -61,10 +61,11 @@ static const uint32_t kPartitionColsOffset = kArgCols + kIdCols;
 using Intervals = std::vector<Interval>;
 using BuilderColType = RuntimeTable::BuilderColumnType;
 
-struct MultiIndexInterval {
+// An interval of the intersection. The ids of the intervals from each table
+// which produced it are stored separately (see |PushPartition()|).
+struct IntersectedInterval {
   uint64_t start;
   uint64_t end;
-  std::vector<int64_t> idx_in_table;
 };
 
 BuilderColType FromSqlValueTypeToBuilderType(SqlValue::Type type) {
@@ -134,23 +135,30 @@ static base::StatusOr<uint32_t> PushPartition(
   uint32_t idx_of_smallest_part = tables_order.front();
   PERFETTO_DCHECK(!partitions[idx_of_smallest_part]->intervals.empty());
 
-  // Trivially translate intervals from smallest table to `MultiIndexIntervals`.
-  std::vector<MultiIndexInterval> last_results;
-  last_results.reserve(partitions.back()->intervals.size());
-  for (const auto& interval : partitions[idx_of_smallest_part]->intervals) {
-    MultiIndexInterval m_int;
-    m_int.start = interval.start;
-    m_int.end = interval.end;
-    m_int.idx_in_table.resize(tables_count);
-    m_int.idx_in_table[idx_of_smallest_part] = interval.id;
-    last_results.push_back(m_int);
+  // Trivially translate intervals from smallest table to
+  // `IntersectedInterval`s. The ids of the intervals producing the n-th
+  // intersected interval are stored in |last_ids|, starting at
+  // n * |tables_count|: storing them contiguously (instead of in a vector per
+  // interval) avoids an allocation for every overlap.
+  const auto& smallest = partitions[idx_of_smallest_part]->intervals;
+  std::vector<IntersectedInterval> last_results;
+  std::vector<int64_t> last_ids;
+  last_results.reserve(smallest.size());
+  last_ids.reserve(smallest.size() * tables_count);
+  for (const auto& interval : smallest) {
+    last_results.push_back({interval.start, interval.end});
+    last_ids.resize(last_ids.size() + tables_count);
+    last_ids[last_ids.size() - tables_count + idx_of_smallest_part] =
+        interval.id;
   }
 
   // Create an interval tree on all tables except the smallest - the first one.
-  std::vector<MultiIndexInterval> overlaps_with_this_table;
-  overlaps_with_this_table.reserve(partitions.back()->intervals.size());
+  std::vector<IntersectedInterval> overlaps_with_this_table;
+  std::vector<int64_t> ids_with_this_table;
+  Intervals new_overlaps;
   for (uint32_t i = 1; i < tables_count && !last_results.empty(); i++) {
     overlaps_with_this_table.clear();
+    ids_with_this_table.clear();
     uint32_t table_idx = tables_order[i];
 
     IntervalIntersector::Mode intersection_mode =
@@ -159,21 +167,22 @@ static base::StatusOr<uint32_t> PushPartition(
             static_cast<uint32_t>(last_results.size()));
     IntervalIntersector cur_int_operator(partitions[table_idx]->intervals,
                                          intersection_mode);
-    for (const auto& prev_result : last_results) {
-      Intervals new_overlaps;
-      cur_int_operator.FindOverlaps(prev_result.start, prev_result.end,
+    for (size_t r = 0; r < last_results.size(); ++r) {
+      new_overlaps.clear();
+      cur_int_operator.FindOverlaps(last_results[r].start, last_results[r].end,
                                     new_overlaps);
+      const int64_t* prev_ids = last_ids.data() + r * tables_count;
       for (const auto& overlap : new_overlaps) {
-        MultiIndexInterval m_int;
-        m_int.idx_in_table = std::move(prev_result.idx_in_table);
-        m_int.idx_in_table[table_idx] = overlap.id;
-        m_int.start = overlap.start;
-        m_int.end = overlap.end;
-        overlaps_with_this_table.push_back(std::move(m_int));
+        overlaps_with_this_table.push_back({overlap.start, overlap.end});
+        ids_with_this_table.insert(ids_with_this_table.end(), prev_ids,
+                                   prev_ids + tables_count);
+        ids_with_this_table[ids_with_this_table.size() - tables_count +
+                            table_idx] = overlap.id;
       }
     }
 
-    last_results = std::move(overlaps_with_this_table);
+    std::swap(last_results, overlaps_with_this_table);
+    std::swap(last_ids, ids_with_this_table);
   }
 
   uint32_t rows_count = static_cast<uint32_t>(last_results.size());
@@ -185,19 +194,19 @@ static base::StatusOr<uint32_t> PushPartition(
   }
 
   for (uint32_t i = 0; i < rows_count; i++) {
-    const MultiIndexInterval& interval = last_results[i];
+    const IntersectedInterval& interval = last_results[i];
     timestamps[i] = static_cast<int64_t>(interval.start);
     durations[i] = static_cast<int64_t>(interval.end) -
                    static_cast<int64_t>(interval.start);
     for (uint32_t j = 0; j < tables_count; j++) {
-      ids[j][i] = interval.idx_in_table[j];
+      ids[j][i] = last_ids[i * tables_count + j];
     }
   }
 
   builder.AddNonNullIntegersUnchecked(0, std::move(timestamps));
   builder.AddNonNullIntegersUnchecked(1, std::move(durations));
   for (uint32_t i = 0; i < tables_count; i++) {
-    builder.AddNonNullIntegersUnchecked(i + kArgCols, ids[i]);
+    builder.AddNonNullIntegersUnchecked(i + kArgCols, std::move(ids[i]));
   }
 
   for (uint32_t i = 0; i < partitions[0]->sql_values.size(); i++) {
@@ -0,0 +1,173 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Compares the ways of joining two tables of intervals on overlap: the
+// interval_intersect macro, SPAN_JOIN and a plain SQL join on
+// `a.ts < b.ts + b.dur AND b.ts < a.ts + a.dur`.
+
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <string>
+
+#include <benchmark/benchmark.h>
+
+#include "perfetto/base/logging.h"
+#include "perfetto/ext/base/string_utils.h"
+#include "perfetto/trace_processor/basic_types.h"
+#include "perfetto/trace_processor/trace_processor.h"
+
+namespace perfetto::trace_processor {
+namespace {
+
+// Number of threads the intervals are spread over.
+constexpr uint32_t kThreads = 64;
+
+bool IsBenchmarkFunctionalOnly() {
+  return getenv("BENCHMARK_FUNCTIONAL_TEST_ONLY") != nullptr;
+}
+
+void SizeArgs(benchmark::internal::Benchmark* b) {
+  if (IsBenchmarkFunctionalOnly()) {
+    b->Arg(1024);
+  } else {
+    b->RangeMultiplier(4)->Range(4 * 1024, 256 * 1024);
+  }
+}
+
+// The plain join is quadratic in the number of intervals of each thread so
+// it is only run on smaller sizes.
+void SmallSizeArgs(benchmark::internal::Benchmark* b) {
+  if (IsBenchmarkFunctionalOnly()) {
+    b->Arg(1024);
+  } else {
+    b->RangeMultiplier(4)->Range(4 * 1024, 16 * 1024);
+  }
+}
+
+void RunQueryChecked(TraceProcessor* tp, const std::string& query) {
+  auto it = tp->ExecuteQuery(query);
+  while (it.Next()) {
+  }
+  PERFETTO_CHECK(it.Status().ok());
+}
+
+int64_t CountChecked(TraceProcessor* tp, const std::string& query) {
+  auto it = tp->ExecuteQuery(query);
+  PERFETTO_CHECK(it.Next());
+  int64_t count = it.Get(0).AsLong();
+  PERFETTO_CHECK(!it.Next());
+  PERFETTO_CHECK(it.Status().ok());
+  return count;
+}
+
+// Creates |rows| intervals in a "sched" table resembling the sched table
+// (intervals of a thread don't overlap) and |rows| intervals in a "slice"
+// table. If |nested| is true, the slices of a thread form stacks of depth 3
+// (and so overlap each other), otherwise they don't overlap.
+std::unique_ptr<TraceProcessor> CreateSchedAndSlice(int64_t rows,
+                                                    bool nested) {
+  auto tp = TraceProcessor::CreateInstance(Config());
+  RunQueryChecked(tp.get(), "INCLUDE PERFETTO MODULE intervals.intersect;");
+  RunQueryChecked(
+      tp.get(),
+      "CREATE PERFETTO TABLE sched AS "
+      "WITH RECURSIVE n(i) AS (SELECT 0 UNION ALL SELECT i + 1 FROM n "
+      "  WHERE i + 1 < " + std::to_string(rows) + ") "
+      "SELECT i AS id, (i / " + std::to_string(kThreads) + ") * 100 "
+      "  + i % 7 AS ts, 50 + i % 37 AS dur, i % " +
+      std::to_string(kThreads) + " AS utid FROM n ORDER BY ts");
+  std::string slice_ts_dur =
+      nested ? "(i / 3 / " + std::to_string(kThreads) +
+                   ") * 300 + (i % 3) * 10 AS ts, 200 - (i % 3) * 40 + i % 17 "
+                   "AS dur"
+             : "(i / " + std::to_string(kThreads) +
+                   ") * 150 + i % 11 AS ts, 70 + i % 29 AS dur";
+  RunQueryChecked(
+      tp.get(),
+      "CREATE PERFETTO TABLE slice AS "
+      "WITH RECURSIVE n(i) AS (SELECT 0 UNION ALL SELECT i + 1 FROM n "
+      "  WHERE i + 1 < " + std::to_string(rows) + ") "
+      "SELECT i AS id, " + slice_ts_dur + ", i % " +
+      std::to_string(kThreads) + " AS utid FROM n ORDER BY ts");
+  return tp;
+}
+
+void BM_IntervalIntersectSchedSlice(benchmark::State& state) {
+  auto tp = CreateSchedAndSlice(state.range(0), /*nested=*/false);
+  int64_t count = 0;
+  for (auto _ : state) {
+    count = CountChecked(
+        tp.get(),
+        "SELECT COUNT(*) FROM interval_intersect!((sched, slice), (utid))");
+    benchmark::DoNotOptimize(count);
+  }
+  state.counters["overlaps"] = static_cast<double>(count);
+}
+BENCHMARK(BM_IntervalIntersectSchedSlice)->Apply(SizeArgs);
+
+void BM_SpanJoinSchedSlice(benchmark::State& state) {
+  auto tp = CreateSchedAndSlice(state.range(0), /*nested=*/false);
+  // SPAN_JOIN requires the tables to not have any column in common other
+  // than ts, dur and the partition.
+  RunQueryChecked(tp.get(),
+                  "CREATE PERFETTO VIEW sched_sp AS "
+                  "SELECT id AS sched_id, ts, dur, utid FROM sched");
+  RunQueryChecked(tp.get(),
+                  "CREATE PERFETTO VIEW slice_sp AS "
+                  "SELECT id AS slice_id, ts, dur, utid FROM slice");
+  RunQueryChecked(tp.get(),
+                  "CREATE VIRTUAL TABLE sp USING SPAN_JOIN(sched_sp "
+                  "PARTITIONED utid, slice_sp PARTITIONED utid)");
+  int64_t count = 0;
+  for (auto _ : state) {
+    count = CountChecked(tp.get(), "SELECT COUNT(*) FROM sp");
+    benchmark::DoNotOptimize(count);
+  }
+  state.counters["overlaps"] = static_cast<double>(count);
+}
+BENCHMARK(BM_SpanJoinSchedSlice)->Apply(SizeArgs);
+
+void BM_PlainJoinSchedSlice(benchmark::State& state) {
+  auto tp = CreateSchedAndSlice(state.range(0), /*nested=*/false);
+  int64_t count = 0;
+  for (auto _ : state) {
+    count = CountChecked(
+        tp.get(),
+        "SELECT COUNT(*) FROM sched a JOIN slice b USING (utid) "
+        "WHERE a.ts < b.ts + b.dur AND b.ts < a.ts + a.dur");
+    benchmark::DoNotOptimize(count);
+  }
+  state.counters["overlaps"] = static_cast<double>(count);
+}
+BENCHMARK(BM_PlainJoinSchedSlice)->Apply(SmallSizeArgs);
+
+// SPAN_JOIN can't be used when the slices of a thread overlap each other.
+void BM_IntervalIntersectSchedNestedSlice(benchmark::State& state) {
+  auto tp = CreateSchedAndSlice(state.range(0), /*nested=*/true);
+  int64_t count = 0;
+  for (auto _ : state) {
+    count = CountChecked(
+        tp.get(),
+        "SELECT COUNT(*) FROM interval_intersect!((sched, slice), (utid))");
+    benchmark::DoNotOptimize(count);
+  }
+  state.counters["overlaps"] = static_cast<double>(count);
+}
+BENCHMARK(BM_IntervalIntersectSchedNestedSlice)->Apply(SizeArgs);
+
+}  // namespace
+}  // namespace perfetto::trace_processor
@@ -319,7 +319,14 @@ struct IntervalTreeIntervalsAgg
 
     // Fetch and validate the interval.
     Interval interval;
-    interval.id = static_cast<uint32_t>(sqlite::value::Int64(argv[0]));
+    int64_t id = sqlite::value::Int64(argv[0]);
+    if (id < 0 || id > std::numeric_limits<uint32_t>::max()) {
+      sqlite::result::Error(
+          ctx, "Interval intersect only works on intervals with ids in the "
+               "range [0, 2^32)");
+      return;
+    }
+    interval.id = static_cast<uint32_t>(id);
     interval.start = static_cast<uint64_t>(sqlite::value::Int64(argv[1]));
     if (interval.start < agg_ctx.max_ts) {
       sqlite::result::Error(
@@ -214,6 +214,11 @@ base::Status SpanJoinOperatorModule::TableDefinition::Create(
         desc.name.c_str());
   }
 
+  // Table valued functions can be passed with their arguments.
+  RETURN_IF_ERROR(
+      engine->CreateLazyTable(desc.name.substr(0, desc.name.find('(')))
+          .status());
+
   std::vector<std::pair<SqlValue::Type, std::string>> cols;
   RETURN_IF_ERROR(sqlite::utils::GetColumnsForTable(
       engine->sqlite_engine()->db(), desc.name, cols));
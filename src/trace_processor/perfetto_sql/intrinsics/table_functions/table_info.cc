@@ -90,7 +90,7 @@ std::vector<TableInfoTable::Row> GetColInfoRows(
 
 }  // namespace
 
-TableInfo::TableInfo(StringPool* string_pool, const PerfettoSqlEngine* engine)
+TableInfo::TableInfo(StringPool* string_pool, PerfettoSqlEngine* engine)
     : string_pool_(string_pool), engine_(engine) {}
 
 base::StatusOr<std::unique_ptr<Table>> TableInfo::ComputeTable(
@@ -103,6 +103,7 @@ base::StatusOr<std::unique_ptr<Table>> TableInfo::ComputeTable(
   std::string table_name = arguments[0].AsString();
   auto table = std::make_unique<TableInfoTable>(string_pool_);
   auto table_name_id = string_pool_->InternString(table_name.c_str());
+  RETURN_IF_ERROR(engine_->CreateLazyTable(table_name).status());
 
   // Find static table
   const Table* static_table = engine_->GetStaticTableOrNull(table_name);
@@ -36,7 +36,7 @@ class TraceProcessorContext;
 
 class TableInfo : public StaticTableFunction {
  public:
-  explicit TableInfo(StringPool*, const PerfettoSqlEngine*);
+  explicit TableInfo(StringPool*, PerfettoSqlEngine*);
 
   Table::Schema CreateSchema() override;
   std::string TableName() override;
@@ -46,7 +46,7 @@ class TableInfo : public StaticTableFunction {
 
  private:
   StringPool* string_pool_ = nullptr;
-  const PerfettoSqlEngine* engine_ = nullptr;
+  PerfettoSqlEngine* engine_ = nullptr;
 };
 
 }  // namespace perfetto::trace_processor
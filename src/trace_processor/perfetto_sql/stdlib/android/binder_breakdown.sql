@@ -104,7 +104,7 @@ SELECT
   _server_flat.flat_id,
   _thread_state_view.state,
   _thread_state_view.io_wait
-FROM _interval_intersect !((_binder_server_flat_descendants, _thread_state_view), (utid)) ii
+FROM interval_intersect !((_binder_server_flat_descendants, _thread_state_view), (utid)) ii
 JOIN _binder_server_flat_descendants _server_flat
   ON id_0 = _server_flat.id
 JOIN _thread_state_view
@@ -122,7 +122,7 @@ SELECT
   _client_flat.flat_id,
   _thread_state_view.state,
   _thread_state_view.io_wait
-FROM _interval_intersect !((_binder_client_flat_descendants, _thread_state_view), (utid)) ii
+FROM interval_intersect !((_binder_client_flat_descendants, _thread_state_view), (utid)) ii
 JOIN _binder_client_flat_descendants _client_flat
   ON id_0 = _client_flat.id
 JOIN _thread_state_view
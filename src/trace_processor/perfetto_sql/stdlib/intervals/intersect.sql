@@ -44,10 +44,40 @@ RETURNS TableOrSubquery AS
   FROM (SELECT * FROM $tab ORDER BY ts) input
 );
 
-CREATE PERFETTO MACRO _interval_intersect(
+-- Given a list of interval tables, returns all the intervals of time where an
+-- interval from each of the tables overlaps, together with the ids of those
+-- intervals: i.e. an overlap join of the tables.
+--
+-- This is an alternative to SPAN_JOIN and to joining on
+-- `a.ts < b.ts + b.dur AND b.ts < a.ts + a.dur` (which SQLite evaluates in
+-- O(n * m)): the intervals of each table are indexed in an interval tree (or
+-- binary searched if they don't overlap each other) so the cost is
+-- O((n + m) * log(n) + k) for k overlaps. Unlike SPAN_JOIN, the intervals of
+-- each table may overlap each other (e.g. nested slices).
+--
+-- For example, for the intervals
+-- ```
+-- A: id=0, ts=0, dur=10
+-- B: id=0, ts=2, dur=3
+--    id=1, ts=4, dur=10
+-- ```
+-- `interval_intersect!((A, B), ())` returns
+-- ```
+-- ts=2, dur=3, id_0=0, id_1=0
+-- ts=4, dur=6, id_0=0, id_1=1
+-- ```
+CREATE PERFETTO MACRO interval_intersect(
+  -- Tables or views to intersect (at most 5). Each must have the columns
+  -- "id" (in the range [0, 2^32)), "ts" and "dur" (which must be positive).
   tabs _TableNameList,
-  agg_columns _ColumnNameList
+  -- Columns to partition the intersection by (at most 4), e.g. `(utid)`:
+  -- only intervals with the same values of these columns are intersected.
+  -- Use `()` to not partition the intervals.
+  partitions _ColumnNameList
 )
+-- Table with the schema (ts INT64, dur INT64, id_0 INT64, ..., id_N INT64,
+-- followed by the partition columns) where `id_i` is the id of the
+-- overlapping interval from the i-th table.
 RETURNS TableOrSubquery AS
 (
   SELECT
@@ -63,7 +93,7 @@ RETURNS TableOrSubquery AS
     __intrinsic_token_apply_prefix!(
       _ii_df_select,
       (c7, c8, c9, c10),
-      $agg_columns
+      $partitions
     )
   -- Interval intersect result table.
   FROM __intrinsic_table_ptr(
@@ -71,9 +101,9 @@ RETURNS TableOrSubquery AS
       __intrinsic_token_apply!(
         _interval_agg,
         $tabs,
-        ($agg_columns, $agg_columns, $agg_columns, $agg_columns, $agg_columns)
+        ($partitions, $partitions, $partitions, $partitions, $partitions)
       ),
-      __intrinsic_stringify!($agg_columns)
+      __intrinsic_stringify!($partitions)
     )
   )
 
@@ -91,22 +121,32 @@ RETURNS TableOrSubquery AS
     __intrinsic_token_apply_and_prefix!(
       _ii_df_bind,
       (c7, c8, c9, c10),
-      $agg_columns
+      $partitions
     )
 );
 
-CREATE PERFETTO MACRO _interval_intersect_single(
+-- Returns the intervals of |t| overlapping the interval (|ts|, |dur|), clipped
+-- to it. Equivalent to intersecting |t| with a table containing the single
+-- interval with `interval_intersect`.
+CREATE PERFETTO MACRO interval_intersect_single(
+  -- Timestamp of the interval.
   ts Expr,
+  -- Duration of the interval.
   dur Expr,
+  -- Table or view with the columns "id", "ts" and "dur" to intersect with
+  -- the interval.
   t TableOrSubquery
 )
+-- Table with the schema (id INT64, ts INT64, dur INT64), where `id` is the id
+-- of the interval from |t| and `ts` and `dur` describe its overlap with the
+-- interval.
 RETURNS TableOrSubquery AS
 (
   SELECT
   id_0 AS id,
   ts,
   dur
-  FROM _interval_intersect!(
+  FROM interval_intersect!(
     ($t, (SELECT 0 AS id, $ts AS ts, $dur AS dur)),
     ()
   )
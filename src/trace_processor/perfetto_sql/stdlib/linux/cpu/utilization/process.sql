@@ -139,6 +139,6 @@ SELECT
   MIN(freq) AS min_freq,
   MAX(freq) AS max_freq,
   cast_int!(SUM((ii.dur * freq / 1000)) / SUM(ii.dur / 1000)) AS avg_freq
-FROM _interval_intersect_single!($ts, $dur, threads_counters) ii
+FROM interval_intersect_single!($ts, $dur, threads_counters) ii
 JOIN threads_counters USING (id)
 GROUP BY upid;
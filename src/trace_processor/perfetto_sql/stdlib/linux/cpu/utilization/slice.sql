@@ -47,7 +47,7 @@ WITH intersected AS (
     sum(ii.dur) AS dur,
     cast_int!(SUM(ii.dur * freq / 1000)) AS millicycles,
     cast_int!(SUM(ii.dur * freq / 1000) / 1e9) AS megacycles
-  FROM _interval_intersect!(
+  FROM interval_intersect!(
     ((SELECT * FROM thread_slice WHERE dur > 0 AND utid > 0),
     _cpu_freq_per_thread), (utid)) ii
   JOIN _cpu_freq_per_thread f ON f.id = ii.id_1
@@ -95,7 +95,7 @@ RETURNS TABLE(
 ) AS
 WITH cut_thread_slice AS (
   SELECT id, ii.ts, ii.dur, thread_slice.*
-  FROM _interval_intersect_single!(
+  FROM interval_intersect_single!(
     $ts, $dur, 
     (SELECT * FROM thread_slice WHERE dur > 0 AND utid > 0)) ii
   JOIN thread_slice USING (id)
@@ -107,7 +107,7 @@ intersected AS (
     sum(ii.dur) AS dur,
     cast_int!(SUM(ii.dur * freq / 1000)) AS millicycles,
     cast_int!(SUM(ii.dur * freq / 1000) / 1e9) AS megacycles
-  FROM _interval_intersect!(
+  FROM interval_intersect!(
     (cut_thread_slice, _cpu_freq_per_thread), (utid)) ii
   JOIN _cpu_freq_per_thread f ON f.id = ii.id_1
   WHERE freq IS NOT NULL
@@ -119,7 +119,7 @@ SELECT
   MIN(freq) AS min_freq,
   MAX(freq) AS max_freq,
   cast_int!(SUM((ii.dur * freq / 1000)) / SUM(ii.dur / 1000)) AS avg_freq
-FROM _interval_intersect_single!($ts, $dur, _cpu_freq_per_thread) ii
+FROM interval_intersect_single!($ts, $dur, _cpu_freq_per_thread) ii
 JOIN _cpu_freq_per_thread USING (id);
 
 -- Aggregated CPU statistics for each CPU.
@@ -187,6 +187,6 @@ SELECT
   MIN(freq) AS min_freq,
   MAX(freq) AS max_freq,
   cast_int!(SUM((ii.dur * freq / 1000)) / SUM(ii.dur / 1000)) AS avg_freq
-FROM _interval_intersect_single!($ts, $dur, _cpu_freq_per_thread) ii
+FROM interval_intersect_single!($ts, $dur, _cpu_freq_per_thread) ii
 JOIN _cpu_freq_per_thread USING (id)
 GROUP BY ucpu;
@@ -36,7 +36,10 @@ CREATE PERFETTO VIEW track (
   -- Chrome tracepoints etc. Alias of `args.arg_set_id`.
   source_arg_set_id UINT,
   -- Machine identifier, non-null for tracks on a remote machine.
-  machine_id UINT
+  machine_id UINT,
+  -- The trace this track belongs to. Useful when multiple traces are loaded
+  -- in the same trace processor instance. Alias of `trace_file.id`.
+  trace_id UINT
 ) AS
 SELECT
   id,
@@ -44,7 +47,8 @@ SELECT
   name,
   parent_id,
   source_arg_set_id,
-  machine_id
+  machine_id,
+  trace_id
 FROM
   __intrinsic_track;
 
@@ -72,7 +76,10 @@ CREATE PERFETTO VIEW cpu (
   -- https://www.kernel.org/doc/Documentation/devicetree/bindings/arm/cpu-capacity.txt
   capacity UINT,
   -- Extra key/value pairs associated with this cpu.
-  arg_set_id UINT
+  arg_set_id UINT,
+  -- The trace this CPU belongs to. Useful when multiple traces are loaded in
+  -- the same trace processor instance. Alias of `trace_file.id`.
+  trace_id UINT
 ) AS
 SELECT
   id,
@@ -83,7 +90,8 @@ SELECT
   processor,
   machine_id,
   capacity,
-  arg_set_id
+  arg_set_id,
+  trace_id
 FROM
   __intrinsic_cpu
 WHERE
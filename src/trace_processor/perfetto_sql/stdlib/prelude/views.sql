@@ -181,7 +181,10 @@ CREATE PERFETTO VIEW thread(
   -- Boolean indicating if this thread is the main thread in the process.
   is_main_thread BOOL,
   -- Machine identifier, non-null for threads on a remote machine.
-  machine_id INT
+  machine_id INT,
+  -- The trace this thread belongs to. Useful when multiple traces are loaded in
+  -- the same trace processor instance. Alias of `trace_file.id`.
+  trace_id INT
 ) AS
 SELECT id as utid, *
 FROM __intrinsic_thread;
@@ -221,7 +224,10 @@ CREATE PERFETTO VIEW process(
   -- Extra args for this process.
   arg_set_id INT,
   -- Machine identifier, non-null for processes on a remote machine.
-  machine_id INT
+  machine_id INT,
+  -- The trace this process belongs to. Useful when multiple traces are loaded
+  -- in the same trace processor instance. Alias of `trace_file.id`.
+  trace_id INT
 ) AS
 SELECT id as upid, *
 FROM __intrinsic_process;
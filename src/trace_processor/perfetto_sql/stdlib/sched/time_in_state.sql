@@ -118,7 +118,7 @@ SELECT
   sum(ii.dur) as dur
 FROM thread_state
 JOIN
-  (SELECT * FROM _interval_intersect_single!(
+  (SELECT * FROM interval_intersect_single!(
     $ts, $dur,
     (SELECT id, ts, dur
     FROM thread_state
@@ -155,7 +155,7 @@ SELECT
   sum(ii.dur) as dur
 FROM thread_state
 JOIN
-  (SELECT * FROM _interval_intersect_single!(
+  (SELECT * FROM interval_intersect_single!(
     $ts, $dur,
     (SELECT id, ts, dur
     FROM thread_state
@@ -186,7 +186,7 @@ SELECT
     end_state,
     sum(ii.dur) AS dur
 FROM sched
-JOIN _interval_intersect_single!($ts, $dur, sched_for_cpu) ii
+JOIN interval_intersect_single!($ts, $dur, sched_for_cpu) ii
 USING (id)
 GROUP BY end_state;
 
@@ -41,7 +41,7 @@ thread_name,
 upid,
 process_name,
 SUM(ii.dur) AS cpu_time
-FROM _interval_intersect!((
+FROM interval_intersect!((
   (SELECT * FROM thread_slice WHERE utid > 0 AND dur > 0),
   (SELECT * FROM sched WHERE dur > 0)
   ), (utid)) ii
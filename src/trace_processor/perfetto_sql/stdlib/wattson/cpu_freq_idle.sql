@@ -58,7 +58,7 @@ CREATE PERFETTO TABLE _idle_freq_materialized
 AS
 SELECT
   ii.ts, ii.dur, ii.cpu, freq.policy, freq.freq, idle.idle, lut.curve_value
-FROM _interval_intersect!(
+FROM interval_intersect!(
   (
     _ii_subquery!(_valid_window),
     _ii_subquery!(_adjusted_cpu_freq),
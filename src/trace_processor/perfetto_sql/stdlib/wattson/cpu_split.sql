@@ -84,7 +84,7 @@ SELECT
   ii.ts,
   ii.dur,
   id_0 as cpu0_id, id_1 as cpu1_id, id_2 as cpu2_id, id_3 as cpu3_id
-FROM _interval_intersect!(
+FROM interval_intersect!(
   (
     _ii_subquery!(_stats_cpu0),
     _ii_subquery!(_stats_cpu1),
@@ -99,7 +99,7 @@ SELECT
   ii.ts,
   ii.dur,
   id_0 as cpu4_id, id_1 as cpu5_id, id_2 as cpu6_id, id_3 as cpu7_id
-FROM _interval_intersect!(
+FROM interval_intersect!(
   (
     _ii_subquery!(_stats_cpu4),
     _ii_subquery!(_stats_cpu5),
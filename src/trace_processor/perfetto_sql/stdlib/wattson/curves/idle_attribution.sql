@@ -53,7 +53,7 @@ WITH _ii_idle_threads AS (
     threads.utid,
     threads.upid,
     id_1 as idle_group
-  FROM _interval_intersect!(
+  FROM interval_intersect!(
     (
       _ii_table!(_thread_process_slices),
       _ii_table!(_idle_exits)
@@ -118,7 +118,7 @@ SELECT
     WHEN 7 THEN power.cpu7_mw
     ELSE 0
   END estimated_mw
-FROM _interval_intersect!(
+FROM interval_intersect!(
   (
     _ii_table!(_idle_w_threads),
     _ii_table!(_system_state_mw)
@@ -138,7 +138,7 @@ SELECT
   cost.utid,
   cost.upid,
   cost.cpu
-FROM _interval_intersect_single!(
+FROM interval_intersect_single!(
   $ts, $dur, _ii_table!(_idle_transition_cost)
 ) ii
 JOIN _idle_transition_cost as cost ON cost._auto_id = id;
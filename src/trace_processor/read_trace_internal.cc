@@ -24,6 +24,7 @@
 #include "perfetto/protozero/proto_utils.h"
 #include "perfetto/trace_processor/trace_processor.h"
 
+#include "perfetto/trace_processor/ref_counted.h"
 #include "perfetto/trace_processor/trace_blob.h"
 #include "perfetto/trace_processor/trace_blob_view.h"
 #include "src/trace_processor/forwarding_trace_parser.h"
@@ -84,14 +85,22 @@ util::Status ReadTraceUnfinalized(
     base::ScopedMmap mapped = base::ReadMmapWholeFile(filename);
     if (mapped.IsValid()) {
       size_t length = mapped.length();
-      TraceBlobView whole_mmap(TraceBlob::FromMmap(std::move(mapped)));
+      // All the slices below reference the same mapping: packets (and any
+      // other data retained by the importers) point straight into the mapped
+      // file rather than into heap copies, even when they straddle two slices.
+      // The mapping is held by a RefPtr rather than a TraceBlobView as the
+      // latter cannot represent files larger than 4GB.
+      RefPtr<TraceBlob> whole_mmap(
+          new TraceBlob(TraceBlob::FromMmap(std::move(mapped))));
       // Parse the file in chunks so we get some status update on stdio.
       static constexpr size_t kMmapChunkSize = 128ul * 1024 * 1024;
       while (bytes_read < length) {
-        progress_callback(bytes_read);
+        if (progress_callback)
+          progress_callback(bytes_read);
         const size_t bytes_read_z = static_cast<size_t>(bytes_read);
         size_t slice_size = std::min(length - bytes_read_z, kMmapChunkSize);
-        TraceBlobView slice = whole_mmap.slice_off(bytes_read_z, slice_size);
+        TraceBlobView slice(whole_mmap, bytes_read_z,
+                            static_cast<uint32_t>(slice_size));
         RETURN_IF_ERROR(tp->Parse(std::move(slice)));
         bytes_read += slice_size;
       }  // while (slices)
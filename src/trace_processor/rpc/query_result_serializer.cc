@@ -16,8 +16,13 @@
 
 #include "perfetto/ext/trace_processor/rpc/query_result_serializer.h"
 
+#include <cstring>
+#include <string>
+#include <utility>
 #include <vector>
 
+#include "perfetto/ext/base/flat_hash_map.h"
+#include "perfetto/ext/base/hash.h"
 #include "perfetto/protozero/packed_repeated_fields.h"
 #include "perfetto/protozero/proto_utils.h"
 #include "perfetto/protozero/scattered_heap_buffer.h"
@@ -32,9 +37,12 @@ namespace {
 
 namespace pu = ::protozero::proto_utils;
 using BatchProto = protos::pbzero::QueryResult::CellsBatch;
+using ColumnarBatchProto = protos::pbzero::QueryResult::ColumnarBatch;
+using ColumnProto = protos::pbzero::QueryResult::ColumnarBatch::Column;
 using ResultProto = protos::pbzero::QueryResult;
 
-// The reserved field in trace_processor.proto.
+// The reserved field in trace_processor.proto. This is the same for both
+// CellsBatch and ColumnarBatch.Column.
 static constexpr uint32_t kPaddingFieldId = 7;
 
 uint8_t MakeLenDelimTag(uint32_t field_num) {
@@ -43,10 +51,107 @@ uint8_t MakeLenDelimTag(uint32_t field_num) {
   return static_cast<uint8_t>(tag);
 }
 
+// Appends |size| bytes from |data| as the length-delimited field |field_num|
+// of |msg|. The payload is appended at a 64-bit aligned offset of |writer|, so
+// that JS can access it by overlaying a TypedArray, without extra copies.
+void AppendAligned(const protozero::ScatteredStreamWriter& writer,
+                   protozero::Message* msg,
+                   uint32_t field_num,
+                   const void* data,
+                   uint32_t size) {
+  uint8_t preamble[16];
+  uint8_t* preamble_end = &preamble[0];
+  *(preamble_end++) = MakeLenDelimTag(field_num);
+  preamble_end = pu::WriteVarInt(size, preamble_end);
+  uint32_t preamble_size = static_cast<uint32_t>(preamble_end - &preamble[0]);
+
+  // The byte after the preamble must start at a 64bit-aligned offset.
+  // The padding needs to be > 1 Byte because of proto encoding.
+  const uint32_t off = static_cast<uint32_t>(writer.written() + preamble_size);
+  const uint32_t aligned_off = (off + 7) & ~7u;
+  uint32_t padding = aligned_off - off;
+  padding = padding == 1 ? 9 : padding;
+  if (padding > 0) {
+    uint8_t pad_buf[10];
+    uint8_t* pad = pad_buf;
+    *(pad++) = pu::MakeTagVarInt(kPaddingFieldId);
+    for (uint32_t i = 0; i < padding - 2; i++)
+      *(pad++) = 0x80;
+    *(pad++) = 0;
+    msg->AppendRawProtoBytes(pad_buf, static_cast<size_t>(pad - pad_buf));
+  }
+  msg->AppendRawProtoBytes(preamble, preamble_size);
+  PERFETTO_CHECK(writer.written() % 8 == 0);
+  msg->AppendRawProtoBytes(data, size);
+}
+
+// Appends the blob in |value| to |blobs| as the length-delimited field
+// |field_num|. Returns the size of the blob.
+uint32_t AppendBlob(const SqlValue& value,
+                    uint32_t field_num,
+                    std::vector<uint8_t>* blobs) {
+  auto* src = static_cast<const uint8_t*>(value.bytes_value);
+  uint32_t len = static_cast<uint32_t>(value.bytes_count);
+  uint8_t preamble[16];
+  uint8_t* preamble_end = &preamble[0];
+  *(preamble_end++) = MakeLenDelimTag(field_num);
+  preamble_end = pu::WriteVarInt(len, preamble_end);
+  blobs->insert(blobs->end(), preamble, preamble_end);
+  blobs->insert(blobs->end(), src, src + len);
+  return len;
+}
+
+// The cells of one column of a ColumnarBatch, buffered while iterating.
+struct ColumnarColumn {
+  std::vector<uint8_t> cell_types;
+  std::vector<int64_t> int64_values;
+  std::vector<double> float64_values;
+  std::vector<uint32_t> string_ids;
+
+  // Already encoded |blob_values| fields (see SerializeBatch()).
+  std::vector<uint8_t> blobs;
+
+  bool has_mixed_types = false;
+};
+
+// The |string_dictionary| of a ColumnarBatch. Deduplicates strings by their
+// hash: on the (unlikely) event of a collision, the colliding string is just
+// added again with a new id.
+class ColumnarStringDictionary {
+ public:
+  // Returns the id of the |len_with_nul| bytes long string |str| and whether
+  // this was the first time the string was seen.
+  std::pair<uint32_t, bool> Intern(const char* str, uint32_t len_with_nul) {
+    base::Hasher hasher;
+    hasher.Update(str, len_with_nul);
+    auto id = static_cast<uint32_t>(offsets_.size());
+    auto [it, inserted] = ids_.Insert(hasher.digest(), id);
+    if (!inserted) {
+      uint32_t off = offsets_[*it];
+      if (data_.size() - off >= len_with_nul &&
+          memcmp(data_.data() + off, str, len_with_nul) == 0) {
+        return std::make_pair(*it, false);
+      }
+    }
+    offsets_.push_back(static_cast<uint32_t>(data_.size()));
+    data_.append(str, len_with_nul);
+    return std::make_pair(id, true);
+  }
+
+  const std::string& data() const { return data_; }
+
+ private:
+  base::FlatHashMap<uint64_t, uint32_t, base::AlreadyHashed<uint64_t>> ids_;
+  std::vector<uint32_t> offsets_;
+  std::string data_;
+};
+
 }  // namespace
 
-QueryResultSerializer::QueryResultSerializer(Iterator iter)
-    : iter_(iter.take_impl()), num_cols_(iter_->ColumnCount()) {}
+QueryResultSerializer::QueryResultSerializer(Iterator iter, Format format)
+    : iter_(iter.take_impl()),
+      num_cols_(iter_->ColumnCount()),
+      format_(format) {}
 
 QueryResultSerializer::~QueryResultSerializer() = default;
 
@@ -71,7 +176,11 @@ bool QueryResultSerializer::Serialize(protos::pbzero::QueryResult* res) {
   // write an empty batch with the EOF marker. Errors can happen also in the
   // middle of a query, not just before starting it.
 
-  SerializeBatch(res);
+  if (format_ == Format::kColumnar) {
+    SerializeColumnarBatch(res);
+  } else {
+    SerializeBatch(res);
+  }
   MaybeSerializeError(res);
   return !eof_reached_;
 }
@@ -172,14 +281,8 @@ void QueryResultSerializer::SerializeBatch(protos::pbzero::QueryResult* res) {
         // Each blob is stored as its own repeated proto field, unlike strings.
         // Blobs don't incur in text-decoding overhead (and are also rare).
         cell_type = BatchProto::CELL_BLOB;
-        auto* src = static_cast<const uint8_t*>(value.bytes_value);
-        uint32_t len = static_cast<uint32_t>(value.bytes_count);
-        uint8_t preamble[16];
-        uint8_t* preamble_end = &preamble[0];
-        *(preamble_end++) = MakeLenDelimTag(BatchProto::kBlobCellsFieldNumber);
-        preamble_end = pu::WriteVarInt(len, preamble_end);
-        blobs.insert(blobs.end(), preamble, preamble_end);
-        blobs.insert(blobs.end(), src, src + len);
+        uint32_t len =
+            AppendBlob(value, BatchProto::kBlobCellsFieldNumber, &blobs);
         approx_batch_size += len + 4;  // 4 is a guess on the preamble size.
         break;
       }
@@ -208,32 +311,9 @@ void QueryResultSerializer::SerializeBatch(protos::pbzero::QueryResult* res) {
   // a TypedArray, without extra copies.
   const uint32_t doubles_size = static_cast<uint32_t>(doubles.size());
   if (doubles_size > 0) {
-    uint8_t preamble[16];
-    uint8_t* preamble_end = &preamble[0];
-    *(preamble_end++) = MakeLenDelimTag(BatchProto::kFloat64CellsFieldNumber);
-    preamble_end = pu::WriteVarInt(doubles_size, preamble_end);
-    uint32_t preamble_size = static_cast<uint32_t>(preamble_end - &preamble[0]);
-
-    // The byte after the preamble must start at a 64bit-aligned offset.
-    // The padding needs to be > 1 Byte because of proto encoding.
-    const uint32_t off =
-        static_cast<uint32_t>(writer.written() + preamble_size);
-    const uint32_t aligned_off = (off + 7) & ~7u;
-    uint32_t padding = aligned_off - off;
-    padding = padding == 1 ? 9 : padding;
-    if (padding > 0) {
-      uint8_t pad_buf[10];
-      uint8_t* pad = pad_buf;
-      *(pad++) = pu::MakeTagVarInt(kPaddingFieldId);
-      for (uint32_t i = 0; i < padding - 2; i++)
-        *(pad++) = 0x80;
-      *(pad++) = 0;
-      batch->AppendRawProtoBytes(pad_buf, static_cast<size_t>(pad - pad_buf));
-    }
-    batch->AppendRawProtoBytes(preamble, preamble_size);
-    PERFETTO_CHECK(writer.written() % 8 == 0);
-    batch->AppendRawProtoBytes(doubles.data(), doubles_size);
-  }  // if (doubles_size > 0)
+    AppendAligned(writer, batch, BatchProto::kFloat64CellsFieldNumber,
+                  doubles.data(), doubles_size);
+  }
 
   // Append the blobs.
   if (blobs.size() > 0) {
@@ -250,6 +330,128 @@ void QueryResultSerializer::SerializeBatch(protos::pbzero::QueryResult* res) {
   batch->Finalize();
 }
 
+void QueryResultSerializer::SerializeColumnarBatch(
+    protos::pbzero::QueryResult* res) {
+  // Unlike SerializeBatch(), nothing can be written until the whole batch has
+  // been iterated, as each column is a contiguous array in the output. So all
+  // the cells are buffered, column by column, and appended at the end.
+
+  const auto& writer = *res->stream_writer();
+  std::vector<ColumnarColumn> columns(num_cols_);
+  ColumnarStringDictionary strings;
+
+  // See SerializeBatch().
+  uint32_t approx_batch_size = 16;
+  uint32_t cell_idx = 0;
+  bool batch_full = false;
+
+  // The row / column iteration logic must be kept in sync with
+  // SerializeBatch().
+  for (;; ++cell_idx, ++col_) {
+    if (col_ >= num_cols_) {
+      col_ = 0;
+      if (!iter_->Next())
+        break;  // EOF or error.
+
+      PERFETTO_DCHECK(num_cols_ > 0);
+      if (cell_idx + num_cols_ > cells_per_batch_ ||
+          approx_batch_size > batch_split_threshold_) {
+        batch_full = true;
+        break;
+      }
+    }
+
+    ColumnarColumn& column = columns[col_];
+    auto value = iter_->Get(col_);
+    uint8_t cell_type = BatchProto::CELL_INVALID;
+    switch (value.type) {
+      case SqlValue::Type::kNull: {
+        cell_type = BatchProto::CELL_NULL;
+        break;
+      }
+      case SqlValue::Type::kLong: {
+        cell_type = BatchProto::CELL_VARINT;
+        column.int64_values.push_back(value.long_value);
+        approx_batch_size += sizeof(int64_t);
+        break;
+      }
+      case SqlValue::Type::kDouble: {
+        cell_type = BatchProto::CELL_FLOAT64;
+        column.float64_values.push_back(value.double_value);
+        approx_batch_size += sizeof(double);
+        break;
+      }
+      case SqlValue::Type::kString: {
+        cell_type = BatchProto::CELL_STRING;
+        uint32_t len_with_nul =
+            static_cast<uint32_t>(strlen(value.string_value)) + 1;
+        auto [id, is_new] = strings.Intern(value.string_value, len_with_nul);
+        column.string_ids.push_back(id);
+        approx_batch_size += sizeof(uint32_t) + (is_new ? len_with_nul : 0);
+        break;
+      }
+      case SqlValue::Type::kBytes: {
+        cell_type = BatchProto::CELL_BLOB;
+        uint32_t len = AppendBlob(value, ColumnProto::kBlobValuesFieldNumber,
+                                  &column.blobs);
+        approx_batch_size += len + 4;  // 4 is a guess on the preamble size.
+        break;
+      }
+    }
+
+    PERFETTO_DCHECK(cell_type != BatchProto::CELL_INVALID);
+    if (!column.cell_types.empty() && column.cell_types[0] != cell_type)
+      column.has_mixed_types = true;
+    column.cell_types.push_back(cell_type);
+  }  // for (cell)
+
+  auto* batch = res->add_columnar_batch();
+  const uint32_t row_count = num_cols_ > 0 ? cell_idx / num_cols_ : 0;
+  batch->set_row_count(row_count);
+  for (const ColumnarColumn& column : columns) {
+    auto* col = batch->add_columns();
+    if (column.has_mixed_types) {
+      col->AppendBytes(ColumnProto::kCellTypesFieldNumber,
+                       column.cell_types.data(), column.cell_types.size());
+    } else if (row_count > 0) {
+      col->set_type(static_cast<BatchProto::CellType>(column.cell_types[0]));
+    }
+    if (!column.int64_values.empty()) {
+      AppendAligned(
+          writer, col, ColumnProto::kInt64ValuesFieldNumber,
+          column.int64_values.data(),
+          static_cast<uint32_t>(column.int64_values.size() * sizeof(int64_t)));
+    }
+    if (!column.float64_values.empty()) {
+      AppendAligned(
+          writer, col, ColumnProto::kFloat64ValuesFieldNumber,
+          column.float64_values.data(),
+          static_cast<uint32_t>(column.float64_values.size() * sizeof(double)));
+    }
+    if (!column.string_ids.empty()) {
+      AppendAligned(
+          writer, col, ColumnProto::kStringIdsFieldNumber,
+          column.string_ids.data(),
+          static_cast<uint32_t>(column.string_ids.size() * sizeof(uint32_t)));
+    }
+    if (!column.blobs.empty())
+      col->AppendRawProtoBytes(column.blobs.data(), column.blobs.size());
+    col->Finalize();
+  }
+
+  if (!strings.data().empty()) {
+    batch->AppendBytes(ColumnarBatchProto::kStringDictionaryFieldNumber,
+                       strings.data().data(), strings.data().size());
+  }
+
+  // If this is the last batch, write the EOF field.
+  if (!batch_full) {
+    eof_reached_ = true;
+    batch->set_is_last_batch(true);
+  }
+  batch->Finalize();
+}
+
 void QueryResultSerializer::MaybeSerializeError(
     protos::pbzero::QueryResult* res) {
   if (iter_->Status().ok())
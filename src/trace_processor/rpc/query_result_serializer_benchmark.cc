@@ -40,6 +40,10 @@ void BenchmarkArgs(benchmark::internal::Benchmark* b) {
   }
 }
 
+void FormatArgs(benchmark::internal::Benchmark* b) {
+  b->ArgNames({"columnar"})->Arg(0)->Arg(1);
+}
+
 void RunQueryChecked(TraceProcessor* tp, const std::string& query) {
   auto iter = tp->ExecuteQuery(query);
   iter.Next();
@@ -92,5 +96,35 @@ static void BM_QueryResultSerializer_Strings(benchmark::State& state) {
   benchmark::ClobberMemory();
 }
 
+// Compares the serialization time and the bytes on the wire of the two
+// formats on a result resembling the slice table, where many rows repeat the
+// same few strings.
+static void BM_QueryResultSerializer_Format(benchmark::State& state) {
+  auto tp = TraceProcessor::CreateInstance(Config());
+  RunQueryChecked(tp.get(), "create virtual table win using window;");
+  RunQueryChecked(tp.get(),
+                  "update win set window_start=0, window_dur=100000, quantum=1 "
+                  "where rowid = 0");
+  auto format = state.range(0) ? QueryResultSerializer::Format::kColumnar
+                               : QueryResultSerializer::Format::kCells;
+  VectorType buf;
+  size_t bytes = 0;
+  for (auto _ : state) {
+    auto iter = tp->ExecuteQuery(
+        "select ts, dur * 1000 as dur, ts % 16 as depth, 'slice_' || (ts % 64) "
+        "as name, 'thread_' || (ts % 8) as thread_name, dur * 1.5 as value "
+        "from win");
+    QueryResultSerializer serializer(std::move(iter), format);
+    while (serializer.Serialize(&buf)) {
+    }
+    benchmark::DoNotOptimize(buf.data());
+    bytes = buf.size();
+    buf.clear();
+  }
+  benchmark::ClobberMemory();
+  state.counters["bytes"] = static_cast<double>(bytes);
+}
+
 BENCHMARK(BM_QueryResultSerializer_Mixed)->Apply(BenchmarkArgs);
 BENCHMARK(BM_QueryResultSerializer_Strings)->Apply(BenchmarkArgs);
+BENCHMARK(BM_QueryResultSerializer_Format)->Apply(FormatArgs);
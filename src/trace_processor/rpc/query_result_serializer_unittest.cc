@@ -89,17 +89,46 @@ class TestDeserializer {
   std::vector<SqlValue> cells;
   std::string error;
   bool eof_reached = false;
+  size_t serialized_size = 0;
 
  private:
+  // The payloads of the non-NULL cells of a CellsBatch or of a
+  // ColumnarBatch.Column, in order.
+  struct Payloads {
+    std::deque<int64_t> varints;
+    std::deque<double> doubles;
+    std::deque<std::string> strings;
+    std::deque<std::string> blobs;
+  };
+
+  void DeserializeCellsBatch(protozero::ConstBytes);
+  void DeserializeColumnarBatch(protozero::ConstBytes);
+  void DeserializeCell(uint8_t cell_type,
+                       Payloads*,
+                       std::vector<SqlValue>* out);
+
   std::vector<std::unique_ptr<char[]>> copied_buf_;
 };
 
+// Splits a string of NUL-terminated strings.
+std::deque<std::string> SplitNulTerminated(const std::string& merged_strings) {
+  std::deque<std::string> strings;
+  for (size_t pos = 0; pos < merged_strings.size();) {
+    // Will return npos for the last string, but it's fine
+    size_t next_sep = merged_strings.find('\0', pos);
+    strings.emplace_back(merged_strings.substr(pos, next_sep - pos));
+    pos = next_sep == std::string::npos ? next_sep : next_sep + 1;
+  }
+  return strings;
+}
+
 void TestDeserializer::SerializeAndDeserialize(
     QueryResultSerializer* serializer) {
   std::vector<uint8_t> buf;
   error.clear();
   for (eof_reached = false; !eof_reached;) {
     serializer->Serialize(&buf);
+    serialized_size += buf.size();
     DeserializeBuffer(buf.data(), buf.size());
     buf.clear();
   }
@@ -113,83 +142,137 @@ void TestDeserializer::DeserializeBuffer(const uint8_t* start, size_t size) {
 
   for (auto batch_it = result.batch(); batch_it; ++batch_it) {
     ASSERT_FALSE(eof_reached);
-    auto batch_bytes = batch_it->as_bytes();
+    DeserializeCellsBatch(batch_it->as_bytes());
+  }
+  for (auto batch_it = result.columnar_batch(); batch_it; ++batch_it) {
+    ASSERT_FALSE(eof_reached);
+    DeserializeColumnarBatch(batch_it->as_bytes());
+  }
+}
 
-    ResultProto::CellsBatch::Decoder batch(batch_bytes.data, batch_bytes.size);
-    eof_reached = batch.is_last_batch();
-    std::deque<int64_t> varints;
-    std::deque<double> doubles;
-    std::deque<std::string> blobs;
+void TestDeserializer::DeserializeCellsBatch(protozero::ConstBytes bytes) {
+  ResultProto::CellsBatch::Decoder batch(bytes.data, bytes.size);
+  eof_reached = batch.is_last_batch();
+  Payloads payloads;
+
+  bool parse_error = false;
+  for (auto it = batch.varint_cells(&parse_error); it; ++it)
+    payloads.varints.emplace_back(*it);
+
+  for (auto it = batch.float64_cells(&parse_error); it; ++it)
+    payloads.doubles.emplace_back(*it);
+
+  for (auto it = batch.blob_cells(); it; ++it)
+    payloads.blobs.emplace_back((*it).ToStdString());
+
+  payloads.strings = SplitNulTerminated(batch.string_cells().ToStdString());
+
+  uint32_t num_cells = 0;
+  for (auto it = batch.cells(&parse_error); it; ++it, ++num_cells) {
+    DeserializeCell(static_cast<uint8_t>(*it), &payloads, &cells);
+    EXPECT_FALSE(parse_error);
+  }
+  if (columns.empty()) {
+    EXPECT_EQ(num_cells, 0u);
+  } else {
+    EXPECT_EQ(num_cells % columns.size(), 0u);
+  }
+}
+
+void TestDeserializer::DeserializeColumnarBatch(protozero::ConstBytes bytes) {
+  ResultProto::ColumnarBatch::Decoder batch(bytes.data, bytes.size);
+  eof_reached = batch.is_last_batch();
+  const uint32_t row_count = batch.row_count();
+  std::deque<std::string> dictionary =
+      SplitNulTerminated(batch.string_dictionary().ToStdString());
+
+  std::vector<std::vector<SqlValue>> column_cells;
+  for (auto col_it = batch.columns(); col_it; ++col_it) {
+    ResultProto::ColumnarBatch::Column::Decoder col(*col_it);
+    Payloads payloads;
 
     bool parse_error = false;
-    for (auto it = batch.varint_cells(&parse_error); it; ++it)
-      varints.emplace_back(*it);
+    for (auto it = col.int64_values(&parse_error); it; ++it)
+      payloads.varints.emplace_back(*it);
 
-    for (auto it = batch.float64_cells(&parse_error); it; ++it)
-      doubles.emplace_back(*it);
+    for (auto it = col.float64_values(&parse_error); it; ++it)
+      payloads.doubles.emplace_back(*it);
 
-    for (auto it = batch.blob_cells(); it; ++it)
-      blobs.emplace_back((*it).ToStdString());
+    for (auto it = col.blob_values(); it; ++it)
+      payloads.blobs.emplace_back((*it).ToStdString());
 
-    std::string merged_strings = batch.string_cells().ToStdString();
-    std::deque<std::string> strings;
-    for (size_t pos = 0; pos < merged_strings.size();) {
-      // Will return npos for the last string, but it's fine
-      size_t next_sep = merged_strings.find('\0', pos);
-      strings.emplace_back(merged_strings.substr(pos, next_sep - pos));
-      pos = next_sep == std::string::npos ? next_sep : next_sep + 1;
+    for (auto it = col.string_ids(&parse_error); it; ++it) {
+      ASSERT_LT(*it, dictionary.size());
+      payloads.strings.emplace_back(dictionary[*it]);
     }
 
-    uint32_t num_cells = 0;
-    for (auto it = batch.cells(&parse_error); it; ++it, ++num_cells) {
-      uint8_t cell_type = static_cast<uint8_t>(*it);
-      switch (cell_type) {
-        case BatchProto::CELL_INVALID:
-          break;
-        case BatchProto::CELL_NULL:
-          cells.emplace_back(SqlValue());
-          break;
-        case BatchProto::CELL_VARINT:
-          ASSERT_GT(varints.size(), 0u);
-          cells.emplace_back(SqlValue::Long(varints.front()));
-          varints.pop_front();
-          break;
-        case BatchProto::CELL_FLOAT64:
-          ASSERT_GT(doubles.size(), 0u);
-          cells.emplace_back(SqlValue::Double(doubles.front()));
-          doubles.pop_front();
-          break;
-        case BatchProto::CELL_STRING: {
-          ASSERT_GT(strings.size(), 0u);
-          const std::string& str = strings.front();
-          copied_buf_.emplace_back(new char[str.size() + 1]);
-          char* new_buf = copied_buf_.back().get();
-          memcpy(new_buf, str.c_str(), str.size() + 1);
-          cells.emplace_back(SqlValue::String(new_buf));
-          strings.pop_front();
-          break;
-        }
-        case BatchProto::CELL_BLOB: {
-          ASSERT_GT(blobs.size(), 0u);
-          auto bytes = blobs.front();
-          copied_buf_.emplace_back(new char[bytes.size()]);
-          memcpy(copied_buf_.back().get(), bytes.data(), bytes.size());
-          cells.emplace_back(
-              SqlValue::Bytes(copied_buf_.back().get(), bytes.size()));
-          blobs.pop_front();
-          break;
-        }
-        default:
-          FAIL() << "Unknown cell type " << cell_type;
-      }
+    std::vector<uint8_t> cell_types;
+    if (col.has_type()) {
+      cell_types.resize(row_count, static_cast<uint8_t>(col.type()));
+    } else {
+      for (auto it = col.cell_types(&parse_error); it; ++it)
+        cell_types.push_back(static_cast<uint8_t>(*it));
+    }
+    EXPECT_FALSE(parse_error);
+    ASSERT_EQ(cell_types.size(), row_count);
+
+    column_cells.emplace_back();
+    for (uint8_t cell_type : cell_types)
+      DeserializeCell(cell_type, &payloads, &column_cells.back());
+    EXPECT_TRUE(payloads.varints.empty());
+    EXPECT_TRUE(payloads.doubles.empty());
+    EXPECT_TRUE(payloads.strings.empty());
+    EXPECT_TRUE(payloads.blobs.empty());
+  }
+  ASSERT_EQ(column_cells.size(), columns.size());
 
-      EXPECT_FALSE(parse_error);
+  for (uint32_t row = 0; row < row_count; row++) {
+    for (const auto& col : column_cells)
+      cells.emplace_back(col[row]);
+  }
+}
+
+void TestDeserializer::DeserializeCell(uint8_t cell_type,
+                                       Payloads* payloads,
+                                       std::vector<SqlValue>* out) {
+  switch (cell_type) {
+    case BatchProto::CELL_INVALID:
+      break;
+    case BatchProto::CELL_NULL:
+      out->emplace_back(SqlValue());
+      break;
+    case BatchProto::CELL_VARINT:
+      ASSERT_GT(payloads->varints.size(), 0u);
+      out->emplace_back(SqlValue::Long(payloads->varints.front()));
+      payloads->varints.pop_front();
+      break;
+    case BatchProto::CELL_FLOAT64:
+      ASSERT_GT(payloads->doubles.size(), 0u);
+      out->emplace_back(SqlValue::Double(payloads->doubles.front()));
+      payloads->doubles.pop_front();
+      break;
+    case BatchProto::CELL_STRING: {
+      ASSERT_GT(payloads->strings.size(), 0u);
+      const std::string& str = payloads->strings.front();
+      copied_buf_.emplace_back(new char[str.size() + 1]);
+      char* new_buf = copied_buf_.back().get();
+      memcpy(new_buf, str.c_str(), str.size() + 1);
+      out->emplace_back(SqlValue::String(new_buf));
+      payloads->strings.pop_front();
+      break;
     }
-    if (columns.empty()) {
-      EXPECT_EQ(num_cells, 0u);
-    } else {
-      EXPECT_EQ(num_cells % columns.size(), 0u);
+    case BatchProto::CELL_BLOB: {
+      ASSERT_GT(payloads->blobs.size(), 0u);
+      auto bytes = payloads->blobs.front();
+      copied_buf_.emplace_back(new char[bytes.size()]);
+      memcpy(copied_buf_.back().get(), bytes.data(), bytes.size());
+      out->emplace_back(
+          SqlValue::Bytes(copied_buf_.back().get(), bytes.size()));
+      payloads->blobs.pop_front();
+      break;
     }
+    default:
+      FAIL() << "Unknown cell type " << cell_type;
   }
 }
 
@@ -212,6 +295,26 @@ TEST(QueryResultSerializerTest, ShortBatch) {
                           SqlValue::Bytes("a_blob", 6)));
 }
 
+TEST(QueryResultSerializerTest, ColumnarShortBatch) {
+  auto tp = TraceProcessor::CreateInstance(trace_processor::Config());
+
+  auto iter = tp->ExecuteQuery(
+      "select 1 as i8, 128 as i16, 100000 as i32, 42001001001 as i64, 1e9 as "
+      "f64, 'a_string' as str, cast('a_blob' as blob) as blb, null as nul");
+  QueryResultSerializer ser(std::move(iter),
+                            QueryResultSerializer::Format::kColumnar);
+  TestDeserializer deser;
+  deser.SerializeAndDeserialize(&ser);
+
+  EXPECT_THAT(deser.columns, ElementsAre("i8", "i16", "i32", "i64", "f64",
+                                         "str", "blb", "nul"));
+  EXPECT_THAT(deser.cells,
+              ElementsAre(SqlValue::Long(1), SqlValue::Long(128),
+                          SqlValue::Long(100000), SqlValue::Long(42001001001),
+                          SqlValue::Double(1e9), SqlValue::String("a_string"),
+                          SqlValue::Bytes("a_blob", 6), SqlValue()));
+}
+
 TEST(QueryResultSerializerTest, LongBatch) {
   auto tp = TraceProcessor::CreateInstance(trace_processor::Config());
 
@@ -245,6 +348,49 @@ TEST(QueryResultSerializerTest, LongBatch) {
   }
 }
 
+TEST(QueryResultSerializerTest, ColumnarDeduplicatesStrings) {
+  auto tp = TraceProcessor::CreateInstance(trace_processor::Config());
+
+  RunQueryChecked(tp.get(), "create virtual table win using window;");
+  RunQueryChecked(tp.get(),
+                  "update win set window_start=0, window_dur=8192, quantum=1 "
+                  "where rowid = 0");
+
+  const char kQuery[] =
+      "select 'main_thread_' || (ts % 4) as name, ts, dur * 1.0 as dur "
+      "from win";
+  TestDeserializer cells_deser;
+  {
+    QueryResultSerializer ser(tp->ExecuteQuery(kQuery));
+    cells_deser.SerializeAndDeserialize(&ser);
+  }
+
+  // Check that each string is stored only once per batch.
+  QueryResultSerializer ser(tp->ExecuteQuery(kQuery),
+                            QueryResultSerializer::Format::kColumnar);
+  std::vector<uint8_t> buf;
+  ser.Serialize(&buf);
+  ResultProto::Decoder result(buf.data(), buf.size());
+  ASSERT_TRUE(result.has_columnar_batch());
+  auto batch_bytes = result.columnar_batch()->as_bytes();
+  ResultProto::ColumnarBatch::Decoder batch(batch_bytes.data,
+                                            batch_bytes.size);
+  EXPECT_EQ(batch.string_dictionary().ToStdString(),
+            std::string("main_thread_0\0main_thread_1\0main_thread_2\0"
+                        "main_thread_3\0",
+                        56));
+
+  TestDeserializer columnar_deser;
+  columnar_deser.DeserializeBuffer(buf.data(), buf.size());
+  ASSERT_FALSE(columnar_deser.eof_reached);
+  columnar_deser.SerializeAndDeserialize(&ser);
+  EXPECT_EQ(columnar_deser.columns, cells_deser.columns);
+  ASSERT_EQ(columnar_deser.cells.size(), 3 * 8192u);
+  EXPECT_EQ(columnar_deser.cells, cells_deser.cells);
+  EXPECT_LT(columnar_deser.serialized_size + buf.size(),
+            cells_deser.serialized_size);
+}
+
 TEST(QueryResultSerializerTest, BatchSaturatingBinaryPayload) {
   auto tp = TraceProcessor::CreateInstance(trace_processor::Config());
 
@@ -385,10 +531,13 @@ TEST(QueryResultSerializerTest, RandomSizes) {
     }
   }
 
-  // Serialize and de-serialize with different batch and payload sizes.
+  // Serialize and de-serialize with different batch and payload sizes, using
+  // both formats.
   for (int rep = 0; rep < 10; rep++) {
     auto iter = tp->ExecuteQuery("select * from tab");
-    QueryResultSerializer ser(std::move(iter));
+    QueryResultSerializer ser(std::move(iter),
+                              rep % 2 ? QueryResultSerializer::Format::kColumnar
+                                      : QueryResultSerializer::Format::kCells);
     uint32_t cells_per_batch = 1 << (rnd_engine() % 8 + 2);
     uint32_t binary_payload_size = 1 << (rnd_engine() % 8 + 8);
     ser.set_batch_size_for_testing(cells_per_batch, binary_payload_size);
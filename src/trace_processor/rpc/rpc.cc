@@ -95,6 +95,15 @@ void Response::Send(Rpc::RpcResponseFunction send_fn) {
   }
 }
 
+QueryResultSerializer::Format GetResultFormat(
+    const protos::pbzero::QueryArgs::Decoder& query) {
+  if (query.result_format() ==
+      protos::pbzero::QueryArgs::RESULT_FORMAT_COLUMNAR) {
+    return QueryResultSerializer::Format::kColumnar;
+  }
+  return QueryResultSerializer::Format::kCells;
+}
+
 }  // namespace
 
 Rpc::Rpc(std::unique_ptr<TraceProcessor> preloaded_instance)
@@ -236,7 +245,7 @@ void Rpc::ParseRpcRequest(const uint8_t* data, size_t len) {
                           });
 
         auto it = trace_processor_->ExecuteQuery(sql);
-        QueryResultSerializer serializer(std::move(it));
+        QueryResultSerializer serializer(std::move(it), GetResultFormat(query));
         for (bool has_more = true; has_more;) {
           const auto seq_id = tx_seq_id_++;
           Response resp(seq_id, req_type);
@@ -334,6 +343,26 @@ void Rpc::ParseRpcRequest(const uint8_t* data, size_t len) {
       resp.Send(rpc_response_fn_);
       break;
     }
+    case RpcProto::TPM_SAVE_SNAPSHOT: {
+      Response resp(tx_seq_id_++, req_type);
+      base::Status status = SaveSnapshot(req.snapshot_args());
+      auto* res = resp->set_snapshot_result();
+      if (!status.ok()) {
+        res->set_error(status.message());
+      }
+      resp.Send(rpc_response_fn_);
+      break;
+    }
+    case RpcProto::TPM_LOAD_SNAPSHOT: {
+      Response resp(tx_seq_id_++, req_type);
+      base::Status status = LoadSnapshot(req.snapshot_args());
+      auto* res = resp->set_snapshot_result();
+      if (!status.ok()) {
+        res->set_error(status.message());
+      }
+      resp.Send(rpc_response_fn_);
+      break;
+    }
     default: {
       // This can legitimately happen if the client is newer. We reply with a
       // generic "unkown request" response, so the client can do feature
@@ -422,6 +451,23 @@ base::Status Rpc::RegisterSqlPackage(protozero::ConstBytes bytes) {
   return trace_processor_->RegisterSqlPackage(package);
 }
 
+base::Status Rpc::SaveSnapshot(protozero::ConstBytes bytes) {
+  protos::pbzero::SnapshotArgs::Decoder args(bytes);
+  return trace_processor_->SaveSnapshot(args.path().ToStdString());
+}
+
+base::Status Rpc::LoadSnapshot(protozero::ConstBytes bytes) {
+  protos::pbzero::SnapshotArgs::Decoder args(bytes);
+  // Snapshots can only be loaded into a pristine instance: reset the trace
+  // processor state if any trace data was previously received.
+  if (eof_ || bytes_parsed_ > 0) {
+    ResetTraceProcessorInternal(trace_processor_config_);
+  }
+  RETURN_IF_ERROR(trace_processor_->LoadSnapshot(args.path().ToStdString()));
+  eof_ = true;
+  return base::OkStatus();
+}
+
 void Rpc::MaybePrintProgress() {
   if (eof_ || bytes_parsed_ - bytes_last_progress_ > kProgressUpdateBytes) {
     bytes_last_progress_ = bytes_parsed_;
@@ -451,7 +497,7 @@ void Rpc::Query(const uint8_t* args,
 
   auto it = trace_processor_->ExecuteQuery(sql);
 
-  QueryResultSerializer serializer(std::move(it));
+  QueryResultSerializer serializer(std::move(it), GetResultFormat(query));
 
   std::vector<uint8_t> res;
   for (bool has_more = true; has_more;) {
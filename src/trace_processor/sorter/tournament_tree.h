@@ -0,0 +1,125 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_TRACE_PROCESSOR_SORTER_TOURNAMENT_TREE_H_
+#define SRC_TRACE_PROCESSOR_SORTER_TOURNAMENT_TREE_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include "perfetto/base/logging.h"
+
+namespace perfetto::trace_processor {
+
+// A tournament (winner) tree over a fixed number of leaves, each keyed by an
+// optional int64_t. Used by TraceSorter to find the queue holding the earliest
+// event in O(log(n)) rather than by scanning all the queues.
+//
+// Leaves without a key (i.e. empty queues) never win against a leaf with a
+// key. Ties between equal keys are broken in favour of the leaf with the lower
+// index: this matches the behaviour of a linear scan using a strict "<".
+class TournamentTree {
+ public:
+  // Rebuilds the tree in O(n) so that leaf i has key |keys[i]|.
+  void Reset(const std::vector<std::optional<int64_t>>& keys) {
+    capacity_ = 1;
+    while (capacity_ < keys.size()) {
+      capacity_ *= 2;
+    }
+    keys_.assign(capacity_, std::nullopt);
+    std::copy(keys.begin(), keys.end(), keys_.begin());
+
+    nodes_.resize(2 * capacity_);
+    for (size_t i = 0; i < capacity_; ++i) {
+      nodes_[capacity_ + i] = i;
+    }
+    for (size_t i = capacity_ - 1; i > 0; --i) {
+      nodes_[i] = Match(nodes_[2 * i], nodes_[2 * i + 1]);
+    }
+  }
+
+  // Changes the key of |leaf| and replays the matches on its path to the root.
+  void Update(size_t leaf, std::optional<int64_t> key) {
+    PERFETTO_DCHECK(leaf < capacity_);
+    keys_[leaf] = key;
+    for (size_t i = (capacity_ + leaf) / 2; i > 0; i /= 2) {
+      nodes_[i] = Match(nodes_[2 * i], nodes_[2 * i + 1]);
+    }
+  }
+
+  // Returns the index of the leaf with the smallest key or std::nullopt if no
+  // leaf has a key.
+  std::optional<size_t> Winner() const {
+    if (nodes_.empty() || !keys_[nodes_[1]]) {
+      return std::nullopt;
+    }
+    return nodes_[1];
+  }
+
+  // Returns the smallest key among all leaves other than |Winner()| or
+  // std::nullopt if there is no such key.
+  //
+  // The runner-up must have lost directly against the winner so it is enough
+  // to look at the winners of the sibling subtrees on the path from the
+  // winner to the root.
+  std::optional<int64_t> RunnerUpKey() const {
+    std::optional<size_t> winner = Winner();
+    if (!winner) {
+      return std::nullopt;
+    }
+    std::optional<size_t> best;
+    for (size_t i = capacity_ + *winner; i > 1; i /= 2) {
+      size_t candidate = nodes_[i ^ 1];
+      if (!best || Beats(candidate, *best)) {
+        best = candidate;
+      }
+    }
+    return best ? keys_[*best] : std::nullopt;
+  }
+
+ private:
+  bool Beats(size_t a, size_t b) const {
+    const std::optional<int64_t>& a_key = keys_[a];
+    const std::optional<int64_t>& b_key = keys_[b];
+    if (!a_key) {
+      return false;
+    }
+    if (!b_key) {
+      return true;
+    }
+    return *a_key < *b_key || (*a_key == *b_key && a < b);
+  }
+
+  size_t Match(size_t a, size_t b) const { return Beats(b, a) ? b : a; }
+
+  size_t capacity_ = 0;
+
+  // |keys_[i]| is the key of leaf i. Leaves in [n, capacity_) are padding and
+  // never have a key.
+  std::vector<std::optional<int64_t>> keys_;
+
+  // Implicit binary tree: |nodes_[1]| is the root, the children of node i are
+  // 2i and 2i+1 and |nodes_[capacity_ + i]| is leaf i. Each node stores the
+  // index of the leaf which won the match played at that node.
+  std::vector<size_t> nodes_;
+};
+
+}  // namespace perfetto::trace_processor
+
+#endif  // SRC_TRACE_PROCESSOR_SORTER_TOURNAMENT_TREE_H_
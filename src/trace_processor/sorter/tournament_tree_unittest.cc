@@ -0,0 +1,110 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "src/trace_processor/sorter/tournament_tree.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <random>
+#include <vector>
+
+#include "test/gtest_and_gmock.h"
+
+namespace perfetto::trace_processor {
+namespace {
+
+TEST(TournamentTreeTest, Empty) {
+  TournamentTree tree;
+  tree.Reset({});
+  ASSERT_EQ(tree.Winner(), std::nullopt);
+  ASSERT_EQ(tree.RunnerUpKey(), std::nullopt);
+}
+
+TEST(TournamentTreeTest, SingleLeaf) {
+  TournamentTree tree;
+  tree.Reset({10});
+  ASSERT_EQ(tree.Winner(), 0u);
+  ASSERT_EQ(tree.RunnerUpKey(), std::nullopt);
+
+  tree.Update(0, std::nullopt);
+  ASSERT_EQ(tree.Winner(), std::nullopt);
+}
+
+TEST(TournamentTreeTest, EmptyLeavesNeverWin) {
+  TournamentTree tree;
+  tree.Reset({std::nullopt, 30, std::nullopt, 20, std::nullopt});
+  ASSERT_EQ(tree.Winner(), 3u);
+  ASSERT_EQ(tree.RunnerUpKey(), 30);
+
+  tree.Update(3, std::nullopt);
+  ASSERT_EQ(tree.Winner(), 1u);
+  ASSERT_EQ(tree.RunnerUpKey(), std::nullopt);
+}
+
+TEST(TournamentTreeTest, TiesGoToLowerIndex) {
+  TournamentTree tree;
+  tree.Reset({20, 10, 10, 15, 10});
+  ASSERT_EQ(tree.Winner(), 1u);
+  ASSERT_EQ(tree.RunnerUpKey(), 10);
+
+  tree.Update(1, 25);
+  ASSERT_EQ(tree.Winner(), 2u);
+  ASSERT_EQ(tree.RunnerUpKey(), 10);
+
+  tree.Update(2, 25);
+  ASSERT_EQ(tree.Winner(), 4u);
+  ASSERT_EQ(tree.RunnerUpKey(), 15);
+}
+
+// Checks the tree against a linear scan over random keys and updates.
+TEST(TournamentTreeTest, MatchesLinearScan) {
+  std::minstd_rand0 rnd_engine(0);
+  for (size_t n : {2u, 3u, 7u, 8u, 9u, 33u, 129u}) {
+    std::vector<std::optional<int64_t>> keys(n);
+    for (auto& key : keys) {
+      if (rnd_engine() % 4)
+        key = static_cast<int64_t>(rnd_engine() % 16);
+    }
+    TournamentTree tree;
+    tree.Reset(keys);
+
+    for (uint32_t i = 0; i < 1000; ++i) {
+      std::optional<size_t> winner;
+      for (size_t j = 0; j < n; ++j) {
+        if (keys[j] && (!winner || *keys[j] < *keys[*winner]))
+          winner = j;
+      }
+      std::optional<int64_t> runner_up;
+      for (size_t j = 0; j < n; ++j) {
+        if (j != winner && keys[j] && (!runner_up || *keys[j] < *runner_up))
+          runner_up = keys[j];
+      }
+      ASSERT_EQ(tree.Winner(), winner);
+      ASSERT_EQ(tree.RunnerUpKey(), runner_up);
+
+      size_t leaf = rnd_engine() % n;
+      std::optional<int64_t> key;
+      if (rnd_engine() % 4)
+        key = static_cast<int64_t>(rnd_engine() % 16);
+      keys[leaf] = key;
+      tree.Update(leaf, key);
+    }
+  }
+}
+
+}  // namespace
+}  // namespace perfetto::trace_processor
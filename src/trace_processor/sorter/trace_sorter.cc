@@ -21,7 +21,9 @@
 #include <cstring>
 #include <limits>
 #include <memory>
+#include <optional>
 #include <utility>
+#include <vector>
 
 #include "perfetto/base/compiler.h"
 #include "perfetto/base/logging.h"
@@ -35,18 +37,26 @@
 #include "src/trace_processor/importers/gecko/gecko_event.h"
 #include "src/trace_processor/importers/instruments/row.h"
 #include "src/trace_processor/importers/perf/record.h"
+#include "src/trace_processor/sorter/tournament_tree.h"
 #include "src/trace_processor/sorter/trace_sorter.h"
 #include "src/trace_processor/sorter/trace_token_buffer.h"
 #include "src/trace_processor/storage/stats.h"
 #include "src/trace_processor/types/trace_processor_context.h"
 #include "src/trace_processor/util/bump_allocator.h"
+#include "src/trace_processor/util/parallel_for.h"
 
 namespace perfetto::trace_processor {
 
 TraceSorter::TraceSorter(TraceProcessorContext* context,
                          SortingMode sorting_mode)
-    : sorting_mode_(sorting_mode), storage_(context->storage) {
+    : sorting_mode_(sorting_mode),
+      storage_(context->storage),
+      thread_pool_(context->thread_pool.get()),
+      thread_count_(context->config.ingestion_thread_count) {
   AddMachineContext(context);
+  if (context->config.compress_sorter_buffer) {
+    token_buffer_.EnablePacketCompression();
+  }
   const char* env = getenv("TRACE_PROCESSOR_SORT_ONLY");
   bypass_next_stage_for_testing_ = env && !strcmp(env, "1");
   if (bypass_next_stage_for_testing_)
@@ -108,7 +118,34 @@ void TraceSorter::Queue::Sort(TraceTokenBuffer& buffer, bool use_slow_sorting) {
 
 // Removes all the events in |queues_| that are earlier than the given
 // packet index and moves them to the next parser stages, respecting global
-// timestamp order. This function is a "extract min from N sorted queues", with
+// timestamp order.
+void TraceSorter::SortAndExtractEventsUntilAllocId(
+    BumpAllocator::AllocId limit_alloc_id) {
+  if (thread_pool_) {
+    SortQueuesInParallel();
+    ExtractEventsUsingTournamentTree(limit_alloc_id);
+  } else {
+    ExtractEventsUsingLinearScan(limit_alloc_id);
+  }
+}
+
+void TraceSorter::SortQueuesInParallel() {
+  std::vector<Queue*> queues;
+  for (auto& sorter_data : sorter_data_by_machine_) {
+    for (auto& queue : sorter_data.queues) {
+      if (queue.needs_sorting())
+        queues.push_back(&queue);
+    }
+  }
+  // Sorting only reads from |token_buffer_| (for the slow comparator) so
+  // different queues can safely be sorted concurrently.
+  util::ParallelFor(thread_pool_, thread_count_, queues.size(),
+                    [this, &queues](size_t i) {
+                      queues[i]->Sort(token_buffer_, use_slow_sorting_);
+                    });
+}
+
+// This function is a "extract min from N sorted queues", with
 // some little cleverness: we know that events tend to be bursty, so events are
 // not going to be randomly distributed on the N |queues_|.
 // Upon each iteration this function finds the first two queues (if any) that
@@ -122,11 +159,10 @@ void TraceSorter::Queue::Sort(TraceTokenBuffer& buffer, bool use_slow_sorting) {
 // We know that we can extract all events from q1 until we hit ts=10 without
 // looking at any other queue. After hitting ts=10, we need to re-look to all of
 // them to figure out the next min-event.
-// There are more suitable data structures to do this (e.g. keeping a min-heap
-// to avoid re-scanning all the queues all the times) but doesn't seem worth it.
 // With Android traces (that have 8 CPUs) this function accounts for ~1-3% cpu
-// time in a profiler.
-void TraceSorter::SortAndExtractEventsUntilAllocId(
+// time in a profiler. See ExtractEventsUsingTournamentTree() for a version
+// which scales better with the number of queues.
+void TraceSorter::ExtractEventsUsingLinearScan(
     BumpAllocator::AllocId limit_alloc_id) {
   constexpr int64_t kTsMax = std::numeric_limits<int64_t>::max();
   for (;;) {
@@ -165,54 +201,113 @@ void TraceSorter::SortAndExtractEventsUntilAllocId(
     if (all_queues_empty)
       break;
 
-    auto& sorter_data = sorter_data_by_machine_[min_machine_idx];
-    auto& queue = sorter_data.queues[min_queue_idx];
-    auto& events = queue.events_;
-    if (queue.needs_sorting())
-      queue.Sort(token_buffer_, use_slow_sorting_);
-    PERFETTO_DCHECK(queue.min_ts_ == events.front().ts);
-
-    // Now that we identified the min-queue, extract all events from it until
-    // we hit either: (1) the min-ts of the 2nd queue or (2) the packet index
-    // limit, whichever comes first.
-    size_t num_extracted = 0;
-    for (auto& event : events) {
-      if (event.alloc_id() >= limit_alloc_id) {
-        break;
-      }
+    // The earliest event cannot be extracted without going past the limit.
+    if (!ExtractEventsFromQueue(min_machine_idx, min_queue_idx, min_queue_ts[1],
+                                limit_alloc_id)) {
+      break;
+    }
+  }  // for(;;)
+}
 
-      if (event.ts > min_queue_ts[1]) {
-        // We should never hit this condition on the first extraction as by
-        // the algorithm above (event.ts =) min_queue_ts[0] <= min_queue[1].
-        PERFETTO_DCHECK(num_extracted > 0);
-        break;
-      }
+// Same as ExtractEventsUsingLinearScan() but the queue with the earliest event
+// and the earliest event of the 2nd queue are found using a tournament tree
+// whose leaves are keyed by the min_ts of each (non-empty) queue. After each
+// round of extraction only the path from the extracted queue to the root needs
+// to be replayed.
+void TraceSorter::ExtractEventsUsingTournamentTree(
+    BumpAllocator::AllocId limit_alloc_id) {
+  constexpr int64_t kTsMax = std::numeric_limits<int64_t>::max();
+  auto queue_key = [](const Queue& queue) -> std::optional<int64_t> {
+    if (queue.events_.empty())
+      return std::nullopt;
+    return queue.min_ts_;
+  };
 
-      ++num_extracted;
-      MaybeExtractEvent(min_machine_idx, min_queue_idx, event);
-    }  // for (event: events)
+  // Leaf i of the tree corresponds to the queue |leaves[i]|. Leaves are
+  // ordered the same way the linear scan visits queues so that ties are
+  // broken identically.
+  std::vector<std::pair<size_t, size_t>> leaves;
+  std::vector<std::optional<int64_t>> keys;
+  for (size_t m = 0; m < sorter_data_by_machine_.size(); m++) {
+    const auto& queues = sorter_data_by_machine_[m].queues;
+    for (size_t i = 0; i < queues.size(); i++) {
+      leaves.emplace_back(m, i);
+      keys.push_back(queue_key(queues[i]));
+    }
+  }
+  TournamentTree tree;
+  tree.Reset(keys);
+
+  for (;;) {
+    std::optional<size_t> winner = tree.Winner();
+    if (!winner)
+      break;
+
+    auto [machine_idx, queue_idx] = leaves[*winner];
+    int64_t next_queue_ts = tree.RunnerUpKey().value_or(kTsMax);
 
     // The earliest event cannot be extracted without going past the limit.
-    if (!num_extracted)
+    if (!ExtractEventsFromQueue(machine_idx, queue_idx, next_queue_ts,
+                                limit_alloc_id)) {
       break;
+    }
+    tree.Update(
+        *winner,
+        queue_key(sorter_data_by_machine_[machine_idx].queues[queue_idx]));
+  }
+}
 
-    // Now remove the entries from the event buffer and update the queue-local
-    // and global time bounds.
-    events.erase_front(num_extracted);
-    events.shrink_to_fit();
+size_t TraceSorter::ExtractEventsFromQueue(
+    size_t machine_idx,
+    size_t queue_idx,
+    int64_t max_ts,
+    BumpAllocator::AllocId limit_alloc_id) {
+  auto& queue = sorter_data_by_machine_[machine_idx].queues[queue_idx];
+  auto& events = queue.events_;
+  if (queue.needs_sorting())
+    queue.Sort(token_buffer_, use_slow_sorting_);
+  PERFETTO_DCHECK(queue.min_ts_ == events.front().ts);
 
-    // Since we likely just removed a bunch of items try to reduce the memory
-    // usage of the token buffer.
-    token_buffer_.FreeMemory();
+  // Now that we identified the min-queue, extract all events from it until
+  // we hit either: (1) the min-ts of the 2nd queue or (2) the packet index
+  // limit, whichever comes first.
+  size_t num_extracted = 0;
+  for (auto& event : events) {
+    if (event.alloc_id() >= limit_alloc_id) {
+      break;
+    }
 
-    // Update the queue timestamps to reflect the bounds after extraction.
-    if (events.empty()) {
-      queue.min_ts_ = kTsMax;
-      queue.max_ts_ = 0;
-    } else {
-      queue.min_ts_ = queue.events_.front().ts;
+    if (event.ts > max_ts) {
+      // We should never hit this condition on the first extraction as this
+      // queue was picked because it holds the earliest event (<= |max_ts|).
+      PERFETTO_DCHECK(num_extracted > 0);
+      break;
     }
-  }  // for(;;)
+
+    ++num_extracted;
+    MaybeExtractEvent(machine_idx, queue_idx, event);
+  }  // for (event: events)
+
+  if (!num_extracted)
+    return 0;
+
+  // Now remove the entries from the event buffer and update the queue-local
+  // and global time bounds.
+  events.erase_front(num_extracted);
+  events.shrink_to_fit();
+
+  // Since we likely just removed a bunch of items try to reduce the memory
+  // usage of the token buffer.
+  token_buffer_.FreeMemory();
+
+  // Update the queue timestamps to reflect the bounds after extraction.
+  if (events.empty()) {
+    queue.min_ts_ = std::numeric_limits<int64_t>::max();
+    queue.max_ts_ = 0;
+  } else {
+    queue.min_ts_ = queue.events_.front().ts;
+  }
+  return num_extracted;
 }
 
 void TraceSorter::ParseTracePacket(TraceProcessorContext& context,
@@ -0,0 +1,134 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "perfetto/ext/base/threading/thread_pool.h"
+#include "perfetto/trace_processor/trace_blob.h"
+#include "perfetto/trace_processor/trace_blob_view.h"
+#include "src/trace_processor/importers/common/parser_types.h"
+#include "src/trace_processor/importers/proto/packet_sequence_state_generation.h"
+#include "src/trace_processor/importers/proto/proto_trace_parser_impl.h"
+#include "src/trace_processor/sorter/trace_sorter.h"
+#include "src/trace_processor/storage/trace_storage.h"
+#include "src/trace_processor/types/trace_processor_context.h"
+
+namespace perfetto::trace_processor {
+namespace {
+
+bool IsBenchmarkFunctionalOnly() {
+  return getenv("BENCHMARK_FUNCTIONAL_TEST_ONLY") != nullptr;
+}
+
+// Drops all the events instead of parsing them so that only the cost of the
+// sorter is measured.
+class NullTraceParser : public ProtoTraceParserImpl {
+ public:
+  explicit NullTraceParser(TraceProcessorContext* context)
+      : ProtoTraceParserImpl(context) {}
+
+  void ParseFtraceEvent(uint32_t, int64_t ts, TracePacketData data) override {
+    benchmark::DoNotOptimize(ts);
+    benchmark::DoNotOptimize(data.packet.data());
+  }
+};
+
+struct FtraceEvent {
+  uint32_t cpu;
+  int64_t ts;
+};
+
+// Creates a synthetic ftrace stream for |cpus| CPUs. As in real traces,
+// events arrive in per-CPU bundles and are mostly (but not always) sorted
+// within each CPU.
+std::vector<FtraceEvent> CreateFtraceEvents(uint32_t cpus, size_t count) {
+  static constexpr uint32_t kRandomSeed = 42;
+  static constexpr uint32_t kBundleSize = 64;
+  std::minstd_rand0 rnd_engine(kRandomSeed);
+
+  std::vector<int64_t> cpu_ts(cpus, 0);
+  std::vector<FtraceEvent> events;
+  events.reserve(count);
+  while (events.size() < count) {
+    uint32_t cpu = static_cast<uint32_t>(rnd_engine() % cpus);
+    for (uint32_t i = 0; i < kBundleSize && events.size() < count; ++i) {
+      cpu_ts[cpu] += rnd_engine() % 10000;
+      int64_t ts = cpu_ts[cpu];
+      // ~5% of the events are late, forcing the queue to be re-sorted.
+      if (rnd_engine() % 20 == 0) {
+        ts -= static_cast<int64_t>(rnd_engine() % 100000);
+      }
+      events.push_back(FtraceEvent{cpu, ts < 0 ? 0 : ts});
+    }
+  }
+  return events;
+}
+
+void SorterArgs(benchmark::internal::Benchmark* b) {
+  if (IsBenchmarkFunctionalOnly()) {
+    b->Args({8, 0});
+    b->Args({8, 2});
+    return;
+  }
+  for (int cpus : {8, 32, 128}) {
+    for (int threads : {0, 1, 4, 16}) {
+      b->Args({cpus, threads});
+    }
+  }
+}
+
+}  // namespace
+
+static void BM_TraceSorterManyCpuFtrace(benchmark::State& state) {
+  auto cpus = static_cast<uint32_t>(state.range(0));
+  auto thread_count = static_cast<uint32_t>(state.range(1));
+  size_t count = IsBenchmarkFunctionalOnly() ? 10000 : 4 * 1024 * 1024;
+  std::vector<FtraceEvent> events = CreateFtraceEvents(cpus, count);
+
+  TraceProcessorContext context;
+  context.storage = std::make_shared<TraceStorage>();
+  context.config.ingestion_thread_count = thread_count;
+  if (thread_count > 0) {
+    context.thread_pool = std::make_shared<base::ThreadPool>(thread_count);
+  }
+  context.proto_trace_parser = std::make_unique<NullTraceParser>(&context);
+  auto seq_state = PacketSequenceStateGeneration::CreateFirst(&context);
+  TraceBlobView blob(TraceBlob::Allocate(1));
+
+  for (auto _ : state) {
+    state.PauseTiming();
+    TraceSorter sorter(&context, TraceSorter::SortingMode::kFullSort);
+    for (const FtraceEvent& event : events) {
+      sorter.PushFtraceEvent(event.cpu, event.ts, blob.copy(), seq_state);
+    }
+    state.ResumeTiming();
+
+    sorter.ExtractEventsForced();
+  }
+  state.counters["events/s"] = benchmark::Counter(
+      static_cast<double>(events.size()),
+      benchmark::Counter::kIsIterationInvariantRate);
+}
+BENCHMARK(BM_TraceSorterManyCpuFtrace)->Apply(SorterArgs)->UseRealTime();
+
+}  // namespace perfetto::trace_processor
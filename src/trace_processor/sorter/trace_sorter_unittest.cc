@@ -15,10 +15,14 @@
  */
 #include "src/trace_processor/sorter/trace_sorter.h"
 
+#include <limits>
 #include <map>
+#include <memory>
 #include <random>
+#include <tuple>
 #include <vector>
 
+#include "perfetto/ext/base/threading/thread_pool.h"
 #include "perfetto/trace_processor/basic_types.h"
 #include "perfetto/trace_processor/trace_blob.h"
 #include "perfetto/trace_processor/trace_blob_view.h"
@@ -421,6 +425,55 @@ TEST_F(TraceSorterTest, MultiMachineSorting) {
   EXPECT_TRUE(expectations.empty());
 }
 
+// Checks that sorting the queues on a thread pool and merging them with a
+// tournament tree extracts events in exactly the same order (including the
+// order of events with equal timestamps) as the single-threaded sorter.
+TEST_F(TraceSorterTest, ThreadPoolMatchesSingleThreaded) {
+  using Event = std::tuple<int64_t /*ts*/, uint32_t /*cpu*/, const uint8_t*>;
+  TraceBlobView tbv(TraceBlob::Allocate(2000));
+
+  auto run = [&]() {
+    auto state = PacketSequenceStateGeneration::CreateFirst(&context_);
+    std::vector<Event> extracted;
+    EXPECT_CALL(*parser_, MOCK_ParseFtracePacket(_, _, _, _, _))
+        .WillRepeatedly(Invoke([&extracted](uint32_t cpu, int64_t ts,
+                                            const uint8_t* data, size_t,
+                                            std::optional<MachineId>) {
+          extracted.emplace_back(ts, cpu, data);
+        }));
+    EXPECT_CALL(*parser_, MOCK_ParseTracePacket(_, _, _))
+        .WillRepeatedly(
+            Invoke([&extracted](int64_t ts, const uint8_t* data, size_t) {
+              extracted.emplace_back(ts, std::numeric_limits<uint32_t>::max(),
+                                     data);
+            }));
+
+    // Use a small range of timestamps so that many events on different
+    // queues compare equal.
+    std::minstd_rand0 rnd_engine(0);
+    for (uint16_t i = 0; i < 2000; i++) {
+      int64_t ts = static_cast<int64_t>(rnd_engine() % 500);
+      if (rnd_engine() % 8 == 0) {
+        context_.sorter->PushTracePacket(ts, state, tbv.slice_off(i, 1));
+      } else {
+        uint32_t cpu = static_cast<uint32_t>(rnd_engine() % 64);
+        context_.sorter->PushFtraceEvent(cpu, ts, tbv.slice_off(i, 1), state);
+      }
+    }
+    context_.sorter->ExtractEventsForced();
+    return extracted;
+  };
+
+  std::vector<Event> single_threaded = run();
+  ASSERT_EQ(single_threaded.size(), 2000u);
+
+  context_.config.ingestion_thread_count = 4;
+  context_.thread_pool = std::make_shared<base::ThreadPool>(4);
+  CreateSorter();
+  std::vector<Event> multi_threaded = run();
+  ASSERT_EQ(single_threaded, multi_threaded);
+}
+
 }  // namespace
 }  // namespace trace_processor
 }  // namespace perfetto
@@ -32,6 +32,7 @@
 #include "src/trace_processor/importers/common/parser_types.h"
 #include "src/trace_processor/importers/proto/packet_sequence_state_generation.h"
 #include "src/trace_processor/util/bump_allocator.h"
+#include "src/trace_processor/util/gzip_utils.h"
 
 namespace perfetto::trace_processor {
 namespace {
@@ -74,9 +75,17 @@ uint8_t* AppendToPtr(uint8_t* ptr, T value) {
   return ptr + sizeof(T);
 }
 
-uint32_t GetAllocSize(const TrackEventDataDescriptor& desc) {
+// The size of the blocks packets are copied into when packet compression is
+// enabled. Large enough to give the compressor a decent window but small
+// enough that the few blocks being decompressed at any point in time do not
+// meaningfully contribute to the peak memory.
+constexpr uint32_t kPacketBlockSize = 1024 * 1024;
+
+uint32_t GetAllocSize(const TrackEventDataDescriptor& desc,
+                      bool compress_packets) {
   uint32_t alloc_size = sizeof(TrackEventDataDescriptor);
   alloc_size += sizeof(uint64_t);
+  alloc_size += compress_packets * sizeof(uint64_t);
   alloc_size += desc.has_thread_instruction_count * sizeof(int64_t);
   alloc_size += desc.has_thread_timestamp * sizeof(int64_t);
   alloc_size += desc.has_counter_value * sizeof(double);
@@ -107,14 +116,21 @@ TraceTokenBuffer::Id TraceTokenBuffer::Append(TrackEventData ted) {
   // Allocate enough memory using the BumpAllocator to store the data in |ted|.
   // Also figure out the interned index.
   BumpAllocator::AllocId alloc_id =
-      AllocAndResizeInternedVectors(GetAllocSize(desc));
+      AllocAndResizeInternedVectors(GetAllocSize(desc, compress_packets_));
   InternedIndex interned_index = GetInternedIndex(alloc_id);
 
   // Compute the interning information for the TrackBlob and the SequenceState.
+  // If packets are being compressed, the packet is instead copied into a packet
+  // block below and the TraceBlob is not retained at all.
   TracePacketData& tpd = ted.trace_packet_data;
-  desc.intern_blob_offset = InternTraceBlob(interned_index, tpd.packet);
-  desc.intern_blob_index =
-      static_cast<uint16_t>(interned_blobs_.at(interned_index).size() - 1);
+  if (compress_packets_) {
+    desc.intern_blob_offset = 0;
+    desc.intern_blob_index = 0;
+  } else {
+    desc.intern_blob_offset = InternTraceBlob(interned_index, tpd.packet);
+    desc.intern_blob_index =
+        static_cast<uint16_t>(interned_blobs_.at(interned_index).size() - 1);
+  }
   desc.intern_seq_index =
       InternSeqState(interned_index, std::move(tpd.sequence_state));
 
@@ -126,6 +142,11 @@ TraceTokenBuffer::Id TraceTokenBuffer::Append(TrackEventData ted) {
   uint64_t packet_size = static_cast<uint64_t>(tpd.packet.size());
   ptr = AppendToPtr(ptr, packet_size);
 
+  // Store where the packet was copied to.
+  if (compress_packets_) {
+    ptr = AppendToPtr(ptr, AppendToPacketBlock(tpd.packet));
+  }
+
   // Add the "optional" fields of TrackEventData based on whether or not they
   // are non-null.
   if (desc.has_thread_instruction_count) {
@@ -151,11 +172,17 @@ TrackEventData TraceTokenBuffer::Extract<TrackEventData>(Id id) {
   uint64_t packet_size = ExtractFromPtr<uint64_t>(&ptr);
 
   InternedIndex interned_index = GetInternedIndex(id.alloc_id);
-  BlobWithOffset& bwo =
-      interned_blobs_.at(interned_index)[desc.intern_blob_index];
-  TraceBlobView tbv(RefPtr<TraceBlob>::FromReleasedUnsafe(bwo.blob),
-                    bwo.offset_in_blob + desc.intern_blob_offset,
-                    static_cast<uint32_t>(packet_size));
+  TraceBlobView tbv;
+  if (compress_packets_) {
+    tbv = ExtractFromPacketBlock(ExtractFromPtr<PacketLocation>(&ptr),
+                                 static_cast<uint32_t>(packet_size));
+  } else {
+    BlobWithOffset& bwo =
+        interned_blobs_.at(interned_index)[desc.intern_blob_index];
+    tbv = TraceBlobView(RefPtr<TraceBlob>::FromReleasedUnsafe(bwo.blob),
+                        bwo.offset_in_blob + desc.intern_blob_offset,
+                        static_cast<uint32_t>(packet_size));
+  }
   auto seq = RefPtr<PacketSequenceStateGeneration>::FromReleasedUnsafe(
       interned_seqs_.at(interned_index)[desc.intern_seq_index]);
 
@@ -241,12 +268,106 @@ uint32_t TraceTokenBuffer::AddTraceBlob(InternedIndex interned_index,
   return 0u;
 }
 
+TraceTokenBuffer::PacketLocation TraceTokenBuffer::AppendToPacketBlock(
+    const TraceBlobView& tbv) {
+  // Start a new block if the current one was already (partially) extracted or
+  // if the packet does not fit. Packets larger than the block size get a block
+  // of their own.
+  if (packet_blocks_.empty() || packet_blocks_.back().decompressed ||
+      (!packet_blocks_.back().data.empty() &&
+       packet_blocks_.back().data.size() + tbv.size() > kPacketBlockSize)) {
+    if (!packet_blocks_.empty() && !packet_blocks_.back().decompressed) {
+      CompressPacketBlock(packet_blocks_.back());
+    }
+    packet_blocks_.emplace_back();
+    packet_blocks_.back().data.reserve(
+        std::max<size_t>(kPacketBlockSize, tbv.size()));
+  }
+  PacketBlock& block = packet_blocks_.back();
+  PacketLocation loc;
+  loc.block_id =
+      static_cast<uint32_t>(erased_packet_blocks_ + packet_blocks_.size() - 1);
+  loc.offset = static_cast<uint32_t>(block.data.size());
+  block.data.insert(block.data.end(), tbv.data(), tbv.data() + tbv.size());
+  block.live_packets++;
+  return loc;
+}
+
+TraceBlobView TraceTokenBuffer::ExtractFromPacketBlock(PacketLocation loc,
+                                                       uint32_t size) {
+  PERFETTO_DCHECK(loc.block_id >= erased_packet_blocks_);
+  auto block_index = static_cast<size_t>(loc.block_id - erased_packet_blocks_);
+  PacketBlock& block = packet_blocks_.at(block_index);
+  if (!block.decompressed) {
+    if (block.compressed) {
+      TraceBlob blob = TraceBlob::Allocate(block.uncompressed_size);
+      size_t written = 0;
+      util::GzipDecompressor decompressor(
+          util::GzipDecompressor::InputMode::kRawDeflate);
+      auto res = decompressor.FeedAndExtract(
+          block.data.data(), block.data.size(),
+          [&](const uint8_t* buf, size_t buf_len) {
+            PERFETTO_CHECK(written + buf_len <= blob.size());
+            memcpy(blob.data() + written, buf, buf_len);
+            written += buf_len;
+          });
+      PERFETTO_CHECK(res == util::GzipDecompressor::ResultCode::kEof);
+      PERFETTO_CHECK(written == blob.size());
+      block.decompressed.reset(new TraceBlob(std::move(blob)));
+    } else {
+      // The block which is still being filled is being extracted from: just
+      // copy it out as it's not worth compressing.
+      block.decompressed.reset(new TraceBlob(
+          TraceBlob::CopyFrom(block.data.data(), block.data.size())));
+    }
+    block.data = std::vector<uint8_t>();
+  }
+  TraceBlobView tbv(block.decompressed, loc.offset, size);
+
+  // Drop the reference to the decompressed data as soon as possible: the
+  // returned TraceBlobViews keep it alive for as long as it's needed.
+  PERFETTO_DCHECK(block.live_packets > 0);
+  if (--block.live_packets == 0) {
+    block.decompressed.reset();
+  }
+  return tbv;
+}
+
+void TraceTokenBuffer::CompressPacketBlock(PacketBlock& block) {
+  PERFETTO_DCHECK(!block.compressed);
+  block.uncompressed_size = static_cast<uint32_t>(block.data.size());
+  block.data = util::RawDeflateFast(block.data.data(), block.data.size());
+  block.compressed = true;
+}
+
+void TraceTokenBuffer::EnablePacketCompression() {
+  PERFETTO_CHECK(interned_seqs_.empty());
+  compress_packets_ = util::IsGzipSupported();
+}
+
+size_t TraceTokenBuffer::packet_block_bytes_for_testing() {
+  size_t bytes = 0;
+  for (auto it = packet_blocks_.begin(); it != packet_blocks_.end(); ++it) {
+    bytes += it->data.size();
+    bytes += it->decompressed ? it->decompressed->size() : 0;
+  }
+  return bytes;
+}
+
 void TraceTokenBuffer::FreeMemory() {
   uint64_t erased = allocator_.EraseFrontFreeChunks();
   PERFETTO_CHECK(erased <= std::numeric_limits<size_t>::max());
   interned_blobs_.erase_front(static_cast<size_t>(erased));
   interned_seqs_.erase_front(static_cast<size_t>(erased));
   PERFETTO_CHECK(interned_blobs_.size() == interned_seqs_.size());
+
+  // Blocks which have had all their packets extracted can be dropped, apart
+  // from the last one which can still be appended to.
+  while (packet_blocks_.size() > 1 &&
+         packet_blocks_.front().live_packets == 0) {
+    packet_blocks_.pop_front();
+    erased_packet_blocks_++;
+  }
 }
 
 BumpAllocator::AllocId TraceTokenBuffer::AllocAndResizeInternedVectors(
@@ -17,6 +17,7 @@
 #ifndef SRC_TRACE_PROCESSOR_SORTER_TRACE_TOKEN_BUFFER_H_
 #define SRC_TRACE_PROCESSOR_SORTER_TRACE_TOKEN_BUFFER_H_
 
+#include <cstddef>
 #include <cstdint>
 #include <limits>
 #include <optional>
@@ -26,6 +27,7 @@
 #include "perfetto/base/compiler.h"
 #include "perfetto/ext/base/circular_queue.h"
 #include "perfetto/ext/base/utils.h"
+#include "perfetto/trace_processor/ref_counted.h"
 #include "perfetto/trace_processor/trace_blob.h"
 #include "perfetto/trace_processor/trace_blob_view.h"
 #include "src/trace_processor/importers/common/parser_types.h"
@@ -105,11 +107,46 @@ class TraceTokenBuffer {
   // allocator. The amount of memory free is implementation defined.
   void FreeMemory();
 
+  // Makes this buffer copy the bytes of appended TracePacketData and
+  // TrackEventData into fixed size blocks instead of retaining the TraceBlobs
+  // the packets point into. Full blocks are compressed and only decompressed
+  // when a packet is extracted from them. This trades CPU time for a large
+  // reduction in peak memory for traces which need a lot of buffering while
+  // sorting (e.g. ring buffer traces).
+  //
+  // Must be called before anything is appended. Does nothing if gzip is not
+  // supported in this build.
+  void EnablePacketCompression();
+
+  // Returns the number of bytes currently used to store packet blocks.
+  // Only meaningful if |EnablePacketCompression| was called.
+  size_t packet_block_bytes_for_testing();
+
  private:
   struct BlobWithOffset {
     TraceBlob* blob;
     size_t offset_in_blob;
   };
+  // A block of packet bytes copied out of the TraceBlobs the packets were
+  // tokenized from. See |EnablePacketCompression|.
+  struct PacketBlock {
+    // The packets bytes while the block is being filled or, once |compressed|
+    // is set, the raw deflate compressed bytes.
+    std::vector<uint8_t> data;
+    uint32_t uncompressed_size = 0;
+    bool compressed = false;
+
+    // Set when the first packet is extracted from this block. Once set,
+    // nothing more is appended to this block.
+    RefPtr<TraceBlob> decompressed;
+
+    // The number of packets in this block which have not been extracted.
+    uint32_t live_packets = 0;
+  };
+  struct PacketLocation {
+    uint32_t block_id;
+    uint32_t offset;
+  };
   using InternedIndex = size_t;
   using BlobWithOffsets = std::vector<BlobWithOffset>;
   using SequenceStates = std::vector<PacketSequenceStateGeneration*>;
@@ -121,12 +158,22 @@ class TraceTokenBuffer {
   uint16_t InternSeqState(InternedIndex, RefPtr<PacketSequenceStateGeneration>);
   uint32_t AddTraceBlob(InternedIndex, const TraceBlobView&);
 
+  // Functions to store and retrieve packets when packet compression is
+  // enabled.
+  PacketLocation AppendToPacketBlock(const TraceBlobView&);
+  TraceBlobView ExtractFromPacketBlock(PacketLocation, uint32_t size);
+  static void CompressPacketBlock(PacketBlock&);
+
   BumpAllocator::AllocId AllocAndResizeInternedVectors(uint32_t size);
   InternedIndex GetInternedIndex(BumpAllocator::AllocId);
 
   BumpAllocator allocator_;
   base::CircularQueue<BlobWithOffsets> interned_blobs_;
   base::CircularQueue<SequenceStates> interned_seqs_;
+
+  bool compress_packets_ = false;
+  base::CircularQueue<PacketBlock> packet_blocks_;
+  uint64_t erased_packet_blocks_ = 0;
 };
 
 // GCC7 does not like us declaring these inside the class so define these
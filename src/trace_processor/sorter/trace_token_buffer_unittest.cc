@@ -16,7 +16,11 @@
 
 #include "src/trace_processor/sorter/trace_token_buffer.h"
 
+#include <cstdint>
+#include <cstring>
 #include <optional>
+#include <string>
+#include <vector>
 
 #include "perfetto/base/compiler.h"
 #include "perfetto/trace_processor/ref_counted.h"
@@ -25,6 +29,7 @@
 #include "src/trace_processor/importers/common/parser_types.h"
 #include "src/trace_processor/importers/proto/packet_sequence_state_generation.h"
 #include "src/trace_processor/types/trace_processor_context.h"
+#include "src/trace_processor/util/gzip_utils.h"
 #include "test/gtest_and_gmock.h"
 
 namespace perfetto {
@@ -162,6 +167,80 @@ TEST_F(TraceTokenBufferUnittest, ExtractOrAppendAfterFreeMemory) {
   ASSERT_EQ(tbv.size(), 4567u);
 }
 
+TEST_F(TraceTokenBufferUnittest, CompressedPacketsInOut) {
+  if (!util::IsGzipSupported()) {
+    GTEST_SKIP() << "Gzip not supported";
+  }
+  store.EnablePacketCompression();
+
+  // Enough packets to span several packet blocks, from a few different blobs.
+  constexpr uint32_t kPacketCount = 4096;
+  constexpr uint32_t kPacketSize = 1000;
+  std::vector<TraceBlobView> packets;
+  std::vector<TraceTokenBuffer::Id> ids;
+  for (uint32_t i = 0; i < kPacketCount; i += 64) {
+    TraceBlob blob = TraceBlob::Allocate(64 * kPacketSize);
+    for (uint32_t j = 0; j < blob.size(); ++j) {
+      blob.data()[j] = static_cast<uint8_t>((i + j) % 7);
+    }
+    TraceBlobView root(std::move(blob));
+    for (uint32_t j = 0; j < 64; ++j) {
+      packets.push_back(root.slice_off(j * kPacketSize, kPacketSize));
+      TrackEventData ted(packets.back().copy(), state);
+      ted.thread_timestamp = i + j;
+      ids.push_back(store.Append(std::move(ted)));
+    }
+  }
+  // The packets are copied and compressed so should take up much less space
+  // than the original data.
+  ASSERT_LT(store.packet_block_bytes_for_testing(),
+            kPacketCount * kPacketSize / 4);
+
+  // Extract from both ends to have several blocks decompressed at once.
+  for (uint32_t i = 0; i < kPacketCount / 2; ++i) {
+    for (uint32_t idx : {i, kPacketCount - i - 1}) {
+      TrackEventData ted = store.Extract<TrackEventData>(ids[idx]);
+      const TraceBlobView& out = ted.trace_packet_data.packet;
+      ASSERT_EQ(out.size(), kPacketSize);
+      ASSERT_NE(out.data(), packets[idx].data());
+      ASSERT_EQ(memcmp(out.data(), packets[idx].data(), kPacketSize), 0);
+      ASSERT_EQ(ted.trace_packet_data.sequence_state, state);
+      ASSERT_EQ(ted.thread_timestamp, idx);
+    }
+  }
+  store.FreeMemory();
+  ASSERT_EQ(store.packet_block_bytes_for_testing(), 0u);
+}
+
+TEST_F(TraceTokenBufferUnittest, CompressedPacketsAppendAfterExtract) {
+  if (!util::IsGzipSupported()) {
+    GTEST_SKIP() << "Gzip not supported";
+  }
+  store.EnablePacketCompression();
+
+  TraceBlobView root(TraceBlob::CopyFrom("abcdefgh", 8));
+  TraceTokenBuffer::Id id_1 =
+      store.Append(TracePacketData{root.slice_off(0, 4), state});
+  TracePacketData out_1 = store.Extract<TracePacketData>(id_1);
+
+  // The block |id_1| was in cannot be appended to anymore as its data was
+  // handed out.
+  TraceTokenBuffer::Id id_2 =
+      store.Append(TracePacketData{root.slice_off(4, 4), state});
+  TraceTokenBuffer::Id id_3 =
+      store.Append(TracePacketData{TraceBlobView(), state});
+  TracePacketData out_2 = store.Extract<TracePacketData>(id_2);
+  TracePacketData out_3 = store.Extract<TracePacketData>(id_3);
+
+  ASSERT_EQ(std::string(reinterpret_cast<const char*>(out_1.packet.data()),
+                        out_1.packet.size()),
+            "abcd");
+  ASSERT_EQ(std::string(reinterpret_cast<const char*>(out_2.packet.data()),
+                        out_2.packet.size()),
+            "efgh");
+  ASSERT_EQ(out_3.packet.size(), 0u);
+}
+
 }  // namespace
 }  // namespace trace_processor
 }  // namespace perfetto
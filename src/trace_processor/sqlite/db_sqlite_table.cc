@@ -32,6 +32,7 @@
 #include "perfetto/base/compiler.h"
 #include "perfetto/base/logging.h"
 #include "perfetto/base/status.h"
+#include "perfetto/ext/base/flat_hash_map.h"
 #include "perfetto/ext/base/small_vector.h"
 #include "perfetto/ext/base/status_or.h"
 #include "perfetto/ext/base/string_splitter.h"
@@ -235,6 +236,37 @@ int ReadIdxStrAndUpdateCursor(DbSqliteModule::Cursor* cursor,
   return SQLITE_OK;
 }
 
+// Builds |SortedCache::ranges| for |sorted|, which must be sorted on |col_idx|.
+// Returns std::nullopt if the column contains non-integer values.
+std::optional<base::FlatHashMap<int64_t, RowMap::Range>> BuildSortedCacheRanges(
+    const Table& sorted,
+    uint32_t col_idx) {
+  const ColumnLegacy& col = sorted.columns()[col_idx];
+  base::FlatHashMap<int64_t, RowMap::Range> ranges;
+  std::optional<int64_t> current;
+  uint32_t start = 0;
+  for (uint32_t i = 0; i < sorted.row_count(); ++i) {
+    SqlValue v = col.Get(i);
+    // Nulls never match an equality constraint and are sorted first.
+    if (v.is_null()) {
+      start = i + 1;
+      continue;
+    }
+    if (v.type != SqlValue::kLong) {
+      return std::nullopt;
+    }
+    if (current && *current != v.long_value) {
+      ranges.Insert(*current, RowMap::Range(start, i));
+      start = i;
+    }
+    current = v.long_value;
+  }
+  if (current) {
+    ranges.Insert(*current, RowMap::Range(start, sorted.row_count()));
+  }
+  return std::make_optional(std::move(ranges));
+}
+
 PERFETTO_ALWAYS_INLINE void TryCacheCreateSortedTable(
     DbSqliteModule::Cursor* cursor,
     const Table::Schema& schema,
@@ -247,7 +279,7 @@ PERFETTO_ALWAYS_INLINE void TryCacheCreateSortedTable(
   // Only try and create the cached table on exactly the third time we see
   // this constraint set.
   constexpr uint32_t kRepeatedThreshold = 3;
-  if (cursor->sorted_cache_table ||
+  if (cursor->sorted_cache ||
       cursor->repeated_cache_count++ != kRepeatedThreshold) {
     return;
   }
@@ -271,8 +303,31 @@ PERFETTO_ALWAYS_INLINE void TryCacheCreateSortedTable(
   }
 
   // Try again to get the result or start caching it.
-  cursor->sorted_cache_table =
-      cursor->upstream_table->Sort({Order{c.col_idx, false}});
+  Table sorted = cursor->upstream_table->Sort({Order{c.col_idx, false}});
+  auto ranges = BuildSortedCacheRanges(sorted, c.col_idx);
+  cursor->sorted_cache = DbSqliteModule::Cursor::SortedCache{
+      std::move(sorted), c.col_idx, std::move(ranges)};
+}
+
+// Looks up the rows of |sorted_cache| matching the query of |cursor| if it is
+// a single integer equality constraint on the column the cache is sorted on.
+// Returns std::nullopt for any other query: these go through the filtering
+// path which still benefits from the table being sorted.
+PERFETTO_ALWAYS_INLINE std::optional<RowMap> TryLookupSortedCache(
+    const DbSqliteModule::Cursor* cursor) {
+  const auto& cache = cursor->sorted_cache;
+  const Query& q = cursor->query;
+  if (!cache || !cache->ranges || q.constraints.size() != 1 ||
+      !q.orders.empty() || q.limit || q.offset != 0) {
+    return std::nullopt;
+  }
+  const Constraint& c = q.constraints.front();
+  if (c.col_idx != cache->col_idx || c.op != FilterOp::kEq ||
+      c.value.type != SqlValue::kLong) {
+    return std::nullopt;
+  }
+  const RowMap::Range* r = cache->ranges->Find(c.value.long_value);
+  return r ? RowMap(r->start, r->end) : RowMap();
 }
 
 void FilterAndSortMetatrace(const std::string& table_name,
@@ -370,6 +425,7 @@ int DbSqliteModule::Create(sqlite3* db,
   std::unique_ptr<Vtab> res = std::make_unique<Vtab>();
   res->state = context->manager.OnCreate(argv, std::move(state));
   res->table_name = argv[2];
+  res->query_thread_pool = context->query_thread_pool;
   *vtab = res.release();
   return SQLITE_OK;
 }
@@ -399,6 +455,7 @@ int DbSqliteModule::Connect(sqlite3* db,
   std::unique_ptr<Vtab> res = std::make_unique<Vtab>();
   res->state = context->manager.OnConnect(argv);
   res->table_name = argv[2];
+  res->query_thread_pool = context->query_thread_pool;
 
   auto* state =
       sqlite::ModuleStateManager<DbSqliteModule>::GetState(res->state);
@@ -673,8 +730,22 @@ int DbSqliteModule::BestIndex(sqlite3_vtab* vtab, sqlite3_index_info* info) {
   // We can sort on any column correctly.
   info->orderByConsumed = true;
 
-  auto cost_and_rows =
-      EstimateCost(s->schema, row_count, info, cs_idxes, ob_idxes);
+  // Figure out how many of the leading constraints will be resolved using an
+  // index created with CREATE PERFETTO INDEX.
+  uint32_t indexed_cs_count = 0;
+  if (table && !cs_idxes.empty()) {
+    std::vector<Constraint> cs;
+    cs.reserve(cs_idxes.size());
+    for (int i : cs_idxes) {
+      const auto& c = info->aConstraint[i];
+      cs.push_back(Constraint{static_cast<uint32_t>(c.iColumn),
+                              *SqliteOpToFilterOp(c.op), SqlValue()});
+    }
+    indexed_cs_count = table->IndexedConstraintCount(cs);
+  }
+
+  auto cost_and_rows = EstimateCost(s->schema, row_count, info, cs_idxes,
+                                    ob_idxes, indexed_cs_count);
   info->estimatedCost = cost_and_rows.cost;
   info->estimatedRows = cost_and_rows.rows;
 
@@ -773,8 +844,11 @@ int DbSqliteModule::Filter(sqlite3_vtab_cursor* cursor,
                     });
 
   const auto* source_table =
-      c->sorted_cache_table ? &*c->sorted_cache_table : c->upstream_table;
-  RowMap filter_map = source_table->QueryToRowMap(c->query);
+      c->sorted_cache ? &c->sorted_cache->table : c->upstream_table;
+  std::optional<RowMap> cached_map = TryLookupSortedCache(c);
+  RowMap filter_map =
+      cached_map ? std::move(*cached_map)
+                 : source_table->QueryToRowMap(c->query, t->query_thread_pool);
   if (filter_map.IsRange() && filter_map.size() <= 1) {
     // Currently, our criteria where we have a special fast path is if it's
     // a single ranged row. We have this fast path for joins on id columns
@@ -818,7 +892,7 @@ int DbSqliteModule::Column(sqlite3_vtab_cursor* cursor,
   Cursor* c = GetCursor(cursor);
   auto idx = static_cast<uint32_t>(N);
   const auto* source_table =
-      c->sorted_cache_table ? &*c->sorted_cache_table : c->upstream_table;
+      c->sorted_cache ? &c->sorted_cache->table : c->upstream_table;
   SqlValue value = c->mode == Cursor::Mode::kSingleRow
                        ? source_table->columns()[idx].Get(*c->single_row)
                        : c->iterator->Get(idx);
@@ -844,7 +918,8 @@ DbSqliteModule::QueryCost DbSqliteModule::EstimateCost(
     uint32_t row_count,
     sqlite3_index_info* info,
     const std::vector<int>& cs_idxes,
-    const std::vector<int>& ob_idxes) {
+    const std::vector<int>& ob_idxes,
+    uint32_t indexed_cs_count) {
   // Currently our cost estimation algorithm is quite simplistic but is good
   // enough for the simplest cases.
   // TODO(lalitm): replace hardcoded constants with either more heuristics
@@ -870,14 +945,14 @@ DbSqliteModule::QueryCost DbSqliteModule::EstimateCost(
 
   // Setup the variables for estimating the cost of filtering.
   double filter_cost = 0.0;
-  for (int i : cs_idxes) {
+  for (uint32_t pos = 0; pos < cs_idxes.size(); ++pos) {
     if (current_row_count < 2) {
       break;
     }
-    const auto& c = info->aConstraint[i];
+    const auto& c = info->aConstraint[cs_idxes[pos]];
     PERFETTO_DCHECK(c.usable);
-    PERFETTO_DCHECK(info->aConstraintUsage[i].omit);
-    PERFETTO_DCHECK(info->aConstraintUsage[i].argvIndex > 0);
+    PERFETTO_DCHECK(info->aConstraintUsage[cs_idxes[pos]].omit);
+    PERFETTO_DCHECK(info->aConstraintUsage[cs_idxes[pos]].argvIndex > 0);
     const auto& col_schema = schema.columns[static_cast<uint32_t>(c.iColumn)];
     if (sqlite::utils::IsOpEq(c.op) && col_schema.is_id) {
       // If we have an id equality constraint, we can very efficiently filter
@@ -888,6 +963,15 @@ DbSqliteModule::QueryCost DbSqliteModule::EstimateCost(
       // an entire filter call is ~10x the cost of iterating a single row.
       filter_cost += 10;
       current_row_count = 1;
+    } else if (pos < indexed_cs_count) {
+      // Constraints covered by an index are resolved by binary searching the
+      // index, both for equality and partition constraints. The matching rows
+      // then need to be converted back into table order.
+      filter_cost += log2(current_row_count);
+
+      // Use the same row count heuristic as for sorted columns below.
+      double estimated_rows = current_row_count / (2 * log2(current_row_count));
+      current_row_count = std::max(static_cast<uint32_t>(estimated_rows), 1u);
     } else if (sqlite::utils::IsOpEq(c.op)) {
       // If there is only a single equality constraint, we have special logic
       // to sort by that column and then binary search if we see the
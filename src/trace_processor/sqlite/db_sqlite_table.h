@@ -24,7 +24,9 @@
 #include <string>
 #include <vector>
 
+#include "perfetto/ext/base/flat_hash_map.h"
 #include "perfetto/trace_processor/basic_types.h"
+#include "src/trace_processor/containers/row_map.h"
 #include "src/trace_processor/db/column/types.h"
 #include "src/trace_processor/db/runtime_table.h"
 #include "src/trace_processor/db/table.h"
@@ -32,6 +34,10 @@
 #include "src/trace_processor/sqlite/bindings/sqlite_module.h"
 #include "src/trace_processor/sqlite/module_lifecycle_manager.h"
 
+namespace perfetto::base {
+class ThreadPool;
+}  // namespace perfetto::base
+
 namespace perfetto::trace_processor {
 
 enum class TableComputation {
@@ -71,11 +77,15 @@ struct DbSqliteModule : public sqlite::Module<DbSqliteModule> {
   struct Context {
     std::unique_ptr<State> temporary_create_state;
     sqlite::ModuleStateManager<DbSqliteModule> manager;
+
+    // Thread pool used to parallelize filtering of the tables. Can be null.
+    base::ThreadPool* query_thread_pool = nullptr;
   };
   struct Vtab : public sqlite::Module<DbSqliteModule>::Vtab {
     sqlite::ModuleStateManager<DbSqliteModule>::PerVtabState* state;
     int best_index_num = 0;
     std::string table_name;
+    base::ThreadPool* query_thread_pool = nullptr;
   };
   struct Cursor : public sqlite::Module<DbSqliteModule>::Cursor {
     enum class Mode {
@@ -100,10 +110,22 @@ struct DbSqliteModule : public sqlite::Module<DbSqliteModule> {
     // Stores a sorted version of |db_table| sorted on a repeated equals
     // constraint. This allows speeding up repeated subqueries in joins
     // significantly.
-    std::optional<Table> sorted_cache_table;
+    struct SortedCache {
+      Table table;
+
+      // The column |table| is sorted on.
+      uint32_t col_idx;
+
+      // Maps every value of |col_idx| to the range of rows of |table|
+      // containing it: equality queries on |col_idx| (i.e. the inner side of a
+      // join) are answered with a single lookup rather than by filtering
+      // |table|. Unset if the column has non-integer values.
+      std::optional<base::FlatHashMap<int64_t, RowMap::Range>> ranges;
+    };
+    std::optional<SortedCache> sorted_cache;
 
     // Stores the count of repeated equality queries to decide whether it is
-    // wortwhile to sort |db_table| to create |sorted_cache_table|.
+    // wortwhile to sort |db_table| to create |sorted_cache|.
     uint32_t repeated_cache_count = 0;
 
     Mode mode = Mode::kSingleRow;
@@ -154,11 +176,16 @@ struct DbSqliteModule : public sqlite::Module<DbSqliteModule> {
   static int Rowid(sqlite3_vtab_cursor*, sqlite_int64*);
 
   // static for testing.
+  //
+  // |indexed_cs_count| is the number of leading constraints in |cs_idxes|
+  // which can be resolved by binary searching an index on the table (see
+  // Table::IndexedConstraintCount).
   static QueryCost EstimateCost(const Table::Schema&,
                                 uint32_t row_count,
                                 sqlite3_index_info* info,
-                                const std::vector<int>&,
-                                const std::vector<int>&);
+                                const std::vector<int>& cs_idxes,
+                                const std::vector<int>& ob_idxes,
+                                uint32_t indexed_cs_count = 0);
 
   // This needs to happen at the end as it depends on the functions
   // defined above.
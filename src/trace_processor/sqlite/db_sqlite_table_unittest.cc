@@ -160,6 +160,43 @@ TEST(DbSqliteModule, MultiSortedEqCheaperThanMultiUnsortedEq) {
   ASSERT_EQ(sorted_cost.rows, unsorted_cost.rows);
 }
 
+TEST(DbSqliteModule, IndexedConstraintCheaperThanScan) {
+  auto schema = CreateSchema();
+  constexpr uint32_t kRowCount = 1234;
+
+  std::array c{CreateConstraint(3, SQLITE_INDEX_CONSTRAINT_GT)};
+  std::array u{CreateUsage()};
+  auto info = CreateCsIndexInfo(c.size(), c.data(), u.data());
+
+  auto scan_cost =
+      DbSqliteModule::EstimateCost(schema, kRowCount, &info, {0u}, {});
+  auto indexed_cost =
+      DbSqliteModule::EstimateCost(schema, kRowCount, &info, {0u}, {}, 1);
+
+  ASSERT_LT(indexed_cost.cost, scan_cost.cost);
+  ASSERT_LT(indexed_cost.rows, scan_cost.rows);
+}
+
+TEST(DbSqliteModule, IndexedEqAfterOtherConstraintCheaper) {
+  auto schema = CreateSchema();
+  constexpr uint32_t kRowCount = 1234;
+
+  std::array c{CreateConstraint(3, SQLITE_INDEX_CONSTRAINT_EQ),
+               CreateConstraint(4, SQLITE_INDEX_CONSTRAINT_EQ)};
+  std::array u{CreateUsage(), CreateUsage()};
+  auto info = CreateCsIndexInfo(c.size(), c.data(), u.data());
+
+  auto scan_cost =
+      DbSqliteModule::EstimateCost(schema, kRowCount, &info, {0u, 1u}, {});
+  auto one_indexed_cost =
+      DbSqliteModule::EstimateCost(schema, kRowCount, &info, {0u, 1u}, {}, 1);
+  auto two_indexed_cost =
+      DbSqliteModule::EstimateCost(schema, kRowCount, &info, {0u, 1u}, {}, 2);
+
+  ASSERT_LT(one_indexed_cost.cost, scan_cost.cost);
+  ASSERT_LT(two_indexed_cost.cost, one_indexed_cost.cost);
+}
+
 TEST(DbSqliteModule, EmptyTableCosting) {
   auto schema = CreateSchema();
   constexpr uint32_t kRowCount = 0;
@@ -37,6 +37,8 @@ int SqlStatsModule::Connect(sqlite3* db,
       started BIGINT,
       first_next BIGINT,
       ended BIGINT,
+      cache_hits INT,
+      cache_misses INT,
       PRIMARY KEY(started)
     ) WITHOUT ROWID
   )";
@@ -109,6 +111,12 @@ int SqlStatsModule::Column(sqlite3_vtab_cursor* cursor,
     case Column::kTimeEnded:
       sqlite::result::Long(ctx, stats.times_ended()[c->row]);
       break;
+    case Column::kCacheHits:
+      sqlite::result::Long(ctx, stats.cache_hits()[c->row]);
+      break;
+    case Column::kCacheMisses:
+      sqlite::result::Long(ctx, stats.cache_misses()[c->row]);
+      break;
     default:
       PERFETTO_FATAL("Unknown column %d", N);
       break;
@@ -43,6 +43,8 @@ struct SqlStatsModule : sqlite::Module<SqlStatsModule> {
     kTimeStarted = 1,
     kTimeFirstNext = 2,
     kTimeEnded = 3,
+    kCacheHits = 4,
+    kCacheMisses = 5,
   };
 
   static constexpr auto kType = kEponymousOnly;
@@ -18,6 +18,7 @@
 
 #include <sqlite3.h>
 #include <cstdint>
+#include <cstring>
 #include <optional>
 #include <string>
 #include <utility>
@@ -25,6 +26,7 @@
 #include "perfetto/base/build_config.h"
 #include "perfetto/base/logging.h"
 #include "perfetto/base/status.h"
+#include "perfetto/ext/base/string_utils.h"
 #include "perfetto/public/compiler.h"
 #include "src/trace_processor/sqlite/scoped_db.h"
 #include "src/trace_processor/sqlite/sql_source.h"
@@ -44,6 +46,18 @@ extern "C" int sqlite3_percentile_init(sqlite3* db,
 namespace perfetto::trace_processor {
 namespace {
 
+// Returns the name of the table from a "no such table" error of SQLite.
+std::optional<std::string> GetMissingTableName(const char* errmsg) {
+  std::string msg(errmsg);
+  if (!base::StartsWith(msg, "no such table: "))
+    return std::nullopt;
+  std::string name = msg.substr(strlen("no such table: "));
+  // Tables referenced by views are qualified with the schema name.
+  if (base::StartsWith(name, "main."))
+    return name.substr(strlen("main."));
+  return name;
+}
+
 void EnsureSqliteInitialized() {
   // sqlite3_initialize isn't actually thread-safe in standalone builds because
   // we build with SQLITE_THREADSAFE=0. Ensure it's only called from a single
@@ -141,6 +155,21 @@ SqliteEngine::PreparedStatement SqliteEngine::PrepareStatement(SqlSource sql) {
   PreparedStatement statement{ScopedStmt(raw_stmt), std::move(sql)};
   if (err != SQLITE_OK) {
     const char* errmsg = sqlite3_errmsg(db_.get());
+    if (missing_table_fn_) {
+      std::optional<std::string> table = GetMissingTableName(errmsg);
+      if (table) {
+        base::StatusOr<bool> created = missing_table_fn_(*table);
+        if (!created.ok()) {
+          statement.status_ = created.status();
+          return statement;
+        }
+        if (*created) {
+          return PrepareStatement(std::move(statement.sql_source_));
+        }
+        // |errmsg| could have been changed by |missing_table_fn_|.
+        errmsg = sqlite3_errmsg(db_.get());
+      }
+    }
     std::string frame =
         statement.sql_source_.AsTracebackForSqliteOffset(GetErrorOffset());
     base::Status status = base::ErrStatus("%s%s", frame.c_str(), errmsg);
@@ -169,6 +198,9 @@ base::Status SqliteEngine::RegisterFunction(const char* name,
     return base::ErrStatus("Unable to register function with name %s", name);
   }
   *fn_ctx_.Insert(std::make_pair(name, argc), ctx).first = ctx;
+  if (!deterministic) {
+    non_deterministic_fns_.Insert(base::ToLower(name), true);
+  }
   return base::OkStatus();
 }
 
@@ -187,6 +219,9 @@ base::Status SqliteEngine::RegisterAggregateFunction(
   if (ret != SQLITE_OK) {
     return base::ErrStatus("Unable to register function with name %s", name);
   }
+  if (!deterministic) {
+    non_deterministic_fns_.Insert(base::ToLower(name), true);
+  }
   return base::OkStatus();
 }
 
@@ -206,6 +241,9 @@ base::Status SqliteEngine::RegisterWindowFunction(const char* name,
   if (ret != SQLITE_OK) {
     return base::ErrStatus("Unable to register function with name %s", name);
   }
+  if (!deterministic) {
+    non_deterministic_fns_.Insert(base::ToLower(name), true);
+  }
   return base::OkStatus();
 }
 
@@ -234,6 +272,10 @@ void* SqliteEngine::GetFunctionContext(const std::string& name, int argc) {
   return res ? *res : nullptr;
 }
 
+bool SqliteEngine::IsNonDeterministicFunction(const std::string& name) const {
+  return non_deterministic_fns_.Find(base::ToLower(name)) != nullptr;
+}
+
 std::optional<uint32_t> SqliteEngine::GetErrorOffset() const {
   return GetErrorOffsetDb(db_.get());
 }
@@ -20,6 +20,7 @@
 #include <sqlite3.h>
 #include <cstddef>
 #include <cstdint>
+#include <functional>
 #include <memory>
 #include <optional>
 #include <string>
@@ -30,6 +31,7 @@
 #include "perfetto/base/status.h"
 #include "perfetto/ext/base/flat_hash_map.h"
 #include "perfetto/ext/base/hash.h"
+#include "perfetto/ext/base/status_or.h"
 #include "src/trace_processor/sqlite/bindings/sqlite_module.h"
 #include "src/trace_processor/sqlite/scoped_db.h"
 #include "src/trace_processor/sqlite/sql_source.h"
@@ -61,6 +63,12 @@ class SqliteEngine {
   using WindowFnFinal = void(sqlite3_context* ctx);
   using FnCtxDestructor = void(void*);
 
+  // Called with the name of a table when preparing a statement fails because
+  // the table does not exist. Returns whether the table was created by the
+  // function, in which case the statement is prepared again.
+  using MissingTableFn =
+      std::function<base::StatusOr<bool>(const std::string&)>;
+
   // Wrapper class for SQLite's |sqlite3_stmt| struct and associated functions.
   struct PreparedStatement {
    public:
@@ -93,6 +101,13 @@ class SqliteEngine {
   // Prepares a SQLite statement for the given SQL.
   PreparedStatement PrepareStatement(SqlSource);
 
+  // Sets the function to call when a statement references a table which does
+  // not exist (see |MissingTableFn|). This allows tables to be created only
+  // when they are first used.
+  void SetMissingTableFn(MissingTableFn fn) {
+    missing_table_fn_ = std::move(fn);
+  }
+
   // Registers a C++ function to be runnable from SQL.
   base::Status RegisterFunction(const char* name,
                                 int argc,
@@ -140,6 +155,10 @@ class SqliteEngine {
   // Gets the context for a registered SQL function.
   void* GetFunctionContext(const std::string& name, int argc);
 
+  // Returns whether a function called |name| was registered as
+  // non-deterministic. |name| is case insensitive.
+  bool IsNonDeterministicFunction(const std::string& name) const;
+
   sqlite3* db() const { return db_.get(); }
 
  private:
@@ -155,6 +174,8 @@ class SqliteEngine {
   std::optional<uint32_t> GetErrorOffset() const;
 
   base::FlatHashMap<std::pair<std::string, int>, void*, FnHasher> fn_ctx_;
+  base::FlatHashMap<std::string, bool> non_deterministic_fns_;
+  MissingTableFn missing_table_fn_;
   ScopedDb db_;
 };
 
@@ -19,12 +19,14 @@
 #include <cstdint>
 #include <cstring>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "perfetto/base/logging.h"
 #include "perfetto/ext/base/no_destructor.h"
 #include "perfetto/trace_processor/basic_types.h"
 #include "src/trace_processor/containers/null_term_string_view.h"
+#include "src/trace_processor/db/table.h"
 #include "src/trace_processor/types/variadic.h"
 
 namespace perfetto::trace_processor {
@@ -60,6 +62,134 @@ TraceStorage::TraceStorage(const Config&) {
 
 TraceStorage::~TraceStorage() {}
 
+std::vector<std::pair<const char*, Table*>>
+TraceStorage::GetAllMutableTables() {
+  // Must list every table, in their order of declaration which guarantees
+  // that parents come before their children: tables missing from here are
+  // not saved in snapshots. tools/check_trace_storage_tables.py enforces this.
+  return {
+      {tables::MetadataTable::Name(), &metadata_table_},
+      {tables::ClockSnapshotTable::Name(), &clock_snapshot_table_},
+      {tables::TrackTable::Name(), &track_table_},
+      {tables::ThreadStateTable::Name(), &thread_state_table_},
+      {tables::CpuTrackTable::Name(), &cpu_track_table_},
+      {tables::GpuTrackTable::Name(), &gpu_track_table_},
+      {tables::UidTrackTable::Name(), &uid_track_table_},
+      {tables::GpuWorkPeriodTrackTable::Name(), &gpu_work_period_track_table_},
+      {tables::ProcessTrackTable::Name(), &process_track_table_},
+      {tables::ThreadTrackTable::Name(), &thread_track_table_},
+      {tables::LinuxDeviceTrackTable::Name(), &linux_device_track_table_},
+      {tables::CounterTrackTable::Name(), &counter_track_table_},
+      {tables::ThreadCounterTrackTable::Name(), &thread_counter_track_table_},
+      {tables::ProcessCounterTrackTable::Name(), &process_counter_track_table_},
+      {tables::CpuCounterTrackTable::Name(), &cpu_counter_track_table_},
+      {tables::IrqCounterTrackTable::Name(), &irq_counter_track_table_},
+      {tables::SoftirqCounterTrackTable::Name(), &softirq_counter_track_table_},
+      {tables::GpuCounterTrackTable::Name(), &gpu_counter_track_table_},
+      {tables::EnergyCounterTrackTable::Name(), &energy_counter_track_table_},
+      {tables::UidCounterTrackTable::Name(), &uid_counter_track_table_},
+      {tables::EnergyPerUidCounterTrackTable::Name(),
+       &energy_per_uid_counter_track_table_},
+      {tables::GpuCounterGroupTable::Name(), &gpu_counter_group_table_},
+      {tables::PerfCounterTrackTable::Name(), &perf_counter_track_table_},
+      {tables::ArgTable::Name(), &arg_table_},
+      {tables::ThreadTable::Name(), &thread_table_},
+      {tables::ProcessTable::Name(), &process_table_},
+      {tables::FiledescriptorTable::Name(), &filedescriptor_table_},
+      {tables::SliceTable::Name(), &slice_table_},
+      {tables::FlowTable::Name(), &flow_table_},
+      {tables::SchedSliceTable::Name(), &sched_slice_table_},
+      {tables::SpuriousSchedWakeupTable::Name(), &spurious_sched_wakeup_table_},
+      {tables::GpuSliceTable::Name(), &gpu_slice_table_},
+      {tables::CounterTable::Name(), &counter_table_},
+      {tables::RawTable::Name(), &raw_table_},
+      {tables::FtraceEventTable::Name(), &ftrace_event_table_},
+      {tables::MachineTable::Name(), &machine_table_},
+      {tables::CpuTable::Name(), &cpu_table_},
+      {tables::CpuFreqTable::Name(), &cpu_freq_table_},
+      {tables::AndroidLogTable::Name(), &android_log_table_},
+      {tables::AndroidDumpstateTable::Name(), &android_dumpstate_table_},
+      {tables::AndroidKeyEventsTable::Name(), &android_key_events_table_},
+      {tables::AndroidMotionEventsTable::Name(), &android_motion_events_table_},
+      {tables::AndroidInputEventDispatchTable::Name(),
+       &android_input_event_dispatch_table_},
+      {tables::StackProfileMappingTable::Name(), &stack_profile_mapping_table_},
+      {tables::StackProfileFrameTable::Name(), &stack_profile_frame_table_},
+      {tables::StackProfileCallsiteTable::Name(),
+       &stack_profile_callsite_table_},
+      {tables::HeapProfileAllocationTable::Name(),
+       &heap_profile_allocation_table_},
+      {tables::CpuProfileStackSampleTable::Name(),
+       &cpu_profile_stack_sample_table_},
+      {tables::PerfSessionTable::Name(), &perf_session_table_},
+      {tables::PerfSampleTable::Name(), &perf_sample_table_},
+      {tables::InstrumentsSampleTable::Name(), &instruments_sample_table_},
+      {tables::PackageListTable::Name(), &package_list_table_},
+      {tables::AndroidGameInterventionListTable::Name(),
+       &android_game_intervention_list_table_},
+      {tables::ProfilerSmapsTable::Name(), &profiler_smaps_table_},
+      {tables::TraceFileTable::Name(), &trace_file_table_},
+      {tables::SymbolTable::Name(), &symbol_table_},
+      {tables::HeapGraphObjectTable::Name(), &heap_graph_object_table_},
+      {tables::HeapGraphClassTable::Name(), &heap_graph_class_table_},
+      {tables::HeapGraphReferenceTable::Name(), &heap_graph_reference_table_},
+      {tables::VulkanMemoryAllocationsTable::Name(),
+       &vulkan_memory_allocations_table_},
+      {tables::GraphicsFrameSliceTable::Name(), &graphics_frame_slice_table_},
+      {tables::MemorySnapshotTable::Name(), &memory_snapshot_table_},
+      {tables::ProcessMemorySnapshotTable::Name(),
+       &process_memory_snapshot_table_},
+      {tables::MemorySnapshotNodeTable::Name(), &memory_snapshot_node_table_},
+      {tables::MemorySnapshotEdgeTable::Name(), &memory_snapshot_edge_table_},
+      {tables::ExpectedFrameTimelineSliceTable::Name(),
+       &expected_frame_timeline_slice_table_},
+      {tables::ActualFrameTimelineSliceTable::Name(),
+       &actual_frame_timeline_slice_table_},
+      {tables::AndroidNetworkPacketsTable::Name(),
+       &android_network_packets_table_},
+      {tables::V8IsolateTable::Name(), &v8_isolate_table_},
+      {tables::V8JsScriptTable::Name(), &v8_js_script_table_},
+      {tables::V8WasmScriptTable::Name(), &v8_wasm_script_table_},
+      {tables::V8JsFunctionTable::Name(), &v8_js_function_table_},
+      {tables::V8JsCodeTable::Name(), &v8_js_code_table_},
+      {tables::V8InternalCodeTable::Name(), &v8_internal_code_table_},
+      {tables::V8WasmCodeTable::Name(), &v8_wasm_code_table_},
+      {tables::V8RegexpCodeTable::Name(), &v8_regexp_code_table_},
+      {tables::JitCodeTable::Name(), &jit_code_table_},
+      {tables::JitFrameTable::Name(), &jit_frame_table_},
+      {tables::SpeRecordTable::Name(), &spe_record_table_},
+      {tables::InputMethodClientsTable::Name(), &inputmethod_clients_table_},
+      {tables::InputMethodManagerServiceTable::Name(),
+       &inputmethod_manager_service_table_},
+      {tables::InputMethodServiceTable::Name(), &inputmethod_service_table_},
+      {tables::SurfaceFlingerLayersSnapshotTable::Name(),
+       &surfaceflinger_layers_snapshot_table_},
+      {tables::SurfaceFlingerLayerTable::Name(), &surfaceflinger_layer_table_},
+      {tables::SurfaceFlingerTransactionsTable::Name(),
+       &surfaceflinger_transactions_table_},
+      {tables::ViewCaptureTable::Name(), &viewcapture_table_},
+      {tables::WindowManagerTable::Name(), &windowmanager_table_},
+      {tables::WindowManagerShellTransitionsTable::Name(),
+       &window_manager_shell_transitions_table_},
+      {tables::WindowManagerShellTransitionHandlersTable::Name(),
+       &window_manager_shell_transition_handlers_table_},
+      {tables::ProtoLogTable::Name(), &protolog_table_},
+      {tables::ExperimentalProtoPathTable::Name(),
+       &experimental_proto_path_table_},
+      {tables::ExperimentalProtoContentTable::Name(),
+       &experimental_proto_content_table_},
+      {tables::ExpMissingChromeProcTable::Name(),
+       &experimental_missing_chrome_processes_table_},
+  };
+}
+
+std::vector<std::pair<const char*, const Table*>> TraceStorage::GetAllTables()
+    const {
+  auto tables = const_cast<TraceStorage*>(this)->GetAllMutableTables();
+  return {tables.begin(), tables.end()};
+}
+
+
 uint32_t TraceStorage::SqlStats::RecordQueryBegin(const std::string& query,
                                                   int64_t time_started) {
   if (queries_.size() >= kMaxLogEntries) {
@@ -67,12 +197,16 @@ uint32_t TraceStorage::SqlStats::RecordQueryBegin(const std::string& query,
     times_started_.pop_front();
     times_first_next_.pop_front();
     times_ended_.pop_front();
+    cache_hits_.pop_front();
+    cache_misses_.pop_front();
     popped_queries_++;
   }
   queries_.push_back(query);
   times_started_.push_back(time_started);
   times_first_next_.push_back(0);
   times_ended_.push_back(0);
+  cache_hits_.push_back(0);
+  cache_misses_.push_back(0);
   return static_cast<uint32_t>(popped_queries_ + queries_.size() - 1);
 }
 
@@ -97,4 +231,17 @@ void TraceStorage::SqlStats::RecordQueryEnd(uint32_t row, int64_t time_ended) {
   times_ended_[queue_row] = time_ended;
 }
 
+void TraceStorage::SqlStats::RecordQueryCacheStats(uint32_t row,
+                                                   uint32_t cache_hits,
+                                                   uint32_t cache_misses) {
+  // This means we've popped this query off the queue of queries before it had
+  // a chance to finish. Just silently drop this number.
+  if (popped_queries_ > row)
+    return;
+  uint32_t queue_row = row - popped_queries_;
+  PERFETTO_DCHECK(queue_row < queries_.size());
+  cache_hits_[queue_row] = cache_hits;
+  cache_misses_[queue_row] = cache_misses;
+}
+
 }  // namespace perfetto::trace_processor
@@ -40,6 +40,7 @@
 #include "src/trace_processor/containers/null_term_string_view.h"
 #include "src/trace_processor/containers/string_pool.h"
 #include "src/trace_processor/db/column/types.h"
+#include "src/trace_processor/db/table.h"
 #include "src/trace_processor/db/typed_column_internal.h"
 #include "src/trace_processor/storage/stats.h"
 #include "src/trace_processor/tables/android_tables_py.h"
@@ -201,6 +202,9 @@ class TraceStorage {
     uint32_t RecordQueryBegin(const std::string& query, int64_t time_started);
     void RecordQueryFirstNext(uint32_t row, int64_t time_first_next);
     void RecordQueryEnd(uint32_t row, int64_t time_end);
+    void RecordQueryCacheStats(uint32_t row,
+                               uint32_t cache_hits,
+                               uint32_t cache_misses);
     size_t size() const { return queries_.size(); }
     const std::deque<std::string>& queries() const { return queries_; }
     const std::deque<int64_t>& times_started() const { return times_started_; }
@@ -208,6 +212,8 @@ class TraceStorage {
       return times_first_next_;
     }
     const std::deque<int64_t>& times_ended() const { return times_ended_; }
+    const std::deque<uint32_t>& cache_hits() const { return cache_hits_; }
+    const std::deque<uint32_t>& cache_misses() const { return cache_misses_; }
 
    private:
     uint32_t popped_queries_ = 0;
@@ -216,6 +222,8 @@ class TraceStorage {
     std::deque<int64_t> times_started_;
     std::deque<int64_t> times_first_next_;
     std::deque<int64_t> times_ended_;
+    std::deque<uint32_t> cache_hits_;
+    std::deque<uint32_t> cache_misses_;
   };
 
   struct Stats {
@@ -336,6 +344,11 @@ class TraceStorage {
     heap_graph_reference_table_.ShrinkToFit();
   }
 
+  // Returns all the tables in the storage together with their names. Parent
+  // tables are always returned before their children.
+  std::vector<std::pair<const char*, const Table*>> GetAllTables() const;
+  std::vector<std::pair<const char*, Table*>> GetAllMutableTables();
+
   const tables::ThreadTable& thread_table() const { return thread_table_; }
   tables::ThreadTable* mutable_thread_table() { return &thread_table_; }
 
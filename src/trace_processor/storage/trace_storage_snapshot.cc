@@ -0,0 +1,217 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "src/trace_processor/storage/trace_storage_snapshot.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <utility>
+
+#include "perfetto/base/status.h"
+#include "perfetto/ext/base/string_view.h"
+#include "src/trace_processor/containers/string_pool.h"
+#include "src/trace_processor/db/table_snapshot.h"
+#include "src/trace_processor/storage/stats.h"
+#include "src/trace_processor/storage/trace_storage.h"
+#include "src/trace_processor/util/snapshot_file.h"
+#include "src/trace_processor/util/status_macros.h"
+
+namespace perfetto::trace_processor {
+namespace {
+
+using util::SnapshotReader;
+using util::SnapshotWriter;
+
+// Strings are written in the iteration order of the pool, which is the order in
+// which they were interned. Interning them again in the same order into a new
+// pool reproduces exactly the same ids.
+void WriteStringPool(const StringPool& pool, SnapshotWriter* writer) {
+  uint64_t count = 0;
+  for (auto it = pool.CreateIterator(); it; ++it) {
+    count += !it.StringId().is_null();
+  }
+  writer->WriteU64(count);
+  for (auto it = pool.CreateIterator(); it; ++it) {
+    if (it.StringId().is_null()) {
+      continue;
+    }
+    writer->WriteU32(it.StringId().raw_id());
+    writer->WriteString(it.StringView());
+  }
+}
+
+base::Status ReadStringPool(SnapshotReader* reader, StringPool* pool) {
+  uint64_t count = reader->ReadU64();
+  for (uint64_t i = 0; i < count && reader->ok(); ++i) {
+    uint32_t raw_id = reader->ReadU32();
+    base::StringView str = reader->ReadString();
+    if (!reader->ok()) {
+      break;
+    }
+    if (pool->InternString(str).raw_id() != raw_id) {
+      return base::ErrStatus("Snapshot string pool is inconsistent");
+    }
+  }
+  return reader->status();
+}
+
+void WriteStats(const TraceStorage::StatsMap& stats, SnapshotWriter* writer) {
+  uint32_t count = 0;
+  for (const auto& stat : stats) {
+    count += stat.value != 0 || !stat.indexed_values.empty();
+  }
+  writer->WriteU32(count);
+  for (size_t key = 0; key < stats::kNumKeys; ++key) {
+    const TraceStorage::Stats& stat = stats[key];
+    if (stat.value == 0 && stat.indexed_values.empty()) {
+      continue;
+    }
+    writer->WriteString(stats::kNames[key]);
+    writer->WriteI64(stat.value);
+    writer->WriteU32(static_cast<uint32_t>(stat.indexed_values.size()));
+    for (const auto& [index, value] : stat.indexed_values) {
+      writer->WriteI64(index);
+      writer->WriteI64(value);
+    }
+  }
+}
+
+std::optional<size_t> StatsKeyForName(base::StringView name) {
+  for (size_t key = 0; key < stats::kNumKeys; ++key) {
+    if (name == base::StringView(stats::kNames[key])) {
+      return key;
+    }
+  }
+  return std::nullopt;
+}
+
+base::Status ReadStats(SnapshotReader* reader, TraceStorage* storage) {
+  uint32_t count = reader->ReadU32();
+  for (uint32_t i = 0; i < count && reader->ok(); ++i) {
+    base::StringView name = reader->ReadString();
+    int64_t value = reader->ReadI64();
+    uint32_t indexed_count = reader->ReadU32();
+    RETURN_IF_ERROR(reader->status());
+
+    std::optional<size_t> key = StatsKeyForName(name);
+    if (!key) {
+      return base::ErrStatus("Snapshot contains unknown stat %s",
+                             name.ToStdString().c_str());
+    }
+    if (stats::kTypes[*key] == stats::kSingle) {
+      if (indexed_count != 0) {
+        return base::ErrStatus("Snapshot stat %s should not be indexed",
+                               stats::kNames[*key]);
+      }
+      storage->SetStats(*key, value);
+      continue;
+    }
+    for (uint32_t j = 0; j < indexed_count && reader->ok(); ++j) {
+      auto index = static_cast<int>(reader->ReadI64());
+      int64_t indexed_value = reader->ReadI64();
+      storage->SetIndexedStats(*key, index, indexed_value);
+    }
+  }
+  return reader->status();
+}
+
+void WriteVirtualTrackSlices(const TraceStorage::VirtualTrackSlices& slices,
+                             SnapshotWriter* writer) {
+  writer->WriteU32(slices.slice_count());
+  for (uint32_t i = 0; i < slices.slice_count(); ++i) {
+    writer->WriteU32(slices.slice_ids()[i].value);
+    writer->WriteI64(slices.thread_timestamp_ns()[i]);
+    writer->WriteI64(slices.thread_duration_ns()[i]);
+    writer->WriteI64(slices.thread_instruction_counts()[i]);
+    writer->WriteI64(slices.thread_instruction_deltas()[i]);
+  }
+}
+
+base::Status ReadVirtualTrackSlices(SnapshotReader* reader,
+                                    TraceStorage::VirtualTrackSlices* slices) {
+  uint32_t count = reader->ReadU32();
+  for (uint32_t i = 0; i < count && reader->ok(); ++i) {
+    SliceId slice_id(reader->ReadU32());
+    int64_t thread_timestamp_ns = reader->ReadI64();
+    int64_t thread_duration_ns = reader->ReadI64();
+    int64_t thread_instruction_count = reader->ReadI64();
+    int64_t thread_instruction_delta = reader->ReadI64();
+    slices->AddVirtualTrackSlice(slice_id, thread_timestamp_ns,
+                                 thread_duration_ns, thread_instruction_count,
+                                 thread_instruction_delta);
+  }
+  return reader->status();
+}
+
+}  // namespace
+
+base::Status WriteTraceStorageSnapshot(const TraceStorage& storage,
+                                       const std::string& path) {
+  ASSIGN_OR_RETURN(SnapshotWriter writer, SnapshotWriter::Create(path));
+
+  WriteStringPool(storage.string_pool(), &writer);
+  WriteStats(storage.stats(), &writer);
+  WriteVirtualTrackSlices(storage.virtual_track_slices(), &writer);
+
+  auto tables = storage.GetAllTables();
+  writer.WriteU32(static_cast<uint32_t>(tables.size()));
+  for (const auto& [name, table] : tables) {
+    writer.WriteString(name);
+    TableSnapshot::Write(*table, &writer);
+  }
+  return writer.Finalize();
+}
+
+base::Status ReadTraceStorageSnapshot(const std::string& path,
+                                      TraceStorage* storage) {
+  ASSIGN_OR_RETURN(SnapshotReader reader, SnapshotReader::Open(path));
+
+  RETURN_IF_ERROR(ReadStringPool(&reader, storage->mutable_string_pool()));
+  RETURN_IF_ERROR(ReadStats(&reader, storage));
+  RETURN_IF_ERROR(ReadVirtualTrackSlices(
+      &reader, storage->mutable_virtual_track_slices()));
+
+  auto tables = storage->GetAllMutableTables();
+  uint32_t table_count = reader.ReadU32();
+  RETURN_IF_ERROR(reader.status());
+  if (table_count != tables.size()) {
+    return base::ErrStatus(
+        "Snapshot contains %u tables, expected %zu: the snapshot was likely "
+        "written by a different version of trace processor",
+        table_count, tables.size());
+  }
+  for (const auto& [name, table] : tables) {
+    base::StringView snapshot_name = reader.ReadString();
+    RETURN_IF_ERROR(reader.status());
+    if (snapshot_name != base::StringView(name)) {
+      return base::ErrStatus("Snapshot contains table %s, expected %s",
+                             snapshot_name.ToStdString().c_str(), name);
+    }
+    base::Status status = TableSnapshot::Read(&reader, table);
+    if (!status.ok()) {
+      return base::ErrStatus("Failed to restore table %s: %s", name,
+                             status.c_message());
+    }
+  }
+  if (!reader.AtEnd()) {
+    return base::ErrStatus("Snapshot file has trailing data");
+  }
+  return base::OkStatus();
+}
+
+}  // namespace perfetto::trace_processor
@@ -0,0 +1,45 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_TRACE_PROCESSOR_STORAGE_TRACE_STORAGE_SNAPSHOT_H_
+#define SRC_TRACE_PROCESSOR_STORAGE_TRACE_STORAGE_SNAPSHOT_H_
+
+#include <string>
+
+#include "perfetto/base/status.h"
+
+namespace perfetto::trace_processor {
+
+class TraceStorage;
+
+// Writes the contents of |storage| (the string pool, the stats and all the
+// tables) to a snapshot file at |path|.
+//
+// Note: anything which is not part of TraceStorage (e.g. tables and views
+// created through SQL or the state of the importers) is not part of the
+// snapshot.
+base::Status WriteTraceStorageSnapshot(const TraceStorage& storage,
+                                       const std::string& path);
+
+// Restores the contents of the snapshot file at |path| into |storage|. Only
+// valid on a newly constructed TraceStorage: on error, |storage| is left in an
+// unspecified state and should be discarded.
+base::Status ReadTraceStorageSnapshot(const std::string& path,
+                                      TraceStorage* storage);
+
+}  // namespace perfetto::trace_processor
+
+#endif  // SRC_TRACE_PROCESSOR_STORAGE_TRACE_STORAGE_SNAPSHOT_H_
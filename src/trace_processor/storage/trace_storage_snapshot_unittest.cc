@@ -0,0 +1,147 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "src/trace_processor/storage/trace_storage_snapshot.h"
+
+#include <cstdint>
+#include <optional>
+#include <string>
+
+#include "perfetto/ext/base/file_utils.h"
+#include "perfetto/ext/base/temp_file.h"
+#include "src/trace_processor/storage/stats.h"
+#include "src/trace_processor/storage/trace_storage.h"
+#include "src/trace_processor/tables/metadata_tables_py.h"
+#include "src/trace_processor/tables/track_tables_py.h"
+#include "test/gtest_and_gmock.h"
+
+namespace perfetto::trace_processor {
+namespace {
+
+class TraceStorageSnapshotTest : public ::testing::Test {
+ protected:
+  void PopulateStorage() {
+    tables::ThreadTable::Row thread;
+    thread.tid = 42;
+    thread.name = storage_.InternString("main");
+    thread.start_ts = 100;
+    storage_.mutable_thread_table()->Insert(thread);
+
+    tables::ThreadTable::Row unnamed_thread;
+    unnamed_thread.tid = 43;
+    storage_.mutable_thread_table()->Insert(unnamed_thread);
+
+    // Interleave plain tracks and thread tracks so that the overlay of the
+    // thread track table over the track table is not a contiguous range.
+    tables::TrackTable::Row track;
+    track.name = storage_.InternString("track");
+    storage_.mutable_track_table()->Insert(track);
+
+    tables::ThreadTrackTable::Row thread_track;
+    thread_track.name = storage_.InternString("thread_track");
+    thread_track.utid = 1;
+    storage_.mutable_thread_track_table()->Insert(thread_track);
+
+    storage_.mutable_track_table()->Insert(track);
+
+    storage_.SetStats(stats::android_log_num_failed, 7);
+    storage_.SetIndexedStats(stats::ftrace_cpu_bytes_begin, 2, 1024);
+  }
+
+  TraceStorage storage_;
+  base::TempFile file_ = base::TempFile::Create();
+};
+
+TEST_F(TraceStorageSnapshotTest, RoundTrip) {
+  PopulateStorage();
+  ASSERT_TRUE(WriteTraceStorageSnapshot(storage_, file_.path()).ok());
+
+  TraceStorage restored;
+  base::Status status = ReadTraceStorageSnapshot(file_.path(), &restored);
+  ASSERT_TRUE(status.ok()) << status.message();
+
+  const auto& threads = restored.thread_table();
+  ASSERT_EQ(threads.row_count(), 2u);
+  EXPECT_EQ(threads[0].tid(), 42u);
+  EXPECT_EQ(restored.GetString(*threads[0].name()).ToStdString(), "main");
+  EXPECT_EQ(threads[0].start_ts(), 100);
+  EXPECT_EQ(threads[1].tid(), 43u);
+  EXPECT_EQ(threads[1].name(), std::nullopt);
+  EXPECT_EQ(threads[1].start_ts(), std::nullopt);
+
+  const auto& tracks = restored.track_table();
+  ASSERT_EQ(tracks.row_count(), 3u);
+  EXPECT_EQ(restored.GetString(tracks[0].name()).ToStdString(), "track");
+  EXPECT_EQ(restored.GetString(tracks[1].name()).ToStdString(), "thread_track");
+  EXPECT_EQ(restored.GetString(tracks[2].name()).ToStdString(), "track");
+
+  const auto& thread_tracks = restored.thread_track_table();
+  ASSERT_EQ(thread_tracks.row_count(), 1u);
+  EXPECT_EQ(thread_tracks[0].id(), tracks[1].id());
+  EXPECT_EQ(restored.GetString(thread_tracks[0].name()).ToStdString(),
+            "thread_track");
+  EXPECT_EQ(thread_tracks[0].utid(), 1u);
+
+  EXPECT_EQ(restored.stats()[stats::android_log_num_failed].value, 7);
+  EXPECT_EQ(restored.GetIndexedStats(stats::ftrace_cpu_bytes_begin, 2), 1024);
+
+  // Strings interned after the restore should not clash with restored ones.
+  EXPECT_EQ(restored.InternString("main"), threads[0].name());
+  EXPECT_NE(restored.InternString("new string"), tracks[0].name());
+
+  // Rows inserted after the restore should be appended as usual.
+  tables::ThreadTrackTable::Row thread_track;
+  thread_track.name = restored.InternString("new_thread_track");
+  thread_track.utid = 0;
+  restored.mutable_thread_track_table()->Insert(thread_track);
+  ASSERT_EQ(restored.track_table().row_count(), 4u);
+  ASSERT_EQ(restored.thread_track_table().row_count(), 2u);
+  EXPECT_EQ(restored.thread_track_table()[1].id(),
+            restored.track_table()[3].id());
+}
+
+TEST_F(TraceStorageSnapshotTest, NonEmptyStorage) {
+  PopulateStorage();
+  ASSERT_TRUE(WriteTraceStorageSnapshot(storage_, file_.path()).ok());
+  ASSERT_FALSE(ReadTraceStorageSnapshot(file_.path(), &storage_).ok());
+}
+
+TEST_F(TraceStorageSnapshotTest, TruncatedSnapshot) {
+  PopulateStorage();
+  ASSERT_TRUE(WriteTraceStorageSnapshot(storage_, file_.path()).ok());
+
+  std::string contents;
+  ASSERT_TRUE(base::ReadFile(file_.path(), &contents));
+  base::TempFile truncated = base::TempFile::Create();
+  size_t truncated_size = contents.size() / 2;
+  ASSERT_EQ(base::WriteAll(*truncated, contents.data(), truncated_size),
+            static_cast<ssize_t>(truncated_size));
+
+  TraceStorage restored;
+  ASSERT_FALSE(ReadTraceStorageSnapshot(truncated.path(), &restored).ok());
+}
+
+TEST_F(TraceStorageSnapshotTest, NotASnapshot) {
+  std::string garbage = "this is not a snapshot";
+  ASSERT_EQ(base::WriteAll(*file_, garbage.data(), garbage.size()),
+            static_cast<ssize_t>(garbage.size()));
+
+  TraceStorage restored;
+  ASSERT_FALSE(ReadTraceStorageSnapshot(file_.path(), &restored).ok());
+}
+
+}  // namespace
+}  // namespace perfetto::trace_processor
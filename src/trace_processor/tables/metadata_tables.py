@@ -48,6 +48,38 @@ MACHINE_TABLE = Table(
                 '''
         }))
 
+TRACE_FILE_TABLE = Table(
+    python_module=__file__,
+    class_name='TraceFileTable',
+    sql_name='__intrinsic_trace_file',
+    columns=[
+        C('parent_id', CppOptional(CppSelfTableId())),
+        C('name', CppOptional(CppString())),
+        C('size', CppInt64()),
+        C('trace_type', CppString()),
+    ],
+    wrapping_sql_view=WrappingSqlView('trace_file'),
+    tabledoc=TableDoc(
+        doc='''
+            Metadata related to the trace file parsed. Note the order in which
+            the files appear in this table corresponds to the order in which
+            they are read and sent to the tokenization stage.
+        ''',
+        group='Misc',
+        columns={
+            'parent_id':
+                '''
+                  Parent file. E.g. files contained in a zip file will point to
+                  the zip file.
+                ''',
+            'name':
+                '''File name, if known, NULL otherwise''',
+            'size':
+                '''Size in bytes''',
+            'trace_type':
+                '''Trace type''',
+        }))
+
 PROCESS_TABLE = Table(
     python_module=__file__,
     class_name='ProcessTable',
@@ -64,6 +96,7 @@ PROCESS_TABLE = Table(
         C('cmdline', CppOptional(CppString())),
         C('arg_set_id', CppUint32()),
         C('machine_id', CppOptional(CppTableId(MACHINE_TABLE))),
+        C('trace_id', CppOptional(CppTableId(TRACE_FILE_TABLE))),
     ],
     wrapping_sql_view=WrappingSqlView(view_name='process',),
     tabledoc=TableDoc(
@@ -124,6 +157,13 @@ PROCESS_TABLE = Table(
                   Machine identifier, non-null for processes on a remote
                   machine.
                 ''',
+            'trace_id':
+                ColumnDoc(
+                    '''
+                  The trace this process belongs to. Useful when multiple traces
+                  are loaded in the same trace processor instance.
+                ''',
+                    joinable='trace_file.id'),
         }))
 
 THREAD_TABLE = Table(
@@ -139,6 +179,7 @@ THREAD_TABLE = Table(
         C('upid', CppOptional(CppTableId(PROCESS_TABLE))),
         C('is_main_thread', CppOptional(CppUint32())),
         C('machine_id', CppOptional(CppTableId(MACHINE_TABLE))),
+        C('trace_id', CppOptional(CppTableId(TRACE_FILE_TABLE))),
     ],
     wrapping_sql_view=WrappingSqlView(view_name='thread',),
     tabledoc=TableDoc(
@@ -189,6 +230,13 @@ THREAD_TABLE = Table(
                 '''
                   Machine identifier, non-null for threads on a remote machine.
                 ''',
+            'trace_id':
+                ColumnDoc(
+                    '''
+                  The trace this thread belongs to. Useful when multiple traces
+                  are loaded in the same trace processor instance.
+                ''',
+                    joinable='trace_file.id'),
         }))
 
 CPU_TABLE = Table(
@@ -202,6 +250,7 @@ CPU_TABLE = Table(
         C('machine_id', CppOptional(CppTableId(MACHINE_TABLE))),
         C('capacity', CppOptional(CppUint32())),
         C('arg_set_id', CppOptional(CppUint32())),
+        C('trace_id', CppOptional(CppTableId(TRACE_FILE_TABLE))),
     ],
     wrapping_sql_view=WrappingSqlView('cpu'),
     tabledoc=TableDoc(
@@ -229,6 +278,13 @@ CPU_TABLE = Table(
                 ''',
             'arg_set_id':
                 '''Extra args associated with the CPU''',
+            'trace_id':
+                ColumnDoc(
+                    '''
+                  The trace this CPU belongs to. Useful when multiple traces
+                  are loaded in the same trace processor instance.
+                ''',
+                    joinable='trace_file.id'),
         }))
 
 RAW_TABLE = Table(
@@ -451,38 +507,6 @@ otherwise.''',
                 ''',
         }))
 
-TRACE_FILE_TABLE = Table(
-    python_module=__file__,
-    class_name='TraceFileTable',
-    sql_name='__intrinsic_trace_file',
-    columns=[
-        C('parent_id', CppOptional(CppSelfTableId())),
-        C('name', CppOptional(CppString())),
-        C('size', CppInt64()),
-        C('trace_type', CppString()),
-    ],
-    wrapping_sql_view=WrappingSqlView('trace_file'),
-    tabledoc=TableDoc(
-        doc='''
-            Metadata related to the trace file parsed. Note the order in which
-            the files appear in this table corresponds to the order in which
-            they are read and sent to the tokenization stage.
-        ''',
-        group='Misc',
-        columns={
-            'parent_id':
-                '''
-                  Parent file. E.g. files contained in a zip file will point to
-                  the zip file.
-                ''',
-            'name':
-                '''File name, if known, NULL otherwise''',
-            'size':
-                '''Size in bytes''',
-            'trace_type':
-                '''Trace type''',
-        }))
-
 # Keep this list sorted.
 ALL_TABLES = [
     ARG_TABLE,
@@ -18,6 +18,7 @@
 #include <utility>
 #include <vector>
 
+#include "src/trace_processor/containers/row_map.h"
 #include "src/trace_processor/containers/string_pool.h"
 #include "src/trace_processor/db/column.h"
 #include "src/trace_processor/db/column/types.h"
@@ -116,6 +117,77 @@ TEST_F(PyTablesUnittest, FindById) {
   ASSERT_EQ(row_ref->arg_set_id(), 0u);
 }
 
+TEST_F(PyTablesUnittest, IndexRebuiltAfterInsert) {
+  event_.Insert(TestEventTable::Row(100, 3));
+  event_.Insert(TestEventTable::Row(101, 1));
+  event_.Insert(TestEventTable::Row(102, 3));
+
+  ASSERT_TRUE(event_
+                  .CreateIndex("arg_set_id_idx",
+                               {TestEventTable::ColumnIndex::arg_set_id},
+                               false)
+                  .ok());
+  ASSERT_EQ(event_.IndexedConstraintCount({event_.arg_set_id().eq(3)}), 1u);
+  ASSERT_EQ(event_.IndexedConstraintCount({event_.arg_set_id().gt(3)}), 1u);
+  ASSERT_EQ(event_.IndexedConstraintCount({event_.arg_set_id().ne(3)}), 0u);
+  ASSERT_EQ(event_.IndexedConstraintCount({event_.ts().eq(100)}), 0u);
+
+  // Rows inserted after the index was created should still be returned.
+  event_.Insert(TestEventTable::Row(103, 3));
+  event_.Insert(TestEventTable::Row(104, 0));
+
+  // Planning must not rebuild the now stale index.
+  ASSERT_EQ(event_.IndexedConstraintCount({event_.arg_set_id().eq(3)}), 0u);
+  ASSERT_FALSE(event_.GetIndex({TestEventTable::ColumnIndex::arg_set_id}));
+
+  Query q;
+  q.constraints = {event_.arg_set_id().eq(3)};
+  RowMap rm = event_.QueryToRowMap(q);
+  ASSERT_THAT(std::move(rm).TakeAsIndexVector(),
+              testing::ElementsAre(0u, 2u, 3u));
+  ASSERT_EQ(event_.IndexedConstraintCount({event_.arg_set_id().eq(3)}), 1u);
+
+  q.constraints = {event_.arg_set_id().lt(3)};
+  rm = event_.QueryToRowMap(q);
+  ASSERT_THAT(std::move(rm).TakeAsIndexVector(),
+              testing::ElementsAre(1u, 4u));
+}
+
+TEST_F(PyTablesUnittest, IndexRebuiltAfterSet) {
+  event_.Insert(TestEventTable::Row(100, 3));
+  event_.Insert(TestEventTable::Row(101, 1));
+  auto slice_row = slice_.Insert(TestSliceTable::Row(102, 3, 10)).row;
+
+  ASSERT_TRUE(event_
+                  .CreateIndex("arg_set_id_idx",
+                               {TestEventTable::ColumnIndex::arg_set_id},
+                               false)
+                  .ok());
+  ASSERT_TRUE(event_.GetIndex({TestEventTable::ColumnIndex::arg_set_id}));
+
+  // Changing an indexed value in place makes the index stale even though the
+  // number of rows did not change.
+  event_[1].set_arg_set_id(3);
+  ASSERT_EQ(event_.IndexedConstraintCount({event_.arg_set_id().eq(3)}), 0u);
+  ASSERT_FALSE(event_.GetIndex({TestEventTable::ColumnIndex::arg_set_id}));
+
+  Query q;
+  q.constraints = {event_.arg_set_id().eq(3)};
+  ASSERT_THAT(event_.QueryToRowMap(q).TakeAsIndexVector(),
+              testing::ElementsAre(0u, 1u, 2u));
+  ASSERT_EQ(event_.IndexedConstraintCount({event_.arg_set_id().eq(3)}), 1u);
+
+  // Child tables share the storage of the parent columns so changing a value
+  // through the child also makes the index of the parent stale.
+  slice_[slice_row].set_arg_set_id(4);
+  ASSERT_FALSE(event_.GetIndex({TestEventTable::ColumnIndex::arg_set_id}));
+  ASSERT_THAT(event_.QueryToRowMap(q).TakeAsIndexVector(),
+              testing::ElementsAre(0u, 1u));
+  q.constraints = {event_.arg_set_id().eq(4)};
+  ASSERT_THAT(event_.QueryToRowMap(q).TakeAsIndexVector(),
+              testing::ElementsAre(2u));
+}
+
 TEST_F(PyTablesUnittest, ChildFindById) {
   event_.Insert(TestEventTable::Row(50, 0));
   auto id_and_row = slice_.Insert(TestSliceTable::Row(100, 0, 10));
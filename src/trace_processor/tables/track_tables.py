@@ -28,6 +28,7 @@ from python.generators.trace_processor_table.public import TableDoc
 from python.generators.trace_processor_table.public import WrappingSqlView
 
 from src.trace_processor.tables.metadata_tables import CPU_TABLE, MACHINE_TABLE
+from src.trace_processor.tables.metadata_tables import TRACE_FILE_TABLE
 
 TRACK_TABLE = Table(
     python_module=__file__,
@@ -40,6 +41,7 @@ TRACK_TABLE = Table(
         C('machine_id', CppOptional(CppTableId(MACHINE_TABLE))),
         C("classification", CppOptional(CppString()), flags=ColumnFlag.HIDDEN),
         C("tags", CppOptional(CppUint32()), flags=ColumnFlag.HIDDEN),
+        C('trace_id', CppOptional(CppTableId(TRACE_FILE_TABLE))),
     ],
     wrapping_sql_view=WrappingSqlView('track'),
     tabledoc=TableDoc(
@@ -82,6 +84,13 @@ TRACK_TABLE = Table(
                 ColumnDoc(
                     doc='Additional details about the track.',
                     joinable='args.arg_set_id'),
+            'trace_id':
+                ColumnDoc(
+                    doc='''
+                      The trace this track belongs to. Useful when multiple
+                      traces are loaded in the same trace processor instance.
+                    ''',
+                    joinable='trace_file.id'),
         }))
 
 PROCESS_TRACK_TABLE = Table(
@@ -110,6 +110,16 @@ class TraceProcessorIntegrationTest : public ::testing::Test {
   base::Status LoadTrace(const char* name,
                          size_t min_chunk_size = 512,
                          size_t max_chunk_size = kMaxChunkSize) {
+    base::Status status = ParseTrace(name, min_chunk_size, max_chunk_size);
+    if (!status.ok())
+      return status;
+    return processor_->NotifyEndOfFile();
+  }
+
+  // Like LoadTrace but without calling NotifyEndOfFile.
+  base::Status ParseTrace(const char* name,
+                          size_t min_chunk_size = 512,
+                          size_t max_chunk_size = kMaxChunkSize) {
     EXPECT_LE(min_chunk_size, max_chunk_size);
     base::ScopedFstream f(
         fopen(base::GetTestDataPath(std::string("test/data/") + name).c_str(),
@@ -124,7 +134,7 @@ class TraceProcessorIntegrationTest : public ::testing::Test {
       if (!status.ok())
         return status;
     }
-    return processor_->NotifyEndOfFile();
+    return base::OkStatus();
   }
 
   Iterator Query(const std::string& query) {
@@ -152,6 +162,41 @@ TEST_F(TraceProcessorIntegrationTest, AndroidSchedAndPs) {
   ASSERT_FALSE(it.Next());
 }
 
+TEST_F(TraceProcessorIntegrationTest, MultipleTraces) {
+  ASSERT_TRUE(ParseTrace("android_sched_and_ps.pb").ok());
+  ASSERT_TRUE(Processor()->StartNewTrace().ok());
+  ASSERT_TRUE(LoadTrace("android_sched_and_ps.pb").ok());
+
+  // Each trace has its own swapper thread so tid is used rather than utid to
+  // exclude it.
+  auto it = Query(
+      "select count(*), max(ts) - min(ts) from sched join thread using (utid) "
+      "where dur != 0 and tid != 0 group by thread.trace_id "
+      "order by thread.trace_id");
+  for (uint32_t i = 0; i < 2; ++i) {
+    ASSERT_TRUE(it.Next());
+    ASSERT_EQ(it.Get(0).type, SqlValue::kLong);
+    ASSERT_EQ(it.Get(0).long_value, 139793);
+    ASSERT_EQ(it.Get(1).type, SqlValue::kLong);
+    ASSERT_EQ(it.Get(1).long_value, 19684308497);
+  }
+  ASSERT_FALSE(it.Next());
+
+  // Every thread, process, cpu and track belongs to one of the two traces.
+  it = Query(
+      "select count(distinct trace_id), sum(trace_id is null) from ("
+      "  select trace_id from thread"
+      "  union all select trace_id from process"
+      "  union all select trace_id from cpu"
+      "  union all select trace_id from track)");
+  ASSERT_TRUE(it.Next());
+  ASSERT_EQ(it.Get(0).long_value, 2);
+  ASSERT_EQ(it.Get(1).long_value, 0);
+  ASSERT_FALSE(it.Next());
+
+  ASSERT_FALSE(Processor()->StartNewTrace().ok());
+}
+
 TEST_F(TraceProcessorIntegrationTest, TraceBounds) {
   ASSERT_TRUE(LoadTrace("android_sched_and_ps.pb").ok());
   auto it = Query("select start_ts, end_ts from trace_bounds");
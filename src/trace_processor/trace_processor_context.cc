@@ -53,8 +53,13 @@
 
 namespace perfetto::trace_processor {
 
-TraceProcessorContext::TraceProcessorContext(const InitArgs& args)
-    : config(args.config), storage(args.storage) {
+TraceProcessorContext::TraceProcessorContext(const InitArgs& args) {
+  Init(args);
+}
+
+void TraceProcessorContext::Init(const InitArgs& args) {
+  config = args.config;
+  storage = args.storage;
   reader_registry = std::make_unique<TraceReaderRegistry>(this);
   // Init the trackers.
   machine_tracker.reset(new MachineTracker(this, args.raw_machine_id));
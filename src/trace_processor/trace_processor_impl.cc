@@ -33,6 +33,7 @@
 #include "perfetto/base/logging.h"
 #include "perfetto/base/status.h"
 #include "perfetto/base/time.h"
+#include "perfetto/ext/base/file_utils.h"
 #include "perfetto/ext/base/flat_hash_map.h"
 #include "perfetto/ext/base/small_vector.h"
 #include "perfetto/ext/base/status_or.h"
@@ -44,6 +45,8 @@
 #include "perfetto/trace_processor/iterator.h"
 #include "perfetto/trace_processor/trace_blob_view.h"
 #include "perfetto/trace_processor/trace_processor.h"
+#include "src/trace_processor/db/table.h"
+#include "src/trace_processor/db/table_columnar_export.h"
 #include "src/trace_processor/importers/android_bugreport/android_log_event_parser_impl.h"
 #include "src/trace_processor/importers/android_bugreport/android_log_reader.h"
 #include "src/trace_processor/importers/art_method/art_method_parser_impl.h"
@@ -117,6 +120,7 @@
 #include "src/trace_processor/sqlite/sql_stats_table.h"
 #include "src/trace_processor/sqlite/stats_table.h"
 #include "src/trace_processor/storage/trace_storage.h"
+#include "src/trace_processor/storage/trace_storage_snapshot.h"
 #include "src/trace_processor/tp_metatrace.h"
 #include "src/trace_processor/trace_processor_storage_impl.h"
 #include "src/trace_processor/trace_reader_registry.h"
@@ -390,6 +394,51 @@ std::pair<int64_t, int64_t> GetTraceTimestampBoundsNs(
 
 TraceProcessorImpl::TraceProcessorImpl(const Config& cfg)
     : TraceProcessorStorageImpl(cfg), config_(cfg) {
+#if !PERFETTO_BUILDFLAG(PERFETTO_OS_WASM)
+  if (cfg.query_thread_count > 0) {
+    query_thread_pool_ =
+        std::make_unique<base::ThreadPool>(cfg.query_thread_count);
+  }
+#endif
+  RegisterAdditionalImporters();
+
+  // Add metrics to descriptor pool
+  const std::vector<std::string> sanitized_extension_paths =
+      SanitizeMetricMountPaths(config_.skip_builtin_metric_paths);
+  std::vector<std::string> skip_prefixes;
+  skip_prefixes.reserve(sanitized_extension_paths.size());
+  for (const auto& path : sanitized_extension_paths) {
+    skip_prefixes.push_back(kMetricProtoRoot + path);
+  }
+  pool_.AddFromFileDescriptorSet(kMetricsDescriptor.data(),
+                                 kMetricsDescriptor.size(), skip_prefixes);
+  pool_.AddFromFileDescriptorSet(kAllChromeMetricsDescriptor.data(),
+                                 kAllChromeMetricsDescriptor.size(),
+                                 skip_prefixes);
+  pool_.AddFromFileDescriptorSet(kAllWebviewMetricsDescriptor.data(),
+                                 kAllWebviewMetricsDescriptor.size(),
+                                 skip_prefixes);
+
+  InitPerfettoSqlEngine();
+
+  sqlite_objects_post_constructor_initialization_ =
+      engine_->SqliteRegisteredObjectCount();
+
+  bool skip_all_sql = std::find(config_.skip_builtin_metric_paths.begin(),
+                                config_.skip_builtin_metric_paths.end(),
+                                "") != config_.skip_builtin_metric_paths.end();
+  if (!skip_all_sql) {
+    for (const auto& file_to_sql : sql_metrics::kFileToSql) {
+      if (base::StartsWithAny(file_to_sql.path, sanitized_extension_paths))
+        continue;
+      RegisterMetric(file_to_sql.path, file_to_sql.sql);
+    }
+  }
+}
+
+TraceProcessorImpl::~TraceProcessorImpl() = default;
+
+void TraceProcessorImpl::RegisterAdditionalImporters() {
   context_.reader_registry->RegisterTraceReader<AndroidLogReader>(
       kAndroidLogcatTraceType);
   context_.android_log_event_parser =
@@ -454,45 +503,14 @@ TraceProcessorImpl::TraceProcessorImpl(const Config& cfg)
         std::make_unique<ProtoContentAnalyzer>(&context_);
   }
 
-  // Add metrics to descriptor pool
-  const std::vector<std::string> sanitized_extension_paths =
-      SanitizeMetricMountPaths(config_.skip_builtin_metric_paths);
-  std::vector<std::string> skip_prefixes;
-  skip_prefixes.reserve(sanitized_extension_paths.size());
-  for (const auto& path : sanitized_extension_paths) {
-    skip_prefixes.push_back(kMetricProtoRoot + path);
-  }
-  pool_.AddFromFileDescriptorSet(kMetricsDescriptor.data(),
-                                 kMetricsDescriptor.size(), skip_prefixes);
-  pool_.AddFromFileDescriptorSet(kAllChromeMetricsDescriptor.data(),
-                                 kAllChromeMetricsDescriptor.size(),
-                                 skip_prefixes);
-  pool_.AddFromFileDescriptorSet(kAllWebviewMetricsDescriptor.data(),
-                                 kAllWebviewMetricsDescriptor.size(),
-                                 skip_prefixes);
-
   RegisterAdditionalModules(&context_);
-  InitPerfettoSqlEngine();
-
-  sqlite_objects_post_constructor_initialization_ =
-      engine_->SqliteRegisteredObjectCount();
-
-  bool skip_all_sql = std::find(config_.skip_builtin_metric_paths.begin(),
-                                config_.skip_builtin_metric_paths.end(),
-                                "") != config_.skip_builtin_metric_paths.end();
-  if (!skip_all_sql) {
-    for (const auto& file_to_sql : sql_metrics::kFileToSql) {
-      if (base::StartsWithAny(file_to_sql.path, sanitized_extension_paths))
-        continue;
-      RegisterMetric(file_to_sql.path, file_to_sql.sql);
-    }
-  }
 }
 
-TraceProcessorImpl::~TraceProcessorImpl() = default;
-
 base::Status TraceProcessorImpl::Parse(TraceBlobView blob) {
   bytes_parsed_ += blob.size();
+
+  // Parsing adds rows to the tables so cached results are stale.
+  engine_->InvalidateQueryCache();
   return TraceProcessorStorageImpl::Parse(std::move(blob));
 }
 
@@ -507,10 +525,82 @@ void TraceProcessorImpl::SetCurrentTraceName(const std::string& name) {
   current_trace_name_ = name;
 }
 
+base::Status TraceProcessorImpl::SaveSnapshot(const std::string& path) {
+  if (!notify_eof_called_) {
+    return base::ErrStatus(
+        "SaveSnapshot can only be called after NotifyEndOfFile");
+  }
+  return WriteTraceStorageSnapshot(*context_.storage, path);
+}
+
+base::Status TraceProcessorImpl::LoadSnapshot(const std::string& path) {
+  if (notify_eof_called_ || bytes_parsed_ > 0) {
+    return base::ErrStatus(
+        "LoadSnapshot can only be called before any trace data is parsed");
+  }
+
+  // Restore into a separate storage so that a failure to read the snapshot
+  // leaves this instance untouched.
+  auto storage = std::make_shared<TraceStorage>(config_);
+  RETURN_IF_ERROR(ReadTraceStorageSnapshot(path, storage.get()));
+
+  // Loading a snapshot is equivalent to the end of the trace: there is nothing
+  // left to import so tear down the importers before swapping the storage.
+  notify_eof_called_ = true;
+  if (current_trace_name_.empty())
+    current_trace_name_ = "Unnamed trace";
+  TraceProcessorStorageImpl::DestroyContext();
+
+  // The heap graph tracker keeps a pointer to the storage it was created with:
+  // drop it so it's lazily recreated on top of the restored storage.
+  context_.heap_graph_tracker.reset();
+  context_.storage = std::move(storage);
+
+  // Recreate the engine so that all the tables and functions are bound to the
+  // restored storage. This also rebuilds the trace bounds table.
+  InitPerfettoSqlEngine();
+  PERFETTO_CHECK(engine_->SqliteRegisteredObjectCount() ==
+                 sqlite_objects_post_constructor_initialization_);
+  return base::OkStatus();
+}
+
+base::Status TraceProcessorImpl::ExportColumnar(
+    const std::string& output_dir,
+    const std::vector<std::string>& table_names) {
+  std::vector<std::string> names = table_names;
+  if (names.empty()) {
+    auto it = ExecuteQuery("SELECT name FROM perfetto_tables ORDER BY name");
+    while (it.Next()) {
+      names.emplace_back(it.Get(0).AsString());
+    }
+    RETURN_IF_ERROR(it.Status());
+  }
+  if (!base::FileExists(output_dir) && !base::Mkdir(output_dir)) {
+    return base::ErrStatus("Unable to create directory %s",
+                           output_dir.c_str());
+  }
+  for (const std::string& name : names) {
+    // The tables of included modules may not be computed yet (see
+    // Config::lazy_module_tables).
+    RETURN_IF_ERROR(engine_->CreateLazyTable(name).status());
+    const Table* table = engine_->GetTableOrNull(name);
+    if (!table) {
+      return base::ErrStatus("ExportColumnar: no table named %s",
+                             name.c_str());
+    }
+    RETURN_IF_ERROR(TableColumnarExport::WriteToFile(
+        *table, context_.storage->string_pool(),
+        output_dir + "/" + name + ".pfcol"));
+  }
+  return base::OkStatus();
+}
+
 void TraceProcessorImpl::Flush() {
+  engine_->InvalidateQueryCache();
   TraceProcessorStorageImpl::Flush();
   BuildBoundsTable(engine_->sqlite_engine()->db(),
                    GetTraceTimestampBoundsNs(*context_.storage));
+  UpdateIncrementalQueries();
 }
 
 base::Status TraceProcessorImpl::NotifyEndOfFile() {
@@ -539,11 +629,35 @@ base::Status TraceProcessorImpl::NotifyEndOfFile() {
   // the end to flush all their data.
   BuildBoundsTable(engine_->sqlite_engine()->db(),
                    GetTraceTimestampBoundsNs(*context_.storage));
+  UpdateIncrementalQueries();
 
   TraceProcessorStorageImpl::DestroyContext();
   return base::OkStatus();
 }
 
+base::Status TraceProcessorImpl::StartNewTrace() {
+  if (notify_eof_called_) {
+    return base::ErrStatus(
+        "StartNewTrace cannot be called after NotifyEndOfFile");
+  }
+  if (!parser_) {
+    return base::OkStatus();
+  }
+
+  // Last opportunity to flush all pending data of the current trace.
+  Flush();
+
+  RETURN_IF_ERROR(TraceProcessorStorageImpl::StartNewTrace());
+  RegisterAdditionalImporters();
+
+  // Finishing the current trace might have added rows to the tables.
+  engine_->InvalidateQueryCache();
+  BuildBoundsTable(engine_->sqlite_engine()->db(),
+                   GetTraceTimestampBoundsNs(*context_.storage));
+  UpdateIncrementalQueries();
+  return base::OkStatus();
+}
+
 size_t TraceProcessorImpl::RestoreInitialTables() {
   // We should always have at least as many objects now as we did in the
   // constructor.
@@ -570,7 +684,13 @@ Iterator TraceProcessorImpl::ExecuteQuery(const std::string& sql) {
   std::string non_breaking_sql = base::ReplaceAll(sql, "\u00A0", " ");
   base::StatusOr<PerfettoSqlEngine::ExecutionResult> result =
       engine_->ExecuteUntilLastStatement(
-          SqlSource::FromExecuteQuery(std::move(non_breaking_sql)));
+          SqlSource::FromExecuteQuery(std::move(non_breaking_sql)),
+          /*use_query_cache=*/true);
+  if (result.ok()) {
+    context_.storage->mutable_sql_stats()->RecordQueryCacheStats(
+        sql_stats_row, result->stats.query_cache_hits,
+        result->stats.query_cache_misses);
+  }
   std::unique_ptr<IteratorImpl> impl(
       new IteratorImpl(this, std::move(result), sql_stats_row));
   return Iterator(std::move(impl));
@@ -620,6 +740,34 @@ base::Status TraceProcessorImpl::RegisterSqlPackage(SqlPackage sql_package) {
   return base::OkStatus();
 }
 
+base::Status TraceProcessorImpl::RegisterIncrementalQuery(
+    IncrementalQuery query) {
+  for (const auto& updater : incremental_queries_) {
+    if (updater.name() == query.name) {
+      return base::ErrStatus("Incremental query '%s' is already registered",
+                             query.name.c_str());
+    }
+  }
+  ASSIGN_OR_RETURN(IncrementalQueryUpdater updater,
+                   IncrementalQueryUpdater::Create(std::move(query)));
+
+  // Creates the result table over the rows already parsed.
+  RETURN_IF_ERROR(updater.Update(engine_.get()));
+  incremental_queries_.push_back(std::move(updater));
+  return base::OkStatus();
+}
+
+void TraceProcessorImpl::UpdateIncrementalQueries() {
+  for (auto& updater : incremental_queries_) {
+    base::Status status = updater.Update(engine_.get());
+    if (!status.ok()) {
+      // The rows will be picked up by the next successful update.
+      PERFETTO_ELOG("Failed to update incremental query %s: %s",
+                    updater.name().c_str(), status.c_message());
+    }
+  }
+}
+
 base::Status TraceProcessorImpl::RegisterMetric(const std::string& path,
                                                 const std::string& sql) {
   // Check if the metric with the given path already exists and if it does,
@@ -669,6 +817,7 @@ base::Status TraceProcessorImpl::RegisterMetric(const std::string& path,
   }
 
   if (metric.proto_field_name) {
+    engine_->InvalidateQueryCache();
     InsertIntoTraceMetricsTable(engine_->sqlite_engine()->db(),
                                 *metric.proto_field_name);
   }
@@ -738,8 +887,13 @@ void TraceProcessorImpl::EnableMetatrace(MetatraceConfig config) {
 }
 
 void TraceProcessorImpl::InitPerfettoSqlEngine() {
+  // The result tables of incremental queries are dropped with the engine.
+  incremental_queries_.clear();
   engine_.reset(new PerfettoSqlEngine(context_.storage->mutable_string_pool(),
-                                      config_.enable_extra_checks));
+                                      config_.enable_extra_checks,
+                                      query_thread_pool_.get(),
+                                      config_.query_cache_size_bytes,
+                                      config_.lazy_module_tables));
   sqlite3* db = engine_->sqlite_engine()->db();
   sqlite3_str_split_init(db);
 
@@ -28,11 +28,13 @@
 #include <vector>
 
 #include "perfetto/base/status.h"
+#include "perfetto/ext/base/threading/thread_pool.h"
 #include "perfetto/trace_processor/basic_types.h"
 #include "perfetto/trace_processor/trace_blob_view.h"
 #include "perfetto/trace_processor/trace_processor.h"
 #include "src/trace_processor/iterator_impl.h"
 #include "src/trace_processor/metrics/metrics.h"
+#include "src/trace_processor/perfetto_sql/engine/incremental_query_updater.h"
 #include "src/trace_processor/perfetto_sql/engine/perfetto_sql_engine.h"
 #include "src/trace_processor/perfetto_sql/intrinsics/functions/create_function.h"
 #include "src/trace_processor/perfetto_sql/intrinsics/functions/create_view_function.h"
@@ -60,6 +62,7 @@ class TraceProcessorImpl : public TraceProcessor,
   base::Status Parse(TraceBlobView) override;
   void Flush() override;
   base::Status NotifyEndOfFile() override;
+  base::Status StartNewTrace() override;
 
   // TraceProcessor implementation:
   Iterator ExecuteQuery(const std::string& sql) override;
@@ -69,6 +72,8 @@ class TraceProcessorImpl : public TraceProcessor,
 
   base::Status RegisterSqlPackage(SqlPackage) override;
 
+  base::Status RegisterIncrementalQuery(IncrementalQuery) override;
+
   base::Status ExtendMetricsProto(const uint8_t* data, size_t size) override;
 
   base::Status ExtendMetricsProto(
@@ -92,6 +97,13 @@ class TraceProcessorImpl : public TraceProcessor,
   std::string GetCurrentTraceName() override;
   void SetCurrentTraceName(const std::string&) override;
 
+  base::Status SaveSnapshot(const std::string& path) override;
+  base::Status LoadSnapshot(const std::string& path) override;
+
+  base::Status ExportColumnar(
+      const std::string& output_dir,
+      const std::vector<std::string>& table_names) override;
+
   void EnableMetatrace(MetatraceConfig config) override;
 
   base::Status DisableAndReadMetatrace(
@@ -118,9 +130,22 @@ class TraceProcessorImpl : public TraceProcessor,
 
   bool IsRootMetricField(const std::string& metric_name);
 
+  // Registers the importers for all the non-proto trace formats on |context_|.
+  void RegisterAdditionalImporters();
+
   void InitPerfettoSqlEngine();
 
+  // Merges the rows added to the trace tables since the last call into the
+  // results of all the incremental queries.
+  void UpdateIncrementalQueries();
+
   const Config config_;
+
+  // Used to parallelize filtering of large tables (see
+  // Config::query_thread_count). Null if parallel queries are disabled. Must
+  // outlive |engine_|.
+  std::unique_ptr<base::ThreadPool> query_thread_pool_;
+
   std::unique_ptr<PerfettoSqlEngine> engine_;
 
   DescriptorPool pool_;
@@ -131,6 +156,11 @@ class TraceProcessorImpl : public TraceProcessor,
   // them when running |RestoreInitialTables()|.
   std::vector<SqlPackage> manually_registered_sql_packages_;
 
+  // Incremental queries registered with |RegisterIncrementalQuery()|. Their
+  // result tables are runtime tables so, unlike SQL packages, they are not
+  // restored by |RestoreInitialTables()|.
+  std::vector<IncrementalQueryUpdater> incremental_queries_;
+
   std::unordered_map<std::string, std::string> proto_field_to_sql_metric_path_;
   std::unordered_map<std::string, std::string> proto_fn_name_to_path_;
 
@@ -86,6 +86,12 @@
 #include <signal.h>
 #endif
 
+#if PERFETTO_BUILDFLAG(PERFETTO_OS_LINUX) ||   \
+    PERFETTO_BUILDFLAG(PERFETTO_OS_ANDROID) || \
+    PERFETTO_BUILDFLAG(PERFETTO_OS_APPLE)
+#include <sys/resource.h>
+#endif
+
 #if PERFETTO_BUILDFLAG(PERFETTO_OS_WIN)
 #include <io.h>
 #define ftruncate _chsize
@@ -201,6 +207,33 @@ ScopedLine GetLine(const char* prompt) {
 
 #endif  // PERFETTO_TP_LINENOISE
 
+// Returns the peak resident set size of this process in bytes or std::nullopt
+// if this is not supported on the current platform.
+std::optional<uint64_t> GetPeakRssBytes() {
+#if PERFETTO_BUILDFLAG(PERFETTO_OS_LINUX) ||   \
+    PERFETTO_BUILDFLAG(PERFETTO_OS_ANDROID) || \
+    PERFETTO_BUILDFLAG(PERFETTO_OS_APPLE)
+  struct rusage usage {};
+  if (getrusage(RUSAGE_SELF, &usage) != 0)
+    return std::nullopt;
+  // ru_maxrss is in bytes on Apple platforms and in KB everywhere else.
+#if PERFETTO_BUILDFLAG(PERFETTO_OS_APPLE)
+  return static_cast<uint64_t>(usage.ru_maxrss);
+#else
+  return static_cast<uint64_t>(usage.ru_maxrss) * 1024;
+#endif
+#else
+  return std::nullopt;
+#endif
+}
+
+void MaybeLogPeakRss() {
+  std::optional<uint64_t> peak_rss = GetPeakRssBytes();
+  if (peak_rss) {
+    PERFETTO_ILOG("Peak RSS: %.2f MB", static_cast<double>(*peak_rss) / 1E6);
+  }
+}
+
 base::Status PrintStats() {
   auto it = g_tp->ExecuteQuery(
       "SELECT name, idx, source, value from stats "
@@ -704,10 +737,12 @@ struct CommandLineOptions {
   std::string query_string;
   std::string pre_metrics_path;
   std::string sqlite_file_path;
+  std::string columnar_export_dir;
+  std::vector<std::string> columnar_export_tables;
   std::string sql_module_path;
   std::string metric_names;
   std::string metric_output;
-  std::string trace_file_path;
+  std::vector<std::string> trace_file_paths;
   std::string port_number;
   std::string override_stdlib_path;
   std::vector<std::string> override_sql_module_paths;
@@ -718,6 +753,8 @@ struct CommandLineOptions {
   bool wide = false;
   bool force_full_sort = false;
   std::string metatrace_path;
+  std::string save_snapshot_path;
+  std::string load_snapshot_path;
   size_t metatrace_buffer_capacity = 0;
   metatrace::MetatraceCategories metatrace_categories =
       static_cast<metatrace::MetatraceCategories>(
@@ -728,13 +765,18 @@ struct CommandLineOptions {
   bool no_ftrace_raw = false;
   bool analyze_trace_proto_content = false;
   bool crop_track_events = false;
+  bool lazy_module_tables = false;
   std::vector<std::string> dev_flags;
 };
 
 void PrintUsage(char** argv) {
   PERFETTO_ELOG(R"(
 Interactive trace processor shell.
-Usage: %s [FLAGS] trace_file.pb
+Usage: %s [FLAGS] trace_file.pb [trace_file.pb ...]
+
+If multiple trace files are passed, they are all loaded in the same instance.
+The trace_id column of the process, thread, cpu and track tables tells which
+trace each row comes from.
 
 Options:
  -h, --help                           Prints this guide.
@@ -764,6 +806,15 @@ Options:
  -e, --export FILE                    Export the contents of trace processor
                                       into an SQLite database after running any
                                       metrics or queries specified.
+ --export-columnar DIR                Export the tables of trace processor into
+                                      DIR as compressed, typed columnar files
+                                      (one TABLE.pfcol file per table) after
+                                      running any metrics or queries specified.
+                                      Much faster than --export for large
+                                      traces.
+ --export-columnar-tables TABLES      A comma-separated list of the tables to
+                                      export with --export-columnar (default:
+                                      all the tables of the trace).
 
 Feature flags:
  --full-sort                          Forces the trace processor into performing
@@ -802,6 +853,11 @@ Standard library:
                                       passed contents. The outer directory will
                                       be ignored. Only allowed when --dev is
                                       specified.
+ --lazy-module-tables                 Only computes the tables and views of
+                                      included modules when a query first
+                                      uses them. Speeds up INCLUDE PERFETTO
+                                      MODULE but reports errors in the modules
+                                      later.
 
 Metrics:
  --run-metrics x,y,z                  Runs a comma separated list of metrics and
@@ -828,7 +884,18 @@ Metatracing:
  --metatrace-buffer-capacity N        Sets metatrace event buffer to capture
                                       last N events.
  --metatrace-categories CATEGORIES    A comma-separated list of metatrace
-                                      categories to enable.)",
+                                      categories to enable.
+
+Snapshots:
+ --save-snapshot FILE                 Writes a snapshot of the trace to FILE
+                                      once it has been loaded. Loading the
+                                      snapshot with --load-snapshot is much
+                                      faster than parsing the trace again.
+ --load-snapshot FILE                 Loads a snapshot previously written with
+                                      --save-snapshot instead of parsing a
+                                      trace file. Snapshots can only be loaded
+                                      by the same version of trace processor
+                                      which wrote them.)",
                 argv[0]);
 }
 
@@ -846,6 +913,7 @@ CommandLineOptions ParseCommandLineOptions(int argc, char** argv) {
     OPT_EXTRA_CHECKS,
     OPT_OVERRIDE_STDLIB,
     OPT_OVERRIDE_SQL_MODULE,
+    OPT_LAZY_MODULE_TABLES,
     OPT_NO_FTRACE_RAW,
     OPT_METATRACE_BUFFER_CAPACITY,
     OPT_METATRACE_CATEGORIES,
@@ -853,6 +921,10 @@ CommandLineOptions ParseCommandLineOptions(int argc, char** argv) {
     OPT_CROP_TRACK_EVENTS,
     OPT_DEV_FLAG,
     OPT_STDIOD,
+    OPT_SAVE_SNAPSHOT,
+    OPT_LOAD_SNAPSHOT,
+    OPT_EXPORT_COLUMNAR,
+    OPT_EXPORT_COLUMNAR_TABLES,
   };
 
   static const option long_options[] = {
@@ -867,6 +939,9 @@ CommandLineOptions ParseCommandLineOptions(int argc, char** argv) {
       {"stdiod", no_argument, nullptr, OPT_STDIOD},
       {"interactive", no_argument, nullptr, 'i'},
       {"export", required_argument, nullptr, 'e'},
+      {"export-columnar", required_argument, nullptr, OPT_EXPORT_COLUMNAR},
+      {"export-columnar-tables", required_argument, nullptr,
+       OPT_EXPORT_COLUMNAR_TABLES},
       {"metatrace", required_argument, nullptr, 'm'},
       {"metatrace-buffer-capacity", required_argument, nullptr,
        OPT_METATRACE_BUFFER_CAPACITY},
@@ -883,11 +958,14 @@ CommandLineOptions ParseCommandLineOptions(int argc, char** argv) {
       {"override-sql-module", required_argument, nullptr,
        OPT_OVERRIDE_SQL_MODULE},
       {"override-stdlib", required_argument, nullptr, OPT_OVERRIDE_STDLIB},
+      {"lazy-module-tables", no_argument, nullptr, OPT_LAZY_MODULE_TABLES},
       {"run-metrics", required_argument, nullptr, OPT_RUN_METRICS},
       {"pre-metrics", required_argument, nullptr, OPT_PRE_METRICS},
       {"metrics-output", required_argument, nullptr, OPT_METRICS_OUTPUT},
       {"metric-extension", required_argument, nullptr, OPT_METRIC_EXTENSION},
       {"dev-flag", required_argument, nullptr, OPT_DEV_FLAG},
+      {"save-snapshot", required_argument, nullptr, OPT_SAVE_SNAPSHOT},
+      {"load-snapshot", required_argument, nullptr, OPT_LOAD_SNAPSHOT},
       {nullptr, 0, nullptr, 0}};
 
   bool explicit_interactive = false;
@@ -954,6 +1032,17 @@ CommandLineOptions ParseCommandLineOptions(int argc, char** argv) {
       continue;
     }
 
+    if (option == OPT_EXPORT_COLUMNAR) {
+      command_line_options.columnar_export_dir = optarg;
+      continue;
+    }
+
+    if (option == OPT_EXPORT_COLUMNAR_TABLES) {
+      command_line_options.columnar_export_tables =
+          base::SplitString(optarg, ",");
+      continue;
+    }
+
     if (option == 'm') {
       command_line_options.metatrace_path = optarg;
       continue;
@@ -1006,6 +1095,11 @@ CommandLineOptions ParseCommandLineOptions(int argc, char** argv) {
       continue;
     }
 
+    if (option == OPT_LAZY_MODULE_TABLES) {
+      command_line_options.lazy_module_tables = true;
+      continue;
+    }
+
     if (option == OPT_OVERRIDE_SQL_MODULE) {
       command_line_options.override_sql_module_paths.push_back(optarg);
       continue;
@@ -1041,16 +1135,26 @@ CommandLineOptions ParseCommandLineOptions(int argc, char** argv) {
       continue;
     }
 
+    if (option == OPT_SAVE_SNAPSHOT) {
+      command_line_options.save_snapshot_path = optarg;
+      continue;
+    }
+
+    if (option == OPT_LOAD_SNAPSHOT) {
+      command_line_options.load_snapshot_path = optarg;
+      continue;
+    }
+
     PrintUsage(argv);
     exit(option == 'h' ? 0 : 1);
   }
 
+  const auto& opts = command_line_options;
   command_line_options.launch_shell =
-      explicit_interactive || (command_line_options.pre_metrics_path.empty() &&
-                               command_line_options.metric_names.empty() &&
-                               command_line_options.query_file_path.empty() &&
-                               command_line_options.query_string.empty() &&
-                               command_line_options.sqlite_file_path.empty());
+      explicit_interactive ||
+      (opts.pre_metrics_path.empty() && opts.metric_names.empty() &&
+       opts.query_file_path.empty() && opts.query_string.empty() &&
+       opts.sqlite_file_path.empty() && opts.columnar_export_dir.empty());
 
   // Only allow non-interactive queries to emit perf data.
   if (!command_line_options.perf_file_path.empty() &&
@@ -1059,11 +1163,17 @@ CommandLineOptions ParseCommandLineOptions(int argc, char** argv) {
     exit(1);
   }
 
-  // The only case where we allow omitting the trace file path is when running
-  // in --httpd or --stdiod mode. In all other cases, the last argument must be
-  // the trace file.
-  if (optind == argc - 1 && argv[optind]) {
-    command_line_options.trace_file_path = argv[optind];
+  // The trace file paths can be omitted when running in --httpd or --stdiod
+  // mode and must be omitted when loading a snapshot. In all other cases, the
+  // last arguments must be the trace files.
+  bool has_trace_file = optind < argc;
+  if (!command_line_options.load_snapshot_path.empty()) {
+    if (has_trace_file || !command_line_options.save_snapshot_path.empty()) {
+      PrintUsage(argv);
+      exit(1);
+    }
+  } else if (has_trace_file) {
+    command_line_options.trace_file_paths.assign(argv + optind, argv + argc);
   } else if (!command_line_options.enable_httpd &&
              !command_line_options.enable_stdiod) {
     PrintUsage(argv);
@@ -1132,7 +1242,7 @@ base::Status LoadTrace(const std::string& trace_file_path, double* size_mb) {
           }
         });
   }
-  return g_tp->NotifyEndOfFile();
+  return base::OkStatus();
 }
 
 base::Status RunQueries(const std::string& queries, bool expect_output) {
@@ -1627,6 +1737,7 @@ base::Status TraceProcessorMain(int argc, char** argv) {
       options.crop_track_events
           ? DropTrackEventDataBefore::kTrackEventRangeOfInterest
           : DropTrackEventDataBefore::kNoDrop;
+  config.lazy_module_tables = options.lazy_module_tables;
 
   std::vector<MetricExtension> metric_extensions;
   RETURN_IF_ERROR(ParseMetricExtensionPaths(
@@ -1688,19 +1799,46 @@ base::Status TraceProcessorMain(int argc, char** argv) {
   }
 
   base::TimeNanos t_load{};
-  if (!options.trace_file_path.empty()) {
+  if (!options.trace_file_paths.empty()) {
     base::TimeNanos t_load_start = base::GetWallTimeNs();
     double size_mb = 0;
-    RETURN_IF_ERROR(LoadTrace(options.trace_file_path, &size_mb));
+    for (size_t i = 0; i < options.trace_file_paths.size(); ++i) {
+      if (i > 0) {
+        RETURN_IF_ERROR(tp->StartNewTrace());
+      }
+      double trace_size_mb = 0;
+      RETURN_IF_ERROR(LoadTrace(options.trace_file_paths[i], &trace_size_mb));
+      size_mb += trace_size_mb;
+    }
+    RETURN_IF_ERROR(tp->NotifyEndOfFile());
     t_load = base::GetWallTimeNs() - t_load_start;
 
     double t_load_s = static_cast<double>(t_load.count()) / 1E9;
     PERFETTO_ILOG("Trace loaded: %.2f MB in %.2fs (%.1f MB/s)", size_mb,
                   t_load_s, size_mb / t_load_s);
+    MaybeLogPeakRss();
+
+    RETURN_IF_ERROR(PrintStats());
+  } else if (!options.load_snapshot_path.empty()) {
+    base::TimeNanos t_load_start = base::GetWallTimeNs();
+    RETURN_IF_ERROR(tp->LoadSnapshot(options.load_snapshot_path));
+    t_load = base::GetWallTimeNs() - t_load_start;
+
+    double t_load_s = static_cast<double>(t_load.count()) / 1E9;
+    PERFETTO_ILOG("Snapshot loaded in %.2fs", t_load_s);
+    MaybeLogPeakRss();
 
     RETURN_IF_ERROR(PrintStats());
   }
 
+  if (!options.save_snapshot_path.empty()) {
+    if (options.trace_file_paths.empty()) {
+      return base::ErrStatus("--save-snapshot requires a trace file");
+    }
+    RETURN_IF_ERROR(tp->SaveSnapshot(options.save_snapshot_path));
+    PERFETTO_ILOG("Snapshot written to %s", options.save_snapshot_path.c_str());
+  }
+
 #if PERFETTO_HAS_SIGNAL_H()
   // Set up interrupt signal to allow the user to abort query.
   signal(SIGINT, [](int) { g_tp->InterruptQuery(); });
@@ -1745,6 +1883,17 @@ base::Status TraceProcessorMain(int argc, char** argv) {
     RETURN_IF_ERROR(ExportTraceToDatabase(options.sqlite_file_path));
   }
 
+  if (!options.columnar_export_dir.empty()) {
+    base::TimeNanos t_export_start = base::GetWallTimeNs();
+    RETURN_IF_ERROR(tp->ExportColumnar(options.columnar_export_dir,
+                                       options.columnar_export_tables));
+    double t_export_s =
+        static_cast<double>((base::GetWallTimeNs() - t_export_start).count()) /
+        1E9;
+    PERFETTO_ILOG("Tables exported to %s in %.2fs",
+                  options.columnar_export_dir.c_str(), t_export_s);
+  }
+
   if (options.enable_httpd) {
 #if PERFETTO_HAS_SIGNAL_H()
     if (options.metatrace_path.empty()) {
@@ -22,9 +22,11 @@
 #include <memory>
 #include <utility>
 
+#include "perfetto/base/build_config.h"
 #include "perfetto/base/logging.h"
 #include "perfetto/base/status.h"
 #include "perfetto/ext/base/string_view.h"
+#include "perfetto/ext/base/threading/thread_pool.h"
 #include "perfetto/ext/base/uuid.h"
 #include "perfetto/trace_processor/basic_types.h"
 #include "src/trace_processor/forwarding_trace_parser.h"
@@ -49,6 +51,8 @@
 #include "src/trace_processor/storage/metadata.h"
 #include "src/trace_processor/storage/stats.h"
 #include "src/trace_processor/storage/trace_storage.h"
+#include "src/trace_processor/tables/metadata_tables_py.h"
+#include "src/trace_processor/tables/track_tables_py.h"
 #include "src/trace_processor/trace_reader_registry.h"
 #include "src/trace_processor/types/variadic.h"
 #include "src/trace_processor/util/status_macros.h"
@@ -58,6 +62,18 @@ namespace perfetto::trace_processor {
 
 TraceProcessorStorageImpl::TraceProcessorStorageImpl(const Config& cfg)
     : context_({cfg, std::make_shared<TraceStorage>(cfg)}) {
+#if !PERFETTO_BUILDFLAG(PERFETTO_OS_WASM)
+  if (cfg.ingestion_thread_count > 0) {
+    context_.thread_pool =
+        std::make_shared<base::ThreadPool>(cfg.ingestion_thread_count);
+  }
+#endif
+  RegisterProtoImporters();
+}
+
+TraceProcessorStorageImpl::~TraceProcessorStorageImpl() {}
+
+void TraceProcessorStorageImpl::RegisterProtoImporters() {
   context_.reader_registry->RegisterTraceReader<ProtoTraceReader>(
       kProtoTraceType);
   context_.reader_registry->RegisterTraceReader<ProtoTraceReader>(
@@ -67,8 +83,6 @@ TraceProcessorStorageImpl::TraceProcessorStorageImpl(const Config& cfg)
   RegisterDefaultModules(&context_);
 }
 
-TraceProcessorStorageImpl::~TraceProcessorStorageImpl() {}
-
 base::Status TraceProcessorStorageImpl::Parse(TraceBlobView blob) {
   if (blob.size() == 0)
     return base::OkStatus();
@@ -123,6 +137,7 @@ base::Status TraceProcessorStorageImpl::NotifyEndOfFile() {
   RETURN_IF_ERROR(parser_->NotifyEndOfFile());
   PERFETTO_CHECK(active_file_.has_value());
   active_file_->SetTraceType(parser_->trace_type());
+  tables::TraceFileTable::Id trace_id = active_file_->id();
   active_file_.reset();
   // NotifyEndOfFile might have pushed packets to the sorter.
   Flush();
@@ -140,9 +155,70 @@ base::Status TraceProcessorStorageImpl::NotifyEndOfFile() {
   if (context_.perf_dso_tracker) {
     perf_importer::DsoTracker::GetOrCreate(&context_).SymbolizeFrames();
   }
+  SetTraceIdOnNewRows(trace_id);
+  return base::OkStatus();
+}
+
+base::Status TraceProcessorStorageImpl::StartNewTrace() {
+  // Nothing was pushed since the current trace started: it can be used as is
+  // for the next trace.
+  if (!parser_) {
+    return base::OkStatus();
+  }
+  RETURN_IF_ERROR(TraceProcessorStorageImpl::NotifyEndOfFile());
+
+  const TraceStorage& storage = *context_.storage;
+  trace_start_rows_.process = storage.process_table().row_count();
+  trace_start_rows_.thread = storage.thread_table().row_count();
+  trace_start_rows_.cpu = storage.cpu_table().row_count();
+  trace_start_rows_.track = storage.track_table().row_count();
+
+  // Recreate all the trackers from scratch as none of the state of the previous
+  // trace (e.g. pid to upid mappings, clock snapshots) applies to the new one.
+  // Only the storage (and so the interned strings) is shared.
+  TraceProcessorContext::InitArgs args{context_.config, context_.storage};
+  std::shared_ptr<base::ThreadPool> thread_pool = context_.thread_pool;
+  // The SQL functions converting timestamps keep a pointer to the clock
+  // converter so it must outlive the context of the trace.
+  std::unique_ptr<ClockConverter> clock_converter =
+      std::move(context_.clock_converter);
+  context_ = TraceProcessorContext();
+  context_.Init(args);
+  context_.thread_pool = std::move(thread_pool);
+  context_.clock_converter = std::move(clock_converter);
+  RegisterProtoImporters();
+
+  // This is now a dangling pointer, reset it.
+  parser_ = nullptr;
+  trace_hash_ = base::Hasher();
+  hash_input_size_remaining_ = 4096;
   return base::OkStatus();
 }
 
+void TraceProcessorStorageImpl::SetTraceIdOnNewRows(
+    tables::TraceFileTable::Id trace_id) {
+  TraceStorage* storage = context_.storage.get();
+  auto* process_table = storage->mutable_process_table();
+  for (uint32_t i = trace_start_rows_.process; i < process_table->row_count();
+       ++i) {
+    (*process_table)[i].set_trace_id(trace_id);
+  }
+  auto* thread_table = storage->mutable_thread_table();
+  for (uint32_t i = trace_start_rows_.thread; i < thread_table->row_count();
+       ++i) {
+    (*thread_table)[i].set_trace_id(trace_id);
+  }
+  auto* cpu_table = storage->mutable_cpu_table();
+  for (uint32_t i = trace_start_rows_.cpu; i < cpu_table->row_count(); ++i) {
+    (*cpu_table)[i].set_trace_id(trace_id);
+  }
+  auto* track_table = storage->mutable_track_table();
+  for (uint32_t i = trace_start_rows_.track; i < track_table->row_count();
+       ++i) {
+    (*track_table)[i].set_trace_id(trace_id);
+  }
+}
+
 void TraceProcessorStorageImpl::DestroyContext() {
   // End any active files. Eg. when NotifyEndOfFile is not called.
   active_file_.reset();
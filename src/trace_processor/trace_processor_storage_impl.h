@@ -17,6 +17,7 @@
 #ifndef SRC_TRACE_PROCESSOR_TRACE_PROCESSOR_STORAGE_IMPL_H_
 #define SRC_TRACE_PROCESSOR_TRACE_PROCESSOR_STORAGE_IMPL_H_
 
+#include <cstdint>
 #include <memory>
 #include <optional>
 
@@ -25,6 +26,7 @@
 #include "perfetto/trace_processor/status.h"
 #include "perfetto/trace_processor/trace_processor_storage.h"
 #include "src/trace_processor/importers/common/trace_file_tracker.h"
+#include "src/trace_processor/tables/metadata_tables_py.h"
 #include "src/trace_processor/types/trace_processor_context.h"
 
 namespace perfetto {
@@ -40,18 +42,35 @@ class TraceProcessorStorageImpl : public TraceProcessorStorage {
   util::Status Parse(TraceBlobView) override;
   void Flush() override;
   base::Status NotifyEndOfFile() override;
+  base::Status StartNewTrace() override;
 
   void DestroyContext();
 
   TraceProcessorContext* context() { return &context_; }
 
  protected:
+  // Number of rows of the tables with a |trace_id| column when the current
+  // trace started being imported.
+  struct TraceStartRowCounts {
+    uint32_t process = 0;
+    uint32_t thread = 0;
+    uint32_t cpu = 0;
+    uint32_t track = 0;
+  };
+
+  // Registers the importers for proto traces on |context_|.
+  void RegisterProtoImporters();
+
+  // Sets the |trace_id| of the rows added since the current trace started.
+  void SetTraceIdOnNewRows(tables::TraceFileTable::Id trace_id);
+
   base::Hasher trace_hash_;
   TraceProcessorContext context_;
   bool unrecoverable_parse_error_ = false;
   size_t hash_input_size_remaining_ = 4096;
   ForwardingTraceParser* parser_ = nullptr;
   std::optional<ScopedActiveTraceFile> active_file_;
+  TraceStartRowCounts trace_start_rows_;
 };
 
 }  // namespace trace_processor
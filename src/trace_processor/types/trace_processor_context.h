@@ -26,6 +26,10 @@
 #include "src/trace_processor/tables/metadata_tables_py.h"
 #include "src/trace_processor/types/destructible.h"
 
+namespace perfetto::base {
+class ThreadPool;
+}  // namespace perfetto::base
+
 namespace perfetto::trace_processor {
 
 class AndroidLogEventParser;
@@ -93,6 +97,11 @@ class TraceProcessorContext {
   TraceProcessorContext(TraceProcessorContext&&);
   TraceProcessorContext& operator=(TraceProcessorContext&&);
 
+  // Creates all the trackers of a default constructed context. Unlike moving a
+  // newly constructed context into this one, this keeps the pointers to this
+  // context (e.g. the ones held by the trackers) valid.
+  void Init(const InitArgs&);
+
   Config config;
 
   // |storage| is shared among multiple contexts in multi-machine tracing.
@@ -109,6 +118,11 @@ class TraceProcessorContext {
   // multiple machines.
   std::shared_ptr<TraceSorter> sorter;
 
+  // Worker threads used to parallelize CPU-bound ingestion work. Only set if
+  // |config.ingestion_thread_count| is non-zero. Shared among multiple
+  // machines.
+  std::shared_ptr<base::ThreadPool> thread_pool;
+
   // Keep the global tracker before the args tracker as we access the global
   // tracker in the destructor of the args tracker. Also keep it before other
   // trackers, as they may own ArgsTrackers themselves.
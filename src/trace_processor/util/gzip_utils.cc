@@ -22,6 +22,7 @@
 #include <vector>
 
 #include "perfetto/base/build_config.h"
+#include "perfetto/base/logging.h"
 
 #if PERFETTO_BUILDFLAG(PERFETTO_ZLIB)
 #include <zconf.h>
@@ -91,6 +92,25 @@ void GzipDecompressor::Deleter::operator()(z_stream_s* stream) const {
   delete stream;
 }
 
+std::vector<uint8_t> RawDeflateFast(const uint8_t* data, size_t len) {
+  z_stream stream{};
+  // See GzipDecompressor for the meaning of the negative window size.
+  int ret = deflateInit2(&stream, Z_BEST_SPEED, Z_DEFLATED, -MAX_WBITS,
+                         /*memLevel=*/8, Z_DEFAULT_STRATEGY);
+  PERFETTO_CHECK(ret == Z_OK);
+
+  std::vector<uint8_t> out(deflateBound(&stream, static_cast<uLong>(len)));
+  stream.next_in = const_cast<uint8_t*>(data);
+  stream.avail_in = static_cast<uInt>(len);
+  stream.next_out = out.data();
+  stream.avail_out = static_cast<uInt>(out.size());
+  ret = deflate(&stream, Z_FINISH);
+  PERFETTO_CHECK(ret == Z_STREAM_END);
+  out.resize(out.size() - stream.avail_out);
+  deflateEnd(&stream);
+  return out;
+}
+
 #else  // Dummy Implementation
 
 GzipDecompressor::GzipDecompressor(InputMode) {}
@@ -103,6 +123,9 @@ size_t GzipDecompressor::AvailIn() const {
   return 0;
 }
 void GzipDecompressor::Deleter::operator()(z_stream_s*) const {}
+std::vector<uint8_t> RawDeflateFast(const uint8_t*, size_t) {
+  return {};
+}
 
 #endif  // PERFETTO_BUILDFLAG(PERFETTO_ZLIB)
 
@@ -136,6 +136,14 @@ class GzipDecompressor {
   std::unique_ptr<z_stream_s, Deleter> z_stream_;
 };
 
+// Compresses |len| bytes at |data| into a raw deflate stream (i.e. without any
+// gzip or zlib header) which can be decompressed by GzipDecompressor using
+// |InputMode::kRawDeflate|. The fastest compression level is used as this is
+// intended for data held in memory rather than for storage.
+//
+// Returns an empty vector if gzip is not supported by the current build.
+std::vector<uint8_t> RawDeflateFast(const uint8_t* data, size_t len);
+
 }  // namespace perfetto::trace_processor::util
 
 #endif  // SRC_TRACE_PROCESSOR_UTIL_GZIP_UTILS_H_
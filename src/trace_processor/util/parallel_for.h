@@ -0,0 +1,99 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_TRACE_PROCESSOR_UTIL_PARALLEL_FOR_H_
+#define SRC_TRACE_PROCESSOR_UTIL_PARALLEL_FOR_H_
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+
+#include "perfetto/ext/base/threading/thread_pool.h"
+
+namespace perfetto::trace_processor::util {
+
+// Invokes |fn(i)| for every i in [0, count) and blocks until all the
+// invocations have returned.
+//
+// If |pool| is non-null, invocations are distributed between up to
+// |max_workers| tasks posted on |pool| and the calling thread. The calling
+// thread always participates in the work: this guarantees forward progress
+// even if every thread of |pool| is busy with other work (including a
+// ParallelFor issued from a pool thread).
+//
+// If |pool| is null, all invocations happen in order on the calling thread.
+//
+// |fn| must be safe to call concurrently from multiple threads with distinct
+// values of i.
+template <typename Fn>
+void ParallelFor(base::ThreadPool* pool,
+                 uint32_t max_workers,
+                 size_t count,
+                 const Fn& fn) {
+  if (!pool || max_workers == 0 || count <= 1) {
+    for (size_t i = 0; i < count; ++i) {
+      fn(i);
+    }
+    return;
+  }
+
+  // The state is reference counted as tasks posted on |pool| might only start
+  // running after all the work has been done and this function has returned.
+  struct State {
+    std::atomic<size_t> next{0};
+    std::mutex mutex;
+    std::condition_variable cv;
+    size_t done = 0;  // Guarded by |mutex|.
+  };
+  auto state = std::make_shared<State>();
+  auto work = std::make_shared<std::function<void(size_t)>>(fn);
+
+  // Claims and runs items until none are left, then accounts for them.
+  auto drain = [state, count](const std::function<void(size_t)>& f) {
+    size_t processed = 0;
+    for (size_t i = state->next.fetch_add(1, std::memory_order_relaxed);
+         i < count; i = state->next.fetch_add(1, std::memory_order_relaxed)) {
+      f(i);
+      ++processed;
+    }
+    if (processed == 0) {
+      return;
+    }
+    std::lock_guard<std::mutex> lock(state->mutex);
+    state->done += processed;
+    if (state->done == count) {
+      state->cv.notify_all();
+    }
+  };
+
+  size_t workers = std::min<size_t>(max_workers, count - 1);
+  for (size_t i = 0; i < workers; ++i) {
+    pool->PostTask([drain, work]() { drain(*work); });
+  }
+  drain(*work);
+
+  std::unique_lock<std::mutex> lock(state->mutex);
+  state->cv.wait(lock, [&state, count] { return state->done == count; });
+}
+
+}  // namespace perfetto::trace_processor::util
+
+#endif  // SRC_TRACE_PROCESSOR_UTIL_PARALLEL_FOR_H_
@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "src/trace_processor/util/parallel_for.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "perfetto/ext/base/threading/thread_pool.h"
+#include "test/gtest_and_gmock.h"
+
+namespace perfetto::trace_processor::util {
+namespace {
+
+TEST(ParallelForTest, NoPoolRunsInOrder) {
+  std::vector<size_t> order;
+  ParallelFor(nullptr, 4, 5, [&order](size_t i) { order.push_back(i); });
+  ASSERT_THAT(order, testing::ElementsAre(0u, 1u, 2u, 3u, 4u));
+}
+
+TEST(ParallelForTest, Empty) {
+  base::ThreadPool pool(2);
+  std::atomic<uint32_t> calls{0};
+  ParallelFor(&pool, 2, 0, [&calls](size_t) { calls++; });
+  ASSERT_EQ(calls.load(), 0u);
+}
+
+TEST(ParallelForTest, EveryIndexVisitedOnce) {
+  base::ThreadPool pool(4);
+  for (uint32_t repeat = 0; repeat < 50; ++repeat) {
+    std::vector<std::atomic<uint32_t>> visits(1000);
+    ParallelFor(&pool, 4, visits.size(),
+                [&visits](size_t i) { visits[i].fetch_add(1); });
+    for (const auto& v : visits) {
+      ASSERT_EQ(v.load(), 1u);
+    }
+  }
+}
+
+TEST(ParallelForTest, BusyPoolStillCompletes) {
+  // Every pool thread is blocked until the ParallelFor returns: the calling
+  // thread has to do all the work by itself.
+  base::ThreadPool pool(1);
+  std::atomic<bool> release{false};
+  pool.PostTask([&release] {
+    while (!release.load()) {
+    }
+  });
+
+  std::vector<uint32_t> out(100);
+  ParallelFor(&pool, 1, out.size(),
+              [&out](size_t i) { out[i] = static_cast<uint32_t>(i); });
+  release = true;
+  for (uint32_t i = 0; i < out.size(); ++i) {
+    ASSERT_EQ(out[i], i);
+  }
+}
+
+}  // namespace
+}  // namespace perfetto::trace_processor::util
@@ -0,0 +1,244 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "src/trace_processor/util/snapshot_file.h"
+
+#include <fcntl.h>
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "perfetto/base/logging.h"
+#include "perfetto/base/status.h"
+#include "perfetto/ext/base/file_utils.h"
+#include "perfetto/ext/base/scoped_file.h"
+#include "perfetto/ext/base/scoped_mmap.h"
+#include "perfetto/ext/base/status_or.h"
+#include "perfetto/ext/base/string_view.h"
+#include "src/trace_processor/util/status_macros.h"
+
+namespace perfetto::trace_processor::util {
+namespace {
+
+constexpr char kMagic[] = {'P', 'F', 'T', 'P', 'S', 'N', 'A', 'P'};
+constexpr size_t kAlignment = 8;
+constexpr size_t kFlushThreshold = 4 * 1024 * 1024;
+constexpr uint8_t kZeroes[kAlignment] = {};
+
+size_t PaddingFor(uint64_t offset) {
+  return static_cast<size_t>((kAlignment - offset % kAlignment) % kAlignment);
+}
+
+}  // namespace
+
+SnapshotWriter::SnapshotWriter(base::ScopedFile fd) : fd_(std::move(fd)) {}
+SnapshotWriter::~SnapshotWriter() = default;
+SnapshotWriter::SnapshotWriter(SnapshotWriter&&) noexcept = default;
+SnapshotWriter& SnapshotWriter::operator=(SnapshotWriter&&) noexcept = default;
+
+base::StatusOr<SnapshotWriter> SnapshotWriter::Create(const std::string& path) {
+  base::ScopedFile fd =
+      base::OpenFile(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (!fd) {
+    return base::ErrStatus("Unable to open snapshot file %s for writing: %s",
+                           path.c_str(), strerror(errno));
+  }
+  SnapshotWriter writer(std::move(fd));
+  writer.WriteRaw(kMagic, sizeof(kMagic));
+  writer.WriteU32(kSnapshotFormatVersion);
+  writer.WriteU32(0);  // Reserved.
+  return std::move(writer);
+}
+
+void SnapshotWriter::WriteString(base::StringView str) {
+  WriteU32(static_cast<uint32_t>(str.size()));
+  WriteRaw(str.data(), str.size());
+}
+
+void SnapshotWriter::WriteBlock(const void* data, size_t size) {
+  WriteU64(size);
+  WritePadding();
+  WriteRaw(data, size);
+  WritePadding();
+}
+
+void SnapshotWriter::WriteRaw(const void* data, size_t size) {
+  if (size == 0) {
+    return;
+  }
+  const auto* ptr = static_cast<const uint8_t*>(data);
+  buffer_.insert(buffer_.end(), ptr, ptr + size);
+  offset_ += size;
+  if (buffer_.size() >= kFlushThreshold) {
+    Flush();
+  }
+}
+
+void SnapshotWriter::WritePadding() {
+  WriteRaw(kZeroes, PaddingFor(offset_));
+}
+
+void SnapshotWriter::Flush() {
+  if (buffer_.empty() || !status_.ok()) {
+    buffer_.clear();
+    return;
+  }
+  ssize_t res = base::WriteAll(*fd_, buffer_.data(), buffer_.size());
+  if (res < 0 || static_cast<size_t>(res) != buffer_.size()) {
+    status_ = base::ErrStatus("Failed writing snapshot file: %s",
+                              strerror(errno));
+  }
+  buffer_.clear();
+}
+
+base::Status SnapshotWriter::Finalize() {
+  Flush();
+  if (status_.ok() && !base::FlushFile(*fd_)) {
+    status_ = base::ErrStatus("Failed flushing snapshot file: %s",
+                              strerror(errno));
+  }
+  fd_.reset();
+  return status_;
+}
+
+SnapshotReader::SnapshotReader() = default;
+SnapshotReader::~SnapshotReader() = default;
+SnapshotReader::SnapshotReader(SnapshotReader&&) noexcept = default;
+SnapshotReader& SnapshotReader::operator=(SnapshotReader&&) noexcept = default;
+
+base::StatusOr<SnapshotReader> SnapshotReader::Open(const std::string& path) {
+  SnapshotReader reader;
+#if PERFETTO_HAS_MMAP()
+  reader.mmap_ = base::ReadMmapWholeFile(path.c_str());
+  if (reader.mmap_.IsValid()) {
+    reader.data_ = static_cast<const uint8_t*>(reader.mmap_.data());
+    reader.size_ = reader.mmap_.length();
+  }
+#endif
+  if (!reader.data_) {
+    reader.file_contents_ = std::make_unique<std::string>();
+    if (!base::ReadFile(path, reader.file_contents_.get())) {
+      return base::ErrStatus("Unable to read snapshot file %s", path.c_str());
+    }
+    reader.data_ =
+        reinterpret_cast<const uint8_t*>(reader.file_contents_->data());
+    reader.size_ = reader.file_contents_->size();
+  }
+  RETURN_IF_ERROR(reader.ReadHeader());
+  return std::move(reader);
+}
+
+base::StatusOr<SnapshotReader> SnapshotReader::FromBuffer(const uint8_t* data,
+                                                          size_t size) {
+  SnapshotReader reader;
+  reader.data_ = data;
+  reader.size_ = size;
+  RETURN_IF_ERROR(reader.ReadHeader());
+  return std::move(reader);
+}
+
+base::Status SnapshotReader::ReadHeader() {
+  const uint8_t* magic = Consume(sizeof(kMagic));
+  if (!magic || memcmp(magic, kMagic, sizeof(kMagic)) != 0) {
+    return base::ErrStatus("Not a trace processor snapshot file");
+  }
+  uint32_t version = ReadU32();
+  ReadU32();  // Reserved.
+  if (!ok_) {
+    return base::ErrStatus("Truncated snapshot file header");
+  }
+  if (version != kSnapshotFormatVersion) {
+    return base::ErrStatus(
+        "Unsupported snapshot format version %u (expected %u)", version,
+        kSnapshotFormatVersion);
+  }
+  return base::OkStatus();
+}
+
+uint32_t SnapshotReader::ReadU32() {
+  uint32_t value = 0;
+  ReadRaw(&value, sizeof(value));
+  return value;
+}
+
+uint64_t SnapshotReader::ReadU64() {
+  uint64_t value = 0;
+  ReadRaw(&value, sizeof(value));
+  return value;
+}
+
+int64_t SnapshotReader::ReadI64() {
+  int64_t value = 0;
+  ReadRaw(&value, sizeof(value));
+  return value;
+}
+
+base::StringView SnapshotReader::ReadString() {
+  uint32_t size = ReadU32();
+  const uint8_t* data = Consume(size);
+  if (!data) {
+    return {};
+  }
+  return {reinterpret_cast<const char*>(data), size};
+}
+
+const uint8_t* SnapshotReader::ReadBlock(size_t* size) {
+  uint64_t block_size = ReadU64();
+  if (block_size > size_) {
+    ok_ = false;
+  }
+  SkipPadding();
+  const uint8_t* data = Consume(static_cast<size_t>(block_size));
+  SkipPadding();
+  *size = data ? static_cast<size_t>(block_size) : 0;
+  return data;
+}
+
+base::Status SnapshotReader::status() const {
+  if (ok_) {
+    return base::OkStatus();
+  }
+  return base::ErrStatus("Snapshot file is truncated or corrupted");
+}
+
+const uint8_t* SnapshotReader::Consume(size_t size) {
+  if (!ok_ || size > size_ - pos_) {
+    ok_ = false;
+    return nullptr;
+  }
+  const uint8_t* ptr = data_ + pos_;
+  pos_ += size;
+  return ptr;
+}
+
+void SnapshotReader::SkipPadding() {
+  Consume(PaddingFor(pos_));
+}
+
+void SnapshotReader::ReadRaw(void* out, size_t size) {
+  const uint8_t* data = Consume(size);
+  if (data) {
+    memcpy(out, data, size);
+  }
+}
+
+}  // namespace perfetto::trace_processor::util
@@ -0,0 +1,158 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_TRACE_PROCESSOR_UTIL_SNAPSHOT_FILE_H_
+#define SRC_TRACE_PROCESSOR_UTIL_SNAPSHOT_FILE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "perfetto/base/status.h"
+#include "perfetto/ext/base/scoped_file.h"
+#include "perfetto/ext/base/scoped_mmap.h"
+#include "perfetto/ext/base/status_or.h"
+#include "perfetto/ext/base/string_view.h"
+
+namespace perfetto::trace_processor::util {
+
+// Low level helpers for the trace processor snapshot file format.
+//
+// A snapshot file is a fixed header (magic + format version) followed by a
+// stream of little-endian primitives written by |SnapshotWriter| and read back
+// in the same order by |SnapshotReader|. The format has no self-describing
+// schema: it is an implementation detail of trace processor and snapshots are
+// only guaranteed to be readable by the build which wrote them.
+//
+// Large arrays (e.g. the contents of a column) are written as "blocks": the
+// data of a block always starts at an 8 byte aligned offset in the file so it
+// can be accessed in place once the file is mmaped.
+
+// Version of the snapshot format. Must be bumped on any change to the layout
+// of the data written by trace processor.
+inline constexpr uint32_t kSnapshotFormatVersion = 1;
+
+// Writes a snapshot file. All the writes are buffered; any error is sticky and
+// reported by |Finalize()|.
+class SnapshotWriter {
+ public:
+  // Creates (or truncates) the file at |path| and writes the file header.
+  static base::StatusOr<SnapshotWriter> Create(const std::string& path);
+
+  ~SnapshotWriter();
+
+  SnapshotWriter(SnapshotWriter&&) noexcept;
+  SnapshotWriter& operator=(SnapshotWriter&&) noexcept;
+
+  void WriteU32(uint32_t value) { WriteRaw(&value, sizeof(value)); }
+  void WriteU64(uint64_t value) { WriteRaw(&value, sizeof(value)); }
+  void WriteI64(int64_t value) { WriteRaw(&value, sizeof(value)); }
+
+  // Writes a length-prefixed string.
+  void WriteString(base::StringView str);
+
+  // Writes |size| bytes from |data| as a block.
+  void WriteBlock(const void* data, size_t size);
+
+  // Flushes all the buffered data and closes the file.
+  base::Status Finalize();
+
+ private:
+  explicit SnapshotWriter(base::ScopedFile fd);
+
+  SnapshotWriter(const SnapshotWriter&) = delete;
+  SnapshotWriter& operator=(const SnapshotWriter&) = delete;
+
+  void WriteRaw(const void* data, size_t size);
+  void WritePadding();
+  void Flush();
+
+  base::ScopedFile fd_;
+  std::vector<uint8_t> buffer_;
+  uint64_t offset_ = 0;
+  base::Status status_;
+};
+
+// Reads a snapshot file written by |SnapshotWriter|. The file is mmaped
+// whenever possible.
+//
+// Reads past the end of the file do not crash: they return zeroed values and
+// put the reader in an error state which is sticky and can be checked with
+// |status()|. This means callers only need to check for errors before acting
+// on the values they have read (e.g. before allocating memory based on a
+// size).
+class SnapshotReader {
+ public:
+  // Opens the file at |path| and validates its header.
+  static base::StatusOr<SnapshotReader> Open(const std::string& path);
+
+  // Creates a reader over the given buffer, which must outlive the reader.
+  // The buffer must include the file header.
+  static base::StatusOr<SnapshotReader> FromBuffer(const uint8_t* data,
+                                                   size_t size);
+
+  ~SnapshotReader();
+
+  SnapshotReader(SnapshotReader&&) noexcept;
+  SnapshotReader& operator=(SnapshotReader&&) noexcept;
+
+  uint32_t ReadU32();
+  uint64_t ReadU64();
+  int64_t ReadI64();
+
+  // Reads a string written by |SnapshotWriter::WriteString|. The returned view
+  // points inside the file and is valid as long as this reader.
+  base::StringView ReadString();
+
+  // Reads a block written by |SnapshotWriter::WriteBlock|. The returned pointer
+  // is 8 byte aligned and is valid as long as this reader.
+  const uint8_t* ReadBlock(size_t* size);
+
+  // Returns true if all the data in the file has been consumed.
+  bool AtEnd() const { return pos_ == size_; }
+
+  bool ok() const { return ok_; }
+
+  // Returns an error if any read went past the end of the file.
+  base::Status status() const;
+
+ private:
+  SnapshotReader();
+
+  SnapshotReader(const SnapshotReader&) = delete;
+  SnapshotReader& operator=(const SnapshotReader&) = delete;
+
+  base::Status ReadHeader();
+  const uint8_t* Consume(size_t size);
+  void SkipPadding();
+  void ReadRaw(void* out, size_t size);
+
+  // Only one of |mmap_| and |file_contents_| is used, depending on whether
+  // mmap is supported on the platform.
+  base::ScopedMmap mmap_;
+  std::unique_ptr<std::string> file_contents_;
+
+  const uint8_t* data_ = nullptr;
+  size_t size_ = 0;
+  size_t pos_ = 0;
+  bool ok_ = true;
+};
+
+}  // namespace perfetto::trace_processor::util
+
+#endif  // SRC_TRACE_PROCESSOR_UTIL_SNAPSHOT_FILE_H_
@@ -1,4 +1,3 @@
-
 /*
  * Copyright (C) 2024 The Android Open Source Project
  *
@@ -59,6 +58,20 @@ bool TraceBlobViewReader::PopFrontUntil(const size_t target_offset) {
   return target_offset == end_offset_;
 }
 
+bool TraceBlobViewReader::IsContiguousInSameBlob(
+    base::CircularQueue<Entry>::Iterator first,
+    size_t end_offset) const {
+  const TraceBlob* blob = first->data.blob().get();
+  auto prev = first;
+  for (auto it = first + 1; prev->end_offset() < end_offset; prev = it++) {
+    if (it->data.blob().get() != blob ||
+        it->data.data() != prev->data.data() + prev->data.size()) {
+      return false;
+    }
+  }
+  return true;
+}
+
 std::optional<TraceBlobView> TraceBlobViewReader::SliceOff(
     size_t offset,
     size_t length) const {
@@ -102,6 +115,14 @@ std::optional<TraceBlobView> TraceBlobViewReader::SliceOff(
     return rit->data.slice_off(rel_off, length);
   }
 
+  // If the slice spans blocks which are adjacent slices of the same blob (e.g.
+  // consecutive chunks of a mmapped trace file), the slice can still point
+  // directly into that blob.
+  if (IsContiguousInSameBlob(rit, offset + length)) {
+    return TraceBlobView(rit->data.blob(), rit->data.offset() + rel_off,
+                         static_cast<uint32_t>(length));
+  }
+
   // Otherwise, allocate some memory and make a copy.
   auto buffer = TraceBlob::Allocate(length);
   uint8_t* ptr = buffer.data();
@@ -164,6 +164,11 @@ class TraceBlobViewReader {
   bool empty() const { return data_.empty(); }
 
  private:
+  // Returns true if the blocks starting at |first| and spanning up to
+  // |end_offset| are all adjacent slices of the same TraceBlob.
+  bool IsContiguousInSameBlob(base::CircularQueue<Entry>::Iterator first,
+                              size_t end_offset) const;
+
   // CircularQueue has no const_iterator, so mutable is needed to access it from
   // const methods.
   mutable base::CircularQueue<Entry> data_;
@@ -137,6 +137,37 @@ TEST(TraceBlobViewReader, NoCopyIfDataIsContiguous) {
   }
 }
 
+TEST(TraceBlobViewReader, NoCopyIfChunksAreAdjacentInSameBlob) {
+  constexpr size_t kExpectedSize = 256;
+  constexpr size_t kChunkSize = kExpectedSize / 4;
+  TraceBlobView expected_data = CreateExpectedData(kExpectedSize);
+  TraceBlobViewReader buffer =
+      CreateTraceBlobViewReader(Slice(expected_data, kChunkSize));
+
+  for (size_t off = 0; off < kExpectedSize; ++off) {
+    EXPECT_THAT(buffer.SliceOff(off, kExpectedSize - off),
+                Optional(Property(&TraceBlobView::data,
+                                  Eq(expected_data.data() + off))));
+  }
+}
+
+TEST(TraceBlobViewReader, CopyIfChunksAreInDifferentBlobs) {
+  constexpr size_t kExpectedSize = 256;
+  constexpr size_t kChunkSize = kExpectedSize / 4;
+  TraceBlobView expected_data = CreateExpectedData(kExpectedSize);
+  TraceBlobViewReader buffer;
+  for (const auto& chunk : Slice(expected_data, kChunkSize)) {
+    TraceBlob blob = TraceBlob::CopyFrom(chunk.data(), chunk.size());
+    buffer.PushBack(TraceBlobView(std::move(blob)));
+  }
+
+  std::optional<TraceBlobView> tbv =
+      buffer.SliceOff(kChunkSize / 2, kChunkSize);
+  ASSERT_THAT(tbv, Optional(SameDataAs(
+                       expected_data.slice_off(kChunkSize / 2, kChunkSize))));
+  EXPECT_THAT(tbv->blob()->size(), Eq(kChunkSize));
+}
+
 TEST(TraceBlobViewReader, PopRemovesData) {
   size_t expected_size = 256;
   size_t expected_file_offset = 0;
@@ -16,6 +16,7 @@
 
 #include <stdio.h>
 #include <algorithm>
+#include <optional>
 
 #include "perfetto/base/status.h"
 #include "perfetto/ext/base/file_utils.h"
@@ -58,6 +59,11 @@ Options and arguments
     --enable-relay-endpoint : enables the relay endpoint on producer socket(s)
         for traced_relay to communicate with traced in a multiple-machine
         tracing session.
+    --read-buffers-threads <N> : reads the buffers of a tracing session
+        concurrently on N worker threads when writing the trace, rather than
+        one after the other on the service thread.
+    --compression-threads <N> : compresses the chunks of compressed traces
+        concurrently on N worker threads when writing them into files.
 
 Example:
     %s --set-socket-permissions traced-producer:0660:traced-consumer:0660
@@ -74,11 +80,15 @@ int PERFETTO_EXPORT_ENTRYPOINT ServiceMain(int argc, char** argv) {
     OPT_VERSION = 1000,
     OPT_SET_SOCKET_PERMISSIONS = 1001,
     OPT_BACKGROUND,
-    OPT_ENABLE_RELAY_ENDPOINT
+    OPT_ENABLE_RELAY_ENDPOINT,
+    OPT_READ_BUFFERS_THREADS,
+    OPT_COMPRESSION_THREADS
   };
 
   bool background = false;
   bool enable_relay_endpoint = false;
+  uint32_t read_buffers_thread_count = 0;
+  uint32_t compression_thread_count = 0;
 
   static const option long_options[] = {
       {"background", no_argument, nullptr, OPT_BACKGROUND},
@@ -87,6 +97,10 @@ int PERFETTO_EXPORT_ENTRYPOINT ServiceMain(int argc, char** argv) {
        OPT_SET_SOCKET_PERMISSIONS},
       {"enable-relay-endpoint", no_argument, nullptr,
        OPT_ENABLE_RELAY_ENDPOINT},
+      {"read-buffers-threads", required_argument, nullptr,
+       OPT_READ_BUFFERS_THREADS},
+      {"compression-threads", required_argument, nullptr,
+       OPT_COMPRESSION_THREADS},
       {nullptr, 0, nullptr, 0}};
 
   std::string producer_socket_group, consumer_socket_group,
@@ -119,6 +133,24 @@ int PERFETTO_EXPORT_ENTRYPOINT ServiceMain(int argc, char** argv) {
       case OPT_ENABLE_RELAY_ENDPOINT:
         enable_relay_endpoint = true;
         break;
+      case OPT_READ_BUFFERS_THREADS: {
+        std::optional<uint32_t> count = base::CStringToUInt32(optarg);
+        if (!count) {
+          PrintUsage(argv[0]);
+          return 1;
+        }
+        read_buffers_thread_count = *count;
+        break;
+      }
+      case OPT_COMPRESSION_THREADS: {
+        std::optional<uint32_t> count = base::CStringToUInt32(optarg);
+        if (!count) {
+          PrintUsage(argv[0]);
+          return 1;
+        }
+        compression_thread_count = *count;
+        break;
+      }
       default:
         PrintUsage(argv[0]);
         return 1;
@@ -135,8 +167,10 @@ int PERFETTO_EXPORT_ENTRYPOINT ServiceMain(int argc, char** argv) {
 #if PERFETTO_BUILDFLAG(PERFETTO_ZLIB)
   init_opts.compressor_fn = &ZlibCompressFn;
 #endif
+  init_opts.compression_thread_count = compression_thread_count;
   if (enable_relay_endpoint)
     init_opts.enable_relay_endpoint = true;
+  init_opts.read_buffers_thread_count = read_buffers_thread_count;
   svc = ServiceIPCHost::CreateInstance(&task_runner, init_opts);
 
   // When built as part of the Android tree, the two socket are created and
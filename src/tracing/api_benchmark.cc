@@ -12,6 +12,9 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <thread>
+#include <vector>
+
 #include <benchmark/benchmark.h>
 
 #include "perfetto/tracing.h"
@@ -167,6 +170,33 @@ static void BM_TracingTrackEventLambda(benchmark::State& state) {
   PERFETTO_CHECK(!tracing_session->ReadTraceBlocking().empty());
 }
 
+// Emits track events from |state.range(0)| threads at the same time, to measure
+// how writers scale when they share the same shared memory buffer.
+static void BM_TracingTrackEventMultiThread(benchmark::State& state) {
+  static constexpr int kEventsPerThread = 10000;
+  auto tracing_session = StartTracing("track_event");
+  const int num_threads = static_cast<int>(state.range(0));
+
+  while (state.KeepRunning()) {
+    std::vector<std::thread> threads;
+    for (int i = 0; i < num_threads; i++) {
+      threads.emplace_back([] {
+        for (int j = 0; j < kEventsPerThread; j++) {
+          TRACE_EVENT_BEGIN("benchmark", "Event");
+          TRACE_EVENT_END("benchmark");
+        }
+      });
+    }
+    for (auto& thread : threads)
+      thread.join();
+  }
+  state.SetItemsProcessed(state.iterations() * num_threads * kEventsPerThread *
+                          2);
+
+  tracing_session->StopBlocking();
+  PERFETTO_CHECK(!tracing_session->ReadTraceBlocking().empty());
+}
+
 }  // namespace
 
 BENCHMARK(BM_TracingDataSourceDisabled);
@@ -176,3 +206,7 @@ BENCHMARK(BM_TracingTrackEventBasic);
 BENCHMARK(BM_TracingTrackEventDebugAnnotations);
 BENCHMARK(BM_TracingTrackEventDisabled);
 BENCHMARK(BM_TracingTrackEventLambda);
+BENCHMARK(BM_TracingTrackEventMultiThread)
+    ->RangeMultiplier(2)
+    ->Range(1, 64)
+    ->UseRealTime();
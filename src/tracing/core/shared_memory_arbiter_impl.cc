@@ -16,13 +16,26 @@
 
 #include "src/tracing/core/shared_memory_arbiter_impl.h"
 
+#include "perfetto/base/build_config.h"
+
+#if PERFETTO_BUILDFLAG(PERFETTO_OS_LINUX) || \
+    PERFETTO_BUILDFLAG(PERFETTO_OS_ANDROID)
+#include <sched.h>
+#endif
+
 #include <algorithm>
+#include <atomic>
 #include <limits>
+#include <optional>
+#include <string>
 #include <utility>
 
 #include "perfetto/base/logging.h"
 #include "perfetto/base/task_runner.h"
 #include "perfetto/base/time.h"
+#include "perfetto/ext/base/file_utils.h"
+#include "perfetto/ext/base/string_splitter.h"
+#include "perfetto/ext/base/string_utils.h"
 #include "perfetto/ext/tracing/core/commit_data_request.h"
 #include "perfetto/ext/tracing/core/shared_memory.h"
 #include "perfetto/ext/tracing/core/shared_memory_abi.h"
@@ -47,6 +60,20 @@ MaybeUnboundBufferID MakeTargetBufferIdForReservation(uint16_t reservation_id) {
 bool IsReservationTargetBufferId(MaybeUnboundBufferID buffer_id) {
   return (buffer_id >> 16) > 0;
 }
+
+int GetCurrentCpu() {
+#if PERFETTO_BUILDFLAG(PERFETTO_OS_LINUX) || \
+    PERFETTO_BUILDFLAG(PERFETTO_OS_ANDROID)
+  return sched_getcpu();
+#else
+  return -1;
+#endif
+}
+
+uint64_t NextArbiterId() {
+  static std::atomic<uint64_t> next_arbiter_id{1};
+  return next_arbiter_id.fetch_add(1, std::memory_order_relaxed);
+}
 }  // namespace
 
 // static
@@ -84,6 +111,7 @@ SharedMemoryArbiterImpl::SharedMemoryArbiterImpl(
     base::TaskRunner* task_runner)
     : producer_endpoint_(producer_endpoint),
       use_shmem_emulation_(mode == ShmemMode::kShmemEmulation),
+      arbiter_id_(NextArbiterId()),
       task_runner_(task_runner),
       shmem_abi_(reinterpret_cast<uint8_t*>(start), size, page_size, mode),
       active_writer_ids_(kMaxWriterID),
@@ -96,89 +124,58 @@ Chunk SharedMemoryArbiterImpl::GetNewChunk(
     BufferExhaustedPolicy buffer_exhausted_policy) {
   int stall_count = 0;
   unsigned stall_interval_us = 0;
-  bool task_runner_runs_on_current_thread = false;
   static const unsigned kMaxStallIntervalUs = 100000;
   static const int kLogAfterNStalls = 3;
   static const int kFlushCommitsAfterEveryNStalls = 2;
   static const int kAssertAtNStalls = 200;
 
-  for (;;) {
-    // TODO(primiano): Probably this lock is not really required and this code
-    // could be rewritten leveraging only the Try* atomic operations in
-    // SharedMemoryABI. But let's not be too adventurous for the moment.
-    {
-      std::unique_lock<std::mutex> scoped_lock(lock_);
-
-      // If ever unbound, we do not support stalling. In theory, we could
-      // support stalling for TraceWriters created after the arbiter and startup
-      // buffer reservations were bound, but to avoid raciness between the
-      // creation of startup writers and binding, we categorically forbid kStall
-      // mode.
-      PERFETTO_DCHECK(was_always_bound_ ||
-                      buffer_exhausted_policy == BufferExhaustedPolicy::kDrop);
+  // If ever unbound, we do not support stalling. In theory, we could support
+  // stalling for TraceWriters created after the arbiter and startup buffer
+  // reservations were bound, but to avoid raciness between the creation of
+  // startup writers and binding, we categorically forbid kStall mode.
+  PERFETTO_DCHECK(was_always_bound_ ||
+                  buffer_exhausted_policy == BufferExhaustedPolicy::kDrop);
 
-      task_runner_runs_on_current_thread =
-          task_runner_ && task_runner_->RunsTasksOnCurrentThread();
+  for (;;) {
+    // Chunks are acquired using only the atomic operations of SharedMemoryABI,
+    // so that writers on different threads don't contend on |lock_|.
+    Chunk chunk = TryAcquireChunk(header);
+    if (chunk.is_valid()) {
+      if (stall_count > kLogAfterNStalls) {
+        PERFETTO_LOG("Recovered from stall after %d iterations", stall_count);
+      }
 
-      // If more than half of the SMB.size() is filled with completed chunks for
-      // which we haven't notified the service yet (i.e. they are still enqueued
-      // in |commit_data_req_|), force a synchronous CommitDataRequest() even if
-      // we acquire a chunk, to reduce the likeliness of stalling the writer.
+      // If more than half of the SMB.size() is filled with completed chunks
+      // for which we haven't notified the service yet (i.e. they are still
+      // enqueued in |commit_data_req_|), force a synchronous
+      // CommitDataRequest() even if we acquired a chunk, to reduce the
+      // likeliness of stalling the writer.
       //
       // We can only do this if we're writing on the same thread that we access
       // the producer endpoint on, since we cannot notify the producer endpoint
       // to commit synchronously on a different thread. Attempting to flush
       // synchronously on another thread will lead to subtle bugs caused by
       // out-of-order commit requests (crbug.com/919187#c28).
-      bool should_commit_synchronously =
-          task_runner_runs_on_current_thread &&
-          buffer_exhausted_policy == BufferExhaustedPolicy::kStall &&
-          commit_data_req_ && bytes_pending_commit_ >= shmem_abi_.size() / 2;
-
-      const size_t initial_page_idx = page_idx_;
-      for (size_t i = 0; i < shmem_abi_.num_pages(); i++) {
-        page_idx_ = (initial_page_idx + i) % shmem_abi_.num_pages();
-        bool is_new_page = false;
-
-        // TODO(primiano): make the page layout dynamic.
-        auto layout = SharedMemoryArbiterImpl::default_page_layout;
-
-        if (shmem_abi_.is_page_free(page_idx_)) {
-          // TODO(primiano): Use the |size_hint| here to decide the layout.
-          is_new_page = shmem_abi_.TryPartitionPage(page_idx_, layout);
-        }
-        uint32_t free_chunks;
-        if (is_new_page) {
-          free_chunks = (1 << SharedMemoryABI::kNumChunksForLayout[layout]) - 1;
-        } else {
-          free_chunks = shmem_abi_.GetFreeChunks(page_idx_);
-        }
-
-        for (uint32_t chunk_idx = 0; free_chunks;
-             chunk_idx++, free_chunks >>= 1) {
-          if (!(free_chunks & 1))
-            continue;
-          // We found a free chunk.
-          Chunk chunk = shmem_abi_.TryAcquireChunkForWriting(
-              page_idx_, chunk_idx, &header);
-          if (!chunk.is_valid())
-            continue;
-          if (stall_count > kLogAfterNStalls) {
-            PERFETTO_LOG("Recovered from stall after %d iterations",
-                         stall_count);
-          }
-
-          if (should_commit_synchronously) {
-            // We can't flush while holding the lock.
-            scoped_lock.unlock();
-            FlushPendingCommitDataRequests();
-            return chunk;
-          } else {
-            return chunk;
-          }
+      //
+      // |bytes_pending_commit_| is checked without the lock first, so that the
+      // lock is only taken when the SMB is filling up.
+      if (buffer_exhausted_policy == BufferExhaustedPolicy::kStall &&
+          bytes_pending_commit_.load(std::memory_order_relaxed) >=
+              shmem_abi_.size() / 2) {
+        bool should_commit_synchronously;
+        {
+          std::lock_guard<std::mutex> scoped_lock(lock_);
+          should_commit_synchronously =
+              task_runner_ && task_runner_->RunsTasksOnCurrentThread() &&
+              commit_data_req_ &&
+              bytes_pending_commit_ >= shmem_abi_.size() / 2;
         }
+        // We can't flush while holding the lock.
+        if (should_commit_synchronously)
+          FlushPendingCommitDataRequests();
       }
-    }  // scoped_lock
+      return chunk;
+    }
 
     if (buffer_exhausted_policy == BufferExhaustedPolicy::kDrop) {
       PERFETTO_DLOG("Shared memory buffer exhausted, returning invalid Chunk!");
@@ -188,6 +185,13 @@ Chunk SharedMemoryArbiterImpl::GetNewChunk(
     // Stalling is not supported if we were ever unbound (see earlier comment).
     PERFETTO_CHECK(was_always_bound_);
 
+    bool task_runner_runs_on_current_thread;
+    {
+      std::lock_guard<std::mutex> scoped_lock(lock_);
+      task_runner_runs_on_current_thread =
+          task_runner_ && task_runner_->RunsTasksOnCurrentThread();
+    }
+
     // All chunks are taken (either kBeingWritten by us or kBeingRead by the
     // Service).
     if (stall_count++ == kLogAfterNStalls) {
@@ -228,6 +232,92 @@ Chunk SharedMemoryArbiterImpl::GetNewChunk(
   }
 }
 
+Chunk SharedMemoryArbiterImpl::TryAcquireChunk(
+    const SharedMemoryABI::ChunkHeader& header) {
+  // The page the calling thread last acquired a chunk from. Writers on
+  // different threads tend to stick to different pages this way, rather than
+  // racing for the chunks of the same page.
+  struct PageHint {
+    uint64_t arbiter_id = 0;
+    size_t page_idx = 0;
+  };
+  static thread_local PageHint page_hint;
+
+  const bool has_hint = page_hint.arbiter_id == arbiter_id_;
+  size_t page_idx = 0;
+  Chunk chunk;
+
+  // With CPU-local pages, first try only the partition of the current CPU.
+  const CpuLocalPages* local_pages =
+      cpu_local_pages_.load(std::memory_order_acquire);
+  int cpu = local_pages ? GetCurrentCpu() : -1;
+  if (cpu >= 0 &&
+      static_cast<size_t>(cpu) < local_pages->partition_for_cpu.size()) {
+    const uint32_t partition =
+        local_pages->partition_for_cpu[static_cast<size_t>(cpu)];
+    const size_t begin = local_pages->first_page[partition];
+    const size_t end = local_pages->first_page[partition + 1];
+    const bool hint_is_local =
+        has_hint && page_hint.page_idx >= begin && page_hint.page_idx < end;
+    chunk = TryAcquireChunkInPages(
+        begin, end, hint_is_local ? page_hint.page_idx : begin, header,
+        &page_idx);
+  }
+
+  if (!chunk.is_valid()) {
+    const size_t start = has_hint ? page_hint.page_idx
+                                  : page_idx_.load(std::memory_order_relaxed);
+    chunk = TryAcquireChunkInPages(0, shmem_abi_.num_pages(), start, header,
+                                   &page_idx);
+  }
+
+  if (chunk.is_valid()) {
+    page_hint.arbiter_id = arbiter_id_;
+    page_hint.page_idx = page_idx;
+    page_idx_.store(page_idx, std::memory_order_relaxed);
+  }
+  return chunk;
+}
+
+Chunk SharedMemoryArbiterImpl::TryAcquireChunkInPages(
+    size_t begin,
+    size_t end,
+    size_t start,
+    const SharedMemoryABI::ChunkHeader& header,
+    size_t* page_idx) {
+  const size_t num_pages = end - begin;
+  for (size_t i = 0; i < num_pages; i++) {
+    *page_idx = begin + (start - begin + i) % num_pages;
+    bool is_new_page = false;
+
+    // TODO(primiano): make the page layout dynamic.
+    auto layout = SharedMemoryArbiterImpl::default_page_layout;
+
+    if (shmem_abi_.is_page_free(*page_idx)) {
+      // TODO(primiano): Use the |size_hint| here to decide the layout.
+      is_new_page = shmem_abi_.TryPartitionPage(*page_idx, layout);
+    }
+    uint32_t free_chunks;
+    if (is_new_page) {
+      free_chunks = (1 << SharedMemoryABI::kNumChunksForLayout[layout]) - 1;
+    } else {
+      free_chunks = shmem_abi_.GetFreeChunks(*page_idx);
+    }
+
+    for (uint32_t chunk_idx = 0; free_chunks; chunk_idx++, free_chunks >>= 1) {
+      if (!(free_chunks & 1))
+        continue;
+      // We found a free chunk. Another thread might still beat us to it, in
+      // which case the compare-and-swap on the page header fails.
+      Chunk chunk =
+          shmem_abi_.TryAcquireChunkForWriting(*page_idx, chunk_idx, &header);
+      if (chunk.is_valid())
+        return chunk;
+    }
+  }
+  return Chunk();
+}
+
 void SharedMemoryArbiterImpl::ReturnCompletedChunk(
     Chunk chunk,
     MaybeUnboundBufferID target_buffer,
@@ -477,6 +567,71 @@ void SharedMemoryArbiterImpl::SetDirectSMBPatchingSupportedByService() {
   direct_patching_supported_by_service_ = true;
 }
 
+bool SharedMemoryArbiterImpl::EnableCpuLocalPages(
+    std::vector<uint32_t> partition_for_cpu) {
+  if (GetCurrentCpu() < 0)
+    return false;
+  if (partition_for_cpu.empty())
+    partition_for_cpu = GetNumaNodeOfCpus();
+  if (partition_for_cpu.empty())
+    return false;
+
+  const size_t num_partitions =
+      *std::max_element(partition_for_cpu.begin(), partition_for_cpu.end()) +
+      1u;
+  const size_t num_pages = shmem_abi_.num_pages();
+  if (num_partitions < 2 || num_partitions > num_pages)
+    return false;
+
+  std::unique_ptr<CpuLocalPages> local_pages(new CpuLocalPages());
+  local_pages->partition_for_cpu = std::move(partition_for_cpu);
+  for (size_t i = 0; i <= num_partitions; i++)
+    local_pages->first_page.push_back(i * num_pages / num_partitions);
+
+  std::lock_guard<std::mutex> scoped_lock(lock_);
+  if (cpu_local_pages_storage_)
+    return false;
+  cpu_local_pages_.store(local_pages.get(), std::memory_order_release);
+  cpu_local_pages_storage_ = std::move(local_pages);
+  return true;
+}
+
+// static
+std::vector<uint32_t> SharedMemoryArbiterImpl::GetNumaNodeOfCpus() {
+  std::vector<uint32_t> node_of_cpu;
+#if PERFETTO_BUILDFLAG(PERFETTO_OS_LINUX) || \
+    PERFETTO_BUILDFLAG(PERFETTO_OS_ANDROID)
+  // Node numbers can be sparse, e.g. when a node is offline.
+  static constexpr uint32_t kMaxNumaNodes = 64;
+  uint32_t num_nodes = 0;
+  for (uint32_t node = 0; node < kMaxNumaNodes; node++) {
+    base::StackString<64> path("/sys/devices/system/node/node%u/cpulist",
+                               node);
+    std::string cpulist;
+    if (!base::ReadFile(path.ToStdString(), &cpulist))
+      continue;
+    // The format is a list of ranges, e.g. "0-15,32-47".
+    for (base::StringSplitter ranges(base::TrimWhitespace(cpulist), ',');
+         ranges.Next();) {
+      base::StringSplitter range(&ranges, '-');
+      std::optional<uint32_t> first;
+      std::optional<uint32_t> last;
+      if (range.Next())
+        first = base::CStringToUInt32(range.cur_token());
+      last = range.Next() ? base::CStringToUInt32(range.cur_token()) : first;
+      if (!first || !last || *last < *first)
+        return {};
+      if (node_of_cpu.size() <= *last)
+        node_of_cpu.resize(*last + 1, 0);
+      for (uint32_t cpu = *first; cpu <= *last; cpu++)
+        node_of_cpu[cpu] = num_nodes;
+    }
+    num_nodes++;
+  }
+#endif
+  return node_of_cpu;
+}
+
 // This function is quite subtle. When making changes keep in mind these two
 // challenges:
 // 1) If the producer stalls and we happen to be on the |task_runner_| IPC
@@ -19,6 +19,7 @@
 
 #include <stdint.h>
 
+#include <atomic>
 #include <functional>
 #include <map>
 #include <memory>
@@ -161,6 +162,11 @@ class SharedMemoryArbiterImpl : public SharedMemoryArbiter {
     return default_page_layout;
   }
 
+  // Returns the NUMA node of each CPU of the host, indexed by CPU number, with
+  // the nodes numbered densely from 0. Returns an empty vector if the topology
+  // is not available.
+  static std::vector<uint32_t> GetNumaNodeOfCpus();
+
   // SharedMemoryArbiter implementation.
   // See include/perfetto/tracing/core/shared_memory_arbiter.h for comments.
   std::unique_ptr<TraceWriter> CreateTraceWriter(
@@ -182,6 +188,9 @@ class SharedMemoryArbiterImpl : public SharedMemoryArbiter {
 
   void SetDirectSMBPatchingSupportedByService() override;
 
+  bool EnableCpuLocalPages(
+      std::vector<uint32_t> partition_for_cpu = {}) override;
+
   void FlushPendingCommitDataRequests(
       std::function<void()> callback = {}) override;
   bool TryShutdown() override;
@@ -213,6 +222,22 @@ class SharedMemoryArbiterImpl : public SharedMemoryArbiter {
   SharedMemoryArbiterImpl(const SharedMemoryArbiterImpl&) = delete;
   SharedMemoryArbiterImpl& operator=(const SharedMemoryArbiterImpl&) = delete;
 
+  // Tries to acquire a free chunk of the SMB for writing, using only the
+  // atomic operations of SharedMemoryABI (i.e. without taking |lock_|).
+  // Starts from the page the calling thread last acquired a chunk from, or
+  // from |page_idx_| if it didn't acquire any yet. Returns an invalid chunk if
+  // all the chunks are taken.
+  SharedMemoryABI::Chunk TryAcquireChunk(const SharedMemoryABI::ChunkHeader&);
+
+  // Tries to acquire a free chunk in the pages [|begin|, |end|), scanning them
+  // from |start| and wrapping around. Sets |page_idx| to the page of the chunk.
+  SharedMemoryABI::Chunk TryAcquireChunkInPages(
+      size_t begin,
+      size_t end,
+      size_t start,
+      const SharedMemoryABI::ChunkHeader&,
+      size_t* page_idx);
+
   void UpdateCommitDataRequest(SharedMemoryABI::Chunk chunk,
                                WriterID writer_id,
                                MaybeUnboundBufferID target_buffer,
@@ -262,15 +287,36 @@ class SharedMemoryArbiterImpl : public SharedMemoryArbiter {
   // endpoint that doesn't support shared memory (e.g. vsock).
   const bool use_shmem_emulation_ = false;
 
+  // Unique across all the arbiters of the process. Used to tell whether the
+  // per-thread page hint of TryAcquireChunk() refers to this arbiter.
+  const uint64_t arbiter_id_;
+
+  // The page the last chunk was acquired from, by any thread. Only a hint.
+  std::atomic<size_t> page_idx_{0};
+
+  // See EnableCpuLocalPages().
+  struct CpuLocalPages {
+    // The partition of each CPU, indexed by CPU number.
+    std::vector<uint32_t> partition_for_cpu;
+    // Partition i is made of the pages [first_page[i], first_page[i + 1]).
+    std::vector<size_t> first_page;
+  };
+
+  // Set at most once, by EnableCpuLocalPages() while holding |lock_|, and
+  // immutable afterwards. Read without the lock by TryAcquireChunk().
+  std::atomic<const CpuLocalPages*> cpu_local_pages_{nullptr};
+
   // --- Begin lock-protected members ---
 
   std::mutex lock_;
 
   base::TaskRunner* task_runner_ = nullptr;
   SharedMemoryABI shmem_abi_;
-  size_t page_idx_ = 0;
   std::unique_ptr<CommitDataRequest> commit_data_req_;
-  size_t bytes_pending_commit_ = 0;  // SUM(chunk.size() : commit_data_req_).
+
+  // SUM(chunk.size() : commit_data_req_). Only changed while holding |lock_|
+  // but atomic, so that GetNewChunk() can check it without taking |lock_|.
+  std::atomic<size_t> bytes_pending_commit_{0};
   IdAllocator<WriterID> active_writer_ids_;
   bool did_shutdown_ = false;
 
@@ -281,8 +327,9 @@ class SharedMemoryArbiterImpl : public SharedMemoryArbiter {
   bool fully_bound_;
 
   // Whether the arbiter was always bound. If false, the arbiter was unbound at
-  // one point in time.
-  bool was_always_bound_;
+  // one point in time. Only changed while holding |lock_| but atomic, so that
+  // GetNewChunk() can check it without taking |lock_|.
+  std::atomic<bool> was_always_bound_;
 
   // Whether all created trace writers were created with kDrop policy.
   bool all_writers_have_drop_policy_ = true;
@@ -296,6 +343,9 @@ class SharedMemoryArbiterImpl : public SharedMemoryArbiter {
   // reservation was unbound.
   std::vector<std::function<void()>> pending_flush_callbacks_;
 
+  // Owns |*cpu_local_pages_|.
+  std::unique_ptr<const CpuLocalPages> cpu_local_pages_storage_;
+
   // See SharedMemoryArbiter::SetBatchCommitsDuration.
   uint32_t batch_commits_duration_ms_ = 0;
 
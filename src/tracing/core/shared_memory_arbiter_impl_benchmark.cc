@@ -0,0 +1,150 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Measures the throughput of chunk acquisition in the shared memory buffer by
+// writer threads pinned in turn to the CPUs of each NUMA node of the host, with
+// and without SharedMemoryArbiter::EnableCpuLocalPages().
+
+#include <sched.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "perfetto/base/logging.h"
+#include "perfetto/ext/tracing/core/commit_data_request.h"
+#include "perfetto/ext/tracing/core/shared_memory_abi.h"
+#include "src/tracing/core/in_process_shared_memory.h"
+#include "src/tracing/core/shared_memory_arbiter_impl.h"
+
+namespace perfetto {
+namespace {
+
+constexpr size_t kPageSize = 4096;
+constexpr size_t kShmSize = 1024 * kPageSize;
+
+bool IsBenchmarkFunctionalOnly() {
+  return getenv("BENCHMARK_FUNCTIONAL_TEST_ONLY") != nullptr;
+}
+
+// Returns the CPUs of the host, alternating between the NUMA nodes, so that
+// consecutive writer threads run on different nodes.
+std::vector<int> GetCpusAcrossNodes() {
+  std::vector<uint32_t> node_of_cpu =
+      SharedMemoryArbiterImpl::GetNumaNodeOfCpus();
+  if (node_of_cpu.empty())
+    node_of_cpu.resize(std::thread::hardware_concurrency(), 0);
+
+  std::vector<std::vector<int>> cpus_of_node;
+  for (size_t cpu = 0; cpu < node_of_cpu.size(); cpu++) {
+    if (cpus_of_node.size() <= node_of_cpu[cpu])
+      cpus_of_node.resize(node_of_cpu[cpu] + 1);
+    cpus_of_node[node_of_cpu[cpu]].push_back(static_cast<int>(cpu));
+  }
+
+  std::vector<int> cpus;
+  for (size_t i = 0; cpus.size() < node_of_cpu.size(); i++) {
+    for (const auto& node_cpus : cpus_of_node) {
+      if (i < node_cpus.size())
+        cpus.push_back(node_cpus[i]);
+    }
+  }
+  return cpus;
+}
+
+void PinCurrentThreadToCpu(int cpu) {
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  // Pinning can fail, e.g. if the CPU is not in the cpuset of the process. The
+  // thread then just runs wherever the scheduler puts it.
+  sched_setaffinity(0 /* calling thread */, sizeof(set), &set);
+}
+
+// Acquires chunks like a trace writer and then immediately gives them back
+// like the service would do after copying them into its buffer.
+void WriteChunks(SharedMemoryArbiterImpl* arbiter, size_t num_chunks) {
+  SharedMemoryABI* abi = arbiter->shmem_abi_for_testing();
+  for (size_t i = 0; i < num_chunks; i++) {
+    SharedMemoryABI::Chunk chunk =
+        arbiter->GetNewChunk({}, BufferExhaustedPolicy::kDrop);
+    if (!chunk.is_valid())
+      continue;
+    memset(chunk.payload_begin(), 0, chunk.payload_size());
+    chunk.IncrementPacketCount();
+    auto page_and_chunk = abi->GetPageAndChunkIndex(chunk);
+    abi->ReleaseChunkAsComplete(std::move(chunk));
+    chunk = abi->TryAcquireChunkForReading(page_and_chunk.first,
+                                           page_and_chunk.second);
+    PERFETTO_CHECK(chunk.is_valid());
+    abi->ReleaseChunkAsFree(std::move(chunk));
+  }
+}
+
+void BM_SharedMemoryArbiterGetNewChunk(benchmark::State& state) {
+  const size_t num_threads = static_cast<size_t>(state.range(0));
+  const bool cpu_local_pages = state.range(1) != 0;
+  const size_t chunks_per_thread = IsBenchmarkFunctionalOnly() ? 100 : 10000;
+
+  std::unique_ptr<InProcessSharedMemory> shmem =
+      InProcessSharedMemory::Create(kShmSize);
+  SharedMemoryArbiterImpl arbiter(shmem->start(), shmem->size(),
+                                  SharedMemoryABI::ShmemMode::kDefault,
+                                  kPageSize, /*producer_endpoint=*/nullptr,
+                                  /*task_runner=*/nullptr);
+  // This fails on hosts with a single NUMA node, in which case both variants
+  // of the benchmark are the same.
+  if (cpu_local_pages)
+    arbiter.EnableCpuLocalPages();
+
+  const std::vector<int> cpus = GetCpusAcrossNodes();
+  for (auto _ : state) {
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < num_threads; i++) {
+      int cpu = cpus.empty() ? -1 : cpus[i % cpus.size()];
+      threads.emplace_back([&arbiter, cpu, chunks_per_thread] {
+        if (cpu >= 0)
+          PinCurrentThreadToCpu(cpu);
+        WriteChunks(&arbiter, chunks_per_thread);
+      });
+    }
+    for (auto& thread : threads)
+      thread.join();
+  }
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) *
+                          static_cast<int64_t>(num_threads) *
+                          static_cast<int64_t>(chunks_per_thread));
+}
+
+void GetNewChunkArgs(benchmark::internal::Benchmark* b) {
+  b->ArgNames({"threads", "cpu_local_pages"});
+  for (int64_t threads : {1, 2, 4, 8, 16, 32}) {
+    for (int64_t cpu_local_pages : {0, 1}) {
+      b->Args({threads, cpu_local_pages});
+    }
+  }
+}
+
+BENCHMARK(BM_SharedMemoryArbiterGetNewChunk)
+    ->Apply(GetNewChunkArgs)
+    ->UseRealTime();
+
+}  // namespace
+}  // namespace perfetto
@@ -17,6 +17,12 @@
 #include "src/tracing/core/shared_memory_arbiter_impl.h"
 
 #include <bitset>
+#include <set>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "perfetto/base/build_config.h"
 #include "perfetto/ext/base/utils.h"
 #include "perfetto/ext/tracing/core/basic_types.h"
 #include "perfetto/ext/tracing/core/commit_data_request.h"
@@ -361,6 +367,76 @@ TEST_P(SharedMemoryArbiterImplTest, BufferExhaustedPolicyDrop) {
   ASSERT_TRUE(chunks[0].is_valid());
 }
 
+// Verify that writers on different threads never get the same chunk and that
+// all the chunks of the SMB can be acquired concurrently.
+TEST_P(SharedMemoryArbiterImplTest, ConcurrentGetNewChunk) {
+  SharedMemoryArbiterImpl::set_default_layout_for_testing(
+      SharedMemoryABI::PageLayout::kPageDiv14);
+  static constexpr size_t kTotChunks = kNumPages * 14;
+  static constexpr size_t kNumThreads = 4;
+
+  std::vector<std::pair<size_t, size_t>> acquired[kNumThreads];
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < kNumThreads; t++) {
+    threads.emplace_back([this, &acquired, t] {
+      for (;;) {
+        SharedMemoryABI::Chunk chunk =
+            arbiter_->GetNewChunk({}, BufferExhaustedPolicy::kDrop);
+        if (!chunk.is_valid())
+          break;
+        acquired[t].push_back(
+            arbiter_->shmem_abi_for_testing()->GetPageAndChunkIndex(chunk));
+      }
+    });
+  }
+  for (auto& thread : threads)
+    thread.join();
+
+  std::set<std::pair<size_t, size_t>> unique_chunks;
+  size_t num_chunks = 0;
+  for (const auto& chunks : acquired) {
+    num_chunks += chunks.size();
+    unique_chunks.insert(chunks.begin(), chunks.end());
+  }
+  EXPECT_EQ(kTotChunks, num_chunks);
+  EXPECT_EQ(kTotChunks, unique_chunks.size());
+}
+
+#if PERFETTO_BUILDFLAG(PERFETTO_OS_LINUX) || \
+    PERFETTO_BUILDFLAG(PERFETTO_OS_ANDROID)
+// Verify that, with CPU-local pages, chunks are taken from the partition of
+// the current CPU first and from the other partitions only once it is full.
+TEST_P(SharedMemoryArbiterImplTest, CpuLocalPages) {
+  SharedMemoryArbiterImpl::set_default_layout_for_testing(
+      SharedMemoryABI::PageLayout::kPageDiv1);
+
+  // At least two partitions and at most one page per partition are needed.
+  ASSERT_FALSE(arbiter_->EnableCpuLocalPages({0, 0}));
+  ASSERT_FALSE(arbiter_->EnableCpuLocalPages(std::vector<uint32_t>(
+      kNumPages + 1, static_cast<uint32_t>(kNumPages))));
+
+  // Put all the CPUs in the second of two partitions.
+  ASSERT_TRUE(arbiter_->EnableCpuLocalPages(std::vector<uint32_t>(4096, 1)));
+  ASSERT_FALSE(arbiter_->EnableCpuLocalPages(std::vector<uint32_t>(4096, 1)));
+
+  std::vector<size_t> pages;
+  std::vector<SharedMemoryABI::Chunk> chunks;
+  for (size_t i = 0; i < kNumPages; i++) {
+    chunks.push_back(arbiter_->GetNewChunk({}, BufferExhaustedPolicy::kDrop));
+    ASSERT_TRUE(chunks.back().is_valid());
+    pages.push_back(
+        arbiter_->shmem_abi_for_testing()->GetPageAndChunkIndex(chunks.back())
+            .first);
+  }
+  std::vector<size_t> expected_pages;
+  for (size_t i = 0; i < kNumPages; i++)
+    expected_pages.push_back((kNumPages / 2 + i) % kNumPages);
+  EXPECT_EQ(expected_pages, pages);
+  EXPECT_FALSE(
+      arbiter_->GetNewChunk({}, BufferExhaustedPolicy::kDrop).is_valid());
+}
+#endif
+
 TEST_P(SharedMemoryArbiterImplTest, CreateUnboundAndBind) {
   auto checkpoint_writer = task_runner_->CreateCheckpoint("writer_registered");
   auto checkpoint_flush = task_runner_->CreateCheckpoint("flush_completed");
@@ -168,11 +168,13 @@ TracingMuxerImpl::ProducerImpl::ProducerImpl(
     TracingMuxerImpl* muxer,
     TracingBackendId backend_id,
     uint32_t shmem_batch_commits_duration_ms,
-    bool shmem_direct_patching_enabled)
+    bool shmem_direct_patching_enabled,
+    bool shmem_numa_aware_pages)
     : muxer_(muxer),
       backend_id_(backend_id),
       shmem_batch_commits_duration_ms_(shmem_batch_commits_duration_ms),
-      shmem_direct_patching_enabled_(shmem_direct_patching_enabled) {}
+      shmem_direct_patching_enabled_(shmem_direct_patching_enabled),
+      shmem_numa_aware_pages_(shmem_numa_aware_pages) {}
 
 TracingMuxerImpl::ProducerImpl::~ProducerImpl() {
   muxer_ = nullptr;
@@ -265,6 +267,9 @@ void TracingMuxerImpl::ProducerImpl::OnTracingSetup() {
   if (shmem_direct_patching_enabled_) {
     service_->MaybeSharedMemoryArbiter()->EnableDirectSMBPatching();
   }
+  if (shmem_numa_aware_pages_) {
+    service_->MaybeSharedMemoryArbiter()->EnableCpuLocalPages();
+  }
 }
 
 void TracingMuxerImpl::ProducerImpl::OnStartupTracingSetup() {
@@ -963,7 +968,8 @@ void TracingMuxerImpl::AddProducerBackend(TracingProducerBackend* backend,
   rb.type = type;
   rb.producer.reset(new ProducerImpl(this, backend_id,
                                      args.shmem_batch_commits_duration_ms,
-                                     args.shmem_direct_patching_enabled));
+                                     args.shmem_direct_patching_enabled,
+                                     args.shmem_numa_aware_pages));
   rb.producer_conn_args.producer = rb.producer.get();
   rb.producer_conn_args.producer_name = platform_->GetCurrentProcessName();
   rb.producer_conn_args.task_runner = task_runner_.get();
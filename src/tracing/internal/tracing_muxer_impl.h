@@ -212,7 +212,8 @@ class TracingMuxerImpl : public TracingMuxer {
     ProducerImpl(TracingMuxerImpl*,
                  TracingBackendId,
                  uint32_t shmem_batch_commits_duration_ms,
-                 bool shmem_direct_patching_enabled);
+                 bool shmem_direct_patching_enabled,
+                 bool shmem_numa_aware_pages);
     ~ProducerImpl() override;
 
     void Initialize(std::unique_ptr<ProducerEndpoint> endpoint);
@@ -254,6 +255,7 @@ class TracingMuxerImpl : public TracingMuxer {
 
     const uint32_t shmem_batch_commits_duration_ms_ = 0;
     const bool shmem_direct_patching_enabled_ = false;
+    const bool shmem_numa_aware_pages_ = false;
 
     // Set of data sources that have been actually registered on this producer.
     // This can be a subset of the global |data_sources_|, because data sources
@@ -20,12 +20,16 @@
 #include <string.h>
 
 #include <cinttypes>
+#include <condition_variable>
 #include <cstdint>
+#include <functional>
 #include <limits>
+#include <mutex>
 #include <optional>
 #include <regex>
 #include <string>
 #include <unordered_set>
+#include <vector>
 #include "perfetto/base/time.h"
 #include "perfetto/ext/tracing/core/client_identity.h"
 #include "perfetto/tracing/core/clock_snapshots.h"
@@ -153,6 +157,26 @@ ssize_t writev(int fd, const struct iovec* iov, int iovcnt) {
 #endif  // PERFETTO_BUILDFLAG(PERFETTO_OS_WIN) ||
         // PERFETTO_BUILDFLAG(PERFETTO_OS_NACL)
 
+// Slices up to this size are copied by WriteIntoFile() next to the preamble of
+// their packet rather than being written with an iovec of their own, which
+// costs more than the copy.
+constexpr size_t kMaxStagedSliceSize = 64;
+
+// Appends a [|base|, |base| + |len|) iovec to |iovecs|, merging it with the
+// last one if the two are contiguous in memory.
+void AppendIovec(std::vector<struct iovec>* iovecs, void* base, size_t len) {
+  if (len == 0)
+    return;
+  if (!iovecs->empty()) {
+    struct iovec& last = iovecs->back();
+    if (static_cast<char*>(last.iov_base) + last.iov_len == base) {
+      last.iov_len += len;
+      return;
+    }
+  }
+  iovecs->push_back({base, len});
+}
+
 // Partially encodes a CommitDataRequest in an int32 for the purposes of
 // metatracing. Note that it encodes only the bottom 10 bits of the producer id
 // (which is technically 16 bits wide).
@@ -328,6 +352,80 @@ std::optional<protozero::StringFilter::Policy> ConvertPolicy(
   return std::nullopt;
 }
 
+// Runs `fn(0)`, ..., `fn(count - 1)` concurrently on `pool` and on the calling
+// thread, and returns once all of them have completed.
+void RunOnThreadPoolAndWait(base::ThreadPool* pool,
+                            size_t count,
+                            const std::function<void(size_t)>& fn) {
+  if (count == 0)
+    return;
+  std::mutex mutex;
+  std::condition_variable cv;
+  size_t pending = count - 1;
+  for (size_t i = 1; i < count; i++) {
+    pool->PostTask([&, i] {
+      fn(i);
+      // Notify while holding the lock: |cv| is destroyed as soon as the
+      // calling thread observes |pending| == 0.
+      std::lock_guard<std::mutex> lock(mutex);
+      if (--pending == 0)
+        cv.notify_one();
+    });
+  }
+  fn(0);
+  std::unique_lock<std::mutex> lock(mutex);
+  cv.wait(lock, [&pending] { return pending == 0; });
+}
+
+// The packets read from a single TraceBuffer by ReadBuffers(), before the
+// trusted fields are appended to them.
+struct BufferReadResult {
+  struct Packet {
+    TracePacket packet;
+    TraceBuffer::PacketSequenceProperties sequence_properties{};
+    bool previous_packet_dropped = false;
+  };
+  std::vector<Packet> packets;
+  uint64_t invalid_packets = 0;
+  bool did_hit_threshold = false;
+};
+
+// Reads and validates the packets of `*tbuf` until their cumulative size
+// exceeds `threshold`. Only touches `*tbuf` and `*result`, so it can run
+// concurrently for different buffers.
+void ReadBufferPackets(TraceBuffer* tbuf,
+                       uint32_t buf_idx,
+                       size_t threshold,
+                       BufferReadResult* result) {
+  size_t packets_bytes = 0;
+  tbuf->BeginRead();
+  while (!result->did_hit_threshold) {
+    BufferReadResult::Packet read_packet;
+    TracePacket& packet = read_packet.packet;
+    const auto& sequence_properties = read_packet.sequence_properties;
+    if (!tbuf->ReadNextTracePacket(&packet, &read_packet.sequence_properties,
+                                   &read_packet.previous_packet_dropped)) {
+      break;
+    }
+    packet.set_buffer_index_for_stats(buf_idx);
+    PERFETTO_DCHECK(sequence_properties.producer_id_trusted != 0);
+    PERFETTO_DCHECK(sequence_properties.writer_id != 0);
+    PERFETTO_DCHECK(sequence_properties.client_identity_trusted.has_uid());
+    // Not checking sequence_properties.client_identity_trusted.has_pid():
+    // it is false if the platform doesn't support it.
+
+    PERFETTO_DCHECK(packet.size() > 0);
+    if (!PacketStreamValidator::Validate(packet.slices())) {
+      result->invalid_packets++;
+      PERFETTO_DLOG("Dropping invalid packet");
+      continue;
+    }
+    packets_bytes += packet.size();
+    result->did_hit_threshold = packets_bytes >= threshold;
+    result->packets.emplace_back(std::move(read_packet));
+  }
+}
+
 }  // namespace
 
 // static
@@ -352,6 +450,14 @@ TracingServiceImpl::TracingServiceImpl(
           static_cast<uint32_t>(base::GetWallTimeNs().count())),
       weak_ptr_factory_(this) {
   PERFETTO_DCHECK(task_runner_);
+  if (init_opts_.read_buffers_thread_count > 0) {
+    read_buffers_thread_pool_ = std::make_unique<base::ThreadPool>(
+        init_opts_.read_buffers_thread_count);
+  }
+  if (init_opts_.compressor_fn && init_opts_.compression_thread_count > 0) {
+    compression_thread_pool_ = std::make_unique<base::ThreadPool>(
+        init_opts_.compression_thread_count);
+  }
 }
 
 TracingServiceImpl::~TracingServiceImpl() {
@@ -2350,6 +2456,7 @@ bool TracingServiceImpl::ReadBuffersIntoConsumer(
   bool has_more;
   std::vector<TracePacket> packets =
       ReadBuffers(tracing_session, kApproxBytesPerTask, &has_more);
+  MaybeCompressPackets(tracing_session, &packets);
 
   if (has_more) {
     auto weak_consumer = consumer->weak_ptr_factory_.GetWeakPtr();
@@ -2391,13 +2498,37 @@ bool TracingServiceImpl::ReadBuffersIntoFile(TracingSessionID tsid) {
   // ReadBuffersIntoConsumer, but that's not currently possible.
   // ReadBuffersIntoFile has to read the whole available data before returning,
   // to support the disable_immediately=true code paths.
+  //
+  // If the chunks have to be compressed and there is a
+  // |compression_thread_pool_|, up to two chunks per thread are read first
+  // and compressed concurrently (each chunk is compressed independently
+  // anyway), then written in order.
+  size_t max_chunks_in_flight = 1;
+  if (compression_thread_pool_ && tracing_session->compress_deflate) {
+    max_chunks_in_flight = 2 * (compression_thread_pool_->thread_count() + 1);
+  }
   bool has_more = true;
   bool stop_writing_into_file = false;
   do {
-    std::vector<TracePacket> packets =
-        ReadBuffers(tracing_session, kWriteIntoFileChunkSize, &has_more);
-
-    stop_writing_into_file = WriteIntoFile(tracing_session, std::move(packets));
+    std::vector<std::vector<TracePacket>> chunks;
+    do {
+      chunks.emplace_back(
+          ReadBuffers(tracing_session, kWriteIntoFileChunkSize, &has_more));
+    } while (has_more && chunks.size() < max_chunks_in_flight);
+
+    if (chunks.size() > 1) {
+      RunOnThreadPoolAndWait(
+          compression_thread_pool_.get(), chunks.size(),
+          [this, &chunks](size_t i) { init_opts_.compressor_fn(&chunks[i]); });
+    } else {
+      MaybeCompressPackets(tracing_session, &chunks[0]);
+    }
+    for (auto& packets : chunks) {
+      stop_writing_into_file =
+          WriteIntoFile(tracing_session, std::move(packets));
+      if (stop_writing_into_file)
+        break;
+    }
   } while (has_more && !stop_writing_into_file);
 
   if (stop_writing_into_file || tracing_session->write_period_ms == 0) {
@@ -2512,39 +2643,55 @@ std::vector<TracePacket> TracingServiceImpl::ReadBuffers(
     packets_bytes += packet.size();
   }
 
-  bool did_hit_threshold = false;
-
-  for (size_t buf_idx = 0;
-       buf_idx < tracing_session->num_buffers() && !did_hit_threshold;
-       buf_idx++) {
-    auto tbuf_iter = buffers_.find(tracing_session->buffers_index[buf_idx]);
+  // Read the packets of the buffers, either one after the other on this
+  // thread or, if the service has a |read_buffers_thread_pool_|, all at once:
+  // each buffer is read by a different thread and the service thread waits
+  // for all of them. In the latter case, each buffer gets an equal share of
+  // |threshold| (at least one packet is always read from each buffer).
+  std::vector<TraceBuffer*> tbufs;
+  for (BufferID buf_id : tracing_session->buffers_index) {
+    auto tbuf_iter = buffers_.find(buf_id);
     if (tbuf_iter == buffers_.end()) {
       PERFETTO_DFATAL("Buffer not found.");
+      tbufs.push_back(nullptr);
       continue;
     }
-    TraceBuffer& tbuf = *tbuf_iter->second;
-    tbuf.BeginRead();
-    while (!did_hit_threshold) {
-      TracePacket packet;
-      TraceBuffer::PacketSequenceProperties sequence_properties{};
-      bool previous_packet_dropped;
-      if (!tbuf.ReadNextTracePacket(&packet, &sequence_properties,
-                                    &previous_packet_dropped)) {
-        break;
-      }
-      packet.set_buffer_index_for_stats(static_cast<uint32_t>(buf_idx));
-      PERFETTO_DCHECK(sequence_properties.producer_id_trusted != 0);
-      PERFETTO_DCHECK(sequence_properties.writer_id != 0);
-      PERFETTO_DCHECK(sequence_properties.client_identity_trusted.has_uid());
-      // Not checking sequence_properties.client_identity_trusted.has_pid():
-      // it is false if the platform doesn't support it.
-
-      PERFETTO_DCHECK(packet.size() > 0);
-      if (!PacketStreamValidator::Validate(packet.slices())) {
-        tracing_session->invalid_packets++;
-        PERFETTO_DLOG("Dropping invalid packet");
+    tbufs.push_back(tbuf_iter->second.get());
+  }
+  size_t remaining = threshold > packets_bytes ? threshold - packets_bytes : 0;
+  std::vector<BufferReadResult> results(tbufs.size());
+  bool did_hit_threshold = false;
+  if (read_buffers_thread_pool_ && tbufs.size() > 1) {
+    size_t buffer_threshold = remaining / tbufs.size();
+    RunOnThreadPoolAndWait(
+        read_buffers_thread_pool_.get(), tbufs.size(), [&](size_t buf_idx) {
+          if (tbufs[buf_idx]) {
+            ReadBufferPackets(tbufs[buf_idx], static_cast<uint32_t>(buf_idx),
+                              buffer_threshold, &results[buf_idx]);
+          }
+        });
+    for (const BufferReadResult& result : results)
+      did_hit_threshold |= result.did_hit_threshold;
+  } else {
+    for (uint32_t buf_idx = 0; buf_idx < tbufs.size() && !did_hit_threshold;
+         buf_idx++) {
+      if (!tbufs[buf_idx])
         continue;
-      }
+      BufferReadResult& result = results[buf_idx];
+      ReadBufferPackets(tbufs[buf_idx], buf_idx, remaining, &result);
+      did_hit_threshold = result.did_hit_threshold;
+      for (const BufferReadResult::Packet& read_packet : result.packets)
+        remaining -= std::min(remaining, read_packet.packet.size());
+    }
+  }
+
+  // Append the packets in buffer order. This happens on the service thread
+  // because the trusted packet sequence IDs are allocated by the session.
+  for (BufferReadResult& result : results) {
+    tracing_session->invalid_packets += result.invalid_packets;
+    for (BufferReadResult::Packet& read_packet : result.packets) {
+      TracePacket& packet = read_packet.packet;
+      const auto& sequence_properties = read_packet.sequence_properties;
 
       // Append a slice with the trusted field data. This can't be spoofed
       // because above we validated that the existing slices don't contain any
@@ -2574,14 +2721,12 @@ std::vector<TracePacket> TracingServiceImpl::ReadBuffers(
       if (client_identity_trusted.has_non_default_machine_id()) {
         trusted_packet->set_machine_id(client_identity_trusted.machine_id());
       }
-      if (previous_packet_dropped)
-        trusted_packet->set_previous_packet_dropped(previous_packet_dropped);
+      if (read_packet.previous_packet_dropped)
+        trusted_packet->set_previous_packet_dropped(true);
       slice.size = trusted_packet.Finalize();
       packet.AddSlice(std::move(slice));
 
       // Append the packet (inclusive of the trusted uid) to |packets|.
-      packets_bytes += packet.size();
-      did_hit_threshold = packets_bytes >= threshold;
       packets.emplace_back(std::move(packet));
     }  // for(packets...)
   }  // for(buffers...)
@@ -2616,8 +2761,6 @@ std::vector<TracePacket> TracingServiceImpl::ReadBuffers(
 
   MaybeFilterPackets(tracing_session, &packets);
 
-  MaybeCompressPackets(tracing_session, &packets);
-
   if (!*has_more) {
     // We've observed some extremely high memory usage by scudo after
     // MaybeFilterPackets in the past. The original bug (b/195145848) is fixed
@@ -2708,52 +2851,83 @@ bool TracingServiceImpl::WriteIntoFile(TracingSession* tracing_session,
                                 ? tracing_session->max_file_size_bytes
                                 : std::numeric_limits<size_t>::max();
 
-  size_t total_slices = 0;
+  // The slices of the packets read from the buffers point straight into the
+  // memory of the TraceBuffer(s), so they are written into the file without
+  // any intermediate copy. Only the small pieces in between (the preamble of
+  // each packet and the slice with the trusted fields appended by
+  // ReadBuffers()) are copied into |staging|, so that the pieces which are
+  // adjacent in the file are written with a single iovec. This saves at least
+  // one iovec per packet, and so writev() calls.
+  size_t max_iovecs = 0;
+  size_t staging_size = 0;
   for (const TracePacket& packet : packets) {
-    total_slices += packet.slices().size();
+    // When writing into a file, the file should look like a root trace.proto
+    // message. Each packet should be prepended with a proto preamble stating
+    // its field id (within trace.proto) and size.
+    max_iovecs += 1 + packet.slices().size();
+    staging_size += TracePacket::kMaxPreambleBytes;
+    for (const Slice& slice : packet.slices()) {
+      if (slice.size <= kMaxStagedSliceSize)
+        staging_size += slice.size;
+    }
   }
-  // When writing into a file, the file should look like a root trace.proto
-  // message. Each packet should be prepended with a proto preamble stating
-  // its field id (within trace.proto) and size. Hence the addition below.
-  const size_t max_iovecs = total_slices + packets.size();
+  std::unique_ptr<char[]> staging(new char[staging_size]);
+  char* staging_end = staging.get();
+  std::vector<struct iovec> iovecs;
+  iovecs.reserve(max_iovecs);
 
-  size_t num_iovecs = 0;
   bool stop_writing_into_file = false;
-  std::unique_ptr<struct iovec[]> iovecs(new struct iovec[max_iovecs]);
   size_t num_iovecs_at_last_packet = 0;
+  size_t last_iovec_len_at_last_packet = 0;
   uint64_t bytes_about_to_be_written = 0;
   for (TracePacket& packet : packets) {
-    std::tie(iovecs[num_iovecs].iov_base, iovecs[num_iovecs].iov_len) =
-        packet.GetProtoPreamble();
-    bytes_about_to_be_written += iovecs[num_iovecs].iov_len;
-    num_iovecs++;
+    char* preamble;
+    size_t preamble_size;
+    std::tie(preamble, preamble_size) = packet.GetProtoPreamble();
+    PERFETTO_DCHECK(preamble_size <= TracePacket::kMaxPreambleBytes);
+    memcpy(staging_end, preamble, preamble_size);
+    AppendIovec(&iovecs, staging_end, preamble_size);
+    staging_end += preamble_size;
+    bytes_about_to_be_written += preamble_size;
+
     for (const Slice& slice : packet.slices()) {
-      // writev() doesn't change the passed pointer. However, struct iovec
-      // take a non-const ptr because it's the same struct used by readv().
-      // Hence the const_cast here.
-      char* start = static_cast<char*>(const_cast<void*>(slice.start));
       bytes_about_to_be_written += slice.size;
-      iovecs[num_iovecs++] = {start, slice.size};
+      if (slice.size <= kMaxStagedSliceSize) {
+        memcpy(staging_end, slice.start, slice.size);
+        AppendIovec(&iovecs, staging_end, slice.size);
+        staging_end += slice.size;
+      } else {
+        // writev() doesn't change the passed pointer. However, struct iovec
+        // take a non-const ptr because it's the same struct used by readv().
+        // Hence the const_cast here.
+        AppendIovec(&iovecs, const_cast<void*>(slice.start), slice.size);
+      }
     }
 
     if (tracing_session->bytes_written_into_file + bytes_about_to_be_written >=
         max_size) {
       stop_writing_into_file = true;
-      num_iovecs = num_iovecs_at_last_packet;
+      // Drop this packet, including the bytes it appended to the iovec of the
+      // previous one.
+      iovecs.resize(num_iovecs_at_last_packet);
+      if (!iovecs.empty())
+        iovecs.back().iov_len = last_iovec_len_at_last_packet;
       break;
     }
 
-    num_iovecs_at_last_packet = num_iovecs;
+    num_iovecs_at_last_packet = iovecs.size();
+    last_iovec_len_at_last_packet = iovecs.back().iov_len;
   }
-  PERFETTO_DCHECK(num_iovecs <= max_iovecs);
+  PERFETTO_DCHECK(iovecs.size() <= max_iovecs);
+  PERFETTO_DCHECK(staging_end <= staging.get() + staging_size);
   int fd = *tracing_session->write_into_file;
 
   uint64_t total_wr_size = 0;
 
   // writev() can take at most IOV_MAX entries per call. Batch them.
   constexpr size_t kIOVMax = IOV_MAX;
-  for (size_t i = 0; i < num_iovecs; i += kIOVMax) {
-    int iov_batch_size = static_cast<int>(std::min(num_iovecs - i, kIOVMax));
+  for (size_t i = 0; i < iovecs.size();) {
+    int iov_batch_size = static_cast<int>(std::min(iovecs.size() - i, kIOVMax));
     ssize_t wr_size = PERFETTO_EINTR(writev(fd, &iovecs[i], iov_batch_size));
     if (wr_size <= 0) {
       PERFETTO_PLOG("writev() failed");
@@ -2761,6 +2935,18 @@ bool TracingServiceImpl::WriteIntoFile(TracingSession* tracing_session,
       break;
     }
     total_wr_size += static_cast<size_t>(wr_size);
+
+    // writev() can write less than requested: skip the iovecs that were
+    // written fully and resume from the middle of the one written partially.
+    size_t wr_left = static_cast<size_t>(wr_size);
+    while (wr_left > 0 && wr_left >= iovecs[i].iov_len) {
+      wr_left -= iovecs[i].iov_len;
+      i++;
+    }
+    if (wr_left > 0) {
+      iovecs[i].iov_base = static_cast<char*>(iovecs[i].iov_base) + wr_left;
+      iovecs[i].iov_len -= wr_left;
+    }
   }
 
   tracing_session->bytes_written_into_file += total_wr_size;
@@ -33,6 +33,7 @@
 #include "perfetto/ext/base/circular_queue.h"
 #include "perfetto/ext/base/periodic_task.h"
 #include "perfetto/ext/base/string_view.h"
+#include "perfetto/ext/base/threading/thread_pool.h"
 #include "perfetto/ext/base/uuid.h"
 #include "perfetto/ext/base/weak_ptr.h"
 #include "perfetto/ext/tracing/core/basic_types.h"
@@ -847,7 +848,8 @@ class TracingServiceImpl : public TracingService {
   static bool IsWaitingForTrigger(TracingSession* tracing_session);
 
   // Reads the buffers from `*tracing_session` and returns them (along with some
-  // metadata packets).
+  // metadata packets). The packets are filtered but not compressed: see
+  // MaybeCompressPackets().
   //
   // The function stops when the cumulative size of the return packets exceeds
   // `threshold` (so it's not a strict upper bound) and sets `*has_more` to
@@ -904,6 +906,14 @@ class TracingServiceImpl : public TracingService {
   std::map<RelayClientID, RelayEndpointImpl*> relay_clients_;
   std::map<TracingSessionID, TracingSession> tracing_sessions_;
   std::map<BufferID, std::unique_ptr<TraceBuffer>> buffers_;
+
+  // Used by ReadBuffers() to read the buffers of a session concurrently. Only
+  // created if |init_opts_.read_buffers_thread_count| > 0.
+  std::unique_ptr<base::ThreadPool> read_buffers_thread_pool_;
+
+  // Used by ReadBuffersIntoFile() to compress chunks of the trace
+  // concurrently. Only created if |init_opts_.compression_thread_count| > 0.
+  std::unique_ptr<base::ThreadPool> compression_thread_pool_;
   std::map<std::string, int64_t> session_to_last_trace_s_;
 
   // Contains timestamps of triggers.
@@ -0,0 +1,244 @@
+/*
+ * Copyright (C) 2024 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Measures the time it takes the service to write the contents of all the
+// buffers of a write_into_file session to the file when the session is
+// stopped, depending on the number of buffers and on
+// TracingService::InitOpts::read_buffers_thread_count, and with compression
+// depending on TracingService::InitOpts::compression_thread_count.
+//
+// The rates are computed on the CPU time of the service thread (the main
+// thread of the benchmark), so bytes_per_second is the inverse of the service
+// CPU time per byte written when no thread pool is used.
+
+#include <fcntl.h>
+
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "perfetto/base/build_config.h"
+#include "perfetto/base/logging.h"
+#include "perfetto/ext/base/file_utils.h"
+#include "perfetto/ext/base/scoped_file.h"
+#include "perfetto/ext/tracing/core/client_identity.h"
+#include "perfetto/ext/tracing/core/consumer.h"
+#include "perfetto/ext/tracing/core/producer.h"
+#include "perfetto/ext/tracing/core/trace_writer.h"
+#include "perfetto/ext/tracing/core/tracing_service.h"
+#include "perfetto/tracing/core/data_source_config.h"
+#include "perfetto/tracing/core/data_source_descriptor.h"
+#include "perfetto/tracing/core/trace_config.h"
+#include "src/base/test/test_task_runner.h"
+#include "src/tracing/core/in_process_shared_memory.h"
+
+#if PERFETTO_BUILDFLAG(PERFETTO_ZLIB)
+#include "src/tracing/service/zlib_compressor.h"
+#endif
+
+#include "protos/perfetto/trace/test_event.pbzero.h"
+#include "protos/perfetto/trace/trace_packet.pbzero.h"
+
+namespace perfetto {
+namespace {
+
+constexpr char kDataSourceName[] = "benchmark_data_source";
+constexpr size_t kDefaultPacketSize = 512;
+constexpr size_t kBytesPerFlush = 32 * 1024;
+
+bool IsBenchmarkFunctionalOnly() {
+  return getenv("BENCHMARK_FUNCTIONAL_TEST_ONLY") != nullptr;
+}
+
+// Collects the target buffers of the data source instances it is asked to
+// start.
+class BenchmarkProducer : public Producer {
+ public:
+  void OnConnect() override {}
+  void OnDisconnect() override {}
+  void OnTracingSetup() override {}
+  void SetupDataSource(DataSourceInstanceID, const DataSourceConfig&) override {
+  }
+  void StartDataSource(DataSourceInstanceID,
+                       const DataSourceConfig& cfg) override {
+    target_buffers.push_back(static_cast<BufferID>(cfg.target_buffer()));
+  }
+  void StopDataSource(DataSourceInstanceID) override {}
+  void Flush(FlushRequestID,
+             const DataSourceInstanceID*,
+             size_t,
+             FlushFlags) override {}
+  void ClearIncrementalState(const DataSourceInstanceID*, size_t) override {}
+
+  std::vector<BufferID> target_buffers;
+};
+
+class BenchmarkConsumer : public Consumer {
+ public:
+  void OnConnect() override {}
+  void OnDisconnect() override {}
+  void OnTracingDisabled(const std::string&) override {}
+  void OnTraceData(std::vector<TracePacket>, bool) override {}
+  void OnDetach(bool) override {}
+  void OnAttach(bool, const TraceConfig&) override {}
+  void OnTraceStats(bool, const TraceStats&) override {}
+  void OnObservableEvents(const ObservableEvents&) override {}
+};
+
+void RunStopWriteIntoFile(benchmark::State& state,
+                          uint32_t num_buffers,
+                          const TracingService::InitOpts& init_opts,
+                          size_t packet_size = kDefaultPacketSize) {
+  const size_t bytes_per_buffer =
+      IsBenchmarkFunctionalOnly() ? 64 * 1024 : 4 * 1024 * 1024;
+
+  base::TestTaskRunner task_runner;
+  std::unique_ptr<TracingService> svc = TracingService::CreateInstance(
+      std::make_unique<InProcessSharedMemory::Factory>(), &task_runner,
+      init_opts);
+
+  BenchmarkProducer producer;
+  std::unique_ptr<TracingService::ProducerEndpoint> producer_endpoint =
+      svc->ConnectProducer(&producer, ClientIdentity(1000, 1000), "producer",
+                           /*shared_memory_size_hint_bytes=*/4 * 1024 * 1024,
+                           /*in_process=*/true);
+  DataSourceDescriptor descriptor;
+  descriptor.set_name(kDataSourceName);
+  producer_endpoint->RegisterDataSource(descriptor);
+
+  BenchmarkConsumer consumer;
+  std::unique_ptr<TracingService::ConsumerEndpoint> consumer_endpoint =
+      svc->ConnectConsumer(&consumer, 1000);
+  task_runner.RunUntilIdle();
+
+  TraceConfig trace_config;
+  trace_config.set_write_into_file(true);
+  if (init_opts.compressor_fn)
+    trace_config.set_compression_type(TraceConfig::COMPRESSION_TYPE_DEFLATE);
+  for (uint32_t i = 0; i < num_buffers; i++) {
+    trace_config.add_buffers()->set_size_kb(
+        static_cast<uint32_t>(bytes_per_buffer * 2 / 1024));
+    auto* ds_config = trace_config.add_data_sources()->mutable_config();
+    ds_config->set_name(kDataSourceName);
+    ds_config->set_target_buffer(i);
+  }
+
+  // Random letters out of 16, which compress to about half their size.
+  std::minstd_rand rnd;
+  std::string payload(packet_size, 'a');
+  for (char& c : payload)
+    c = static_cast<char>('a' + rnd() % 16);
+
+  for (auto _ : state) {
+    state.PauseTiming();
+    producer.target_buffers.clear();
+    consumer_endpoint->EnableTracing(trace_config,
+                                     base::OpenFile("/dev/null", O_WRONLY));
+    task_runner.RunUntilIdle();
+    PERFETTO_CHECK(producer.target_buffers.size() == num_buffers);
+
+    std::vector<std::unique_ptr<TraceWriter>> writers;
+    for (BufferID target_buffer : producer.target_buffers)
+      writers.push_back(producer_endpoint->CreateTraceWriter(target_buffer));
+
+    // Commit the data in small steps so that the writers never stall on the
+    // shared memory buffer, which is only drained when the task runner runs.
+    for (size_t written = 0; written < bytes_per_buffer;
+         written += kBytesPerFlush) {
+      for (auto& writer : writers) {
+        for (size_t i = 0; i < kBytesPerFlush / packet_size; i++) {
+          auto packet = writer->NewTracePacket();
+          packet->set_for_testing()->set_str(payload);
+        }
+        writer->Flush();
+      }
+      task_runner.RunUntilIdle();
+    }
+    writers.clear();
+    task_runner.RunUntilIdle();
+    state.ResumeTiming();
+
+    // Stopping a write_into_file session synchronously reads all its buffers
+    // into the file.
+    consumer_endpoint->DisableTracing();
+
+    state.PauseTiming();
+    consumer_endpoint->FreeBuffers();
+    task_runner.RunUntilIdle();
+    state.ResumeTiming();
+  }
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                          static_cast<int64_t>(num_buffers) *
+                          static_cast<int64_t>(bytes_per_buffer));
+}
+
+void BM_TracingServiceStopWriteIntoFile(benchmark::State& state) {
+  TracingService::InitOpts init_opts;
+  init_opts.read_buffers_thread_count = static_cast<uint32_t>(state.range(1));
+  RunStopWriteIntoFile(state, static_cast<uint32_t>(state.range(0)),
+                       init_opts);
+}
+
+void StopWriteIntoFileArgs(benchmark::internal::Benchmark* b) {
+  b->ArgNames({"buffers", "threads"});
+  for (int64_t buffers : {1, 2, 4, 8, 16}) {
+    for (int64_t threads : {0, 4}) {
+      b->Args({buffers, threads});
+    }
+  }
+}
+
+BENCHMARK(BM_TracingServiceStopWriteIntoFile)
+    ->Apply(StopWriteIntoFileArgs)
+    ->Unit(benchmark::kMillisecond);
+
+// Small packets stress the per-packet overhead of writing into the file.
+void BM_TracingServiceStopWriteIntoFilePacketSize(benchmark::State& state) {
+  RunStopWriteIntoFile(state, /*num_buffers=*/1, TracingService::InitOpts(),
+                       static_cast<size_t>(state.range(0)));
+}
+
+BENCHMARK(BM_TracingServiceStopWriteIntoFilePacketSize)
+    ->ArgName("packet_size")
+    ->Arg(16)
+    ->Arg(64)
+    ->Arg(512)
+    ->Arg(4096)
+    ->Unit(benchmark::kMillisecond);
+
+#if PERFETTO_BUILDFLAG(PERFETTO_ZLIB)
+void BM_TracingServiceStopWriteIntoFileCompressed(benchmark::State& state) {
+  TracingService::InitOpts init_opts;
+  init_opts.compressor_fn = &ZlibCompressFn;
+  init_opts.compression_thread_count = static_cast<uint32_t>(state.range(0));
+  RunStopWriteIntoFile(state, /*num_buffers=*/4, init_opts);
+}
+
+BENCHMARK(BM_TracingServiceStopWriteIntoFileCompressed)
+    ->ArgName("threads")
+    ->Arg(0)
+    ->Arg(2)
+    ->Arg(4)
+    ->Unit(benchmark::kMillisecond);
+#endif  // PERFETTO_BUILDFLAG(PERFETTO_ZLIB)
+
+}  // namespace
+}  // namespace perfetto
@@ -2039,6 +2039,74 @@ TEST_F(TracingServiceImplTest, CompressionWriteIntoFile) {
                   Property(&protos::gen::TestEvent::str, Eq("payload-2")))));
 }
 
+TEST_F(TracingServiceImplTest, CompressionWriteIntoFileOnThreadPool) {
+  static const size_t kNumTestPackets = 8;
+  static const size_t kPayloadSize = 500 * 1024UL;
+  static_assert(kNumTestPackets * kPayloadSize >
+                    2 * TracingServiceImpl::kWriteIntoFileChunkSize,
+                "This test covers compressing multiple chunks");
+
+  TracingService::InitOpts init_opts;
+  init_opts.compressor_fn = ZlibCompressFn;
+  init_opts.compression_thread_count = 2;
+  InitializeSvcWithOpts(init_opts);
+
+  std::unique_ptr<MockConsumer> consumer = CreateMockConsumer();
+  consumer->Connect(svc.get());
+
+  std::unique_ptr<MockProducer> producer = CreateMockProducer();
+  producer->Connect(svc.get(), "mock_producer");
+  producer->RegisterDataSource("data_source");
+
+  TraceConfig trace_config;
+  trace_config.add_buffers()->set_size_kb(8192);
+  auto* ds_config = trace_config.add_data_sources()->mutable_config();
+  ds_config->set_name("data_source");
+  ds_config->set_target_buffer(0);
+  trace_config.set_write_into_file(true);
+  trace_config.set_file_write_period_ms(100000);  // 100s
+  trace_config.set_compression_type(TraceConfig::COMPRESSION_TYPE_DEFLATE);
+  base::TempFile tmp_file = base::TempFile::Create();
+  consumer->EnableTracing(trace_config, base::ScopedFile(dup(tmp_file.fd())));
+
+  producer->WaitForTracingSetup();
+  producer->WaitForDataSourceSetup("data_source");
+  producer->WaitForDataSourceStart("data_source");
+
+  std::unique_ptr<TraceWriter> writer =
+      producer->CreateTraceWriter("data_source");
+  for (size_t i = 0; i < kNumTestPackets; i++) {
+    auto tp = writer->NewTracePacket();
+    std::string payload = std::to_string(i) + std::string(kPayloadSize, 'c');
+    tp->set_for_testing()->set_str(payload.c_str(), payload.size());
+  }
+
+  writer->Flush();
+  writer.reset();
+
+  consumer->DisableTracing();
+  producer->WaitForDataSourceStop("data_source");
+  consumer->WaitForTracingDisabled();
+
+  // Each chunk is compressed into its own packet and the chunks must be
+  // written in order.
+  std::string trace_raw;
+  ASSERT_TRUE(base::ReadFile(tmp_file.path().c_str(), &trace_raw));
+  protos::gen::Trace trace;
+  ASSERT_TRUE(trace.ParseFromString(trace_raw));
+  EXPECT_GT(trace.packet().size(), 2u);
+  EXPECT_THAT(trace.packet(),
+              Each(Property(&protos::gen::TracePacket::compressed_packets,
+                            Not(IsEmpty()))));
+  std::vector<std::string> payload_prefixes;
+  for (const auto& packet : DecompressTrace(trace.packet())) {
+    if (packet.has_for_testing())
+      payload_prefixes.push_back(packet.for_testing().str().substr(0, 1));
+  }
+  EXPECT_THAT(payload_prefixes,
+              ElementsAre("0", "1", "2", "3", "4", "5", "6", "7"));
+}
+
 TEST_F(TracingServiceImplTest, CloneSessionWithCompression) {
   TracingService::InitOpts init_opts;
   init_opts.compressor_fn = ZlibCompressFn;
@@ -2192,6 +2260,68 @@ TEST_F(TracingServiceImplTest, WriteIntoFileAndStopOnMaxSize) {
   }
 }
 
+// Small packets are coalesced into few large iovecs by WriteIntoFile(): check
+// that they are all written, in order, also across writev() batches.
+TEST_F(TracingServiceImplTest, WriteIntoFileManySmallPackets) {
+  std::unique_ptr<MockConsumer> consumer = CreateMockConsumer();
+  consumer->Connect(svc.get());
+
+  std::unique_ptr<MockProducer> producer = CreateMockProducer();
+  producer->Connect(svc.get(), "mock_producer");
+  producer->RegisterDataSource("data_source");
+
+  TraceConfig trace_config;
+  trace_config.add_buffers()->set_size_kb(4096);
+  auto* ds_config = trace_config.add_data_sources()->mutable_config();
+  ds_config->set_name("data_source");
+  ds_config->set_target_buffer(0);
+  trace_config.set_write_into_file(true);
+  base::TempFile tmp_file = base::TempFile::Create();
+  consumer->EnableTracing(trace_config, base::ScopedFile(dup(tmp_file.fd())));
+
+  producer->WaitForTracingSetup();
+  producer->WaitForDataSourceSetup("data_source");
+  producer->WaitForDataSourceStart("data_source");
+
+  // Enough packets to need more than IOV_MAX iovecs, some of them larger than
+  // the slices that are coalesced.
+  static const size_t kNumTestPackets = 5000;
+  std::unique_ptr<TraceWriter> writer =
+      producer->CreateTraceWriter("data_source");
+  for (size_t i = 0; i < kNumTestPackets; i++) {
+    auto tp = writer->NewTracePacket();
+    std::string payload = std::to_string(i);
+    if (i % 10 == 0)
+      payload.append(200, 'x');
+    tp->set_for_testing()->set_str(payload);
+  }
+  writer->Flush();
+  writer.reset();
+
+  consumer->DisableTracing();
+  producer->WaitForDataSourceStop("data_source");
+  consumer->WaitForTracingDisabled();
+
+  std::string trace_raw;
+  ASSERT_TRUE(base::ReadFile(tmp_file.path(), &trace_raw));
+  protos::gen::Trace trace;
+  ASSERT_TRUE(trace.ParseFromString(trace_raw));
+  std::vector<std::string> payloads;
+  for (const protos::gen::TracePacket& packet : trace.packet()) {
+    if (packet.has_for_testing()) {
+      EXPECT_NE(packet.trusted_packet_sequence_id(), 0u);
+      payloads.push_back(packet.for_testing().str());
+    }
+  }
+  ASSERT_EQ(payloads.size(), kNumTestPackets);
+  for (size_t i = 0; i < kNumTestPackets; i++) {
+    std::string payload = std::to_string(i);
+    if (i % 10 == 0)
+      payload.append(200, 'x');
+    EXPECT_EQ(payloads[i], payload);
+  }
+}
+
 TEST_F(TracingServiceImplTest, WriteIntoFileWithPath) {
   auto tmp_file = base::TempFile::Create();
   // Deletes the file (the service would refuse to overwrite an existing file)
@@ -3159,6 +3289,72 @@ TEST_F(TracingServiceImplTest, ProducerUIDsAndPacketSequenceIDs) {
                    Eq(4u)))));
 }
 
+TEST_F(TracingServiceImplTest, ReadBuffersOnThreadPool) {
+  TracingService::InitOpts init_opts;
+  init_opts.read_buffers_thread_count = 2;
+  InitializeSvcWithOpts(init_opts);
+
+  std::unique_ptr<MockConsumer> consumer = CreateMockConsumer();
+  consumer->Connect(svc.get());
+
+  std::unique_ptr<MockProducer> producer = CreateMockProducer();
+  producer->Connect(svc.get(), "mock_producer");
+  static constexpr uint32_t kNumBuffers = 4;
+  TraceConfig trace_config;
+  for (uint32_t i = 0; i < kNumBuffers; i++) {
+    std::string name = "data_source" + std::to_string(i);
+    producer->RegisterDataSource(name);
+    trace_config.add_buffers()->set_size_kb(128);
+    auto* ds_config = trace_config.add_data_sources()->mutable_config();
+    ds_config->set_name(name);
+    ds_config->set_target_buffer(i);
+  }
+  consumer->EnableTracing(trace_config);
+
+  producer->WaitForTracingSetup();
+  for (uint32_t i = 0; i < kNumBuffers; i++)
+    producer->WaitForDataSourceSetup("data_source" + std::to_string(i));
+  std::vector<std::unique_ptr<TraceWriter>> writers;
+  for (uint32_t i = 0; i < kNumBuffers; i++) {
+    std::string name = "data_source" + std::to_string(i);
+    producer->WaitForDataSourceStart(name);
+    writers.push_back(producer->CreateTraceWriter(name));
+  }
+  for (uint32_t i = 0; i < kNumBuffers; i++) {
+    for (uint32_t j = 0; j < 10; j++) {
+      auto tp = writers[i]->NewTracePacket();
+      tp->set_for_testing()->set_str("payload-" + std::to_string(i) + "-" +
+                                     std::to_string(j));
+    }
+    writers[i]->Flush();
+  }
+  writers.clear();
+
+  consumer->DisableTracing();
+  for (uint32_t i = 0; i < kNumBuffers; i++)
+    producer->WaitForDataSourceStop("data_source" + std::to_string(i));
+  consumer->WaitForTracingDisabled();
+
+  // All the packets should be read, in buffer order, with the trusted fields
+  // appended.
+  std::vector<protos::gen::TracePacket> packets = consumer->ReadBuffers();
+  std::vector<std::string> payloads;
+  for (const auto& packet : packets) {
+    if (!packet.has_for_testing())
+      continue;
+    EXPECT_NE(packet.trusted_packet_sequence_id(), 0u);
+    payloads.push_back(packet.for_testing().str());
+  }
+  std::vector<std::string> expected_payloads;
+  for (uint32_t i = 0; i < kNumBuffers; i++) {
+    for (uint32_t j = 0; j < 10; j++) {
+      expected_payloads.push_back("payload-" + std::to_string(i) + "-" +
+                                  std::to_string(j));
+    }
+  }
+  EXPECT_THAT(payloads, ElementsAreArray(expected_payloads));
+}
+
 TEST_F(TracingServiceImplTest, AllowedBuffers) {
   std::unique_ptr<MockConsumer> consumer = CreateMockConsumer();
   consumer->Connect(svc.get());
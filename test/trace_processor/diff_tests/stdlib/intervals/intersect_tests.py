@@ -48,7 +48,7 @@ class IntervalsIntersect(TestSuite):
           SELECT * FROM data;
 
         SELECT ts, dur, id_0, id_1
-        FROM _interval_intersect!((A, B), ())
+        FROM interval_intersect!((A, B), ())
         ORDER BY ts;
         """,
         out=Csv("""
@@ -85,7 +85,7 @@ class IntervalsIntersect(TestSuite):
           SELECT * FROM data;
 
         SELECT ts, dur, id_0, id_1
-        FROM _interval_intersect!((B, A), ())
+        FROM interval_intersect!((B, A), ())
         ORDER BY ts;
         """,
         out=Csv("""
@@ -132,7 +132,7 @@ class IntervalsIntersect(TestSuite):
           SELECT * FROM data;
 
         SELECT ts, dur, id_0, id_1, id_2
-        FROM _interval_intersect!((A, B, C), ())
+        FROM interval_intersect!((A, B, C), ())
         ORDER BY ts;
         """,
         out=Csv("""
@@ -164,7 +164,7 @@ class IntervalsIntersect(TestSuite):
           SELECT * FROM data;
 
         SELECT ts, dur, id_0, id_1
-        FROM _interval_intersect!((A, B), ())
+        FROM interval_intersect!((A, B), ())
         ORDER BY ts;
         """,
         out=Csv("""
@@ -195,7 +195,7 @@ class IntervalsIntersect(TestSuite):
           SELECT * FROM data;
 
         SELECT ts, dur, id_0, id_1
-        FROM _interval_intersect!((B, A), ())
+        FROM interval_intersect!((B, A), ())
         ORDER BY ts;
         """,
         out=Csv("""
@@ -222,7 +222,7 @@ class IntervalsIntersect(TestSuite):
         SELECT * FROM A LIMIT 0;
 
         SELECT ts, dur, id_0, id_1
-        FROM _interval_intersect!((A, B), ())
+        FROM interval_intersect!((A, B), ())
         ORDER BY ts;
         """,
         out=Csv("""
@@ -249,7 +249,7 @@ class IntervalsIntersect(TestSuite):
         SELECT * FROM A LIMIT 0;
 
         SELECT ts, dur, id_0, id_1
-        FROM _interval_intersect!((B, A), ())
+        FROM interval_intersect!((B, A), ())
         ORDER BY ts;
         """,
         out=Csv("""
@@ -280,7 +280,7 @@ class IntervalsIntersect(TestSuite):
           SELECT * FROM data;
 
         SELECT ts, dur, id_0, id_1
-        FROM _interval_intersect!((A, B), ())
+        FROM interval_intersect!((A, B), ())
         ORDER BY ts;
         """,
         out=Csv("""
@@ -311,7 +311,7 @@ class IntervalsIntersect(TestSuite):
           SELECT * FROM data;
 
         SELECT ts, dur, id_0, id_1
-        FROM _interval_intersect!((B, A), ())
+        FROM interval_intersect!((B, A), ())
         ORDER BY ts;
         """,
         out=Csv("""
@@ -345,7 +345,7 @@ class IntervalsIntersect(TestSuite):
           SELECT * FROM data;
 
         SELECT *
-        FROM _interval_intersect_single!(1, 6, B)
+        FROM interval_intersect_single!(1, 6, B)
         ORDER BY ts;
         """,
         out=Csv("""
@@ -355,6 +355,34 @@ class IntervalsIntersect(TestSuite):
         2,6,1
         """))
 
+  def test_single_interval_overlapping_intervals(self):
+    return DiffTestBlueprint(
+        trace=TextProto(""),
+        # The intervals of B overlap each other and the first one ends after
+        # all the others.
+        query="""
+        INCLUDE PERFETTO MODULE intervals.intersect;
+
+        CREATE PERFETTO TABLE B AS
+          WITH data(id, ts, dur) AS (
+            VALUES
+            (0, 0, 100),
+            (1, 1, 1),
+            (2, 3, 1),
+            (3, 60, 10)
+          )
+          SELECT * FROM data;
+
+        SELECT *
+        FROM interval_intersect_single!(50, 15, B)
+        ORDER BY ts;
+        """,
+        out=Csv("""
+        "id","ts","dur"
+        0,50,15
+        3,60,5
+        """))
+
   def test_ii_wrong_partition(self):
     return DiffTestBlueprint(
         trace=TextProto(''),
@@ -371,7 +399,7 @@ class IntervalsIntersect(TestSuite):
         WITH x(id, ts, dur, c0) AS (VALUES(1, 5, 1, 3))
         SELECT * FROM x;
 
-        SELECT ts FROM _interval_intersect!((A, B), (c0));
+        SELECT ts FROM interval_intersect!((A, B), (c0));
         """,
         out=Csv("""
         "ts"
@@ -431,7 +459,7 @@ class IntervalsIntersect(TestSuite):
           count() AS c
         FROM (
           SELECT id_0, id_1, ts, dur, cpu, "ii" AS cat
-          FROM _interval_intersect!((big_foo, small_foo), (cpu))
+          FROM interval_intersect!((big_foo, small_foo), (cpu))
           UNION
           SELECT big_id AS id_0, small_id AS id_1, ts, dur, cpu, "sj" AS cat FROM sj_res
         )
@@ -496,7 +524,7 @@ class IntervalsIntersect(TestSuite):
           count() AS c
         FROM (
           SELECT id_0 AS left_id, id_1 AS right_id, ts, dur, "ii" AS cat
-          FROM _interval_intersect!((big_foo, small_foo), ())
+          FROM interval_intersect!((big_foo, small_foo), ())
           UNION
           SELECT big_id AS left_id, small_id AS right_id, ts, dur, "sj" AS cat FROM sj_res
         )
@@ -532,7 +560,7 @@ class IntervalsIntersect(TestSuite):
 
         WITH ii AS (
           SELECT *
-          FROM _interval_intersect!((trace_interval, non_overlapping), ())
+          FROM interval_intersect!((trace_interval, non_overlapping), ())
         )
         SELECT
           (SELECT count(*) FROM ii) AS ii_count,
@@ -559,7 +587,7 @@ class IntervalsIntersect(TestSuite):
 
         WITH ii AS (
           SELECT *
-          FROM _interval_intersect_single!(
+          FROM interval_intersect_single!(
             TRACE_START(),
             TRACE_DUR(),
             non_overlapping)
@@ -581,7 +609,7 @@ class IntervalsIntersect(TestSuite):
         query="""
         INCLUDE PERFETTO MODULE intervals.intersect;
 
-        SELECT * FROM _interval_intersect!(
+        SELECT * FROM interval_intersect!(
           ((SELECT id, ts, dur, utid, cpu FROM sched WHERE dur > 0 LIMIT 10),
           (SELECT id, ts, dur, utid, cpu FROM sched WHERE dur > 0 LIMIT 10)),
           (utid, cpu)
@@ -607,7 +635,7 @@ class IntervalsIntersect(TestSuite):
         query="""
         INCLUDE PERFETTO MODULE intervals.intersect;
 
-        SELECT * FROM _interval_intersect!(
+        SELECT * FROM interval_intersect!(
           ((SELECT id, ts, dur, utid, cpu FROM sched WHERE dur > 0 LIMIT 10),
           (SELECT id, ts, dur, utid, cpu FROM sched WHERE dur > 0 LIMIT 10)),
           (utid)
@@ -633,7 +661,7 @@ class IntervalsIntersect(TestSuite):
         query="""
         INCLUDE PERFETTO MODULE intervals.intersect;
 
-        SELECT * FROM _interval_intersect!(
+        SELECT * FROM interval_intersect!(
           (
             (SELECT id, ts, dur, utid, cpu FROM sched WHERE dur > 0 LIMIT 10),
             (SELECT id, ts, dur, utid, cpu FROM sched WHERE dur > 0 LIMIT 10),
@@ -662,7 +690,7 @@ class IntervalsIntersect(TestSuite):
         query="""
         INCLUDE PERFETTO MODULE intervals.intersect;
 
-        SELECT * FROM _interval_intersect!(
+        SELECT * FROM interval_intersect!(
           (
             (SELECT id, ts, dur, utid, cpu FROM sched WHERE dur > 0 LIMIT 10),
             (SELECT id, ts, dur, utid, cpu FROM sched WHERE dur > 0 LIMIT 10),
@@ -710,12 +738,12 @@ class IntervalsIntersect(TestSuite):
         SELECT
           ROW_NUMBER() OVER (ORDER BY ts) AS id,
           ts, dur, id_0 AS id_foo, id_1 AS id_bar
-        FROM _interval_intersect!((foo, bar), ())
+        FROM interval_intersect!((foo, bar), ())
         ORDER BY ts;
 
         CREATE PERFETTO TABLE ii_foo_bar_baz AS
         SELECT id_foo, id_bar, id_1 AS id_baz, ii.ts, ii.dur
-        FROM _interval_intersect!((ii_foo_and_bar, baz), ()) ii
+        FROM interval_intersect!((ii_foo_and_bar, baz), ()) ii
         JOIN ii_foo_and_bar ON ii_foo_and_bar.id = ii.id_0;
 
         WITH unioned AS (
@@ -723,7 +751,7 @@ class IntervalsIntersect(TestSuite):
             FROM ii_foo_bar_baz
             UNION
             SELECT id_0 AS id_foo, id_1 AS id_bar, id_2 AS id_baz, ts, dur, "triple" AS cat
-            FROM _interval_intersect!((foo, bar, baz), ())
+            FROM interval_intersect!((foo, bar, baz), ())
         ),
         counted AS (
           SELECT *, count() c FROM unioned GROUP BY ts, dur, id_foo, id_bar, id_baz
@@ -759,7 +787,7 @@ class IntervalsIntersect(TestSuite):
         WHERE dur > 0 AND cpu = 2
         ORDER BY ts;
 
-        SELECT * FROM _interval_intersect!((foo, bar, baz), ())
+        SELECT * FROM interval_intersect!((foo, bar, baz), ())
         ORDER BY ts
         LIMIT 10;
         """,
@@ -0,0 +1,80 @@
+#!/usr/bin/env python3
+# Copyright (C) 2024 The Android Open Source Project
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+# This tool checks that TraceStorage::GetAllMutableTables() lists every table
+# member of TraceStorage, in order of declaration. Snapshots only contain the
+# tables returned by that function so a missing table would silently be left
+# out of them.
+
+import os
+import re
+import sys
+from typing import List, Tuple
+
+ROOT_DIR = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+STORAGE_DIR = os.path.join(ROOT_DIR, 'src', 'trace_processor', 'storage')
+
+# Matches e.g. "tables::SliceTable slice_table_{&string_pool_};".
+MEMBER_PATTERN = re.compile(r'^\s*tables::(\w+)\s+(\w+_)\s*\{', re.MULTILINE)
+
+# Matches e.g. "{tables::SliceTable::Name(), &slice_table_}".
+ENTRY_PATTERN = re.compile(r'\{\s*tables::(\w+)::Name\(\),\s*&(\w+_)\s*\}')
+
+
+def get_members(header: str) -> List[Tuple[str, str]]:
+  return MEMBER_PATTERN.findall(header)
+
+
+def get_entries(source: str) -> List[Tuple[str, str]]:
+  start = source.find('TraceStorage::GetAllMutableTables()')
+  if start == -1:
+    return []
+  end = source.find('};', start)
+  return ENTRY_PATTERN.findall(source[start:end])
+
+
+def main():
+  with open(os.path.join(STORAGE_DIR, 'trace_storage.h')) as f:
+    members = get_members(f.read())
+  with open(os.path.join(STORAGE_DIR, 'trace_storage.cc')) as f:
+    entries = get_entries(f.read())
+
+  errors = []
+  if not members:
+    errors.append('No table found in trace_storage.h')
+  if not entries:
+    errors.append('No table found in TraceStorage::GetAllMutableTables()')
+  for table, name in members:
+    if (table, name) not in entries:
+      errors.append(f'{name} ({table}) is a member of TraceStorage but is '
+                    'missing from TraceStorage::GetAllMutableTables()')
+  for table, name in entries:
+    if (table, name) not in members:
+      errors.append(f'{name} ({table}) is listed in '
+                    'TraceStorage::GetAllMutableTables() but is not a '
+                    'member of TraceStorage')
+  if not errors and members != entries:
+    errors.append('TraceStorage::GetAllMutableTables() must list the tables '
+                  'in their order of declaration in trace_storage.h so that '
+                  'parents come before their children')
+
+  if errors:
+    sys.stderr.write('\n'.join(errors) + '\n')
+    return 1
+  return 0
+
+
+if __name__ == '__main__':
+  sys.exit(main())
@@ -129,7 +129,7 @@ class AndroidClientServer implements PerfettoPlugin {
                 order by ts desc
                 limit 1
               ) as enclosing_slice_name
-            from _interval_intersect!(
+            from interval_intersect!(
               (
                 select id, ts, dur
                 from __binder_for_slice_${sliceId}